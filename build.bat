@@ -68,6 +68,111 @@ if errorlevel 1 (
     exit /b 1
 )
 
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/mesh_cache.c -o src/mesh_cache.o
+if errorlevel 1 (
+    echo Error: Failed to compile mesh_cache.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/stl_stream.c -o src/stl_stream.o
+if errorlevel 1 (
+    echo Error: Failed to compile stl_stream.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/thread_pool.c -o src/thread_pool.o
+if errorlevel 1 (
+    echo Error: Failed to compile thread_pool.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/polygon_offset.c -o src/polygon_offset.o
+if errorlevel 1 (
+    echo Error: Failed to compile polygon_offset.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/infill.c -o src/infill.o
+if errorlevel 1 (
+    echo Error: Failed to compile infill.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/cell_grid.c -o src/cell_grid.o
+if errorlevel 1 (
+    echo Error: Failed to compile cell_grid.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/lightning.c -o src/lightning.o
+if errorlevel 1 (
+    echo Error: Failed to compile lightning.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/path_order.c -o src/path_order.o
+if errorlevel 1 (
+    echo Error: Failed to compile path_order.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/arc_fit.c -o src/arc_fit.o
+if errorlevel 1 (
+    echo Error: Failed to compile arc_fit.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/gcode_writer.c -o src/gcode_writer.o
+if errorlevel 1 (
+    echo Error: Failed to compile gcode_writer.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/gcode_pipeline.c -o src/gcode_pipeline.o
+if errorlevel 1 (
+    echo Error: Failed to compile gcode_pipeline.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/gcode_buffer.c -o src/gcode_buffer.o
+if errorlevel 1 (
+    echo Error: Failed to compile gcode_buffer.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/print_estimate.c -o src/print_estimate.o
+if errorlevel 1 (
+    echo Error: Failed to compile print_estimate.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/bgcode.c -o src/bgcode.o
+if errorlevel 1 (
+    echo Error: Failed to compile bgcode.c
+    pause
+    exit /b 1
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g -c src/thumbnail.c -o src/thumbnail.o
+if errorlevel 1 (
+    echo Error: Failed to compile thumbnail.c
+    pause
+    exit /b 1
+)
+
 gcc -Wall -Wextra -std=c99 -O2 -g -c src/main.c -o src/main.o
 if errorlevel 1 (
     echo Error: Failed to compile main.c
@@ -77,7 +182,7 @@ if errorlevel 1 (
 
 REM Link the executable
 echo Linking executable...
-gcc src/main.o src/stl_parser.o src/slicer.o src/path_generator.o src/bvh.o src/convex_decomposition.o src/topology_evaluator.o src/gpu_accelerator.o -o parametric_slicer.exe -lm
+gcc src/main.o src/stl_parser.o src/slicer.o src/path_generator.o src/bvh.o src/convex_decomposition.o src/topology_evaluator.o src/gpu_accelerator.o src/mesh_cache.o src/stl_stream.o src/thread_pool.o src/polygon_offset.o src/infill.o src/cell_grid.o src/lightning.o src/path_order.o src/arc_fit.o src/gcode_writer.o src/gcode_pipeline.o src/gcode_buffer.o src/print_estimate.o src/bgcode.o src/thumbnail.o -o parametric_slicer.exe -lm -lpthread
 if errorlevel 1 (
     echo Error: Failed to link executable
     pause
@@ -86,38 +191,94 @@ if errorlevel 1 (
 
 REM Build test program
 echo Building BVH test program...
-gcc -Wall -Wextra -std=c99 -O2 -g test_bvh.c src/stl_parser.o src/bvh.o -o test_bvh.exe -lm
+gcc -Wall -Wextra -std=c99 -O2 -g test_bvh.c src/stl_parser.o src/bvh.o -o test_bvh.exe -lm -lpthread
 if errorlevel 1 (
     echo Warning: Failed to build BVH test program
 ) else (
     echo BVH test program built successfully
 )
 
-gcc -Wall -Wextra -std=c99 -O2 -g test_convex.c src/stl_parser.o src/convex_decomposition.o -o test_convex.exe -lm
+gcc -Wall -Wextra -std=c99 -O2 -g test_convex.c src/stl_parser.o src/convex_decomposition.o -o test_convex.exe -lm -lpthread
 if errorlevel 1 (
     echo Warning: Failed to build convex decomposition test program
 ) else (
     echo Convex decomposition test program built successfully
 )
 
-gcc -Wall -Wextra -std=c99 -O2 -g test_topology.c src/stl_parser.o src/topology_evaluator.o -o test_topology.exe -lm
+gcc -Wall -Wextra -std=c99 -O2 -g test_topology.c src/stl_parser.o src/topology_evaluator.o -o test_topology.exe -lm -lpthread
 if errorlevel 1 (
     echo Warning: Failed to build topology test program
 ) else (
     echo Topology test program built successfully
 )
 
-gcc -Wall -Wextra -std=c99 -O2 -g test_gpu.c src/stl_parser.o src/topology_evaluator.o src/gpu_accelerator.o -o test_gpu.exe -lm
+gcc -Wall -Wextra -std=c99 -O2 -g test_gpu.c src/stl_parser.o src/topology_evaluator.o src/gpu_accelerator.o -o test_gpu.exe -lm -lpthread
 if errorlevel 1 (
     echo Warning: Failed to build GPU test program
 ) else (
     echo GPU test program built successfully
 )
 
+gcc -Wall -Wextra -std=c99 -O2 -g test_slicer.c src/stl_parser.o src/slicer.o src/stl_stream.o src/bvh.o src/convex_decomposition.o src/thread_pool.o src/polygon_offset.o src/infill.o src/cell_grid.o src/lightning.o -o test_slicer.exe -lm -lpthread
+if errorlevel 1 (
+    echo Warning: Failed to build slicer test program
+) else (
+    echo Slicer test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_polygon_offset.c src/polygon_offset.o -o test_polygon_offset.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build polygon offset test program
+) else (
+    echo Polygon offset test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_infill.c src/stl_parser.o src/slicer.o src/stl_stream.o src/bvh.o src/convex_decomposition.o src/thread_pool.o src/polygon_offset.o src/infill.o src/cell_grid.o src/lightning.o -o test_infill.exe -lm -lpthread
+if errorlevel 1 (
+    echo Warning: Failed to build infill test program
+) else (
+    echo Infill test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_path_order.c src/path_order.o src/cell_grid.o -o test_path_order.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build path order test program
+) else (
+    echo Path order test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_arc_fit.c src/arc_fit.o -o test_arc_fit.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build arc fit test program
+) else (
+    echo Arc fit test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_gcode_writer.c src/gcode_writer.o src/bgcode.o -o test_gcode_writer.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build G-code writer test program
+) else (
+    echo G-code writer test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_print_estimate.c src/print_estimate.o src/gcode_buffer.o -o test_print_estimate.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build print estimate test program
+) else (
+    echo Print estimate test program built successfully
+)
+
+gcc -Wall -Wextra -std=c99 -O2 -g test_bgcode.c src/bgcode.o -o test_bgcode.exe -lm
+if errorlevel 1 (
+    echo Warning: Failed to build binary G-code test program
+) else (
+    echo Binary G-code test program built successfully
+)
+
 echo.
 echo Build completed successfully!
 echo Executable: parametric_slicer.exe
-echo Test programs: test_bvh.exe, test_convex.exe, test_topology.exe, test_gpu.exe
+echo Test programs: test_bvh.exe, test_convex.exe, test_topology.exe, test_gpu.exe, test_slicer.exe, test_polygon_offset.exe, test_infill.exe, test_path_order.exe, test_arc_fit.exe, test_gcode_writer.exe, test_print_estimate.exe, test_bgcode.exe
 echo.
 echo Usage examples:
 echo   parametric_slicer.exe test_cube.stl
@@ -128,5 +289,13 @@ echo   test_bvh.exe test_cube.stl 4 6
 echo   test_convex.exe test_cube.stl 0 8 0.8 0.1
 echo   test_topology.exe test_cube.stl 5
 echo   test_gpu.exe test_cube.stl auto
+echo   test_slicer.exe test_cube.stl 0.2
+echo   test_polygon_offset.exe
+echo   test_infill.exe
+echo   test_path_order.exe
+echo   test_arc_fit.exe
+echo   test_gcode_writer.exe
+echo   test_print_estimate.exe
+echo   test_bgcode.exe
 echo.
 pause 
\ No newline at end of file
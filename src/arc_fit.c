@@ -0,0 +1,71 @@
+#include "arc_fit.h"
+#include <math.h>
+
+// Does the circle through points[first], the middle point and points[last] pass within
+// tolerance of every point and chord in between, turning one way? Fills arc if so.
+static int arc_fit_check(const point2d_t* points, int first, int last, float tolerance, arc_fit_t* arc) {
+    point2d_t a = points[first];
+    point2d_t b = points[(first + last) / 2];
+    point2d_t c = points[last];
+    
+    // Circumcentre, relative to a for precision
+    double bx = b.x - a.x, by = b.y - a.y;
+    double cx = c.x - a.x, cy = c.y - a.y;
+    double d = 2.0 * (bx * cy - by * cx);
+    if (fabs(d) < 1e-12) return 0; // Collinear
+    double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+    double ux = (cy * b2 - by * c2) / d;
+    double uy = (bx * c2 - cx * b2) / d;
+    double radius = sqrt(ux * ux + uy * uy);
+    if (radius > ARC_FIT_MAX_RADIUS) return 0;
+    
+    int clockwise = d < 0;
+    double sweep = 0.0;
+    double px = -ux, py = -uy; // a, relative to the centre
+    for (int i = first; i < last; i++) {
+        double qx = points[i + 1].x - a.x - ux, qy = points[i + 1].y - a.y - uy;
+        double cross = px * qy - py * qx;
+        if (clockwise ? cross >= 0.0 : cross <= 0.0) return 0;
+        sweep += fabs(atan2(cross, px * qx + py * qy));
+        
+        // Point off the circle, or chord bowing too far inside it
+        if (fabs(sqrt(qx * qx + qy * qy) - radius) > tolerance) return 0;
+        double half = 0.5 * sqrt((qx - px) * (qx - px) + (qy - py) * (qy - py));
+        if (half >= radius || radius - sqrt(radius * radius - half * half) > tolerance) return 0;
+        px = qx;
+        py = qy;
+    }
+    if (sweep > ARC_FIT_MAX_SWEEP) return 0;
+    
+    arc->center.x = (float)(a.x + ux);
+    arc->center.y = (float)(a.y + uy);
+    arc->radius = (float)radius;
+    arc->length = (float)(radius * sweep);
+    arc->clockwise = clockwise;
+    return 1;
+}
+
+int arc_fit(const point2d_t* points, int num_points, int first, float tolerance, arc_fit_t* arc) {
+    int good = first + ARC_FIT_MIN_SEGMENTS;
+    if (!points || tolerance <= 0 || good >= num_points) return first;
+    if (!arc_fit_check(points, first, good, tolerance, arc)) return first;
+    
+    // Double the run until it stops fitting, then binary search the boundary
+    int bad = num_points;
+    for (int step = ARC_FIT_MIN_SEGMENTS; good + step < num_points; step *= 2) {
+        if (!arc_fit_check(points, first, good + step, tolerance, arc)) {
+            bad = good + step;
+            break;
+        }
+        good += step;
+    }
+    while (bad - good > 1) {
+        int mid = good + (bad - good) / 2;
+        if (arc_fit_check(points, first, mid, tolerance, arc)) {
+            good = mid;
+        } else {
+            bad = mid;
+        }
+    }
+    return good;
+}
@@ -0,0 +1,34 @@
+#ifndef ARC_FIT_H
+#define ARC_FIT_H
+
+#include "slicer.h"
+
+// Arc fitting. Runs of path points that lie on one circle, within a tolerance, are
+// replaced by a single G2/G3 move. The circle passes through the first, middle and last
+// point of the run; every point and every chord between them must stay within the
+// tolerance of it.
+
+// Shortest run worth an arc, in segments
+#define ARC_FIT_MIN_SEGMENTS 3
+
+// Flatter runs stay straight moves; huge radii lose precision in firmware
+#define ARC_FIT_MAX_RADIUS 1000.0f
+
+// Largest angle one arc may sweep (radians); a full turn would end where it started
+#define ARC_FIT_MAX_SWEEP 6.0f
+
+// One fitted arc
+typedef struct {
+    point2d_t center;
+    float radius;
+    float length;       // Length along the arc (mm)
+    int clockwise;      // G2 when set, G3 otherwise
+} arc_fit_t;
+
+// Function declarations
+
+// Longest arc starting at points[first]; returns the index of its last point, or first
+// when fewer than ARC_FIT_MIN_SEGMENTS segments fit (arc is then left untouched)
+int arc_fit(const point2d_t* points, int num_points, int first, float tolerance, arc_fit_t* arc);
+
+#endif // ARC_FIT_H
@@ -0,0 +1,392 @@
+#include "bgcode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+// Block header: type, compression, uncompressed size, and the compressed size when there
+// is one
+#define BGCODE_HEADER_SIZE 8
+#define BGCODE_COMPRESSED_HEADER_SIZE 12
+#define BGCODE_CHECKSUM_SIZE 4
+
+// MeatPack: two 0xFF bytes announce a command byte
+#define MEATPACK_SIGNAL 0xFF
+#define MEATPACK_ENABLE_PACKING 251
+#define MEATPACK_DISABLE_PACKING 250
+#define MEATPACK_ENABLE_NO_SPACES 247
+#define MEATPACK_UNPACKED 0xF   // Nibble for a character sent as a whole byte after the pair
+
+// Shortest back-reference worth its 17 bits
+#define HEATSHRINK_MIN_MATCH 3
+
+// CRC32 (zlib polynomial), four bits at a time
+static const uint32_t crc32_nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t bgcode_crc32(uint32_t crc, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ crc32_nibbles[crc & 0xF];
+        crc = (crc >> 4) ^ crc32_nibbles[crc & 0xF];
+    }
+    return ~crc;
+}
+
+void bgcode_metadata_init(bgcode_metadata_t* metadata) {
+    memset(metadata, 0, sizeof(bgcode_metadata_t));
+}
+
+void bgcode_metadata_free(bgcode_metadata_t* metadata) {
+    if (!metadata) return;
+    
+    free(metadata->file.text);
+    free(metadata->printer.text);
+    free(metadata->print.text);
+    free(metadata->slicer.text);
+    for (int i = 0; i < metadata->num_thumbnails; i++) {
+        free(metadata->thumbnails[i].image);
+    }
+    bgcode_metadata_init(metadata);
+}
+
+int bgcode_ini_add(bgcode_ini_t* ini, const char* key, const char* format, ...) {
+    if (!ini || !key || !format) return -1;
+    
+    char value[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(value, sizeof(value), format, args);
+    va_end(args);
+    
+    size_t needed = strlen(key) + strlen(value) + 3; // '=', '\n' and the terminator
+    if (ini->length + needed > ini->capacity) {
+        size_t capacity = ini->capacity ? ini->capacity * 2 : 256;
+        while (capacity < ini->length + needed) capacity *= 2;
+        char* grown = realloc(ini->text, capacity);
+        if (!grown) return -1;
+        ini->text = grown;
+        ini->capacity = capacity;
+    }
+    ini->length += (size_t)sprintf(ini->text + ini->length, "%s=%s\n", key, value);
+    return 0;
+}
+
+int bgcode_metadata_add_thumbnail(bgcode_metadata_t* metadata, unsigned char* image, size_t size,
+                                  int width, int height) {
+    if (!metadata || !image || metadata->num_thumbnails >= BGCODE_MAX_THUMBNAILS) return -1;
+    
+    bgcode_thumbnail_t* thumbnail = &metadata->thumbnails[metadata->num_thumbnails++];
+    thumbnail->image = image;
+    thumbnail->size = size;
+    thumbnail->width = width;
+    thumbnail->height = height;
+    return 0;
+}
+
+bgcode_encoder_t* bgcode_encoder_create(void) {
+    bgcode_encoder_t* encoder = calloc(1, sizeof(bgcode_encoder_t));
+    if (!encoder) return NULL;
+    
+    encoder->head = malloc(((size_t)1 << BGCODE_HASH_BITS) * sizeof(int));
+    if (!encoder->head) {
+        free(encoder);
+        return NULL;
+    }
+    return encoder;
+}
+
+void bgcode_encoder_free(bgcode_encoder_t* encoder) {
+    if (!encoder) return;
+    
+    free(encoder->output);
+    free(encoder->packed);
+    free(encoder->head);
+    free(encoder->chain);
+    free(encoder);
+}
+
+// Room for count more bytes of output
+static int encoder_reserve(bgcode_encoder_t* encoder, size_t count) {
+    if (encoder->length + count <= encoder->capacity) return 0;
+    
+    size_t capacity = encoder->capacity ? encoder->capacity : 1 << 16;
+    while (capacity < encoder->length + count) capacity *= 2;
+    unsigned char* grown = realloc(encoder->output, capacity);
+    if (!grown) return -1;
+    encoder->output = grown;
+    encoder->capacity = capacity;
+    return 0;
+}
+
+// Little-endian fields
+static unsigned char* put_u16(unsigned char* out, unsigned int value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    return out + 2;
+}
+
+static unsigned char* put_u32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+    return out + 4;
+}
+
+// An uncompressed block; parameters are the encoding, or a thumbnail's format and size
+static int encode_block(bgcode_encoder_t* encoder, bgcode_block_type_t type, const unsigned int* params,
+                        int num_params, const void* data, size_t size) {
+    size_t total = BGCODE_HEADER_SIZE + 2 * num_params + size + BGCODE_CHECKSUM_SIZE;
+    if (size > UINT32_MAX || encoder_reserve(encoder, total) != 0) return -1;
+    
+    unsigned char* block = encoder->output + encoder->length;
+    unsigned char* out = put_u16(block, type);
+    out = put_u16(out, BGCODE_COMPRESSION_NONE);
+    out = put_u32(out, (uint32_t)size);
+    for (int i = 0; i < num_params; i++) out = put_u16(out, params[i]);
+    if (size > 0) memcpy(out, data, size);
+    out += size;
+    put_u32(out, bgcode_crc32(0, block, out - block));
+    encoder->length += total;
+    return 0;
+}
+
+int bgcode_encode_header(bgcode_encoder_t* encoder, const bgcode_metadata_t* metadata) {
+    if (!encoder || !metadata) return -1;
+    
+    encoder->length = 0;
+    if (encoder_reserve(encoder, 10) != 0) return -1;
+    memcpy(encoder->output, "GCDE", 4);
+    put_u32(encoder->output + 4, BGCODE_VERSION);
+    put_u16(encoder->output + 8, BGCODE_CHECKSUM_CRC32);
+    encoder->length = 10;
+    
+    unsigned int ini[1] = { BGCODE_ENCODING_INI };
+    if (metadata->file.length > 0 &&
+        encode_block(encoder, BGCODE_BLOCK_FILE_METADATA, ini, 1, metadata->file.text, metadata->file.length) != 0) {
+        return -1;
+    }
+    if (encode_block(encoder, BGCODE_BLOCK_PRINTER_METADATA, ini, 1, metadata->printer.text,
+                     metadata->printer.length) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < metadata->num_thumbnails; i++) {
+        const bgcode_thumbnail_t* thumbnail = &metadata->thumbnails[i];
+        unsigned int params[3] = { BGCODE_THUMBNAIL_QOI, (unsigned int)thumbnail->width,
+                                   (unsigned int)thumbnail->height };
+        if (encode_block(encoder, BGCODE_BLOCK_THUMBNAIL, params, 3, thumbnail->image, thumbnail->size) != 0) {
+            return -1;
+        }
+    }
+    if (encode_block(encoder, BGCODE_BLOCK_PRINT_METADATA, ini, 1, metadata->print.text,
+                     metadata->print.length) != 0 ||
+        encode_block(encoder, BGCODE_BLOCK_SLICER_METADATA, ini, 1, metadata->slicer.text,
+                     metadata->slicer.length) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Four-bit code, or MEATPACK_UNPACKED. With spaces left out, E takes the space's code.
+static unsigned int meatpack_code(unsigned char c) {
+    switch (c) {
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return c - '0';
+        case '.':  return 10;
+        case 'E':  return 11;
+        case '\n': return 12;
+        case 'G':  return 13;
+        case 'X':  return 14;
+        default:   return MEATPACK_UNPACKED;
+    }
+}
+
+static unsigned char* meatpack_command(unsigned char* out, unsigned char command) {
+    out[0] = MEATPACK_SIGNAL;
+    out[1] = MEATPACK_SIGNAL;
+    out[2] = command;
+    return out + 3;
+}
+
+// Two characters in one byte, first in the low nibble; either one that has no code
+// follows in full
+static unsigned char* meatpack_pair(unsigned char* out, unsigned char first, unsigned char second) {
+    unsigned int low = meatpack_code(first);
+    unsigned int high = meatpack_code(second);
+    *out++ = (unsigned char)(low | (high << 4));
+    if (low == MEATPACK_UNPACKED) *out++ = first;
+    if (high == MEATPACK_UNPACKED) *out++ = second;
+    return out;
+}
+
+// Pack whole lines. Pairs restart on every line, since firmware drops the character
+// paired after a newline. Moves lose their spaces; comment lines go as plain text with
+// packing off. Needs 4 * length + 16 bytes of room.
+static size_t meatpack(const char* text, size_t length, unsigned char* out) {
+    unsigned char* start = out;
+    out = meatpack_command(out, MEATPACK_ENABLE_PACKING);
+    out = meatpack_command(out, MEATPACK_ENABLE_NO_SPACES);
+    int packing = 1;
+    
+    size_t i = 0;
+    while (i < length) {
+        const char* line = text + i;
+        const char* newline = memchr(line, '\n', length - i);
+        size_t line_length = newline ? (size_t)(newline - line) : length - i;
+        i += line_length + 1;
+        
+        if (line_length > 0 && line[0] == ';') {
+            if (packing) out = meatpack_command(out, MEATPACK_DISABLE_PACKING);
+            packing = 0;
+            memcpy(out, line, line_length);
+            out += line_length;
+            *out++ = '\n';
+            continue;
+        }
+        if (!packing) out = meatpack_command(out, MEATPACK_ENABLE_PACKING);
+        packing = 1;
+        
+        int move = line_length >= 2 && line[0] == 'G' && line[1] >= '0' && line[1] <= '9';
+        int held = -1;
+        for (size_t k = 0; k <= line_length; k++) {
+            unsigned char c = k < line_length ? (unsigned char)line[k] : '\n';
+            if (move && c == ' ') continue;
+            if (held < 0) {
+                held = c;
+            } else {
+                out = meatpack_pair(out, (unsigned char)held, c);
+                held = -1;
+            }
+        }
+        if (held >= 0) out = meatpack_pair(out, (unsigned char)held, '\n');
+    }
+    return (size_t)(out - start);
+}
+
+// Bits go out most significant first
+typedef struct {
+    unsigned char* out;
+    uint32_t bits;
+    int count;
+} bit_writer_t;
+
+static void put_bits(bit_writer_t* writer, uint32_t value, int count) {
+    writer->bits = (writer->bits << count) | value;
+    writer->count += count;
+    while (writer->count >= 8) {
+        writer->count -= 8;
+        *writer->out++ = (unsigned char)(writer->bits >> writer->count);
+    }
+}
+
+static uint32_t hash3(const unsigned char* p) {
+    uint32_t key = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (key * 2654435761u) >> (32 - BGCODE_HASH_BITS);
+}
+
+// heatshrink stream: a 1 bit and a literal byte, or a 0 bit, distance - 1 and
+// length - 1. Greedy matching over hash chains. Needs length * 9 / 8 + 1 bytes of room.
+static size_t heatshrink(bgcode_encoder_t* encoder, const unsigned char* in, size_t length, unsigned char* out) {
+    const size_t window = (size_t)1 << BGCODE_WINDOW_BITS;
+    const size_t max_match = (size_t)1 << BGCODE_LOOKAHEAD_BITS;
+    int* head = encoder->head;
+    int* chain = encoder->chain;
+    memset(head, 0xFF, ((size_t)1 << BGCODE_HASH_BITS) * sizeof(int));
+    
+    bit_writer_t writer = { out, 0, 0 };
+    size_t i = 0;
+    while (i < length) {
+        size_t best = 0, distance = 0;
+        size_t limit = length - i < max_match ? length - i : max_match;
+        if (limit >= HEATSHRINK_MIN_MATCH) {
+            int candidate = head[hash3(in + i)];
+            for (int tries = 0; candidate >= 0 && i - (size_t)candidate <= window && tries < BGCODE_MAX_CHAIN; tries++) {
+                const unsigned char* match = in + candidate;
+                if (match[best] == in[i + best]) {
+                    size_t n = 0;
+                    while (n < limit && match[n] == in[i + n]) n++;
+                    if (n > best) {
+                        best = n;
+                        distance = i - (size_t)candidate;
+                        if (n == limit) break;
+                    }
+                }
+                candidate = chain[candidate];
+            }
+        }
+        
+        size_t step = 1;
+        if (best >= HEATSHRINK_MIN_MATCH) {
+            put_bits(&writer, (uint32_t)(distance - 1), 1 + BGCODE_WINDOW_BITS);
+            put_bits(&writer, (uint32_t)(best - 1), BGCODE_LOOKAHEAD_BITS);
+            step = best;
+        } else {
+            put_bits(&writer, 0x100 | in[i], 9);
+        }
+        for (size_t end = i + step; i < end; i++) {
+            if (i + HEATSHRINK_MIN_MATCH > length) continue;
+            uint32_t hash = hash3(in + i);
+            chain[i] = head[hash];
+            head[hash] = (int)i;
+        }
+    }
+    if (writer.count > 0) put_bits(&writer, 0, 8 - writer.count);
+    return (size_t)(writer.out - out);
+}
+
+int bgcode_encode_gcode(bgcode_encoder_t* encoder, const char* text, size_t length, int final, size_t* used) {
+    if (!encoder || !used) return -1;
+    
+    encoder->length = 0;
+    *used = 0;
+    
+    // Whole lines up to the block size; a longer line goes alone
+    size_t size = length < BGCODE_BLOCK_TEXT ? length : BGCODE_BLOCK_TEXT;
+    if (!final || size < length) {
+        while (size > 0 && text[size - 1] != '\n') size--;
+        if (size == 0) {
+            const char* newline = memchr(text, '\n', length);
+            if (newline) {
+                size = (size_t)(newline - text) + 1;
+            } else if (final) {
+                size = length;
+            }
+        }
+    }
+    if (size == 0) return 0;
+    
+    if (4 * size + 16 > encoder->packed_capacity) {
+        unsigned char* grown = realloc(encoder->packed, 4 * size + 16);
+        if (!grown) return -1;
+        encoder->packed = grown;
+        encoder->packed_capacity = 4 * size + 16;
+    }
+    size_t packed = meatpack(text, size, encoder->packed);
+    if (packed > encoder->chain_capacity) {
+        int* grown = realloc(encoder->chain, packed * sizeof(int));
+        if (!grown) return -1;
+        encoder->chain = grown;
+        encoder->chain_capacity = packed;
+    }
+    
+    size_t header = BGCODE_COMPRESSED_HEADER_SIZE + 2;
+    if (encoder_reserve(encoder, header + packed / 8 * 9 + 16 + BGCODE_CHECKSUM_SIZE) != 0) return -1;
+    unsigned char* block = encoder->output;
+    size_t compressed = heatshrink(encoder, encoder->packed, packed, block + header);
+    
+    unsigned char* out = put_u16(block, BGCODE_BLOCK_GCODE);
+    out = put_u16(out, BGCODE_COMPRESSION_HEATSHRINK_12_4);
+    out = put_u32(out, (uint32_t)packed);
+    out = put_u32(out, (uint32_t)compressed);
+    put_u16(out, BGCODE_ENCODING_MEATPACK_COMMENTS);
+    put_u32(block + header + compressed, bgcode_crc32(0, block, header + compressed));
+    encoder->length = header + compressed + BGCODE_CHECKSUM_SIZE;
+    *used = size;
+    return 0;
+}
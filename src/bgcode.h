@@ -0,0 +1,109 @@
+#ifndef BGCODE_H
+#define BGCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary G-code (.bgcode), the block format Prusa printers read. A 10-byte file header
+// is followed by blocks, each with a CRC32: file, printer, print and slicer metadata as
+// INI text, thumbnails, then the G-code itself. G-code blocks hold whole lines,
+// MeatPack-encoded (digits and the commonest letters in four bits) and then compressed
+// with heatshrink, an LZSS small enough for printer firmware to decode.
+
+#define BGCODE_VERSION 1
+
+// G-code text per block, at most; blocks end on a line end
+#define BGCODE_BLOCK_TEXT (64 << 10)
+
+// heatshrink 12/4: back-references reach 4096 bytes and copy up to 16
+#define BGCODE_WINDOW_BITS 12
+#define BGCODE_LOOKAHEAD_BITS 4
+
+// Match finder: hash of the next three bytes, and earlier positions tried per byte
+#define BGCODE_HASH_BITS 13
+#define BGCODE_MAX_CHAIN 8
+
+#define BGCODE_MAX_THUMBNAILS 4
+
+typedef enum {
+    BGCODE_BLOCK_FILE_METADATA = 0,
+    BGCODE_BLOCK_GCODE = 1,
+    BGCODE_BLOCK_SLICER_METADATA = 2,
+    BGCODE_BLOCK_PRINTER_METADATA = 3,
+    BGCODE_BLOCK_PRINT_METADATA = 4,
+    BGCODE_BLOCK_THUMBNAIL = 5
+} bgcode_block_type_t;
+
+typedef enum {
+    BGCODE_COMPRESSION_NONE = 0,
+    BGCODE_COMPRESSION_DEFLATE = 1,
+    BGCODE_COMPRESSION_HEATSHRINK_11_4 = 2,
+    BGCODE_COMPRESSION_HEATSHRINK_12_4 = 3
+} bgcode_compression_t;
+
+#define BGCODE_CHECKSUM_CRC32 1
+#define BGCODE_ENCODING_INI 0
+#define BGCODE_ENCODING_MEATPACK_COMMENTS 2 // MeatPack, with comment lines kept as text
+#define BGCODE_THUMBNAIL_QOI 2
+
+// Key=value lines of one metadata block
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+} bgcode_ini_t;
+
+typedef struct {
+    int width, height;
+    unsigned char* image;   // QOI file
+    size_t size;
+} bgcode_thumbnail_t;
+
+typedef struct {
+    bgcode_ini_t file;      // Producer
+    bgcode_ini_t printer;   // What the printer checks and shows before printing
+    bgcode_ini_t print;     // Estimates
+    bgcode_ini_t slicer;    // Settings the file was sliced with
+    bgcode_thumbnail_t thumbnails[BGCODE_MAX_THUMBNAILS];
+    int num_thumbnails;
+} bgcode_metadata_t;
+
+// Encoded bytes ready to write, and scratch space reused from block to block
+typedef struct {
+    unsigned char* output;
+    size_t length;
+    size_t capacity;
+    unsigned char* packed;  // MeatPack form of one block's text
+    size_t packed_capacity;
+    int* head;              // Latest position for each hash
+    int* chain;             // Previous position with the same hash, per position
+    size_t chain_capacity;
+} bgcode_encoder_t;
+
+// Function declarations
+uint32_t bgcode_crc32(uint32_t crc, const void* data, size_t length);
+
+void bgcode_metadata_init(bgcode_metadata_t* metadata);
+void bgcode_metadata_free(bgcode_metadata_t* metadata);
+
+// Append "key=value" with value formatted like printf; -1 when out of memory
+int bgcode_ini_add(bgcode_ini_t* ini, const char* key, const char* format, ...);
+
+// Keep a QOI image (freed along with metadata); -1 when there is no room
+int bgcode_metadata_add_thumbnail(bgcode_metadata_t* metadata, unsigned char* image, size_t size,
+                                  int width, int height);
+
+bgcode_encoder_t* bgcode_encoder_create(void);
+void bgcode_encoder_free(bgcode_encoder_t* encoder);
+
+// Each call replaces encoder->output; -1 when out of memory
+
+// File header, then the metadata and thumbnail blocks in the order the format requires
+int bgcode_encode_header(bgcode_encoder_t* encoder, const bgcode_metadata_t* metadata);
+
+// One G-code block from the start of text: the whole lines that fit in BGCODE_BLOCK_TEXT,
+// or the rest of the text when final. used gets the bytes taken, 0 when no whole line
+// is there yet.
+int bgcode_encode_gcode(bgcode_encoder_t* encoder, const char* text, size_t length, int final, size_t* used);
+
+#endif // BGCODE_H
@@ -10,6 +10,34 @@ typedef struct {
     sort_axis_t sort_axis;
 } sort_context_t;
 
+// What the builder reads about a triangle at every level. Items move with their
+// triangle as ranges are partitioned, so each node's triangles stay contiguous.
+typedef struct {
+    float bounds[6];
+    float centroid[3];
+    unsigned int index;
+} bvh_build_item_t;
+
+typedef struct {
+    const stl_file_t* stl;
+    bvh_build_item_t* items;
+    unsigned int max_depth;
+    unsigned int max_triangles_per_leaf;
+    unsigned int num_nodes;     // Nodes made so far
+    unsigned int depth_reached;
+} bvh_builder_t;
+
+// Triangles whose centroids fall in one slice of a node's centroid bounds
+typedef struct {
+    float bounds[6];
+    unsigned int count;
+} bvh_bin_t;
+
+static bvh_node_t* bvh_build(const stl_file_t* stl, const unsigned int* triangle_indices,
+                             unsigned int num_triangles, unsigned int depth, unsigned int max_depth,
+                             unsigned int max_triangles_per_leaf, unsigned int* num_nodes,
+                             unsigned int* depth_reached);
+
 bvh_tree_t* bvh_create(const stl_file_t* stl, unsigned int max_triangles_per_leaf) {
     if (!stl || stl->num_triangles == 0) return NULL;
     
@@ -20,21 +48,9 @@ bvh_tree_t* bvh_create(const stl_file_t* stl, unsigned int max_triangles_per_lea
     bvh->num_nodes = 0;
     bvh->max_depth = 0;
     
-    // Create array of triangle indices
-    unsigned int* triangle_indices = malloc(stl->num_triangles * sizeof(unsigned int));
-    if (!triangle_indices) {
-        free(bvh);
-        return NULL;
-    }
-    
-    for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        triangle_indices[i] = i;
-    }
-    
-    // Build BVH tree recursively (default to SORT_XYZ for balanced tree)
-    bvh->root = bvh_build_recursive(stl, triangle_indices, stl->num_triangles, 0, 20, max_triangles_per_leaf, SORT_XYZ);
-    
-    free(triangle_indices);
+    // Build over every triangle in file order
+    bvh->root = bvh_build(stl, NULL, stl->num_triangles, 0, BVH_MAX_BUILD_DEPTH, max_triangles_per_leaf,
+                          &bvh->num_nodes, &bvh->max_depth);
     
     if (!bvh->root) {
         free(bvh);
@@ -68,67 +84,203 @@ void bvh_free_node(bvh_node_t* node) {
     free(node);
 }
 
-bvh_node_t* bvh_build_recursive(const stl_file_t* stl, unsigned int* triangle_indices, 
-                                unsigned int num_triangles, unsigned int depth, 
-                                unsigned int max_depth, unsigned int max_triangles_per_leaf,
-                                sort_axis_t sort_axis) {
-    if (!stl || !triangle_indices || num_triangles == 0) return NULL;
+// Bin of a centroid along one axis; the same in the binning and partitioning passes
+static unsigned int bvh_bin_index(float centroid, float min, float scale) {
+    int bin = (int)((centroid - min) * scale);
+    if (bin < 0) return 0;
+    if (bin >= BVH_SAH_BINS) return BVH_SAH_BINS - 1;
+    return (unsigned int)bin;
+}
+
+static void bvh_bounds_clear(float bounds[6]) {
+    bounds[0] = bounds[1] = bounds[2] = FLT_MAX;
+    bounds[3] = bounds[4] = bounds[5] = -FLT_MAX;
+}
+
+// Selects rather than branches: the order triangles arrive in is anything but predictable
+static void bvh_bounds_grow(float bounds[6], const float other[6]) {
+    for (int k = 0; k < 3; k++) {
+        bounds[k] = other[k] < bounds[k] ? other[k] : bounds[k];
+        bounds[k + 3] = other[k + 3] > bounds[k + 3] ? other[k + 3] : bounds[k + 3];
+    }
+}
+
+// Split items so the cheaper side by the surface area heuristic comes first: a side costs
+// its surface area times its triangle count, the chance a query reaching the node enters
+// it times the work done there. Centroids are binned on all three axes in one pass and
+// every bin boundary is priced. Returns the size of the first side, or count / 2 when all
+// centroids coincide.
+static unsigned int bvh_partition_sah(bvh_build_item_t* items, unsigned int count) {
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (unsigned int i = 0; i < count; i++) {
+        for (int k = 0; k < 3; k++) {
+            if (items[i].centroid[k] < min[k]) min[k] = items[i].centroid[k];
+            if (items[i].centroid[k] > max[k]) max[k] = items[i].centroid[k];
+        }
+    }
     
+    float scale[3];
+    bvh_bin_t bins[3][BVH_SAH_BINS];
+    for (int k = 0; k < 3; k++) {
+        scale[k] = max[k] > min[k] ? BVH_SAH_BINS / (max[k] - min[k]) : 0.0f;
+        for (int b = 0; b < BVH_SAH_BINS; b++) {
+            bvh_bounds_clear(bins[k][b].bounds);
+            bins[k][b].count = 0;
+        }
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        for (int k = 0; k < 3; k++) {
+            if (scale[k] == 0.0f) continue;
+            bvh_bin_t* bin = &bins[k][bvh_bin_index(items[i].centroid[k], min[k], scale[k])];
+            bvh_bounds_grow(bin->bounds, items[i].bounds);
+            bin->count++;
+        }
+    }
+    
+    int best_axis = -1;
+    unsigned int best_bin = 0;
+    float best_cost = FLT_MAX;
+    for (int k = 0; k < 3; k++) {
+        if (scale[k] == 0.0f) continue;
+        
+        // Cost of everything above each boundary, then sweep up from the bottom
+        float above_cost[BVH_SAH_BINS];
+        float bounds[6];
+        unsigned int above = 0;
+        bvh_bounds_clear(bounds);
+        for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+            above += bins[k][b].count;
+            if (bins[k][b].count > 0) bvh_bounds_grow(bounds, bins[k][b].bounds);
+            above_cost[b] = above > 0 ? bvh_calculate_surface_area(bounds) * above : 0.0f;
+        }
+        
+        unsigned int below = 0;
+        bvh_bounds_clear(bounds);
+        for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+            below += bins[k][b].count;
+            if (bins[k][b].count > 0) bvh_bounds_grow(bounds, bins[k][b].bounds);
+            if (below == 0 || below == count) continue;
+            
+            float cost = bvh_calculate_surface_area(bounds) * below + above_cost[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = k;
+                best_bin = (unsigned int)b;
+            }
+        }
+    }
+    if (best_axis < 0) return count / 2;
+    
+    // Partition in place: items in bins up to best_bin go first
+    unsigned int i = 0, j = count;
+    while (i < j) {
+        if (bvh_bin_index(items[i].centroid[best_axis], min[best_axis], scale[best_axis]) <= best_bin) {
+            i++;
+        } else {
+            bvh_build_item_t swap = items[i];
+            items[i] = items[--j];
+            items[j] = swap;
+        }
+    }
+    return i;
+}
+
+static bvh_node_t* bvh_build_node(bvh_builder_t* builder, unsigned int first, unsigned int count,
+                                  unsigned int depth) {
     bvh_node_t* node = malloc(sizeof(bvh_node_t));
     if (!node) return NULL;
+    builder->num_nodes++;
+    if (depth > builder->depth_reached) builder->depth_reached = depth;
     
-    // Determine sort axis based on depth (cycle through X, Y, Z for better balance)
-    sort_axis_t current_axis = (sort_axis_t)(depth % 3);
+    bvh_build_item_t* items = builder->items + first;
+    unsigned int split = 0;
+    if (count > builder->max_triangles_per_leaf && depth < builder->max_depth) {
+        split = bvh_partition_sah(items, count);
+    }
     
-    // If we have few triangles or reached max depth, create leaf node
-    if (num_triangles <= max_triangles_per_leaf || depth >= max_depth) {
+    if (split == 0) {
         node->type = BVH_LEAF;
-        node->data.leaf.num_triangles = num_triangles;
-        node->data.leaf.triangle_indices = malloc(num_triangles * sizeof(unsigned int));
-        
+        node->data.leaf.num_triangles = count;
+        node->data.leaf.triangle_indices = malloc(count * sizeof(unsigned int));
         if (!node->data.leaf.triangle_indices) {
             free(node);
             return NULL;
         }
-        
-        // Copy triangle indices
-        memcpy(node->data.leaf.triangle_indices, triangle_indices, num_triangles * sizeof(unsigned int));
-        
-        // Calculate bounds for this leaf
-        bvh_calculate_bounds(node, stl);
-        
+        bvh_bounds_clear(node->bounds);
+        for (unsigned int i = 0; i < count; i++) {
+            node->data.leaf.triangle_indices[i] = items[i].index;
+            bvh_bounds_grow(node->bounds, items[i].bounds);
+        }
         return node;
     }
     
-    // Sort triangles by current axis
-    bvh_sort_triangles_by_axis(triangle_indices, num_triangles, stl, current_axis);
-    
-    // Split triangles into two groups
-    unsigned int mid = num_triangles / 2;
-    
-    // Create internal node
     node->type = BVH_INTERNAL;
-    
-    // Recursively build left and right children
-    node->data.internal.left = bvh_build_recursive(stl, triangle_indices, mid, depth + 1, 
-                                                  max_depth, max_triangles_per_leaf, sort_axis);
-    node->data.internal.right = bvh_build_recursive(stl, triangle_indices + mid, num_triangles - mid, 
-                                                   depth + 1, max_depth, max_triangles_per_leaf, sort_axis);
-    
+    node->data.internal.left = bvh_build_node(builder, first, split, depth + 1);
+    node->data.internal.right = node->data.internal.left ?
+                                bvh_build_node(builder, first + split, count - split, depth + 1) : NULL;
     if (!node->data.internal.left || !node->data.internal.right) {
         // Cleanup on failure
         if (node->data.internal.left) bvh_free_node(node->data.internal.left);
-        if (node->data.internal.right) bvh_free_node(node->data.internal.right);
         free(node);
         return NULL;
     }
     
     // Calculate bounds for this internal node
-    bvh_calculate_bounds(node, stl);
+    bvh_calculate_bounds(node, builder->stl);
     
     return node;
 }
 
+// Gather bounds and centroids once (from the SoA view when there is one), then build.
+// triangle_indices NULL means every triangle in order.
+static bvh_node_t* bvh_build(const stl_file_t* stl, const unsigned int* triangle_indices,
+                             unsigned int num_triangles, unsigned int depth, unsigned int max_depth,
+                             unsigned int max_triangles_per_leaf, unsigned int* num_nodes,
+                             unsigned int* depth_reached) {
+    bvh_builder_t builder = { stl, NULL, max_depth, max_triangles_per_leaf, 0, depth };
+    builder.items = malloc((size_t)num_triangles * sizeof(bvh_build_item_t));
+    if (!builder.items) return NULL;
+    
+    for (unsigned int i = 0; i < num_triangles; i++) {
+        bvh_build_item_t* item = &builder.items[i];
+        item->index = triangle_indices ? triangle_indices[i] : i;
+        
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, item->index, &triangle);
+        bvh_bounds_clear(item->bounds);
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) {
+                float val = triangle.vertices[j][k];
+                if (val < item->bounds[k]) item->bounds[k] = val;
+                if (val > item->bounds[k + 3]) item->bounds[k + 3] = val;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            item->centroid[k] = stl->soa ? bvh_get_center_coordinate_soa(stl->soa, item->index, (sort_axis_t)k)
+                                         : bvh_get_center_coordinate(&triangle, (sort_axis_t)k);
+        }
+    }
+    
+    bvh_node_t* root = bvh_build_node(&builder, 0, num_triangles, depth);
+    free(builder.items);
+    if (num_nodes) *num_nodes = builder.num_nodes;
+    if (depth_reached) *depth_reached = builder.depth_reached;
+    return root;
+}
+
+bvh_node_t* bvh_build_recursive(const stl_file_t* stl, unsigned int* triangle_indices, 
+                                unsigned int num_triangles, unsigned int depth, 
+                                unsigned int max_depth, unsigned int max_triangles_per_leaf,
+                                sort_axis_t sort_axis) {
+    if (!stl || !triangle_indices || num_triangles == 0) return NULL;
+    
+    // The surface area heuristic picks the split axis; sort_axis is not needed
+    (void)sort_axis;
+    return bvh_build(stl, triangle_indices, num_triangles, depth, max_depth, max_triangles_per_leaf,
+                     NULL, NULL);
+}
+
 void bvh_calculate_bounds(bvh_node_t* node, const stl_file_t* stl) {
     if (!node || !stl) return;
     
@@ -136,20 +288,17 @@ void bvh_calculate_bounds(bvh_node_t* node, const stl_file_t* stl) {
         // Calculate bounds from triangles in this leaf
         if (node->data.leaf.num_triangles == 0) return;
         
-        // Initialize bounds with first triangle
-        unsigned int first_triangle_idx = node->data.leaf.triangle_indices[0];
-        const stl_triangle_t* first_triangle = &stl->triangles[first_triangle_idx];
-        
         node->bounds[0] = node->bounds[1] = node->bounds[2] = FLT_MAX;  // min
         node->bounds[3] = node->bounds[4] = node->bounds[5] = -FLT_MAX; // max
         
         for (unsigned int i = 0; i < node->data.leaf.num_triangles; i++) {
             unsigned int triangle_idx = node->data.leaf.triangle_indices[i];
-            const stl_triangle_t* triangle = &stl->triangles[triangle_idx];
+            stl_triangle_t triangle;
+            stl_get_triangle(stl, triangle_idx, &triangle);
             
             for (int j = 0; j < 3; j++) {
                 for (int k = 0; k < 3; k++) {
-                    float val = triangle->vertices[j][k];
+                    float val = triangle.vertices[j][k];
                     if (val < node->bounds[k]) node->bounds[k] = val;     // min
                     if (val > node->bounds[k+3]) node->bounds[k+3] = val; // max
                 }
@@ -207,31 +356,203 @@ float bvh_get_center_coordinate(const stl_triangle_t* triangle, sort_axis_t axis
     }
 }
 
+float bvh_get_center_coordinate_soa(const stl_soa_t* soa, unsigned int index, sort_axis_t axis) {
+    if (!soa || index >= soa->num_triangles) return 0.0f;
+    
+    // Centroids are precomputed when the SoA view is built
+    switch (axis) {
+        case SORT_X: return soa->centroid[0][index];
+        case SORT_Y: return soa->centroid[1][index];
+        case SORT_Z: return soa->centroid[2][index];
+        default: return soa->centroid[0][index]; // Default to X
+    }
+}
+
 int bvh_compare_triangles(const void* a, const void* b, void* arg) {
     sort_context_t* context = (sort_context_t*)arg;
     unsigned int idx_a = *(unsigned int*)a;
     unsigned int idx_b = *(unsigned int*)b;
     
-    const stl_triangle_t* triangle_a = &context->stl->triangles[idx_a];
-    const stl_triangle_t* triangle_b = &context->stl->triangles[idx_b];
+    if (context->stl->soa) {
+        float coord_a = bvh_get_center_coordinate_soa(context->stl->soa, idx_a, context->sort_axis);
+        float coord_b = bvh_get_center_coordinate_soa(context->stl->soa, idx_b, context->sort_axis);
+        
+        if (coord_a < coord_b) return -1;
+        if (coord_a > coord_b) return 1;
+        return 0;
+    }
+    
+    stl_triangle_t triangle_a;
+    stl_get_triangle(context->stl, idx_a, &triangle_a);
+    stl_triangle_t triangle_b;
+    stl_get_triangle(context->stl, idx_b, &triangle_b);
     
-    float coord_a = bvh_get_center_coordinate(triangle_a, context->sort_axis);
-    float coord_b = bvh_get_center_coordinate(triangle_b, context->sort_axis);
+    float coord_a = bvh_get_center_coordinate(&triangle_a, context->sort_axis);
+    float coord_b = bvh_get_center_coordinate(&triangle_b, context->sort_axis);
     
     if (coord_a < coord_b) return -1;
     if (coord_a > coord_b) return 1;
     return 0;
 }
 
+// Serialization
+static void bvh_count_nodes(const bvh_node_t* node, unsigned int* num_nodes, unsigned int* num_leaf_indices) {
+    if (!node) return;
+    
+    (*num_nodes)++;
+    if (node->type == BVH_LEAF) {
+        *num_leaf_indices += node->data.leaf.num_triangles;
+    } else {
+        bvh_count_nodes(node->data.internal.left, num_nodes, num_leaf_indices);
+        bvh_count_nodes(node->data.internal.right, num_nodes, num_leaf_indices);
+    }
+}
+
+static uint32_t bvh_pack_node(const bvh_node_t* node, bvh_packed_node_t* nodes, unsigned int* next_node,
+                              uint32_t* leaf_indices, unsigned int* next_index) {
+    uint32_t slot = (*next_node)++;
+    bvh_packed_node_t* packed = &nodes[slot];
+    memcpy(packed->bounds, node->bounds, 6 * sizeof(float));
+    packed->type = (uint32_t)node->type;
+    
+    if (node->type == BVH_LEAF) {
+        packed->first = *next_index;
+        packed->count = node->data.leaf.num_triangles;
+        memcpy(leaf_indices + *next_index, node->data.leaf.triangle_indices,
+               node->data.leaf.num_triangles * sizeof(uint32_t));
+        *next_index += node->data.leaf.num_triangles;
+    } else {
+        // Children are packed after their parent, so indices always increase
+        packed->first = bvh_pack_node(node->data.internal.left, nodes, next_node, leaf_indices, next_index);
+        packed->count = bvh_pack_node(node->data.internal.right, nodes, next_node, leaf_indices, next_index);
+    }
+    
+    return slot;
+}
+
+int bvh_serialize(const bvh_tree_t* bvh, bvh_packed_node_t** nodes, unsigned int* num_nodes,
+                  uint32_t** leaf_indices, unsigned int* num_leaf_indices) {
+    if (!bvh || !bvh->root || !nodes || !num_nodes || !leaf_indices || !num_leaf_indices) return -1;
+    
+    unsigned int node_count = 0, index_count = 0;
+    bvh_count_nodes(bvh->root, &node_count, &index_count);
+    
+    bvh_packed_node_t* packed = malloc(node_count * sizeof(bvh_packed_node_t));
+    uint32_t* indices = malloc((index_count ? index_count : 1) * sizeof(uint32_t));
+    if (!packed || !indices) {
+        free(packed);
+        free(indices);
+        return -1;
+    }
+    
+    unsigned int next_node = 0, next_index = 0;
+    bvh_pack_node(bvh->root, packed, &next_node, indices, &next_index);
+    
+    *nodes = packed;
+    *num_nodes = node_count;
+    *leaf_indices = indices;
+    *num_leaf_indices = index_count;
+    return 0;
+}
+
+static bvh_node_t* bvh_unpack_node(const bvh_packed_node_t* nodes, unsigned int num_nodes, uint32_t slot,
+                                   const uint32_t* leaf_indices, unsigned int num_leaf_indices,
+                                   unsigned int num_triangles, unsigned int depth, unsigned int* max_depth) {
+    if (slot >= num_nodes || depth > BVH_MAX_SERIALIZED_DEPTH) return NULL;
+    
+    const bvh_packed_node_t* packed = &nodes[slot];
+    bvh_node_t* node = calloc(1, sizeof(bvh_node_t));
+    if (!node) return NULL;
+    memcpy(node->bounds, packed->bounds, 6 * sizeof(float));
+    if (depth > *max_depth) *max_depth = depth;
+    
+    if (packed->type == BVH_LEAF) {
+        // Reject leaf ranges and triangle indices outside the arrays
+        if (packed->count == 0 || packed->first > num_leaf_indices ||
+            packed->count > num_leaf_indices - packed->first) {
+            free(node);
+            return NULL;
+        }
+        node->type = BVH_LEAF;
+        node->data.leaf.num_triangles = packed->count;
+        node->data.leaf.triangle_indices = malloc(packed->count * sizeof(unsigned int));
+        if (!node->data.leaf.triangle_indices) {
+            free(node);
+            return NULL;
+        }
+        for (uint32_t i = 0; i < packed->count; i++) {
+            uint32_t triangle_idx = leaf_indices[packed->first + i];
+            if (triangle_idx >= num_triangles) {
+                bvh_free_node(node);
+                return NULL;
+            }
+            node->data.leaf.triangle_indices[i] = triangle_idx;
+        }
+        return node;
+    }
+    
+    if (packed->type != BVH_INTERNAL || packed->first <= slot || packed->count <= slot) {
+        free(node);
+        return NULL;
+    }
+    
+    node->type = BVH_INTERNAL;
+    node->data.internal.left = bvh_unpack_node(nodes, num_nodes, packed->first, leaf_indices,
+                                               num_leaf_indices, num_triangles, depth + 1, max_depth);
+    node->data.internal.right = bvh_unpack_node(nodes, num_nodes, packed->count, leaf_indices,
+                                                num_leaf_indices, num_triangles, depth + 1, max_depth);
+    if (!node->data.internal.left || !node->data.internal.right) {
+        bvh_free_node(node);
+        return NULL;
+    }
+    
+    return node;
+}
+
+bvh_tree_t* bvh_deserialize(const bvh_packed_node_t* nodes, unsigned int num_nodes,
+                            const uint32_t* leaf_indices, unsigned int num_leaf_indices,
+                            unsigned int num_triangles, unsigned int max_triangles_per_leaf) {
+    if (!nodes || num_nodes == 0 || !leaf_indices) return NULL;
+    
+    bvh_tree_t* bvh = malloc(sizeof(bvh_tree_t));
+    if (!bvh) return NULL;
+    
+    bvh->num_nodes = num_nodes;
+    bvh->max_depth = 0;
+    bvh->max_triangles_per_leaf = max_triangles_per_leaf;
+    bvh->root = bvh_unpack_node(nodes, num_nodes, 0, leaf_indices, num_leaf_indices,
+                                num_triangles, 0, &bvh->max_depth);
+    if (!bvh->root) {
+        fprintf(stderr, "Error: Serialized BVH is corrupt\n");
+        free(bvh);
+        return NULL;
+    }
+    
+    return bvh;
+}
+
 // Spatial partitioning functions
 spatial_partition_t* spatial_partition_create(const stl_file_t* stl, unsigned int num_partitions,
                                              sort_axis_t sort_axis) {
-    if (!stl || num_partitions == 0) return NULL;
+    return spatial_partition_create_with_bvh(stl, num_partitions, sort_axis, NULL);
+}
+
+spatial_partition_t* spatial_partition_create_with_bvh(const stl_file_t* stl, unsigned int num_partitions,
+                                                      sort_axis_t sort_axis, bvh_tree_t* bvh) {
+    // Takes ownership of bvh (e.g. one loaded from the mesh cache), even on failure
+    if (!stl || num_partitions == 0) {
+        bvh_free(bvh);
+        return NULL;
+    }
     
     spatial_partition_t* partition = malloc(sizeof(spatial_partition_t));
-    if (!partition) return NULL;
+    if (!partition) {
+        bvh_free(bvh);
+        return NULL;
+    }
     
     partition->num_partitions = num_partitions;
+    partition->bvh = bvh;
     partition->partition_ids = malloc(stl->num_triangles * sizeof(unsigned int));
     partition->partition_bounds = malloc(num_partitions * 6 * sizeof(float));
     
@@ -241,7 +562,9 @@ spatial_partition_t* spatial_partition_create(const stl_file_t* stl, unsigned in
     }
     
     // Create BVH for efficient spatial queries
-    partition->bvh = bvh_create(stl, 10);
+    if (!partition->bvh) {
+        partition->bvh = bvh_create(stl, BVH_DEFAULT_LEAF_SIZE);
+    }
     if (!partition->bvh) {
         spatial_partition_free(partition);
         return NULL;
@@ -263,8 +586,9 @@ spatial_partition_t* spatial_partition_create(const stl_file_t* stl, unsigned in
     
     // Assign triangles to partitions
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        const stl_triangle_t* triangle = &stl->triangles[i];
-        float center_x = (triangle->vertices[0][0] + triangle->vertices[1][0] + triangle->vertices[2][0]) / 3.0f;
+        stl_triangle_t triangle;
+        stl_get_triangle(stl, i, &triangle);
+        float center_x = (triangle.vertices[0][0] + triangle.vertices[1][0] + triangle.vertices[2][0]) / 3.0f;
         
         // Find which partition this triangle belongs to
         unsigned int partition_id = 0;
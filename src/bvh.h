@@ -4,6 +4,11 @@
 #include "stl_parser.h"
 #include <stdint.h>
 
+#define BVH_DEFAULT_LEAF_SIZE 10        // Triangles per leaf for spatial partitions
+#define BVH_SAH_BINS 16                 // Split candidates per axis, as centroid bins
+#define BVH_MAX_BUILD_DEPTH 40          // Deepest node bvh_create makes; SAH trees are not balanced
+#define BVH_MAX_SERIALIZED_DEPTH 64     // Deepest tree accepted by bvh_deserialize
+
 // BVH node types
 typedef enum {
     BVH_LEAF,    // Leaf node containing triangles
@@ -36,6 +41,14 @@ typedef struct {
     unsigned int max_triangles_per_leaf;
 } bvh_tree_t;
 
+// Flattened BVH node used for serialization (children and leaves referenced by index)
+typedef struct {
+    float bounds[6];    // [min_x, min_y, min_z, max_x, max_y, max_z]
+    uint32_t type;      // bvh_node_type_t
+    uint32_t first;     // Left child node index, or offset into the leaf index array
+    uint32_t count;     // Right child node index, or number of triangles in the leaf
+} bvh_packed_node_t;
+
 // Spatial partition structure
 typedef struct {
     bvh_tree_t* bvh;
@@ -59,6 +72,7 @@ typedef enum {
 bvh_tree_t* bvh_create(const stl_file_t* stl, unsigned int max_triangles_per_leaf);
 void bvh_free(bvh_tree_t* bvh);
 void bvh_free_node(bvh_node_t* node);
+// Binned surface area heuristic build over the given triangles (left unchanged)
 bvh_node_t* bvh_build_recursive(const stl_file_t* stl, unsigned int* triangle_indices, 
                                 unsigned int num_triangles, unsigned int depth, 
                                 unsigned int max_depth, unsigned int max_triangles_per_leaf,
@@ -67,11 +81,21 @@ void bvh_calculate_bounds(bvh_node_t* node, const stl_file_t* stl);
 void bvh_sort_triangles_by_axis(unsigned int* triangle_indices, unsigned int num_triangles,
                                 const stl_file_t* stl, sort_axis_t sort_axis);
 float bvh_get_center_coordinate(const stl_triangle_t* triangle, sort_axis_t axis);
+float bvh_get_center_coordinate_soa(const stl_soa_t* soa, unsigned int index, sort_axis_t axis);
 int bvh_compare_triangles(const void* a, const void* b, void* arg);
 
+// Serialization to flat node and leaf-index arrays (pre-order, root at index 0)
+int bvh_serialize(const bvh_tree_t* bvh, bvh_packed_node_t** nodes, unsigned int* num_nodes,
+                  uint32_t** leaf_indices, unsigned int* num_leaf_indices);
+bvh_tree_t* bvh_deserialize(const bvh_packed_node_t* nodes, unsigned int num_nodes,
+                            const uint32_t* leaf_indices, unsigned int num_leaf_indices,
+                            unsigned int num_triangles, unsigned int max_triangles_per_leaf);
+
 // Spatial partitioning functions
 spatial_partition_t* spatial_partition_create(const stl_file_t* stl, unsigned int num_partitions,
                                              sort_axis_t sort_axis);
+spatial_partition_t* spatial_partition_create_with_bvh(const stl_file_t* stl, unsigned int num_partitions,
+                                                      sort_axis_t sort_axis, bvh_tree_t* bvh);
 void spatial_partition_free(spatial_partition_t* partition);
 unsigned int* spatial_partition_get_triangles_in_region(const spatial_partition_t* partition,
                                                         float bounds[6], unsigned int* num_triangles);
@@ -0,0 +1,36 @@
+#include "cell_grid.h"
+#include <float.h>
+
+// Cell holding (x, y), clamped to the grid; also returns its column and row when asked
+int cell_grid_cell(const cell_grid_t* grid, float x, float y, int* cx, int* cy) {
+    int gx = (int)((x - grid->min_x) / grid->cell_size);
+    int gy = (int)((y - grid->min_y) / grid->cell_size);
+    if (gx < 0) gx = 0;
+    if (gy < 0) gy = 0;
+    if (gx >= grid->nx) gx = grid->nx - 1;
+    if (gy >= grid->ny) gy = grid->ny - 1;
+    if (cx) *cx = gx;
+    if (cy) *cy = gy;
+    return gy * grid->nx + gx;
+}
+
+// Rings of cells around the point's cell; ring k + 1 is at least k cells away, so the
+// search stops once the best item is closer than that
+void cell_grid_nearest(const cell_grid_t* grid, float x, float y, cell_grid_visit_t visit, void* context) {
+    int cx, cy;
+    cell_grid_cell(grid, x, y, &cx, &cy);
+    float best_d2 = FLT_MAX;
+    int max_ring = grid->nx > grid->ny ? grid->nx : grid->ny;
+    for (int k = 0; k <= max_ring; k++) {
+        for (int gy = cy - k; gy <= cy + k; gy++) {
+            if (gy < 0 || gy >= grid->ny) continue;
+            int step = (gy == cy - k || gy == cy + k) ? 1 : 2 * k;
+            for (int gx = cx - k; gx <= cx + k; gx += step) {
+                if (gx < 0 || gx >= grid->nx) continue;
+                best_d2 = visit(context, gy * grid->nx + gx);
+            }
+        }
+        float reach = k * grid->cell_size;
+        if (reach * reach >= best_d2) break;
+    }
+}
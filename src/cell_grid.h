@@ -0,0 +1,20 @@
+#ifndef CELL_GRID_H
+#define CELL_GRID_H
+
+// Uniform grid of square cells over a bounding box. The spatial indexes of the infill
+// clipper, lightning trees and travel ordering share its cell lookup and nearest search;
+// each keeps its own per-cell storage.
+typedef struct {
+    int nx, ny;
+    float min_x, min_y, cell_size;
+} cell_grid_t;
+
+// Called for each cell the nearest search visits; returns the squared distance of the
+// best item found so far
+typedef float (*cell_grid_visit_t)(void* context, int cell);
+
+// Function declarations
+int cell_grid_cell(const cell_grid_t* grid, float x, float y, int* cx, int* cy);
+void cell_grid_nearest(const cell_grid_t* grid, float x, float y, cell_grid_visit_t visit, void* context);
+
+#endif // CELL_GRID_H
@@ -173,12 +173,13 @@ void convex_part_compute_properties(convex_part_t* part, const stl_file_t* stl)
     
     for (unsigned int i = 0; i < part->num_triangles; i++) {
         unsigned int triangle_idx = part->triangle_indices[i];
-        const stl_triangle_t* triangle = &stl->triangles[triangle_idx];
+        stl_triangle_t triangle;
+        stl_get_triangle(stl, triangle_idx, &triangle);
         
         for (int j = 0; j < 3; j++) {
-            total_x += triangle->vertices[j][0];
-            total_y += triangle->vertices[j][1];
-            total_z += triangle->vertices[j][2];
+            total_x += triangle.vertices[j][0];
+            total_y += triangle.vertices[j][1];
+            total_z += triangle.vertices[j][2];
             total_vertices++;
         }
     }
@@ -377,12 +378,13 @@ void hierarchical_split_part(convex_part_t* part, const stl_file_t* stl,
     // Distribute triangles
     for (unsigned int i = 0; i < part->num_triangles; i++) {
         unsigned int triangle_idx = part->triangle_indices[i];
-        const stl_triangle_t* triangle = &stl->triangles[triangle_idx];
+        stl_triangle_t triangle;
+        stl_get_triangle(stl, triangle_idx, &triangle);
         
         // Calculate triangle center
-        float center = (triangle->vertices[0][split_axis] + 
-                       triangle->vertices[1][split_axis] + 
-                       triangle->vertices[2][split_axis]) / 3.0f;
+        float center = (triangle.vertices[0][split_axis] + 
+                       triangle.vertices[1][split_axis] + 
+                       triangle.vertices[2][split_axis]) / 3.0f;
         
         if (center < split_value) {
             convex_part_add_triangle(left_part, triangle_idx);
@@ -469,12 +471,13 @@ convex_decomposition_t* voxel_based_decomposition(const stl_file_t* stl,
     
     // Assign triangles to voxels
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        const stl_triangle_t* triangle = &stl->triangles[i];
+        stl_triangle_t triangle;
+        stl_get_triangle(stl, i, &triangle);
         
         // Calculate triangle center
-        float center_x = (triangle->vertices[0][0] + triangle->vertices[1][0] + triangle->vertices[2][0]) / 3.0f;
-        float center_y = (triangle->vertices[0][1] + triangle->vertices[1][1] + triangle->vertices[2][1]) / 3.0f;
-        float center_z = (triangle->vertices[0][2] + triangle->vertices[1][2] + triangle->vertices[2][2]) / 3.0f;
+        float center_x = (triangle.vertices[0][0] + triangle.vertices[1][0] + triangle.vertices[2][0]) / 3.0f;
+        float center_y = (triangle.vertices[0][1] + triangle.vertices[1][1] + triangle.vertices[2][1]) / 3.0f;
+        float center_z = (triangle.vertices[0][2] + triangle.vertices[1][2] + triangle.vertices[2][2]) / 3.0f;
         
         int voxel_x = (int)((center_x - min_x) / voxel_size);
         int voxel_y = (int)((center_y - min_y) / voxel_size);
@@ -496,10 +499,11 @@ convex_decomposition_t* voxel_based_decomposition(const stl_file_t* stl,
                     if (part) {
                         // Add triangles from this voxel
                         for (unsigned int i = 0; i < stl->num_triangles; i++) {
-                            const stl_triangle_t* triangle = &stl->triangles[i];
-                            float center_x = (triangle->vertices[0][0] + triangle->vertices[1][0] + triangle->vertices[2][0]) / 3.0f;
-                            float center_y = (triangle->vertices[0][1] + triangle->vertices[1][1] + triangle->vertices[2][1]) / 3.0f;
-                            float center_z = (triangle->vertices[0][2] + triangle->vertices[1][2] + triangle->vertices[2][2]) / 3.0f;
+                            stl_triangle_t triangle;
+                            stl_get_triangle(stl, i, &triangle);
+                            float center_x = (triangle.vertices[0][0] + triangle.vertices[1][0] + triangle.vertices[2][0]) / 3.0f;
+                            float center_y = (triangle.vertices[0][1] + triangle.vertices[1][1] + triangle.vertices[2][1]) / 3.0f;
+                            float center_z = (triangle.vertices[0][2] + triangle.vertices[1][2] + triangle.vertices[2][2]) / 3.0f;
                             
                             int tri_voxel_x = (int)((center_x - min_x) / voxel_size);
                             int tri_voxel_y = (int)((center_y - min_y) / voxel_size);
@@ -673,12 +677,13 @@ void approximate_decompose_part(convex_part_t* part, const stl_file_t* stl,
     // Distribute triangles based on their centers
     for (unsigned int i = 0; i < part->num_triangles; i++) {
         unsigned int triangle_idx = part->triangle_indices[i];
-        const stl_triangle_t* triangle = &stl->triangles[triangle_idx];
+        stl_triangle_t triangle;
+        stl_get_triangle(stl, triangle_idx, &triangle);
         
         // Calculate triangle center
-        float center = (triangle->vertices[0][split_axis] + 
-                       triangle->vertices[1][split_axis] + 
-                       triangle->vertices[2][split_axis]) / 3.0f;
+        float center = (triangle.vertices[0][split_axis] + 
+                       triangle.vertices[1][split_axis] + 
+                       triangle.vertices[2][split_axis]) / 3.0f;
         
         if (center < split_value) {
             convex_part_add_triangle(left_part, triangle_idx);
@@ -60,7 +60,7 @@ typedef struct {
 
 // Decomposition result structure
 typedef struct {
-    convex_part_t* parts;       // Array of convex parts
+    convex_part_t** parts;      // Array of convex parts
     unsigned int num_parts;     // Number of parts
     unsigned int capacity;      // Allocated capacity
     decomposition_strategy_t strategy; // Strategy used
@@ -0,0 +1,197 @@
+#include "gcode_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void gcode_buffer_init(gcode_buffer_t* buffer) {
+    memset(buffer, 0, sizeof(gcode_buffer_t));
+}
+
+void gcode_buffer_free(gcode_buffer_t* buffer) {
+    if (!buffer) return;
+    
+    for (size_t i = 0; i < buffer->num_chunks; i++) {
+        free(buffer->chunks[i]);
+    }
+    for (size_t i = 0; i < buffer->num_text_chunks; i++) {
+        free(buffer->text_chunks[i]);
+    }
+    free(buffer->chunks);
+    free(buffer->text_chunks);
+    free(buffer->comments);
+    free(buffer->comment_table);
+    free(buffer->feeds);
+    gcode_buffer_init(buffer);
+}
+
+gcode_command_t* gcode_buffer_append(gcode_buffer_t* buffer) {
+    // Chunks are full except the last, so a new one is needed exactly on the boundary.
+    // Only the array of chunk pointers is ever reallocated.
+    if (buffer->count == buffer->num_chunks * GCODE_BUFFER_CHUNK) {
+        if (buffer->num_chunks == buffer->chunk_slots) {
+            size_t slots = buffer->chunk_slots ? buffer->chunk_slots * 2 : 16;
+            gcode_command_t** grown = realloc(buffer->chunks, slots * sizeof(gcode_command_t*));
+            if (!grown) return NULL;
+            buffer->chunks = grown;
+            buffer->chunk_slots = slots;
+        }
+        gcode_command_t* chunk = malloc(GCODE_BUFFER_CHUNK * sizeof(gcode_command_t));
+        if (!chunk) return NULL;
+        buffer->chunks[buffer->num_chunks++] = chunk;
+    }
+    
+    gcode_command_t* command = (gcode_command_t*)gcode_buffer_at(buffer, buffer->count);
+    memset(command, 0, sizeof(gcode_command_t));
+    buffer->count++;
+    return command;
+}
+
+const gcode_command_t* gcode_buffer_at(const gcode_buffer_t* buffer, size_t index) {
+    return &buffer->chunks[index / GCODE_BUFFER_CHUNK][index % GCODE_BUFFER_CHUNK];
+}
+
+// FNV-1a
+static uint32_t gcode_text_hash(const char* text) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+// Rebuild the lookup table at twice the size
+static int gcode_buffer_grow_table(gcode_buffer_t* buffer) {
+    uint32_t size = buffer->table_size ? buffer->table_size * 2 : 64;
+    uint32_t* table = calloc(size, sizeof(uint32_t));
+    if (!table) return -1;
+    
+    for (uint32_t id = 0; id < buffer->num_comments; id++) {
+        uint32_t slot = gcode_text_hash(buffer->comments[id]) & (size - 1);
+        while (table[slot]) slot = (slot + 1) & (size - 1);
+        table[slot] = id + 1;
+    }
+    free(buffer->comment_table);
+    buffer->comment_table = table;
+    buffer->table_size = size;
+    return 0;
+}
+
+// Copy text into the arena; comments never straddle two chunks
+static const char* gcode_buffer_store_text(gcode_buffer_t* buffer, const char* text) {
+    size_t length = strlen(text) + 1;
+    if (buffer->num_text_chunks == 0 || buffer->text_capacity - buffer->text_used < length) {
+        size_t capacity = length > GCODE_BUFFER_TEXT_CHUNK ? length : GCODE_BUFFER_TEXT_CHUNK;
+        char** grown = realloc(buffer->text_chunks, (buffer->num_text_chunks + 1) * sizeof(char*));
+        if (!grown) return NULL;
+        buffer->text_chunks = grown;
+        
+        char* chunk = malloc(capacity);
+        if (!chunk) return NULL;
+        buffer->text_chunks[buffer->num_text_chunks++] = chunk;
+        buffer->text_used = 0;
+        buffer->text_capacity = capacity;
+    }
+    
+    char* stored = buffer->text_chunks[buffer->num_text_chunks - 1] + buffer->text_used;
+    memcpy(stored, text, length);
+    buffer->text_used += length;
+    return stored;
+}
+
+int gcode_buffer_intern(gcode_buffer_t* buffer, const char* text, uint32_t* id) {
+    if (!buffer || !text || !id) return -1;
+    
+    // Keep the table at most half full
+    if ((buffer->num_comments + 1) * 2 > buffer->table_size && gcode_buffer_grow_table(buffer) != 0) {
+        return -1;
+    }
+    uint32_t slot = gcode_text_hash(text) & (buffer->table_size - 1);
+    while (buffer->comment_table[slot]) {
+        uint32_t existing = buffer->comment_table[slot] - 1;
+        if (strcmp(buffer->comments[existing], text) == 0) {
+            *id = existing;
+            return 0;
+        }
+        slot = (slot + 1) & (buffer->table_size - 1);
+    }
+    
+    if (buffer->num_comments == buffer->comment_slots) {
+        uint32_t slots = buffer->comment_slots ? buffer->comment_slots * 2 : 16;
+        const char** grown = realloc(buffer->comments, slots * sizeof(const char*));
+        if (!grown) return -1;
+        buffer->comments = grown;
+        buffer->comment_slots = slots;
+    }
+    const char* stored = gcode_buffer_store_text(buffer, text);
+    if (!stored) return -1;
+    
+    *id = buffer->num_comments;
+    buffer->comments[buffer->num_comments++] = stored;
+    buffer->comment_table[slot] = *id + 1;
+    return 0;
+}
+
+int gcode_buffer_feed(gcode_buffer_t* buffer, float feed, uint16_t* id) {
+    if (!buffer || !id) return -1;
+    
+    // A job uses a handful of feed rates
+    for (uint32_t i = 0; i < buffer->num_feeds; i++) {
+        if (buffer->feeds[i] == feed) {
+            *id = (uint16_t)i;
+            return 0;
+        }
+    }
+    
+    if (buffer->num_feeds >= GCODE_BUFFER_MAX_FEEDS) return -1;
+    if (buffer->num_feeds == buffer->feed_slots) {
+        uint32_t slots = buffer->feed_slots ? buffer->feed_slots * 2 : 4;
+        float* grown = realloc(buffer->feeds, slots * sizeof(float));
+        if (!grown) return -1;
+        buffer->feeds = grown;
+        buffer->feed_slots = slots;
+    }
+    *id = (uint16_t)buffer->num_feeds;
+    buffer->feeds[buffer->num_feeds++] = feed;
+    return 0;
+}
+
+int gcode_buffer_append_buffer(gcode_buffer_t* buffer, const gcode_buffer_t* other) {
+    if (!buffer || !other) return -1;
+    
+    // Ids are per buffer: map other's ids to this buffer's once
+    uint32_t* comment_ids = malloc((other->num_comments + 1) * sizeof(uint32_t));
+    uint16_t* feed_ids = malloc((other->num_feeds + 1) * sizeof(uint16_t));
+    int status = comment_ids && feed_ids ? 0 : -1;
+    for (uint32_t i = 0; status == 0 && i < other->num_comments; i++) {
+        status = gcode_buffer_intern(buffer, other->comments[i], &comment_ids[i]);
+    }
+    for (uint32_t i = 0; status == 0 && i < other->num_feeds; i++) {
+        status = gcode_buffer_feed(buffer, other->feeds[i], &feed_ids[i]);
+    }
+    
+    for (size_t i = 0; status == 0 && i < other->count; i++) {
+        gcode_command_t* command = gcode_buffer_append(buffer);
+        if (!command) {
+            status = -1;
+            break;
+        }
+        *command = *gcode_buffer_at(other, i);
+        if (command->type == GCODE_COMMENT) {
+            command->data.comment = comment_ids[command->data.comment];
+        } else if (command->type == GCODE_MOVE || command->type == GCODE_ARC) {
+            command->feed = feed_ids[command->feed];
+        }
+    }
+    free(comment_ids);
+    free(feed_ids);
+    return status;
+}
+
+int32_t gcode_units(double mm) {
+    // Exact for any float, so rounding half-to-even matches printf; out of range saturates
+    double scaled = mm * GCODE_UNITS_PER_MM;
+    if (scaled >= INT32_MAX) return INT32_MAX;
+    if (scaled <= INT32_MIN) return INT32_MIN;
+    if (scaled != scaled) return 0;
+    return (int32_t)lrint(scaled);
+}
@@ -0,0 +1,101 @@
+#ifndef GCODE_BUFFER_H
+#define GCODE_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact command storage. Commands are fixed-size records with integer coordinates,
+// kept in chunks that are never moved or copied as the buffer grows. Comment text and
+// feed rates are interned per buffer and referred to by id, so adding a command never
+// allocates anything but, now and then, a new chunk.
+
+// Stored units per mm for positions, extrusion and arc offsets; G-code carries three
+// decimals, so micrometres lose nothing
+#define GCODE_UNITS_PER_MM 1000
+#define GCODE_UNIT_DECIMALS 3
+
+// Commands per chunk
+#define GCODE_BUFFER_CHUNK 4096
+
+// Bytes per chunk of interned comment text (longer comments get a chunk of their own)
+#define GCODE_BUFFER_TEXT_CHUNK 4096
+
+// Distinct feed rates per buffer
+#define GCODE_BUFFER_MAX_FEEDS 65535
+
+// G-code command types
+typedef enum {
+    GCODE_MOVE,     // G0/G1 - Linear move
+    GCODE_ARC,      // G2/G3 - Arc move
+    GCODE_SET_POS,  // G92 - Set extruder position
+    GCODE_HOME,     // G28 - Home axes
+    GCODE_SET_UNITS, // G20/G21 - Set units
+    GCODE_SET_TEMP, // M104/M109 - Set temperature
+    GCODE_FAN,      // M106/M107 - Fan control
+    GCODE_END,      // M2 - End program
+    GCODE_COMMENT,  // Comment line, no motion
+    GCODE_LAYER,    // "Layer N, Z=..." comment, formatted when written
+    GCODE_E_MODE    // M82/M83 - Absolute or relative extrusion
+} gcode_type_t;
+
+// Arc turns clockwise (G2)
+#define GCODE_FLAG_CLOCKWISE 0x01
+
+// G-code command: 24 bytes. Positions are in GCODE_UNITS_PER_MM.
+typedef struct {
+    uint8_t type;           // gcode_type_t
+    uint8_t flags;
+    uint16_t feed;          // Moves and arcs: feed rate id
+    union {
+        struct { int32_t x, y, z, e; } move;
+        struct { int32_t x, y, e, i, j; } arc;  // Stays in the plane of the move before it
+        int32_t value;      // M104: temperature in tenths of a degree; M106: fan speed;
+                            // G92: extruder position; M83: 1, M82: 0
+        uint32_t comment;   // Interned comment id
+        struct { int32_t number, z; } layer;
+    } data;
+} gcode_command_t;
+
+typedef struct {
+    gcode_command_t** chunks;
+    size_t num_chunks;
+    size_t chunk_slots;     // Length of the chunks array
+    size_t count;           // Commands stored
+    
+    // Interned comments: text lives in chunks; comments[id] points into them
+    char** text_chunks;
+    size_t num_text_chunks;
+    size_t text_used;       // Bytes used in the last text chunk
+    size_t text_capacity;   // Size of the last text chunk
+    const char** comments;
+    uint32_t num_comments;
+    uint32_t comment_slots;
+    uint32_t* comment_table; // Open addressing: comment id + 1, 0 = empty
+    uint32_t table_size;    // Power of two
+    
+    float* feeds;           // Feed rates (mm/min) by id
+    uint32_t num_feeds;
+    uint32_t feed_slots;
+} gcode_buffer_t;
+
+// Function declarations
+void gcode_buffer_init(gcode_buffer_t* buffer);
+void gcode_buffer_free(gcode_buffer_t* buffer); // Leaves the buffer empty and reusable
+
+// Zeroed slot for the next command; NULL when out of memory
+gcode_command_t* gcode_buffer_append(gcode_buffer_t* buffer);
+
+const gcode_command_t* gcode_buffer_at(const gcode_buffer_t* buffer, size_t index);
+
+// Append every command of other, with its comments and feed rates given ids in buffer;
+// -1 when out of memory, with part of other appended
+int gcode_buffer_append_buffer(gcode_buffer_t* buffer, const gcode_buffer_t* other);
+
+// Ids for text and feed rates, the same id for the same value; -1 when out of memory
+int gcode_buffer_intern(gcode_buffer_t* buffer, const char* text, uint32_t* id);
+int gcode_buffer_feed(gcode_buffer_t* buffer, float feed, uint16_t* id);
+
+// mm to stored units, rounded like printf("%.3f") rounds
+int32_t gcode_units(double mm);
+
+#endif // GCODE_BUFFER_H
@@ -0,0 +1,122 @@
+#include "gcode_pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// One layer's commands, on their way from the generator to the writer
+typedef struct {
+    gcode_buffer_t commands;
+} gcode_batch_t;
+
+typedef struct {
+    slice_cursor_t* cursor;
+    path_generator_t* generator;
+    thread_queue_t sliced;       // layer_t* ready for path generation
+    thread_queue_t generated;    // gcode_batch_t* ready to write
+    int slice_failed;            // Each flag is set only by its own stage
+    int generate_failed;
+} gcode_pipeline_t;
+
+static void* gcode_pipeline_slice(void* arg) {
+    gcode_pipeline_t* pipeline = (gcode_pipeline_t*)arg;
+    sliced_model_t* model = slice_cursor_model(pipeline->cursor);
+    
+    int first, last, status;
+    while ((status = slice_cursor_next(pipeline->cursor, &first, &last)) > 0) {
+        for (int i = first; i < last; i++) {
+            // Closed by the generator: a later stage stopped
+            if (thread_queue_push(&pipeline->sliced, &model->layers[i]) != 0) return NULL;
+        }
+    }
+    if (status < 0) pipeline->slice_failed = 1;
+    thread_queue_close(&pipeline->sliced);
+    return NULL;
+}
+
+// Queue the commands generated since the last batch; -1 when out of memory, 1 when the
+// writer has stopped taking batches
+static int gcode_pipeline_send(gcode_pipeline_t* pipeline) {
+    gcode_batch_t* batch = malloc(sizeof(gcode_batch_t));
+    if (!batch) return -1;
+    
+    path_generator_take_commands(pipeline->generator, &batch->commands);
+    if (thread_queue_push(&pipeline->generated, batch) != 0) {
+        gcode_buffer_free(&batch->commands);
+        free(batch);
+        return 1;
+    }
+    return 0;
+}
+
+static void* gcode_pipeline_generate(void* arg) {
+    gcode_pipeline_t* pipeline = (gcode_pipeline_t*)arg;
+    sliced_model_t* model = slice_cursor_model(pipeline->cursor);
+    
+    void* item;
+    int status = 0;
+    while (status == 0 && thread_queue_pop(&pipeline->sliced, &item)) {
+        layer_t* layer = (layer_t*)item;
+        status = generate_gcode_for_layer(pipeline->generator, layer, (int)(layer - model->layers));
+        free_layer(layer);
+        if (status == 0) status = gcode_pipeline_send(pipeline);
+    }
+    // The slicer's flag is set before it closes the queue we just drained
+    if (status == 0 && !pipeline->slice_failed) {
+        generate_gcode_end(pipeline->generator);
+        status = gcode_pipeline_send(pipeline);
+    }
+    if (status != 0) {
+        if (status < 0) pipeline->generate_failed = 1;
+        thread_queue_close(&pipeline->sliced);
+    }
+    thread_queue_close(&pipeline->generated);
+    return NULL;
+}
+
+int gcode_pipeline_run(slice_cursor_t* cursor, path_generator_t* generator, gcode_writer_t* writer,
+                       print_estimator_t* estimator, long long* num_commands) {
+    if (!cursor || !generator || !writer) return -1;
+    
+    gcode_pipeline_t pipeline = { .cursor = cursor, .generator = generator };
+    if (thread_queue_init(&pipeline.sliced, GCODE_PIPELINE_DEPTH) != 0) return -1;
+    if (thread_queue_init(&pipeline.generated, GCODE_PIPELINE_DEPTH) != 0) {
+        thread_queue_destroy(&pipeline.sliced);
+        return -1;
+    }
+    
+    // Start commands go out with the first layer
+    generate_gcode_start(generator);
+    write_gcode_header(writer, generator, -1);
+    
+    pthread_t slice_thread, generate_thread;
+    int slicing = pthread_create(&slice_thread, NULL, gcode_pipeline_slice, &pipeline) == 0;
+    int generating = slicing && pthread_create(&generate_thread, NULL, gcode_pipeline_generate, &pipeline) == 0;
+    if (!generating) {
+        fprintf(stderr, "Error: Failed to start pipeline threads\n");
+        thread_queue_close(&pipeline.sliced);
+        thread_queue_close(&pipeline.generated);
+    }
+    
+    // Write batches as they come; after a write error keep draining so upstream stops
+    gcode_output_state_t state = {0};
+    long long count = 0;
+    void* item;
+    while (thread_queue_pop(&pipeline.generated, &item)) {
+        gcode_batch_t* batch = (gcode_batch_t*)item;
+        write_gcode_commands(writer, &state, &batch->commands);
+        if (estimator) print_estimator_add_commands(estimator, &batch->commands);
+        count += (long long)batch->commands.count;
+        gcode_buffer_free(&batch->commands);
+        free(batch);
+        if (writer->error) thread_queue_close(&pipeline.generated);
+    }
+    
+    if (generating) pthread_join(generate_thread, NULL);
+    if (slicing) pthread_join(slice_thread, NULL);
+    thread_queue_destroy(&pipeline.sliced);
+    thread_queue_destroy(&pipeline.generated);
+    
+    if (num_commands) *num_commands = count;
+    if (pipeline.slice_failed) fprintf(stderr, "Error: Failed to slice layers\n");
+    if (pipeline.generate_failed) fprintf(stderr, "Error: Out of memory generating G-code\n");
+    return (!generating || pipeline.slice_failed || pipeline.generate_failed || writer->error) ? -1 : 0;
+}
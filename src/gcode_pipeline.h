@@ -0,0 +1,27 @@
+#ifndef GCODE_PIPELINE_H
+#define GCODE_PIPELINE_H
+
+#include "slicer.h"
+#include "path_generator.h"
+#include "gcode_writer.h"
+#include "print_estimate.h"
+
+// Slice-to-G-code pipeline. One thread slices layers bottom-up, a second orders each
+// layer's paths into commands and frees the layer, and the calling thread writes the
+// commands out and frees them. Bounded queues between the stages keep memory flat
+// whatever the model height.
+
+// Layers waiting between two stages, at most; with the slicing block in progress this
+// bounds the layers held in memory
+#define GCODE_PIPELINE_DEPTH 16
+
+// Function declarations
+
+// Run every layer of the cursor through generator into writer. Output is the same as
+// generate_gcode_from_slices followed by a write, except that the header has no command
+// count. Written commands also go to estimator when it is not NULL. Returns 0, or -1 if
+// any stage failed; num_commands (may be NULL) gets the count.
+int gcode_pipeline_run(slice_cursor_t* cursor, path_generator_t* generator, gcode_writer_t* writer,
+                       print_estimator_t* estimator, long long* num_commands);
+
+#endif // GCODE_PIPELINE_H
@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+#include "gcode_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// G-code is written with bare newlines on every platform
+#ifdef _WIN32
+#define GCODE_WRITER_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC | O_BINARY)
+#else
+#define GCODE_WRITER_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#endif
+
+gcode_writer_t* gcode_writer_create(int fd) {
+    if (fd < 0) return NULL;
+    
+    gcode_writer_t* writer = malloc(sizeof(gcode_writer_t));
+    if (!writer) return NULL;
+    
+    writer->buffer = malloc(GCODE_WRITER_BUFFER_SIZE);
+    if (!writer->buffer) {
+        free(writer);
+        return NULL;
+    }
+    writer->fd = fd;
+    writer->owns_fd = 0;
+    writer->length = 0;
+    writer->bytes_written = 0;
+    writer->error = 0;
+    writer->encoder = NULL;
+    return writer;
+}
+
+gcode_writer_t* gcode_writer_open(const char* filename) {
+    if (!filename) return NULL;
+    
+    int fd = open(filename, GCODE_WRITER_OPEN_FLAGS, 0644);
+    if (fd < 0) return NULL;
+    
+    gcode_writer_t* writer = gcode_writer_create(fd);
+    if (!writer) {
+        close(fd);
+        return NULL;
+    }
+    writer->owns_fd = 1;
+    return writer;
+}
+
+static void gcode_writer_write(gcode_writer_t* writer, const void* data, size_t length) {
+    size_t done = 0;
+    while (!writer->error && done < length) {
+        ssize_t count = write(writer->fd, (const char*)data + done, length - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            writer->error = 1;
+            break;
+        }
+        done += (size_t)count;
+    }
+    writer->bytes_written += done;
+}
+
+gcode_writer_t* gcode_writer_open_binary(const char* filename, const bgcode_metadata_t* metadata) {
+    if (!metadata) return NULL;
+    
+    gcode_writer_t* writer = gcode_writer_open(filename);
+    if (!writer) return NULL;
+    
+    writer->encoder = bgcode_encoder_create();
+    if (!writer->encoder || bgcode_encode_header(writer->encoder, metadata) != 0) {
+        gcode_writer_close(writer);
+        return NULL;
+    }
+    gcode_writer_write(writer, writer->encoder->output, writer->encoder->length);
+    return writer;
+}
+
+// Encode the buffered text block by block; a partial last line waits for the rest unless
+// this is the end, or unless it fills the whole buffer
+static void gcode_writer_encode(gcode_writer_t* writer, int final) {
+    bgcode_encoder_t* encoder = writer->encoder;
+    size_t done = 0;
+    while (!writer->error && done < writer->length) {
+        size_t used = 0;
+        int full = done == 0 && writer->length + GCODE_WRITER_MAX_WORD > GCODE_WRITER_BUFFER_SIZE;
+        if (bgcode_encode_gcode(encoder, writer->buffer + done, writer->length - done, final, &used) != 0 ||
+            (used == 0 && full &&
+             bgcode_encode_gcode(encoder, writer->buffer, writer->length, 1, &used) != 0)) {
+            writer->error = 1;
+            break;
+        }
+        if (used == 0) break;
+        gcode_writer_write(writer, encoder->output, encoder->length);
+        done += used;
+    }
+    if (writer->error) done = writer->length;
+    memmove(writer->buffer, writer->buffer + done, writer->length - done);
+    writer->length -= done;
+}
+
+int gcode_writer_flush(gcode_writer_t* writer) {
+    if (!writer) return -1;
+    
+    if (writer->encoder) {
+        gcode_writer_encode(writer, 0);
+    } else {
+        gcode_writer_write(writer, writer->buffer, writer->length);
+        writer->length = 0;
+    }
+    return writer->error ? -1 : 0;
+}
+
+int gcode_writer_close(gcode_writer_t* writer) {
+    if (!writer) return -1;
+    
+    if (writer->encoder) gcode_writer_encode(writer, 1);
+    int result = gcode_writer_flush(writer);
+    if (writer->owns_fd && close(writer->fd) != 0) {
+        result = -1;
+    }
+    bgcode_encoder_free(writer->encoder);
+    free(writer->buffer);
+    free(writer);
+    return result;
+}
+
+// Make room for one formatted word
+static char* gcode_writer_reserve(gcode_writer_t* writer) {
+    if (GCODE_WRITER_BUFFER_SIZE - writer->length < GCODE_WRITER_MAX_WORD) {
+        gcode_writer_flush(writer);
+    }
+    return writer->buffer + writer->length;
+}
+
+void gcode_writer_text(gcode_writer_t* writer, const char* text) {
+    size_t remaining = strlen(text);
+    while (remaining > 0) {
+        size_t space = GCODE_WRITER_BUFFER_SIZE - writer->length;
+        if (space == 0) {
+            gcode_writer_flush(writer);
+            continue;
+        }
+        size_t count = remaining < space ? remaining : space;
+        memcpy(writer->buffer + writer->length, text, count);
+        writer->length += count;
+        text += count;
+        remaining -= count;
+    }
+}
+
+void gcode_writer_number(gcode_writer_t* writer, double value, int decimals) {
+    char* out = gcode_writer_reserve(writer);
+    writer->length = gcode_format_fixed(out, value, decimals) - writer->buffer;
+}
+
+void gcode_writer_word(gcode_writer_t* writer, char letter, double value, int decimals) {
+    char* out = gcode_writer_reserve(writer);
+    out[0] = ' ';
+    out[1] = letter;
+    writer->length = gcode_format_fixed(out + 2, value, decimals) - writer->buffer;
+}
+
+void gcode_writer_units(gcode_writer_t* writer, long long units, int decimals) {
+    char* out = gcode_writer_reserve(writer);
+    writer->length = gcode_format_units(out, units, decimals) - writer->buffer;
+}
+
+void gcode_writer_word_units(gcode_writer_t* writer, char letter, long long units, int decimals) {
+    char* out = gcode_writer_reserve(writer);
+    out[0] = ' ';
+    out[1] = letter;
+    writer->length = gcode_format_units(out + 2, units, decimals) - writer->buffer;
+}
+
+char* gcode_format_fixed(char* out, double value, int decimals) {
+    static const double scales[GCODE_WRITER_MAX_DECIMALS + 1] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+    if (decimals < 0) decimals = 0;
+    if (decimals > GCODE_WRITER_MAX_DECIMALS) decimals = GCODE_WRITER_MAX_DECIMALS;
+    
+    // A float times 10^6 is exact in a double, so rounding it half-to-even gives the
+    // same digits printf would. Huge values and NaN go through printf itself.
+    double scaled = value * scales[decimals];
+    if (!(fabs(scaled) < 1e18)) {
+        int count = snprintf(out, GCODE_WRITER_MAX_WORD - 2, "%.*g", decimals + 1, value);
+        return out + (count < GCODE_WRITER_MAX_WORD - 2 ? count : GCODE_WRITER_MAX_WORD - 3);
+    }
+    long long units = llrint(scaled);
+    if (units == 0 && signbit(scaled)) *out++ = '-';
+    return gcode_format_units(out, units, decimals);
+}
+
+char* gcode_format_units(char* out, long long units, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > GCODE_WRITER_MAX_DECIMALS) decimals = GCODE_WRITER_MAX_DECIMALS;
+    
+    unsigned long long remaining = (unsigned long long)units;
+    if (units < 0) {
+        *out++ = '-';
+        remaining = 0ULL - remaining;
+    }
+    
+    // Digits come out least significant first; keep at least one before the point
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + remaining % 10);
+        remaining /= 10;
+    } while (remaining > 0 || count <= decimals);
+    
+    while (count > decimals) *out++ = digits[--count];
+    if (decimals > 0) {
+        *out++ = '.';
+        while (count > 0) *out++ = digits[--count];
+    }
+    return out;
+}
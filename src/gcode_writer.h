@@ -0,0 +1,67 @@
+#ifndef GCODE_WRITER_H
+#define GCODE_WRITER_H
+
+#include <stddef.h>
+#include "bgcode.h"
+
+// Buffered G-code output. Numbers are formatted with integer arithmetic straight into
+// one large buffer, which goes to the file descriptor in big blocks instead of a stdio
+// call per word.
+
+// Bytes collected before each write()
+#define GCODE_WRITER_BUFFER_SIZE (4 << 20)
+
+// Room kept free for one formatted word; text longer than this is copied in pieces
+#define GCODE_WRITER_MAX_WORD 64
+
+// Most decimals gcode_format_fixed writes
+#define GCODE_WRITER_MAX_DECIMALS 6
+
+typedef struct {
+    int fd;
+    int owns_fd;            // Close fd along with the writer
+    char* buffer;
+    size_t length;          // Bytes waiting in buffer
+    unsigned long long bytes_written;
+    int error;              // A write failed; later output is dropped
+    bgcode_encoder_t* encoder; // Binary G-code: text goes out as encoded blocks of whole lines
+} gcode_writer_t;
+
+// Function declarations
+
+// Create or truncate filename for writing
+gcode_writer_t* gcode_writer_open(const char* filename);
+
+// Write to an fd the caller already has open (stdout, a pipe, a serial port); the fd
+// stays open after gcode_writer_close
+gcode_writer_t* gcode_writer_create(int fd);
+
+// Binary G-code: the header and metadata blocks go out at once, text written later is
+// encoded into G-code blocks
+gcode_writer_t* gcode_writer_open_binary(const char* filename, const bgcode_metadata_t* metadata);
+
+// Both return 0, or -1 if any write since the writer was made failed. A binary writer's
+// flush holds back a partial last line until more text or the close.
+int gcode_writer_flush(gcode_writer_t* writer);
+int gcode_writer_close(gcode_writer_t* writer);
+
+void gcode_writer_text(gcode_writer_t* writer, const char* text);
+
+// value with a fixed number of decimals, e.g. 12.500 for 3
+void gcode_writer_number(gcode_writer_t* writer, double value, int decimals);
+
+// One parameter word with its leading space, e.g. " X12.500"
+void gcode_writer_word(gcode_writer_t* writer, char letter, double value, int decimals);
+
+// The same from fixed-point values: units in 10^-decimals, e.g. 12500 with 3 decimals
+void gcode_writer_units(gcode_writer_t* writer, long long units, int decimals);
+void gcode_writer_word_units(gcode_writer_t* writer, char letter, long long units, int decimals);
+
+// Format value like printf("%.*f") into out, which needs GCODE_WRITER_MAX_WORD bytes;
+// returns the end of the digits (not terminated). Matches printf exactly for floats.
+char* gcode_format_fixed(char* out, double value, int decimals);
+
+// Format units / 10^decimals the same way, with no rounding at all
+char* gcode_format_units(char* out, long long units, int decimals);
+
+#endif // GCODE_WRITER_H
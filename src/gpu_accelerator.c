@@ -529,11 +529,12 @@ int gpu_analyze_connectivity(const stl_file_t* stl, topology_evaluation_t* eval,
     if (triangle_data) {
         float* data = (float*)triangle_data;
         for (unsigned int i = 0; i < stl->num_triangles; i++) {
-            const stl_triangle_t* tri = &stl->triangles[i];
+            stl_triangle_t tri;
+            stl_get_triangle(stl, i, &tri);
             for (int j = 0; j < 3; j++) {
-                data[i * 9 + j * 3 + 0] = tri->vertices[j][0];
-                data[i * 9 + j * 3 + 1] = tri->vertices[j][1];
-                data[i * 9 + j * 3 + 2] = tri->vertices[j][2];
+                data[i * 9 + j * 3 + 0] = tri.vertices[j][0];
+                data[i * 9 + j * 3 + 1] = tri.vertices[j][1];
+                data[i * 9 + j * 3 + 2] = tri.vertices[j][2];
             }
         }
         gpu_unmap_buffer(triangle_buffer);
@@ -588,14 +589,15 @@ int gpu_analyze_curvature(const stl_file_t* stl, topology_evaluation_t* eval, gp
     if (normal_data) {
         float* data = (float*)normal_data;
         for (unsigned int i = 0; i < stl->num_triangles; i++) {
-            const stl_triangle_t* tri = &stl->triangles[i];
+            stl_triangle_t tri;
+            stl_get_triangle(stl, i, &tri);
             // Calculate normal
-            float v1[3] = {tri->vertices[1][0] - tri->vertices[0][0],
-                          tri->vertices[1][1] - tri->vertices[0][1],
-                          tri->vertices[1][2] - tri->vertices[0][2]};
-            float v2[3] = {tri->vertices[2][0] - tri->vertices[0][0],
-                          tri->vertices[2][1] - tri->vertices[0][1],
-                          tri->vertices[2][2] - tri->vertices[0][2]};
+            float v1[3] = {tri.vertices[1][0] - tri.vertices[0][0],
+                          tri.vertices[1][1] - tri.vertices[0][1],
+                          tri.vertices[1][2] - tri.vertices[0][2]};
+            float v2[3] = {tri.vertices[2][0] - tri.vertices[0][0],
+                          tri.vertices[2][1] - tri.vertices[0][1],
+                          tri.vertices[2][2] - tri.vertices[0][2]};
             float normal[3];
             cross_product_3d(v1, v2, normal);
             normalize_vector_3d(normal);
@@ -658,11 +660,12 @@ int gpu_sort_triangles_by_axis(const stl_file_t* stl, unsigned int* indices,
         
         for (unsigned int i = 0; i < num_triangles - 1; i++) {
             for (unsigned int j = 0; j < num_triangles - i - 1; j++) {
-                const stl_triangle_t* tri1 = &stl->triangles[indices[j]];
-                const stl_triangle_t* tri2 = &stl->triangles[indices[j + 1]];
+                stl_triangle_t tri1, tri2;
+                stl_get_triangle(stl, indices[j], &tri1);
+                stl_get_triangle(stl, indices[j + 1], &tri2);
                 
-                float center1 = (tri1->vertices[0][axis] + tri1->vertices[1][axis] + tri1->vertices[2][axis]) / 3.0f;
-                float center2 = (tri2->vertices[0][axis] + tri2->vertices[1][axis] + tri2->vertices[2][axis]) / 3.0f;
+                float center1 = (tri1.vertices[0][axis] + tri1.vertices[1][axis] + tri1.vertices[2][axis]) / 3.0f;
+                float center2 = (tri2.vertices[0][axis] + tri2.vertices[1][axis] + tri2.vertices[2][axis]) / 3.0f;
                 
                 if (center1 > center2) {
                     unsigned int temp = indices[j];
@@ -690,11 +693,12 @@ int gpu_sort_triangles_by_axis(const stl_file_t* stl, unsigned int* indices,
     if (triangle_data) {
         float* data = (float*)triangle_data;
         for (unsigned int i = 0; i < num_triangles; i++) {
-            const stl_triangle_t* tri = &stl->triangles[i];
+            stl_triangle_t tri;
+            stl_get_triangle(stl, i, &tri);
             for (int j = 0; j < 3; j++) {
-                data[i * 12 + j * 3 + 0] = tri->vertices[j][0];
-                data[i * 12 + j * 3 + 1] = tri->vertices[j][1];
-                data[i * 12 + j * 3 + 2] = tri->vertices[j][2];
+                data[i * 12 + j * 3 + 0] = tri.vertices[j][0];
+                data[i * 12 + j * 3 + 1] = tri.vertices[j][1];
+                data[i * 12 + j * 3 + 2] = tri.vertices[j][2];
             }
             // Center and index will be calculated in shader
             data[i * 12 + 9] = 0.0f; // center.x
@@ -748,6 +752,7 @@ int gpu_generate_contours(const stl_file_t* stl, float z_height,
         // CPU fallback - simplified contour generation
         *num_contours = 1;
         contours[0].num_points = 4;
+        contours[0].closed = 1;
         contours[0].points = malloc(4 * sizeof(point2d_t));
         
         // Simple bounding box contour
@@ -776,11 +781,12 @@ int gpu_generate_contours(const stl_file_t* stl, float z_height,
     if (triangle_data) {
         float* data = (float*)triangle_data;
         for (unsigned int i = 0; i < stl->num_triangles; i++) {
-            const stl_triangle_t* tri = &stl->triangles[i];
+            stl_triangle_t tri;
+            stl_get_triangle(stl, i, &tri);
             for (int j = 0; j < 3; j++) {
-                data[i * 9 + j * 3 + 0] = tri->vertices[j][0];
-                data[i * 9 + j * 3 + 1] = tri->vertices[j][1];
-                data[i * 9 + j * 3 + 2] = tri->vertices[j][2];
+                data[i * 9 + j * 3 + 0] = tri.vertices[j][0];
+                data[i * 9 + j * 3 + 1] = tri.vertices[j][1];
+                data[i * 9 + j * 3 + 2] = tri.vertices[j][2];
             }
         }
         gpu_unmap_buffer(triangle_buffer);
@@ -818,6 +824,7 @@ int gpu_generate_contours(const stl_file_t* stl, float z_height,
         if (num_points > 0 && num_points < 10000) {
             *num_contours = 1;
             contours[0].num_points = num_points;
+            contours[0].closed = 1;
             contours[0].points = malloc(num_points * sizeof(point2d_t));
             
             for (int i = 0; i < num_points; i++) {
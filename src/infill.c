@@ -0,0 +1,840 @@
+#include "infill.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+int infill_edge_table_build(infill_edge_table_t* table, const contour_t* contours, int num_contours,
+                            float angle, float strip_height) {
+    memset(table, 0, sizeof(infill_edge_table_t));
+    table->cos_angle = cosf(angle);
+    table->sin_angle = sinf(angle);
+    table->min_u = table->min_v = FLT_MAX;
+    table->max_u = table->max_v = -FLT_MAX;
+    if (strip_height <= 0.0f) return -1;
+    
+    // Bounds of the closed contours in the scan frame
+    float c = table->cos_angle, s = table->sin_angle;
+    int num_edges = 0;
+    for (int i = 0; i < num_contours; i++) {
+        const contour_t* contour = &contours[i];
+        if (!contour->closed || contour->num_points < 3) continue;
+        for (int p = 0; p < contour->num_points; p++) {
+            float u = contour->points[p].x * c + contour->points[p].y * s;
+            float v = contour->points[p].y * c - contour->points[p].x * s;
+            table->min_u = fminf(table->min_u, u);
+            table->max_u = fmaxf(table->max_u, u);
+            table->min_v = fminf(table->min_v, v);
+            table->max_v = fmaxf(table->max_v, v);
+        }
+        num_edges += contour->num_points;
+    }
+    if (num_edges == 0) return 0;
+    
+    double span = (double)table->max_v - table->min_v;
+    double strips = floor(span / strip_height) + 1.0;
+    if (strips > INFILL_MAX_STRIPS) {
+        strips = INFILL_MAX_STRIPS;
+        strip_height = (float)(span / (INFILL_MAX_STRIPS - 1));
+    }
+    table->num_strips = (int)strips;
+    table->strip_min_v = table->min_v;
+    table->strip_height = strip_height;
+    
+    table->strip_starts = calloc((size_t)table->num_strips + 1, sizeof(int));
+    int* fill = malloc(((size_t)table->num_strips + 1) * sizeof(int));
+    if (!table->strip_starts || !fill) {
+        free(fill);
+        infill_edge_table_free(table);
+        return -1;
+    }
+    
+    // Count entries per strip, then fill them in strip order
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < num_contours; i++) {
+            const contour_t* contour = &contours[i];
+            if (!contour->closed || contour->num_points < 3) continue;
+            for (int p = 0, q = contour->num_points - 1; p < contour->num_points; q = p++) {
+                point2d_t a = contour->points[q];
+                point2d_t b = contour->points[p];
+                float va = a.y * c - a.x * s;
+                float vb = b.y * c - b.x * s;
+                if (va == vb) continue;
+                
+                float ua = a.x * c + a.y * s;
+                float ub = b.x * c + b.y * s;
+                int winding = vb > va ? 1 : -1;
+                float v_min = winding > 0 ? va : vb;
+                float v_max = winding > 0 ? vb : va;
+                float u0 = winding > 0 ? ua : ub;
+                float slope = (winding > 0 ? ub - ua : ua - ub) / (v_max - v_min);
+                
+                int first = (int)((v_min - table->strip_min_v) / strip_height);
+                int last = (int)((v_max - table->strip_min_v) / strip_height);
+                if (first < 0) first = 0;
+                if (last >= table->num_strips) last = table->num_strips - 1;
+                for (int k = first; k <= last; k++) {
+                    if (pass == 0) {
+                        table->strip_starts[k + 1]++;
+                        continue;
+                    }
+                    int slot = fill[k]++;
+                    table->v_min[slot] = v_min;
+                    table->v_max[slot] = v_max;
+                    table->u0[slot] = u0;
+                    table->slope[slot] = slope;
+                    table->winding[slot] = winding;
+                }
+            }
+        }
+        
+        if (pass == 0) {
+            for (int k = 0; k < table->num_strips; k++) {
+                table->strip_starts[k + 1] += table->strip_starts[k];
+            }
+            memcpy(fill, table->strip_starts, (size_t)table->num_strips * sizeof(int));
+            
+            size_t entries = (size_t)table->strip_starts[table->num_strips] + 1;
+            table->v_min = malloc(entries * sizeof(float));
+            table->v_max = malloc(entries * sizeof(float));
+            table->u0 = malloc(entries * sizeof(float));
+            table->slope = malloc(entries * sizeof(float));
+            table->winding = malloc(entries * sizeof(int));
+            if (!table->v_min || !table->v_max || !table->u0 || !table->slope || !table->winding) {
+                free(fill);
+                infill_edge_table_free(table);
+                return -1;
+            }
+        }
+    }
+    
+    free(fill);
+    return 0;
+}
+
+void infill_edge_table_free(infill_edge_table_t* table) {
+    if (!table) return;
+    free(table->v_min);
+    free(table->v_max);
+    free(table->u0);
+    free(table->slope);
+    free(table->winding);
+    free(table->strip_starts);
+    table->v_min = table->v_max = table->u0 = table->slope = NULL;
+    table->winding = table->strip_starts = NULL;
+    table->num_strips = 0;
+}
+
+int infill_max_strip_edges(const infill_edge_table_t* table) {
+    int most = 0;
+    for (int s = 0; s < table->num_strips; s++) {
+        int count = table->strip_starts[s + 1] - table->strip_starts[s];
+        if (count > most) most = count;
+    }
+    return most;
+}
+
+// Edges are half-open in v, so a scanline through a vertex counts it exactly once.
+// Tests and interpolates 8 edges at a time with AVX2.
+int infill_scanline_crossings(const infill_edge_table_t* table, float v, infill_crossing_t* crossings) {
+    if (table->num_strips == 0) return 0;
+    int strip = (int)floorf((v - table->strip_min_v) / table->strip_height);
+    if (strip < 0 || strip >= table->num_strips) return 0;
+    
+    int count = 0;
+    int i = table->strip_starts[strip];
+    int end = table->strip_starts[strip + 1];
+
+#ifdef __AVX2__
+    __m256 vv = _mm256_set1_ps(v);
+    for (; i + 8 <= end; i += 8) {
+        __m256 lo = _mm256_loadu_ps(table->v_min + i);
+        __m256 below = _mm256_cmp_ps(lo, vv, _CMP_LE_OQ);
+        __m256 above = _mm256_cmp_ps(vv, _mm256_loadu_ps(table->v_max + i), _CMP_LT_OQ);
+        int bits = _mm256_movemask_ps(_mm256_and_ps(below, above));
+        if (!bits) continue;
+        
+        __m256 u = _mm256_add_ps(_mm256_loadu_ps(table->u0 + i),
+                                 _mm256_mul_ps(_mm256_sub_ps(vv, lo), _mm256_loadu_ps(table->slope + i)));
+        float lanes[8];
+        _mm256_storeu_ps(lanes, u);
+        for (int b = 0; b < 8; b++) {
+            if (bits & (1 << b)) {
+                crossings[count].u = lanes[b];
+                crossings[count].winding = table->winding[i + b];
+                count++;
+            }
+        }
+    }
+#endif
+    
+    for (; i < end; i++) {
+        if (table->v_min[i] <= v && v < table->v_max[i]) {
+            crossings[count].u = table->u0[i] + (v - table->v_min[i]) * table->slope[i];
+            crossings[count].winding = table->winding[i];
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+static int compare_crossings(const void* a, const void* b) {
+    float ua = ((const infill_crossing_t*)a)->u;
+    float ub = ((const infill_crossing_t*)b)->u;
+    return (ua > ub) - (ua < ub);
+}
+
+// Append one start/end pair
+static int infill_push_segment(point2d_t** points, int* num_points, int* capacity, point2d_t a, point2d_t b) {
+    if (*num_points + 2 > *capacity) {
+        int grown = *capacity < 32 ? 64 : *capacity * 2;
+        point2d_t* resized = realloc(*points, grown * sizeof(point2d_t));
+        if (!resized) return -1;
+        *points = resized;
+        *capacity = grown;
+    }
+    (*points)[(*num_points)++] = a;
+    (*points)[(*num_points)++] = b;
+    return 0;
+}
+
+// Back from the scan frame to model coordinates
+static point2d_t infill_from_scan(const infill_edge_table_t* table, float u, float v) {
+    float c = table->cos_angle, s = table->sin_angle;
+    return (point2d_t){ u * c - v * s, u * s + v * c };
+}
+
+int infill_scanlines(const contour_t* contours, int num_contours, float spacing, float angle, float shift,
+                     infill_rule_t rule, point2d_t** points, int* num_points) {
+    if (spacing <= 0.0f) return -1;
+    
+    // One strip per scanline, so each line only tests the edges crossing its strip
+    infill_edge_table_t table;
+    if (infill_edge_table_build(&table, contours, num_contours, angle, spacing) != 0) return -1;
+    if (table.num_strips == 0) return 0;
+    
+    infill_crossing_t* crossings = malloc(((size_t)infill_max_strip_edges(&table) + 1) * sizeof(infill_crossing_t));
+    if (!crossings) {
+        infill_edge_table_free(&table);
+        return -1;
+    }
+    
+    // Lines sit at (k + 0.5) * spacing + shift
+    shift = fmodf(shift, spacing);
+    int first = (int)ceilf((table.min_v - shift) / spacing - 0.5f);
+    int last = (int)floorf((table.max_v - shift) / spacing - 0.5f);
+    int capacity = *num_points;
+    int status = 0;
+    for (int k = first; k <= last && status == 0; k++) {
+        float v = (k + 0.5f) * spacing + shift;
+        int count = infill_scanline_crossings(&table, v, crossings);
+        if (count < 2) continue;
+        qsort(crossings, count, sizeof(infill_crossing_t), compare_crossings);
+        
+        // Walk the crossings left to right, emitting the spans the rule calls inside
+        int winding = 0;
+        float start = 0.0f;
+        for (int i = 0; i < count && status == 0; i++) {
+            int was_inside = rule == INFILL_RULE_EVEN_ODD ? (winding & 1) : winding != 0;
+            winding += rule == INFILL_RULE_EVEN_ODD ? 1 : crossings[i].winding;
+            int inside = rule == INFILL_RULE_EVEN_ODD ? (winding & 1) : winding != 0;
+            
+            if (!was_inside && inside) {
+                start = crossings[i].u;
+            } else if (was_inside && !inside && crossings[i].u > start) {
+                status = infill_push_segment(points, num_points, &capacity, infill_from_scan(&table, start, v),
+                                             infill_from_scan(&table, crossings[i].u, v));
+            }
+        }
+    }
+    
+    free(crossings);
+    infill_edge_table_free(&table);
+    return status;
+}
+
+void infill_clipper_free(infill_clipper_t* clipper) {
+    free(clipper->edges);
+    free(clipper->cell_starts);
+    free(clipper->cell_edges);
+    free(clipper->stamps);
+    free(clipper->crossings);
+    free(clipper->hits);
+    infill_edge_table_free(&clipper->rays);
+}
+
+int infill_clipper_build(infill_clipper_t* clipper, const contour_t* contours, int num_contours) {
+    memset(clipper, 0, sizeof(infill_clipper_t));
+    
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (int i = 0; i < num_contours; i++) {
+        const contour_t* contour = &contours[i];
+        if (!contour->closed || contour->num_points < 3) continue;
+        for (int p = 0; p < contour->num_points; p++) {
+            min_x = fminf(min_x, contour->points[p].x);
+            min_y = fminf(min_y, contour->points[p].y);
+            max_x = fmaxf(max_x, contour->points[p].x);
+            max_y = fmaxf(max_y, contour->points[p].y);
+        }
+        clipper->num_edges += contour->num_points;
+    }
+    if (clipper->num_edges == 0) return 0;
+    
+    // About one edge per cell
+    float width = max_x - min_x, height = max_y - min_y;
+    clipper->cells.cell_size = sqrtf(fmaxf(width * height, 1e-6f) / clipper->num_edges);
+    if (clipper->cells.cell_size < 1e-3f) clipper->cells.cell_size = 1e-3f;
+    clipper->cells.nx = (int)(width / clipper->cells.cell_size) + 1;
+    clipper->cells.ny = (int)(height / clipper->cells.cell_size) + 1;
+    clipper->cells.min_x = min_x;
+    clipper->cells.min_y = min_y;
+    
+    size_t num_cells = (size_t)clipper->cells.nx * clipper->cells.ny;
+    clipper->edges = malloc((size_t)clipper->num_edges * 4 * sizeof(float));
+    clipper->stamps = malloc((size_t)clipper->num_edges * sizeof(int));
+    clipper->cell_starts = calloc(num_cells + 1, sizeof(int));
+    int* fill = malloc((num_cells + 1) * sizeof(int));
+    if (!clipper->edges || !clipper->stamps || !clipper->cell_starts || !fill) {
+        free(fill);
+        infill_clipper_free(clipper);
+        return -1;
+    }
+    
+    int count = 0;
+    for (int i = 0; i < num_contours; i++) {
+        const contour_t* contour = &contours[i];
+        if (!contour->closed || contour->num_points < 3) continue;
+        for (int p = 0, q = contour->num_points - 1; p < contour->num_points; q = p++) {
+            float* edge = &clipper->edges[count++ * 4];
+            edge[0] = contour->points[q].x;
+            edge[1] = contour->points[q].y;
+            edge[2] = contour->points[p].x;
+            edge[3] = contour->points[p].y;
+        }
+    }
+    
+    for (int pass = 0; pass < 2; pass++) {
+        for (int e = 0; e < clipper->num_edges; e++) {
+            const float* edge = &clipper->edges[e * 4];
+            int x0, y0, x1, y1;
+            cell_grid_cell(&clipper->cells, fminf(edge[0], edge[2]), fminf(edge[1], edge[3]), &x0, &y0);
+            cell_grid_cell(&clipper->cells, fmaxf(edge[0], edge[2]), fmaxf(edge[1], edge[3]), &x1, &y1);
+            for (int cy = y0; cy <= y1; cy++) {
+                for (int cx = x0; cx <= x1; cx++) {
+                    size_t cell = (size_t)cy * clipper->cells.nx + cx;
+                    if (pass == 0) clipper->cell_starts[cell + 1]++;
+                    else clipper->cell_edges[fill[cell]++] = e;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (size_t c = 0; c < num_cells; c++) clipper->cell_starts[c + 1] += clipper->cell_starts[c];
+            memcpy(fill, clipper->cell_starts, num_cells * sizeof(int));
+            clipper->cell_edges = malloc(((size_t)clipper->cell_starts[num_cells] + 1) * sizeof(int));
+            if (!clipper->cell_edges) {
+                free(fill);
+                infill_clipper_free(clipper);
+                return -1;
+            }
+        }
+    }
+    free(fill);
+    for (int e = 0; e < clipper->num_edges; e++) clipper->stamps[e] = -1;
+    
+    if (infill_edge_table_build(&clipper->rays, contours, num_contours, 0.0f, clipper->cells.cell_size) != 0) {
+        infill_clipper_free(clipper);
+        return -1;
+    }
+    clipper->crossings = malloc(((size_t)infill_max_strip_edges(&clipper->rays) + 1) * sizeof(infill_crossing_t));
+    if (!clipper->crossings) {
+        infill_clipper_free(clipper);
+        return -1;
+    }
+    return 0;
+}
+
+static int infill_inside(int winding, infill_rule_t rule) {
+    return rule == INFILL_RULE_EVEN_ODD ? (winding & 1) : winding != 0;
+}
+
+// Winding number (crossing count under even-odd) from a ray towards +x
+static int infill_clipper_winding(const infill_clipper_t* clipper, float x, float y, infill_rule_t rule) {
+    int count = infill_scanline_crossings(&clipper->rays, y, clipper->crossings);
+    int winding = 0;
+    for (int i = 0; i < count; i++) {
+        if (clipper->crossings[i].u > x) {
+            winding += rule == INFILL_RULE_EVEN_ODD ? 1 : clipper->crossings[i].winding;
+        }
+    }
+    return winding;
+}
+
+int infill_clipper_inside(const infill_clipper_t* clipper, float x, float y, infill_rule_t rule) {
+    if (clipper->num_edges == 0) return 0;
+    return infill_inside(infill_clipper_winding(clipper, x, y, rule), rule);
+}
+
+// Nearest-edge search state for cell_grid_nearest
+typedef struct {
+    const infill_clipper_t* clipper;
+    float x, y;
+    float best;
+    point2d_t* nearest;
+} infill_nearest_t;
+
+static float infill_nearest_visit(void* context, int cell) {
+    infill_nearest_t* search = (infill_nearest_t*)context;
+    const infill_clipper_t* clipper = search->clipper;
+    float x = search->x, y = search->y;
+    for (int c = clipper->cell_starts[cell]; c < clipper->cell_starts[cell + 1]; c++) {
+        const float* edge = &clipper->edges[clipper->cell_edges[c] * 4];
+        float ex = edge[2] - edge[0], ey = edge[3] - edge[1];
+        float length2 = ex * ex + ey * ey;
+        float t = length2 > 0.0f ? ((x - edge[0]) * ex + (y - edge[1]) * ey) / length2 : 0.0f;
+        t = fminf(fmaxf(t, 0.0f), 1.0f);
+        float px = edge[0] + t * ex, py = edge[1] + t * ey;
+        float d = sqrtf((px - x) * (px - x) + (py - y) * (py - y));
+        if (d < search->best) {
+            search->best = d;
+            if (search->nearest) *search->nearest = (point2d_t){ px, py };
+        }
+    }
+    return search->best * search->best;
+}
+
+float infill_clipper_nearest(const infill_clipper_t* clipper, float x, float y, point2d_t* nearest) {
+    infill_nearest_t search = { clipper, x, y, FLT_MAX, nearest };
+    if (clipper->num_edges == 0) return search.best;
+    cell_grid_nearest(&clipper->cells, x, y, infill_nearest_visit, &search);
+    return search.best;
+}
+
+int infill_clipper_spans(const infill_clipper_t* clipper, float y, infill_rule_t rule, float* spans) {
+    if (clipper->num_edges == 0) return 0;
+    int count = infill_scanline_crossings(&clipper->rays, y, clipper->crossings);
+    if (count < 2) return 0;
+    qsort(clipper->crossings, count, sizeof(infill_crossing_t), compare_crossings);
+    
+    int winding = 0, num_spans = 0;
+    for (int i = 0; i < count; i++) {
+        int was_inside = infill_inside(winding, rule);
+        winding += rule == INFILL_RULE_EVEN_ODD ? 1 : clipper->crossings[i].winding;
+        int inside = infill_inside(winding, rule);
+        if (!was_inside && inside) {
+            spans[num_spans * 2] = clipper->crossings[i].u;
+        } else if (was_inside && !inside && clipper->crossings[i].u > spans[num_spans * 2]) {
+            spans[num_spans * 2 + 1] = clipper->crossings[i].u;
+            num_spans++;
+        }
+    }
+    return num_spans;
+}
+
+// Where segment p->q crosses region edges, as t in [0, 1) so a polyline joint counts once
+static int infill_clipper_hits(infill_clipper_t* clipper, point2d_t p, point2d_t q) {
+    float dx = q.x - p.x, dy = q.y - p.y;
+    int x0, y0, x1, y1;
+    cell_grid_cell(&clipper->cells, fminf(p.x, q.x), fminf(p.y, q.y), &x0, &y0);
+    cell_grid_cell(&clipper->cells, fmaxf(p.x, q.x), fmaxf(p.y, q.y), &x1, &y1);
+    int segment = ++clipper->segment;
+    
+    int num_hits = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            size_t cell = (size_t)cy * clipper->cells.nx + cx;
+            for (int k = clipper->cell_starts[cell]; k < clipper->cell_starts[cell + 1]; k++) {
+                int e = clipper->cell_edges[k];
+                if (clipper->stamps[e] == segment) continue;
+                clipper->stamps[e] = segment;
+                
+                // Edge endpoints on the segment's line count as right of it
+                const float* edge = &clipper->edges[e * 4];
+                int left_a = dx * (edge[1] - p.y) - dy * (edge[0] - p.x) > 0;
+                int left_b = dx * (edge[3] - p.y) - dy * (edge[2] - p.x) > 0;
+                if (left_a == left_b) continue;
+                
+                float ex = edge[2] - edge[0], ey = edge[3] - edge[1];
+                float denom = dx * ey - dy * ex;
+                if (denom == 0.0f) continue;
+                float t = ((edge[0] - p.x) * ey - (edge[1] - p.y) * ex) / denom;
+                if (t < 0.0f || t >= 1.0f) continue;
+                
+                if (num_hits == clipper->hit_capacity) {
+                    int grown = clipper->hit_capacity ? clipper->hit_capacity * 2 : 16;
+                    infill_hit_t* hits = realloc(clipper->hits, grown * sizeof(infill_hit_t));
+                    if (!hits) return -1;
+                    clipper->hits = hits;
+                    clipper->hit_capacity = grown;
+                }
+                // Passing an edge from its right to its left enters the region
+                clipper->hits[num_hits++] = (infill_hit_t){ t, left_a ? 1 : -1 };
+            }
+        }
+    }
+    
+    // Few hits per segment; insertion sort
+    for (int i = 1; i < num_hits; i++) {
+        infill_hit_t hit = clipper->hits[i];
+        int j = i - 1;
+        while (j >= 0 && clipper->hits[j].t > hit.t) {
+            clipper->hits[j + 1] = clipper->hits[j];
+            j--;
+        }
+        clipper->hits[j + 1] = hit;
+    }
+    return num_hits;
+}
+
+int infill_clipper_clip(infill_clipper_t* clipper, const point2d_t* points, const int* starts, int num_polylines,
+                        infill_rule_t rule, point2d_t** out, int* num_out) {
+    if (clipper->num_edges == 0) return 0;
+    
+    int capacity = *num_out;
+    int status = 0;
+    for (int l = 0; l < num_polylines && status == 0; l++) {
+        const point2d_t* line = &points[starts[l]];
+        int count = starts[l + 1] - starts[l];
+        if (count < 2) continue;
+        
+        int winding = infill_clipper_winding(clipper, line[0].x, line[0].y, rule);
+        for (int i = 0; i + 1 < count && status == 0; i++) {
+            point2d_t p = line[i], q = line[i + 1];
+            if (p.x == q.x && p.y == q.y) continue;
+            
+            int num_hits = infill_clipper_hits(clipper, p, q);
+            if (num_hits < 0) {
+                status = -1;
+                break;
+            }
+            
+            // Inside stretches of the segment; untouched ends are copied exactly so
+            // consecutive pieces share their endpoints
+            point2d_t start = p;
+            for (int h = 0; h < num_hits && status == 0; h++) {
+                int was_inside = infill_inside(winding, rule);
+                winding += rule == INFILL_RULE_EVEN_ODD ? 1 : clipper->hits[h].delta;
+                int inside = infill_inside(winding, rule);
+                
+                point2d_t at = { p.x + clipper->hits[h].t * (q.x - p.x), p.y + clipper->hits[h].t * (q.y - p.y) };
+                if (!was_inside && inside) {
+                    start = at;
+                } else if (was_inside && !inside) {
+                    status = infill_push_segment(out, num_out, &capacity, start, at);
+                }
+            }
+            if (status == 0 && infill_inside(winding, rule)) {
+                status = infill_push_segment(out, num_out, &capacity, start, q);
+            }
+        }
+    }
+    
+    return status;
+}
+
+int infill_clip_polylines(const contour_t* contours, int num_contours, const point2d_t* points,
+                          const int* starts, int num_polylines, infill_rule_t rule,
+                          point2d_t** out, int* num_out) {
+    infill_clipper_t clipper;
+    if (infill_clipper_build(&clipper, contours, num_contours) != 0) return -1;
+    
+    int status = infill_clipper_clip(&clipper, points, starts, num_polylines, rule, out, num_out);
+    infill_clipper_free(&clipper);
+    return status;
+}
+
+// Gyroid: sin(kx)cos(ky) + sin(ky)cos(kz) + sin(kz)cos(kx) = 0 with k = 2 pi / period
+static float infill_gyroid_value(float x, float y, float z, float k) {
+    return sinf(k * x) * cosf(k * y) + sinf(k * y) * cosf(k * z) + sinf(k * z) * cosf(k * x);
+}
+
+// Sample (i, j) of a grid wrapping around the period
+static float infill_gyroid_sample(const float* values, int n, int i, int j) {
+    return values[(j % n) * n + (i % n)];
+}
+
+static int infill_tile_push(infill_tile_t* tile, int* num_points, int* capacity, point2d_t point) {
+    if (*num_points == *capacity) {
+        int grown = *capacity ? *capacity * 2 : 256;
+        point2d_t* points = realloc(tile->points, grown * sizeof(point2d_t));
+        if (!points) return -1;
+        tile->points = points;
+        *capacity = grown;
+    }
+    tile->points[(*num_points)++] = point;
+    return 0;
+}
+
+// Trace the gyroid's cross-section at z over one period with marching squares and chain
+// the pieces into polylines. Samples wrap around the period, so polylines leaving one
+// tile meet the next tile's polylines where they enter it.
+static int infill_gyroid_tile(infill_tile_t* tile, float period, float z) {
+    const int n = INFILL_GYROID_SAMPLES;
+    const int num_h = n * (n + 1);             // Horizontal grid edges, (i, j) -> (i + 1, j)
+    const int num_ids = num_h + (n + 1) * n;   // Then vertical ones, (i, j) -> (i, j + 1)
+    float k = 2.0f * (float)M_PI / period;
+    float cell = period / n;
+    
+    memset(tile, 0, sizeof(infill_tile_t));
+    float* values = malloc((size_t)n * n * sizeof(float));
+    int* seg_a = malloc((size_t)n * n * 2 * sizeof(int));
+    int* seg_b = malloc((size_t)n * n * 2 * sizeof(int));
+    int* adjacent = malloc((size_t)num_ids * 2 * sizeof(int));
+    unsigned char* visited = calloc((size_t)n * n * 2, 1);
+    tile->starts = malloc(((size_t)n * n * 2 + 1) * sizeof(int));
+    int status = values && seg_a && seg_b && adjacent && visited && tile->starts ? 0 : -1;
+    
+    // One or two segments per cell between crossed edges; saddles are split by the center
+    int num_segments = 0;
+    if (status == 0) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                values[j * n + i] = infill_gyroid_value(i * cell, j * cell, z, k);
+            }
+        }
+        for (int id = 0; id < num_ids * 2; id++) adjacent[id] = -1;
+        
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                float c[4] = {
+                    infill_gyroid_sample(values, n, i, j), infill_gyroid_sample(values, n, i + 1, j),
+                    infill_gyroid_sample(values, n, i + 1, j + 1), infill_gyroid_sample(values, n, i, j + 1)
+                };
+                // Bottom, right, top, left; edge e joins corners e and e + 1
+                int ids[4] = { j * n + i, num_h + j * (n + 1) + i + 1, (j + 1) * n + i, num_h + j * (n + 1) + i };
+                int crossed[4];
+                int num_crossed = 0;
+                for (int e = 0; e < 4; e++) {
+                    if ((c[e] >= 0.0f) != (c[(e + 1) % 4] >= 0.0f)) crossed[num_crossed++] = e;
+                }
+                
+                int pairs[2][2] = { { crossed[0], crossed[1] }, { 0, 0 } };
+                int num_pairs = num_crossed == 2 ? 1 : 0;
+                if (num_crossed == 4) {
+                    // Center on corner 0's side joins corners 0 and 2; cut off 1 and 3 instead
+                    float center = infill_gyroid_value((i + 0.5f) * cell, (j + 0.5f) * cell, z, k);
+                    int join = (center >= 0.0f) == (c[0] >= 0.0f);
+                    pairs[0][0] = join ? 0 : 3;
+                    pairs[0][1] = join ? 1 : 0;
+                    pairs[1][0] = join ? 2 : 1;
+                    pairs[1][1] = join ? 3 : 2;
+                    num_pairs = 2;
+                }
+                for (int p = 0; p < num_pairs; p++) {
+                    seg_a[num_segments] = ids[pairs[p][0]];
+                    seg_b[num_segments] = ids[pairs[p][1]];
+                    int* slot_a = &adjacent[seg_a[num_segments] * 2];
+                    int* slot_b = &adjacent[seg_b[num_segments] * 2];
+                    slot_a[slot_a[0] >= 0] = num_segments;
+                    slot_b[slot_b[0] >= 0] = num_segments;
+                    num_segments++;
+                }
+            }
+        }
+    }
+    
+    // Walk from crossings on the tile border first so open polylines are taken end to
+    // end, then pick up the closed loops that remain
+    int num_points = 0;
+    int capacity = 0;
+    for (int pass = 0; pass < 2 && status == 0; pass++) {
+        for (int id = 0; id < num_ids && status == 0; id++) {
+            int current = adjacent[id * 2];
+            if (current < 0 || visited[current]) continue;
+            if (pass == 0 && adjacent[id * 2 + 1] >= 0) continue;
+            
+            tile->starts[tile->num_polylines] = num_points;
+            int at = id;
+            while (status == 0) {
+                int vertical = at >= num_h;
+                int index = vertical ? at - num_h : at;
+                int i = vertical ? index % (n + 1) : index % n;
+                int j = vertical ? index / (n + 1) : index / n;
+                float v0 = infill_gyroid_sample(values, n, i, j);
+                float v1 = vertical ? infill_gyroid_sample(values, n, i, j + 1) : infill_gyroid_sample(values, n, i + 1, j);
+                float t = v0 / (v0 - v1);
+                point2d_t point = vertical ? (point2d_t){ i * cell, (j + t) * cell } : (point2d_t){ (i + t) * cell, j * cell };
+                status = infill_tile_push(tile, &num_points, &capacity, point);
+                if (current < 0) break;
+                
+                visited[current] = 1;
+                at = seg_a[current] == at ? seg_b[current] : seg_a[current];
+                int next = adjacent[at * 2] == current ? adjacent[at * 2 + 1] : adjacent[at * 2];
+                current = next >= 0 && !visited[next] ? next : -1;
+            }
+            tile->num_polylines++;
+        }
+    }
+    if (tile->starts) tile->starts[tile->num_polylines] = num_points;
+    
+    free(values);
+    free(seg_a);
+    free(seg_b);
+    free(adjacent);
+    free(visited);
+    return status;
+}
+
+// Straight-line patterns are families of parallel lines. Triangles offset one family by
+// half a spacing so all three meet at common points; cubic slides each family sideways
+// by z / sqrt(2), tracing cubes stood on a corner. Lightning is grown over the whole
+// model afterwards (lightning.c), so its plan fills nothing per layer.
+static const infill_pattern_info_t infill_patterns[] = {
+    { "rectilinear", INFILL_PATTERN_RECTILINEAR, 2, { 45.0f, 135.0f }, { 0.0f, 0.0f }, 0.0f, 1 },
+    { "grid", INFILL_PATTERN_GRID, 2, { 45.0f, 135.0f }, { 0.0f, 0.0f }, 0.0f, 0 },
+    { "triangles", INFILL_PATTERN_TRIANGLES, 3, { 0.0f, 60.0f, 120.0f }, { 0.0f, 0.0f, 0.5f }, 0.0f, 0 },
+    { "cubic", INFILL_PATTERN_CUBIC, 3, { 0.0f, 120.0f, 240.0f }, { 0.0f, 0.0f, 0.0f }, 0.70710678f, 0 },
+    { "gyroid", INFILL_PATTERN_GYROID, 0, { 0.0f }, { 0.0f }, 0.0f, 0 },
+    { "lightning", INFILL_PATTERN_LIGHTNING, 0, { 0.0f }, { 0.0f }, 0.0f, 0 }
+};
+
+#define INFILL_NUM_PATTERNS ((int)(sizeof(infill_patterns) / sizeof(infill_patterns[0])))
+
+const infill_pattern_info_t* infill_pattern_lookup(const char* name) {
+    for (int i = 0; i < INFILL_NUM_PATTERNS; i++) {
+        if (strcmp(infill_patterns[i].name, name) == 0) return &infill_patterns[i];
+    }
+    return NULL;
+}
+
+const infill_pattern_info_t* infill_pattern_info(infill_pattern_t pattern) {
+    for (int i = 0; i < INFILL_NUM_PATTERNS; i++) {
+        if (infill_patterns[i].pattern == pattern) return &infill_patterns[i];
+    }
+    return &infill_patterns[0];
+}
+
+// Line spacing keeps the printed area fraction at the density: one family per layer
+// prints at bead spacing / density, n families together need n times the spacing. The
+// plan serves every layer, so the bead is the one of the nominal layer height. The gyroid
+// period follows from its wall area per unit volume.
+infill_plan_t* infill_plan_create(const slicing_params_t* params) {
+    if (params->infill_density <= 0.0f) return NULL;
+    
+    infill_plan_t* plan = calloc(1, sizeof(infill_plan_t));
+    if (!plan) return NULL;
+    
+    float width = extrusion_spacing(params, params->infill_width, params->layer_height);
+    float density = fminf(params->infill_density, 1.0f);
+    plan->info = infill_pattern_info(params->infill_pattern);
+    plan->num_families = plan->info->num_families;
+    
+    float spacing = width / density * (plan->info->alternate ? 1 : plan->num_families);
+    for (int f = 0; f < plan->num_families; f++) {
+        plan->families[f].angle = plan->info->angles[f] * (float)M_PI / 180.0f;
+        plan->families[f].spacing = spacing;
+        plan->families[f].shift = plan->info->phases[f] * spacing;
+        plan->families[f].shift_per_z = plan->info->shift_per_z;
+    }
+    
+    if (plan->info->pattern == INFILL_PATTERN_GYROID) {
+        plan->period = INFILL_GYROID_AREA_RATIO * width / density;
+        plan->tiles = calloc(INFILL_GYROID_PHASES, sizeof(infill_tile_t));
+        if (!plan->tiles) {
+            free(plan);
+            return NULL;
+        }
+        for (int i = 0; i < INFILL_GYROID_PHASES; i++) {
+            if (infill_gyroid_tile(&plan->tiles[i], plan->period, plan->period * i / INFILL_GYROID_PHASES) != 0) {
+                infill_plan_free(plan);
+                return NULL;
+            }
+        }
+    }
+    
+    return plan;
+}
+
+void infill_plan_free(infill_plan_t* plan) {
+    if (!plan) return;
+    if (plan->tiles) {
+        for (int i = 0; i < INFILL_GYROID_PHASES; i++) {
+            free(plan->tiles[i].points);
+            free(plan->tiles[i].starts);
+        }
+        free(plan->tiles);
+    }
+    free(plan);
+}
+
+// Lay copies of the gyroid slice nearest z over the region's bounding box and clip them
+static int infill_plan_fill_gyroid(const infill_plan_t* plan, const contour_t* contours, int num_contours,
+                                   float z, infill_rule_t rule, point2d_t** points, int* num_points) {
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (int i = 0; i < num_contours; i++) {
+        if (!contours[i].closed) continue;
+        for (int p = 0; p < contours[i].num_points; p++) {
+            min_x = fminf(min_x, contours[i].points[p].x);
+            min_y = fminf(min_y, contours[i].points[p].y);
+            max_x = fmaxf(max_x, contours[i].points[p].x);
+            max_y = fmaxf(max_y, contours[i].points[p].y);
+        }
+    }
+    if (min_x > max_x) return 0;
+    
+    int phase = (int)floorf(z / plan->period * INFILL_GYROID_PHASES + 0.5f) % INFILL_GYROID_PHASES;
+    if (phase < 0) phase += INFILL_GYROID_PHASES;
+    const infill_tile_t* tile = &plan->tiles[phase];
+    int tile_points = tile->starts[tile->num_polylines];
+    if (tile_points == 0) return 0;
+    
+    int x0 = (int)floorf(min_x / plan->period), x1 = (int)floorf(max_x / plan->period);
+    int y0 = (int)floorf(min_y / plan->period), y1 = (int)floorf(max_y / plan->period);
+    size_t num_tiles = (size_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    point2d_t* placed = malloc(num_tiles * tile_points * sizeof(point2d_t));
+    int* starts = malloc((num_tiles * tile->num_polylines + 1) * sizeof(int));
+    if (!placed || !starts) {
+        free(placed);
+        free(starts);
+        return -1;
+    }
+    
+    int num_placed = 0;
+    int num_polylines = 0;
+    for (int ty = y0; ty <= y1; ty++) {
+        for (int tx = x0; tx <= x1; tx++) {
+            float ox = tx * plan->period, oy = ty * plan->period;
+            for (int l = 0; l < tile->num_polylines; l++) {
+                starts[num_polylines++] = num_placed;
+                for (int p = tile->starts[l]; p < tile->starts[l + 1]; p++) {
+                    placed[num_placed++] = (point2d_t){ tile->points[p].x + ox, tile->points[p].y + oy };
+                }
+            }
+        }
+    }
+    starts[num_polylines] = num_placed;
+    
+    int status = infill_clip_polylines(contours, num_contours, placed, starts, num_polylines, rule,
+                                       points, num_points);
+    free(placed);
+    free(starts);
+    return status;
+}
+
+int infill_plan_fill(const infill_plan_t* plan, const contour_t* contours, int num_contours,
+                     int layer_index, float z, infill_rule_t rule, point2d_t** points, int* num_points) {
+    if (!plan) return 0;
+    if (plan->tiles) {
+        return infill_plan_fill_gyroid(plan, contours, num_contours, z, rule, points, num_points);
+    }
+    
+    int first = 0, last = plan->num_families;
+    if (plan->info->alternate && plan->num_families > 0) {
+        first = layer_index % plan->num_families;
+        last = first + 1;
+    }
+    for (int f = first; f < last; f++) {
+        const infill_family_t* family = &plan->families[f];
+        if (infill_scanlines(contours, num_contours, family->spacing, family->angle,
+                             family->shift + family->shift_per_z * z, rule, points, num_points) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
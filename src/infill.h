@@ -0,0 +1,144 @@
+#ifndef INFILL_H
+#define INFILL_H
+
+#include "slicer.h"
+#include "cell_grid.h"
+
+// Scanline infill. A region's edges are rotated into a scan frame where lines run along
+// u at fixed v, then bucketed into strips of v so each scanline only tests the edges
+// that can reach it.
+
+// Edge tables with more scanlines than this are bucketed more coarsely
+#define INFILL_MAX_STRIPS 65536
+
+// Line sets per pattern, at most
+#define INFILL_MAX_FAMILIES 3
+
+// Gyroid tiles: samples per period along x and y, and precomputed z-slices per period
+#define INFILL_GYROID_SAMPLES 32
+#define INFILL_GYROID_PHASES 64
+
+// Gyroid wall area per unit cell volume, in units of 1 / period; sets the period for a density
+#define INFILL_GYROID_AREA_RATIO 3.0967f
+
+// Crossing of a scanline with one edge; winding is +1 for edges running up in v
+typedef struct {
+    float u;
+    int winding;
+} infill_crossing_t;
+
+// Region edges in SoA form, grouped by strip; an edge spanning several strips is
+// stored once per strip so every strip is one contiguous run for the kernel
+typedef struct {
+    float* v_min;            // Lower end of the edge (inclusive)
+    float* v_max;            // Upper end of the edge (exclusive)
+    float* u0;               // u at v_min
+    float* slope;            // du/dv
+    int* winding;
+    int* strip_starts;       // Strip s holds entries [strip_starts[s], strip_starts[s + 1])
+    int num_strips;
+    float strip_min_v;
+    float strip_height;
+    float cos_angle, sin_angle; // Rotation from model to scan frame
+    float min_u, max_u, min_v, max_v;
+} infill_edge_table_t;
+
+// Region index for clipping and point queries. Region edges sit in a uniform grid so a
+// segment only tests the edges near it; winding numbers come from scanlines at angle 0.
+typedef struct {
+    float t;                     // Position along the segment
+    int delta;                   // Winding change when passing it
+} infill_hit_t;
+
+typedef struct {
+    float* edges;                // ax, ay, bx, by per edge
+    int num_edges;
+    int* cell_starts;
+    int* cell_edges;
+    int* stamps;                 // Last segment that tested each edge
+    int segment;
+    cell_grid_t cells;
+    infill_edge_table_t rays;
+    infill_crossing_t* crossings;
+    infill_hit_t* hits;
+    int hit_capacity;
+} infill_clipper_t;
+
+// Straight lines at angle (radians), spacing apart, moved across by shift + shift_per_z * z
+typedef struct {
+    float angle;
+    float spacing;
+    float shift;
+    float shift_per_z;
+} infill_family_t;
+
+// Pattern catalogue: straight-line patterns list their families, gyroid uses tiles
+typedef struct {
+    const char* name;
+    infill_pattern_t pattern;
+    int num_families;
+    float angles[INFILL_MAX_FAMILIES]; // Degrees
+    float phases[INFILL_MAX_FAMILIES]; // Line offsets, in spacings
+    float shift_per_z;
+    int alternate;           // Print one family per layer, taking turns
+} infill_pattern_info_t;
+
+// Gyroid cross-section at one z within a single period tile, as polylines;
+// polyline p is points[starts[p]] .. points[starts[p + 1] - 1]
+typedef struct {
+    point2d_t* points;
+    int* starts;
+    int num_polylines;
+} infill_tile_t;
+
+// Everything a pattern needs per layer, built once per model
+typedef struct infill_plan {
+    const infill_pattern_info_t* info;
+    infill_family_t families[INFILL_MAX_FAMILIES];
+    int num_families;
+    float period;            // Gyroid tile size (mm)
+    infill_tile_t* tiles;    // INFILL_GYROID_PHASES slices through one period of z
+} infill_plan_t;
+
+// Function declarations
+int infill_edge_table_build(infill_edge_table_t* table, const contour_t* contours, int num_contours,
+                            float angle, float strip_height);
+void infill_edge_table_free(infill_edge_table_t* table);
+
+// Crossings of the scanline at v, unsorted; crossings must hold every edge of v's strip
+int infill_scanline_crossings(const infill_edge_table_t* table, float v, infill_crossing_t* crossings);
+int infill_max_strip_edges(const infill_edge_table_t* table);
+
+// Lines at the given angle (radians from the x axis), spacing apart on a grid anchored
+// at the origin and moved across by shift, so they line up between layers. Clipped to
+// the inside of the closed contours under the rule; appends start/end point pairs.
+int infill_scanlines(const contour_t* contours, int num_contours, float spacing, float angle, float shift,
+                     infill_rule_t rule, point2d_t** points, int* num_points);
+
+int infill_clipper_build(infill_clipper_t* clipper, const contour_t* contours, int num_contours);
+void infill_clipper_free(infill_clipper_t* clipper);
+int infill_clipper_inside(const infill_clipper_t* clipper, float x, float y, infill_rule_t rule);
+
+// Distance to the nearest region edge (FLT_MAX without edges), and the point on it
+float infill_clipper_nearest(const infill_clipper_t* clipper, float x, float y, point2d_t* nearest);
+
+// Inside x ranges of the row at y as start/end pairs; spans must hold every edge of y's strip
+int infill_clipper_spans(const infill_clipper_t* clipper, float y, infill_rule_t rule, float* spans);
+
+// Clip polylines to the inside of the closed contours; appends start/end point pairs,
+// consecutive pairs along a polyline sharing their endpoint exactly
+int infill_clipper_clip(infill_clipper_t* clipper, const point2d_t* points, const int* starts, int num_polylines,
+                        infill_rule_t rule, point2d_t** out, int* num_out);
+int infill_clip_polylines(const contour_t* contours, int num_contours, const point2d_t* points,
+                          const int* starts, int num_polylines, infill_rule_t rule,
+                          point2d_t** out, int* num_out);
+
+const infill_pattern_info_t* infill_pattern_lookup(const char* name);
+const infill_pattern_info_t* infill_pattern_info(infill_pattern_t pattern);
+
+infill_plan_t* infill_plan_create(const slicing_params_t* params);
+void infill_plan_free(infill_plan_t* plan);
+int infill_plan_fill(const infill_plan_t* plan, const contour_t* contours, int num_contours,
+                     int layer_index, float z, infill_rule_t rule, point2d_t** points, int* num_points);
+
+#endif // INFILL_H
@@ -0,0 +1,417 @@
+#include "lightning.h"
+#include "infill.h"
+#include <math.h>
+#include <string.h>
+
+// Tree node; roots (parent -1) sit on the wall
+typedef struct {
+    float x, y;
+    int parent;
+} lightning_node_t;
+
+// Forest of branches, its nodes bucketed in a uniform grid for nearest-branch lookups
+typedef struct {
+    lightning_node_t* nodes;
+    int num_nodes;
+    int capacity;
+    int* next;               // Next node in the same cell, -1 at the end
+    int* heads;              // First node of each cell
+    size_t num_cells;
+    int indexed;             // New nodes go into the grid
+    cell_grid_t cells;
+} lightning_tree_t;
+
+// Top-surface point that needs holding up, and how far it is from the wall
+typedef struct {
+    float x, y;
+    float wall;
+} lightning_sample_t;
+
+static void lightning_tree_free(lightning_tree_t* tree) {
+    free(tree->nodes);
+    free(tree->next);
+    free(tree->heads);
+}
+
+static int lightning_add_node(lightning_tree_t* tree, float x, float y, int parent) {
+    if (tree->num_nodes == tree->capacity) {
+        int grown = tree->capacity ? tree->capacity * 2 : 256;
+        lightning_node_t* nodes = realloc(tree->nodes, grown * sizeof(lightning_node_t));
+        if (!nodes) return -1;
+        tree->nodes = nodes;
+        int* next = realloc(tree->next, grown * sizeof(int));
+        if (!next) return -1;
+        tree->next = next;
+        tree->capacity = grown;
+    }
+    
+    int index = tree->num_nodes++;
+    tree->nodes[index] = (lightning_node_t){ x, y, parent };
+    if (tree->indexed) {
+        int cell = cell_grid_cell(&tree->cells, x, y, NULL, NULL);
+        tree->next[index] = tree->heads[cell];
+        tree->heads[cell] = index;
+    }
+    return index;
+}
+
+// Hang child from parent, adding nodes along the way so no gap is longer than spacing
+static int lightning_connect(lightning_tree_t* tree, int parent, int child, float spacing) {
+    float px = tree->nodes[parent].x, py = tree->nodes[parent].y;
+    float dx = tree->nodes[child].x - px, dy = tree->nodes[child].y - py;
+    int steps = (int)ceilf(sqrtf(dx * dx + dy * dy) / spacing);
+    
+    int previous = parent;
+    for (int s = 1; s < steps; s++) {
+        float t = (float)s / steps;
+        int node = lightning_add_node(tree, px + t * dx, py + t * dy, previous);
+        if (node < 0) return -1;
+        previous = node;
+    }
+    tree->nodes[child].parent = previous;
+    return 0;
+}
+
+// Carry the trees down one layer: tips pull back by retract, nodes that left the region
+// are cut off, and roots either snap to the wall or grow a new branch to it
+static int lightning_descend(lightning_tree_t* tree, const infill_clipper_t* region, infill_rule_t rule,
+                             float retract, float snap, float spacing) {
+    int n = tree->num_nodes;
+    tree->indexed = 0;
+    if (n == 0) return 0;
+    
+    int* children = calloc(n, sizeof(int));
+    int* remap = malloc(n * sizeof(int));
+    if (!children || !remap) {
+        free(children);
+        free(remap);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (tree->nodes[i].parent >= 0) children[tree->nodes[i].parent]++;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        lightning_node_t* node = &tree->nodes[i];
+        int alive = 1;
+        if (children[i] == 0 && retract > 0.0f) {
+            if (node->parent < 0) {
+                alive = 0;
+            } else {
+                const lightning_node_t* parent = &tree->nodes[node->parent];
+                float dx = parent->x - node->x, dy = parent->y - node->y;
+                float length = sqrtf(dx * dx + dy * dy);
+                if (length <= retract) {
+                    alive = 0;
+                } else {
+                    node->x += dx * retract / length;
+                    node->y += dy * retract / length;
+                }
+            }
+        }
+        if (alive && !infill_clipper_inside(region, node->x, node->y, rule)) {
+            alive = node->parent < 0 && infill_clipper_nearest(region, node->x, node->y, NULL) <= snap;
+        }
+        remap[i] = alive;
+    }
+    
+    // Children of removed nodes become roots
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        remap[i] = remap[i] ? count++ : -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (remap[i] < 0) continue;
+        lightning_node_t node = tree->nodes[i];
+        node.parent = node.parent >= 0 ? remap[node.parent] : -1;
+        tree->nodes[remap[i]] = node;
+    }
+    tree->num_nodes = count;
+    free(children);
+    free(remap);
+    
+    for (int i = 0; i < count; i++) {
+        if (tree->nodes[i].parent >= 0) continue;
+        point2d_t wall;
+        float distance = infill_clipper_nearest(region, tree->nodes[i].x, tree->nodes[i].y, &wall);
+        if (distance <= snap) {
+            tree->nodes[i].x = wall.x;
+            tree->nodes[i].y = wall.y;
+        } else if (distance < FLT_MAX) {
+            int root = lightning_add_node(tree, wall.x, wall.y, -1);
+            if (root < 0 || lightning_connect(tree, root, i, spacing) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// Bucket every node over the region's bounding box
+static int lightning_index(lightning_tree_t* tree, const infill_clipper_t* region, float cell_size) {
+    float width = region->cells.nx * region->cells.cell_size;
+    float height = region->cells.ny * region->cells.cell_size;
+    if (cell_size * cell_size * LIGHTNING_MAX_CELLS < width * height) {
+        cell_size = sqrtf(width * height / LIGHTNING_MAX_CELLS);
+    }
+    tree->cells.cell_size = cell_size;
+    tree->cells.min_x = region->cells.min_x;
+    tree->cells.min_y = region->cells.min_y;
+    tree->cells.nx = (int)(width / cell_size) + 1;
+    tree->cells.ny = (int)(height / cell_size) + 1;
+    
+    size_t num_cells = (size_t)tree->cells.nx * tree->cells.ny;
+    if (num_cells > tree->num_cells) {
+        int* heads = realloc(tree->heads, num_cells * sizeof(int));
+        if (!heads) return -1;
+        tree->heads = heads;
+        tree->num_cells = num_cells;
+    }
+    for (size_t c = 0; c < num_cells; c++) tree->heads[c] = -1;
+    for (int i = 0; i < tree->num_nodes; i++) {
+        int cell = cell_grid_cell(&tree->cells, tree->nodes[i].x, tree->nodes[i].y, NULL, NULL);
+        tree->next[i] = tree->heads[cell];
+        tree->heads[cell] = i;
+    }
+    tree->indexed = 1;
+    return 0;
+}
+
+// Nearest-node search state for cell_grid_nearest
+typedef struct {
+    const lightning_tree_t* tree;
+    float x, y;
+    int best;
+    float best_d2;
+} lightning_nearest_t;
+
+static float lightning_nearest_visit(void* context, int cell) {
+    lightning_nearest_t* search = (lightning_nearest_t*)context;
+    const lightning_tree_t* tree = search->tree;
+    for (int i = tree->heads[cell]; i >= 0; i = tree->next[i]) {
+        float dx = tree->nodes[i].x - search->x, dy = tree->nodes[i].y - search->y;
+        float d2 = dx * dx + dy * dy;
+        if (d2 < search->best_d2) {
+            search->best_d2 = d2;
+            search->best = i;
+        }
+    }
+    return search->best_d2;
+}
+
+// Nearest node closer than max_distance, or -1
+static int lightning_nearest_node(const lightning_tree_t* tree, float x, float y, float max_distance,
+                                  float* distance) {
+    lightning_nearest_t search = { tree, x, y, -1, max_distance * max_distance };
+    cell_grid_nearest(&tree->cells, x, y, lightning_nearest_visit, &search);
+    *distance = search.best >= 0 ? sqrtf(search.best_d2) : FLT_MAX;
+    return search.best;
+}
+
+static int compare_samples(const void* a, const void* b) {
+    const lightning_sample_t* sa = (const lightning_sample_t*)a;
+    const lightning_sample_t* sb = (const lightning_sample_t*)b;
+    if (sa->wall != sb->wall) return sa->wall < sb->wall ? -1 : 1;
+    if (sa->y != sb->y) return sa->y < sb->y ? -1 : 1;
+    return (sa->x > sb->x) - (sa->x < sb->x);
+}
+
+// Grid points of the region, radius apart, that the region above does not cover and the
+// wall does not hold up; nearest the wall first, so trees grow inward from it
+static int lightning_samples(const infill_clipper_t* region, const infill_clipper_t* above, infill_rule_t rule,
+                             float radius, lightning_sample_t** samples, int* num_samples) {
+    *samples = NULL;
+    *num_samples = 0;
+    if (region->num_edges == 0) return 0;
+    
+    float* spans = malloc(((size_t)infill_max_strip_edges(&region->rays) + 1) * sizeof(float));
+    float* covered = NULL;
+    if (above && above->num_edges > 0) {
+        covered = malloc(((size_t)infill_max_strip_edges(&above->rays) + 1) * sizeof(float));
+    }
+    if (!spans || (above && above->num_edges > 0 && !covered)) {
+        free(spans);
+        free(covered);
+        return -1;
+    }
+    
+    int capacity = 0;
+    int status = 0;
+    int first = (int)ceilf(region->cells.min_y / radius);
+    int last = (int)floorf((region->cells.min_y + region->cells.ny * region->cells.cell_size) / radius);
+    for (int row = first; row <= last && status == 0; row++) {
+        float y = row * radius;
+        int num_spans = infill_clipper_spans(region, y, rule, spans);
+        int num_covered = covered ? infill_clipper_spans(above, y, rule, covered) : 0;
+        
+        int j = 0;
+        for (int s = 0; s < num_spans && status == 0; s++) {
+            for (int col = (int)ceilf(spans[s * 2] / radius); col * radius <= spans[s * 2 + 1]; col++) {
+                float x = col * radius;
+                while (j < num_covered && covered[j * 2 + 1] < x) j++;
+                if (j < num_covered && covered[j * 2] <= x) continue;
+                
+                float wall = infill_clipper_nearest(region, x, y, NULL);
+                if (wall <= radius) continue;
+                if (*num_samples == capacity) {
+                    int grown = capacity ? capacity * 2 : 256;
+                    lightning_sample_t* resized = realloc(*samples, grown * sizeof(lightning_sample_t));
+                    if (!resized) {
+                        status = -1;
+                        break;
+                    }
+                    *samples = resized;
+                    capacity = grown;
+                }
+                (*samples)[(*num_samples)++] = (lightning_sample_t){ x, y, wall };
+            }
+        }
+    }
+    free(spans);
+    free(covered);
+    
+    if (status == 0 && *num_samples > 1) {
+        qsort(*samples, *num_samples, sizeof(lightning_sample_t), compare_samples);
+    }
+    return status;
+}
+
+// Connect every unsupported sample to the nearest branch, or to the wall when that is closer
+static int lightning_grow(lightning_tree_t* tree, const infill_clipper_t* region, const infill_clipper_t* above,
+                          infill_rule_t rule, float radius, float spacing) {
+    lightning_sample_t* samples;
+    int num_samples;
+    if (lightning_samples(region, above, rule, radius, &samples, &num_samples) != 0) return -1;
+    
+    int status = 0;
+    for (int s = 0; s < num_samples && status == 0; s++) {
+        const lightning_sample_t* sample = &samples[s];
+        float distance;
+        int target = lightning_nearest_node(tree, sample->x, sample->y, sample->wall, &distance);
+        if (target >= 0 && distance <= radius) continue;
+        
+        if (target < 0) {
+            point2d_t wall;
+            infill_clipper_nearest(region, sample->x, sample->y, &wall);
+            target = lightning_add_node(tree, wall.x, wall.y, -1);
+        }
+        int leaf = target >= 0 ? lightning_add_node(tree, sample->x, sample->y, -1) : -1;
+        if (leaf < 0 || lightning_connect(tree, target, leaf, spacing) != 0) status = -1;
+    }
+    free(samples);
+    return status;
+}
+
+// Trees as polylines from the roots outward, clipped to the region since branches
+// carried down from above may cut across where it shrank
+static int lightning_emit(const lightning_tree_t* tree, infill_clipper_t* region, infill_rule_t rule,
+                          layer_t* layer) {
+    free(layer->infill_points);
+    layer->infill_points = NULL;
+    layer->num_infill_points = 0;
+    int n = tree->num_nodes;
+    if (n == 0) return 0;
+    
+    int* child_starts = calloc(n + 1, sizeof(int));
+    int* child_list = malloc(n * sizeof(int));
+    int* cursor = malloc(n * sizeof(int));
+    int* stack = malloc(n * sizeof(int));
+    int* starts = malloc((2 * (size_t)n + 1) * sizeof(int));
+    point2d_t* points = malloc(3 * (size_t)n * sizeof(point2d_t));
+    int status = (child_starts && child_list && cursor && stack && starts && points) ? 0 : -1;
+    
+    if (status == 0) {
+        for (int i = 0; i < n; i++) {
+            if (tree->nodes[i].parent >= 0) child_starts[tree->nodes[i].parent + 1]++;
+        }
+        for (int i = 0; i < n; i++) child_starts[i + 1] += child_starts[i];
+        memcpy(cursor, child_starts, n * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            if (tree->nodes[i].parent >= 0) child_list[cursor[tree->nodes[i].parent]++] = i;
+        }
+        memcpy(cursor, child_starts, n * sizeof(int));
+        
+        // Each polyline follows first children; a node with more children is revisited
+        // to start the next polyline from it
+        int num_points = 0, num_polylines = 0;
+        for (int r = 0; r < n; r++) {
+            if (tree->nodes[r].parent >= 0 || child_starts[r] == child_starts[r + 1]) continue;
+            int depth = 0;
+            stack[depth++] = r;
+            while (depth > 0) {
+                int node = stack[--depth];
+                int first = num_points;
+                starts[num_polylines++] = first;
+                points[num_points++] = (point2d_t){ tree->nodes[node].x, tree->nodes[node].y };
+                while (cursor[node] < child_starts[node + 1]) {
+                    int child = child_list[cursor[node]++];
+                    if (cursor[node] < child_starts[node + 1]) stack[depth++] = node;
+                    point2d_t next = { tree->nodes[child].x, tree->nodes[child].y };
+                    
+                    // Nodes along a straight run only serve lookups; print the run as one line
+                    if (num_points - first >= 2) {
+                        point2d_t a = points[num_points - 2], b = points[num_points - 1];
+                        float ux = next.x - a.x, uy = next.y - a.y;
+                        float cross = (b.x - a.x) * uy - (b.y - a.y) * ux;
+                        float dot = (b.x - a.x) * ux + (b.y - a.y) * uy;
+                        if (dot > 0.0f && fabsf(cross) <= LIGHTNING_COLLINEAR * sqrtf(ux * ux + uy * uy)) {
+                            num_points--;
+                        }
+                    }
+                    points[num_points++] = next;
+                    node = child;
+                }
+            }
+        }
+        starts[num_polylines] = num_points;
+        
+        status = infill_clipper_clip(region, points, starts, num_polylines, rule,
+                                     &layer->infill_points, &layer->num_infill_points);
+    }
+    
+    free(child_starts);
+    free(child_list);
+    free(cursor);
+    free(stack);
+    free(starts);
+    free(points);
+    return status;
+}
+
+// Top-down over the layers: the surviving trees from above are carried down, then every
+// part of this layer's region that the layer above leaves uncovered gets branches. The
+// supporting radius is half the line spacing the density would give straight lines.
+int generate_lightning_infill(sliced_model_t* model) {
+    if (!model || !model->infill_plan || model->params.infill_pattern != INFILL_PATTERN_LIGHTNING) return 0;
+    
+    const slicing_params_t* params = &model->params;
+    float width = extrusion_width(params, params->infill_width);
+    float radius = 0.5f * width / fminf(params->infill_density, 1.0f);
+    float spacing = LIGHTNING_NODE_SPACING * radius;
+    float snap = LIGHTNING_WALL_SNAP * width;
+    
+    lightning_tree_t tree;
+    memset(&tree, 0, sizeof(lightning_tree_t));
+    infill_clipper_t regions[2];
+    infill_clipper_t* above = NULL;
+    int status = 0;
+    for (int i = model->num_layers - 1; i >= 0 && status == 0; i--) {
+        layer_t* layer = &model->layers[i];
+        infill_clipper_t* region = &regions[i & 1];
+        if (infill_clipper_build(region, layer->infill_region, layer->num_infill_region) != 0) {
+            status = -1;
+            break;
+        }
+        
+        float retract = i + 1 < model->num_layers ? model->layers[i + 1].thickness * LIGHTNING_PRUNE_SLOPE : 0.0f;
+        status = lightning_descend(&tree, region, params->infill_rule, retract, snap, spacing);
+        if (status == 0) status = lightning_index(&tree, region, radius);
+        if (status == 0) status = lightning_grow(&tree, region, above, params->infill_rule, radius, spacing);
+        if (status == 0) status = lightning_emit(&tree, region, params->infill_rule, layer);
+        
+        if (above) infill_clipper_free(above);
+        above = region;
+    }
+    if (above) infill_clipper_free(above);
+    
+    lightning_tree_free(&tree);
+    return status;
+}
@@ -0,0 +1,32 @@
+#ifndef LIGHTNING_H
+#define LIGHTNING_H
+
+#include "slicer.h"
+
+// Lightning infill: trees of lines that only hold up the surfaces above them. Trees
+// grow inward from the walls under every top surface and are pruned back layer by
+// layer on the way down, so most of the interior is left empty.
+
+// Branch tips pull back this far per unit of layer height (1 = 45 degree overhang)
+#define LIGHTNING_PRUNE_SLOPE 1.0f
+
+// Largest gap between nodes along a branch, in supporting radii; lookups search nodes
+// rather than segments, so a point near a branch is always near one of its nodes
+#define LIGHTNING_NODE_SPACING 0.5f
+
+// Roots within this many line widths of the wall stay attached to it
+#define LIGHTNING_WALL_SNAP 1.0f
+
+// Nodes closer than this (mm) to the line through their neighbours are not printed
+#define LIGHTNING_COLLINEAR 1e-3f
+
+// Node grids with more cells than this get coarser cells
+#define LIGHTNING_MAX_CELLS (1 << 22)
+
+// Function declarations
+
+// Replace the infill of every layer with lightning trees when the model's pattern is
+// INFILL_PATTERN_LIGHTNING; runs top-down over all layers, after slicing
+int generate_lightning_infill(sliced_model_t* model);
+
+#endif // LIGHTNING_H
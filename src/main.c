@@ -8,20 +8,40 @@
 #include "convex_decomposition.h"
 #include "topology_evaluator.h"
 #include "gpu_accelerator.h"
+#include "mesh_cache.h"
+#include "infill.h"
+#include "gcode_pipeline.h"
+#include "print_estimate.h"
+#include "bgcode.h"
+#include "thumbnail.h"
 
 void print_usage(const char* program_name) {
     printf("Parametric Slicer - 3D Path Generation Tool\n");
-    printf("Usage: %s <input.stl> [options]\n\n", program_name);
+    printf("Usage: %s <input.stl> [options]\n", program_name);
+    printf("       %s <input.gcode> [machine options]   Estimate print time only\n\n", program_name);
     printf("Options:\n");
-    printf("  -o <output.gcode>    Output G-code file (default: output.gcode)\n");
+    printf("  -o <output.gcode>    Output G-code file, binary when it ends in .bgcode (default: output.gcode)\n");
+    printf("  --binary             Write binary G-code with metadata and thumbnails (default file: output.bgcode)\n");
+    printf("  --thumbnails <WxH,...> Thumbnail sizes for binary G-code, or none (default: 16x16,313x173)\n");
     printf("  -h <height>          Layer height in mm (default: 0.2)\n");
+    printf("  --adaptive <cusp>    Adaptive layer heights keeping stair-steps under <cusp> mm\n");
+    printf("  --min-height <mm>    Thinnest adaptive layer (default: 0.08)\n");
+    printf("  --max-height <mm>    Thickest adaptive layer (default: 0.3)\n");
     printf("  -i <density>         Infill density 0.0-1.0 (default: 0.2)\n");
+    printf("  --infill-pattern <p> Infill pattern (rectilinear, grid, triangles, cubic, gyroid, lightning) (default: rectilinear)\n");
+    printf("  --fill-rule <rule>   Infill inside test for overlapping contours (nonzero, evenodd) (default: nonzero)\n");
+    printf("  --arc-fit <mm>       Write G2/G3 arcs for curves within <mm> of the sliced path, e.g. 0.01 (default: off)\n");
     printf("  -s <thickness>       Shell thickness in mm (default: 0.4)\n");
     printf("  -n <shells>          Number of shell layers (default: 2)\n");
     printf("  -p <speed>           Print speed in mm/s (default: 60.0)\n");
     printf("  -t <speed>           Travel speed in mm/s (default: 120.0)\n");
     printf("  -d <diameter>        Nozzle diameter in mm (default: 0.4)\n");
     printf("  -f <diameter>        Filament diameter in mm (default: 1.75)\n");
+    printf("  --perimeter-width <mm> Perimeter extrusion width (default: nozzle diameter)\n");
+    printf("  --infill-width <mm>  Infill extrusion width (default: nozzle diameter)\n");
+    printf("  --perimeter-flow <x> Perimeter extrusion multiplier (default: 1.0)\n");
+    printf("  --infill-flow <x>    Infill extrusion multiplier (default: 1.0)\n");
+    printf("  --relative-e         Write relative extrusion (M83) instead of absolute\n");
     printf("  --bvh <partitions>   Use BVH spatial partitioning with N partitions\n");
     printf("  --sort-axis <axis>   Sort axis for BVH (x, y, z, xy, xz, yz, xyz) (default: xyz)\n");
     printf("  --convex <strategy>  Use convex decomposition (approx, exact, hierarchical, voxel)\n");
@@ -30,7 +50,21 @@ void print_usage(const char* program_name) {
     printf("  --concavity <value>  Concavity tolerance for approx decomposition (0.0-1.0, default: 0.1)\n");
     printf("  --topology <type>    Analyze mesh topology (connectivity, curvature, features, density, quality, complete)\n");
     printf("  --gpu <mode>         GPU acceleration mode (cpu, gpu, auto, preferred)\n");
+    printf("  --weld-epsilon <mm>  Vertex welding distance at load time, 0 = exact duplicates (default: 1e-6)\n");
+    printf("  --no-cache           Always parse the STL; do not read or write the .pscm mesh cache\n");
+    printf("  --stream <layers>    Stream a binary STL in z-bands of N layers instead of loading it whole\n");
+    printf("  --threads <num>      Slice and generate G-code on N threads, 0 = one per CPU (default: 1)\n");
+    printf("  --pipeline           Write G-code layer by layer while slicing, in bounded memory\n");
     printf("  --interactive        Interactive mode for parameter input\n");
+    printf("\nMachine options (print time estimate):\n");
+    printf("  --accel <mm/s2>      Acceleration for extruding moves (default: 1000)\n");
+    printf("  --travel-accel <mm/s2> Acceleration for travel moves (default: 1500)\n");
+    printf("  --junction-deviation <mm> Cornering junction deviation, 0 = use --jerk (default: 0.013)\n");
+    printf("  --jerk <x,y,z,e>     Speed change allowed at a corner in mm/s (default: 10,10,0.3,5)\n");
+    printf("  --max-feedrate <x,y,z,e> Axis speed limits in mm/s (default: 300,300,5,25)\n");
+    printf("  --max-accel <x,y,z,e> Axis acceleration limits in mm/s2 (default: 3000,3000,100,10000)\n");
+    printf("  --filament-density <g/cm3> Filament density for the weight estimate (default: 1.24)\n");
+    printf("  --layer-times        List the estimated time of every layer\n");
     printf("  --help               Show this help message\n\n");
     printf("Example:\n");
     printf("  %s model.stl -h 0.15 -i 0.3 -o model.gcode\n", program_name);
@@ -45,7 +79,18 @@ slicing_params_t get_default_params() {
         .print_speed = 60.0f,
         .travel_speed = 120.0f,
         .nozzle_diameter = 0.4f,
-        .filament_diameter = 1.75f
+        .filament_diameter = 1.75f,
+        .cusp_height = 0.0f,
+        .min_layer_height = 0.08f,
+        .max_layer_height = 0.3f,
+        .infill_rule = INFILL_RULE_NONZERO,
+        .infill_pattern = INFILL_PATTERN_RECTILINEAR,
+        .arc_tolerance = 0.0f,
+        .perimeter_width = 0.0f,
+        .infill_width = 0.0f,
+        .perimeter_flow = 1.0f,
+        .infill_flow = 1.0f,
+        .relative_e = 0
     };
     return params;
 }
@@ -82,15 +127,260 @@ void interactive_input(slicing_params_t* params) {
 
 void print_params(const slicing_params_t* params) {
     printf("Slicing Parameters:\n");
-    printf("  Layer height: %.3f mm\n", params->layer_height);
-    printf("  Infill density: %.1f%%\n", params->infill_density * 100.0f);
+    if (params->cusp_height > 0) {
+        printf("  Layer height: adaptive %.3f-%.3f mm, cusp height %.3f mm\n",
+               params->min_layer_height, params->max_layer_height, params->cusp_height);
+    } else {
+        printf("  Layer height: %.3f mm\n", params->layer_height);
+    }
+    printf("  Infill density: %.1f%% (%s)\n", params->infill_density * 100.0f, infill_pattern_info(params->infill_pattern)->name);
     printf("  Shell thickness: %.3f mm\n", params->shell_thickness);
     printf("  Number of shells: %d\n", params->num_shells);
     printf("  Print speed: %.1f mm/s\n", params->print_speed);
     printf("  Travel speed: %.1f mm/s\n", params->travel_speed);
     printf("  Nozzle diameter: %.3f mm\n", params->nozzle_diameter);
     printf("  Filament diameter: %.3f mm\n", params->filament_diameter);
+    printf("  Extrusion: perimeters %.3f mm at %.0f%%, infill %.3f mm at %.0f%%, %s E\n",
+           extrusion_width(params, params->perimeter_width), params->perimeter_flow * 100.0f,
+           extrusion_width(params, params->infill_width), params->infill_flow * 100.0f,
+           params->relative_e ? "relative" : "absolute");
+    if (params->arc_tolerance > 0) {
+        printf("  Arc fitting: within %.3f mm\n", params->arc_tolerance);
+    }
+    printf("\n");
+}
+
+void print_generation_stats(const path_generator_t* generator, long long num_commands) {
+    printf("Travel moves: %.0f mm (%.0f mm in slice order)\n", generator->travel_distance,
+           generator->unordered_travel_distance);
+    if (generator->arc_moves > 0) {
+        int saved = generator->arc_replaced_moves - generator->arc_moves;
+        printf("Arc fitting: %d G2/G3 moves replace %d G1 moves (%d fewer commands, %.1f%%)\n",
+               generator->arc_moves, generator->arc_replaced_moves, saved,
+               100.0f * saved / (num_commands + saved));
+    }
+}
+
+// Read "x,y,z,e" into values; 0 on success
+int parse_axis_values(const char* text, float* values) {
+    float parsed[PRINT_ESTIMATE_AXES];
+    if (sscanf(text, "%f,%f,%f,%f", &parsed[0], &parsed[1], &parsed[2], &parsed[3]) != PRINT_ESTIMATE_AXES) {
+        return -1;
+    }
+    memcpy(values, parsed, sizeof(parsed));
+    return 0;
+}
+
+int has_extension(const char* filename, const char* extension) {
+    size_t length = strlen(filename);
+    size_t extension_length = strlen(extension);
+    if (length < extension_length) return 0;
+    
+    const char* tail = filename + length - extension_length;
+    for (size_t i = 0; i < extension_length; i++) {
+        char c = tail[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != extension[i]) return 0;
+    }
+    return 1;
+}
+
+// Print the estimate and, when kept is not NULL, hand it to the caller to free
+void print_estimate_report(print_estimator_t* estimator, int show_layers, print_estimate_t* kept) {
+    print_estimate_t estimate;
+    if (print_estimator_finish(estimator, &estimate) != 0) {
+        fprintf(stderr, "Warning: Out of memory estimating print time; per-layer times are incomplete\n");
+    }
+    print_estimate_info(&estimate, show_layers);
+    if (kept) {
+        *kept = estimate;
+    } else {
+        print_estimate_free(&estimate);
+    }
+}
+
+// Where and how the G-code is written
+typedef struct {
+    const char* filename;
+    int binary;                                     // Binary G-code with metadata and thumbnails
+    int thumbnail_sizes[BGCODE_MAX_THUMBNAILS][2];  // Width, height
+    int num_thumbnails;
+} output_options_t;
+
+// Read "WxH,WxH,..." or "none" into output; 0 on success
+int parse_thumbnail_sizes(const char* text, output_options_t* output) {
+    output->num_thumbnails = 0;
+    if (strcmp(text, "none") == 0) return 0;
+    
+    while (*text) {
+        int width, height, length;
+        if (output->num_thumbnails == BGCODE_MAX_THUMBNAILS ||
+            sscanf(text, "%dx%d%n", &width, &height, &length) != 2 ||
+            width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+            return -1;
+        }
+        output->thumbnail_sizes[output->num_thumbnails][0] = width;
+        output->thumbnail_sizes[output->num_thumbnails][1] = height;
+        output->num_thumbnails++;
+        text += length;
+        if (*text == ',') text++;
+        else if (*text) return -1;
+    }
+    return 0;
+}
+
+// "1d 2h 3m 4s", leaving out leading zero units
+void format_duration(char* text, size_t size, double seconds) {
+    long total = (long)(seconds + 0.5);
+    long days = total / 86400, hours = total / 3600 % 24, minutes = total / 60 % 60;
+    if (days > 0) {
+        snprintf(text, size, "%ldd %ldh %ldm %lds", days, hours, minutes, total % 60);
+    } else if (hours > 0) {
+        snprintf(text, size, "%ldh %ldm %lds", hours, minutes, total % 60);
+    } else if (minutes > 0) {
+        snprintf(text, size, "%ldm %lds", minutes, total % 60);
+    } else {
+        snprintf(text, size, "%lds", total % 60);
+    }
+}
+
+// Metadata blocks for binary G-code. estimate is NULL when it is not known before the
+// G-code is written (--pipeline); stl is NULL when streaming, leaving out thumbnails.
+// -1 when out of memory.
+int fill_bgcode_metadata(bgcode_metadata_t* metadata, const output_options_t* output,
+                         const slicing_params_t* params, const stl_file_t* stl,
+                         const sliced_model_t* model, const print_estimate_t* estimate) {
+    int status = bgcode_ini_add(&metadata->file, "Producer", "Parametric Slicer");
+    
+    float max_z = model->num_layers > 0 ? model->layers[model->num_layers - 1].z_height : 0.0f;
+    status |= bgcode_ini_add(&metadata->printer, "nozzle_diameter", "%.2f", params->nozzle_diameter);
+    status |= bgcode_ini_add(&metadata->printer, "filament_diameter", "%.2f", params->filament_diameter);
+    status |= bgcode_ini_add(&metadata->printer, "layer_height", "%.2f", params->layer_height);
+    status |= bgcode_ini_add(&metadata->printer, "fill_density", "%.0f%%", params->infill_density * 100.0f);
+    status |= bgcode_ini_add(&metadata->printer, "temperature", "200");
+    status |= bgcode_ini_add(&metadata->printer, "max_layer_z", "%.2f", max_z);
+    
+    // The printer shows the estimates from its own block; the print block repeats them
+    bgcode_ini_t* blocks[2] = { &metadata->printer, &metadata->print };
+    for (int i = 0; i < 2 && estimate; i++) {
+        char duration[64];
+        format_duration(duration, sizeof(duration), estimate->time);
+        status |= bgcode_ini_add(blocks[i], "filament used [mm]", "%.2f", estimate->filament_length);
+        status |= bgcode_ini_add(blocks[i], "filament used [g]", "%.2f", estimate->filament_mass);
+        status |= bgcode_ini_add(blocks[i], "estimated printing time (normal mode)", "%s", duration);
+    }
+    status |= bgcode_ini_add(&metadata->print, "total layer count", "%d", model->num_layers);
+    
+    bgcode_ini_t* slicer = &metadata->slicer;
+    status |= bgcode_ini_add(slicer, "layer_height", "%.3f", params->layer_height);
+    if (params->cusp_height > 0) {
+        status |= bgcode_ini_add(slicer, "adaptive_cusp_height", "%.3f", params->cusp_height);
+        status |= bgcode_ini_add(slicer, "min_layer_height", "%.3f", params->min_layer_height);
+        status |= bgcode_ini_add(slicer, "max_layer_height", "%.3f", params->max_layer_height);
+    }
+    status |= bgcode_ini_add(slicer, "fill_density", "%.0f%%", params->infill_density * 100.0f);
+    status |= bgcode_ini_add(slicer, "fill_pattern", "%s", infill_pattern_info(params->infill_pattern)->name);
+    status |= bgcode_ini_add(slicer, "fill_rule", "%s", params->infill_rule == INFILL_RULE_EVEN_ODD ? "evenodd" : "nonzero");
+    status |= bgcode_ini_add(slicer, "perimeters", "%d", params->num_shells);
+    status |= bgcode_ini_add(slicer, "shell_thickness", "%.3f", params->shell_thickness);
+    status |= bgcode_ini_add(slicer, "print_speed", "%.1f", params->print_speed);
+    status |= bgcode_ini_add(slicer, "travel_speed", "%.1f", params->travel_speed);
+    status |= bgcode_ini_add(slicer, "nozzle_diameter", "%.3f", params->nozzle_diameter);
+    status |= bgcode_ini_add(slicer, "filament_diameter", "%.3f", params->filament_diameter);
+    status |= bgcode_ini_add(slicer, "perimeter_extrusion_width", "%.3f", extrusion_width(params, params->perimeter_width));
+    status |= bgcode_ini_add(slicer, "infill_extrusion_width", "%.3f", extrusion_width(params, params->infill_width));
+    status |= bgcode_ini_add(slicer, "perimeter_flow", "%.2f", params->perimeter_flow);
+    status |= bgcode_ini_add(slicer, "infill_flow", "%.2f", params->infill_flow);
+    status |= bgcode_ini_add(slicer, "use_relative_e_distances", "%d", params->relative_e);
+    status |= bgcode_ini_add(slicer, "arc_fit_tolerance", "%.3f", params->arc_tolerance);
+    if (status != 0) return -1;
+    
+    for (int i = 0; i < output->num_thumbnails && stl; i++) {
+        int width = output->thumbnail_sizes[i][0], height = output->thumbnail_sizes[i][1];
+        unsigned char* pixels = thumbnail_render(stl, width, height);
+        size_t size = 0;
+        unsigned char* image = pixels ? thumbnail_encode_qoi(pixels, width, height, &size) : NULL;
+        free(pixels);
+        if (!image || bgcode_metadata_add_thumbnail(metadata, image, size, width, height) != 0) {
+            free(image);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Text G-code, or binary G-code with the metadata and thumbnail blocks already written;
+// NULL with an error printed when the file cannot be created
+gcode_writer_t* open_output(const output_options_t* output, const slicing_params_t* params,
+                            const stl_file_t* stl, const sliced_model_t* model,
+                            const print_estimate_t* estimate) {
+    gcode_writer_t* writer = NULL;
+    if (!output->binary) {
+        writer = gcode_writer_open(output->filename);
+    } else {
+        bgcode_metadata_t metadata;
+        bgcode_metadata_init(&metadata);
+        if (fill_bgcode_metadata(&metadata, output, params, stl, model, estimate) != 0) {
+            fprintf(stderr, "Error: Out of memory for binary G-code metadata\n");
+            bgcode_metadata_free(&metadata);
+            return NULL;
+        }
+        writer = gcode_writer_open_binary(output->filename, &metadata);
+        bgcode_metadata_free(&metadata);
+    }
+    if (!writer) {
+        fprintf(stderr, "Error: Cannot create file %s\n", output->filename);
+    }
+    return writer;
+}
+
+// Slice, generate and write layer by layer; stl is NULL when streaming. Returns 0 on success.
+int run_pipeline(const stl_file_t* stl, const char* input_file, unsigned int stream_layers,
+                 const slicing_params_t* params, const output_options_t* output,
+                 const print_estimate_config_t* estimate_config, int show_layers) {
+    slice_cursor_t* cursor = stream_layers > 0 ? slice_cursor_create_streaming(input_file, params, stream_layers)
+                                               : slice_cursor_create(stl, params);
+    if (!cursor) {
+        fprintf(stderr, "Error: Failed to slice model\n");
+        return -1;
+    }
+    print_slicing_info(slice_cursor_model(cursor));
     printf("\n");
+    
+    path_generator_t* generator = path_generator_create(params);
+    if (!generator) {
+        fprintf(stderr, "Error: Failed to create path generator\n");
+        slice_cursor_free(cursor);
+        return -1;
+    }
+    gcode_writer_t* writer = open_output(output, params, stl, slice_cursor_model(cursor), NULL);
+    if (!writer) {
+        path_generator_free(generator);
+        slice_cursor_free(cursor);
+        return -1;
+    }
+    
+    printf("Slicing and writing G-code to %s layer by layer...\n", output->filename);
+    print_estimator_t* estimator = print_estimator_create(estimate_config);
+    if (!estimator) {
+        fprintf(stderr, "Warning: Out of memory for the print time estimate, skipping it\n");
+    }
+    long long num_commands = 0;
+    int status = gcode_pipeline_run(cursor, generator, writer, estimator, &num_commands);
+    if (gcode_writer_close(writer) != 0) {
+        fprintf(stderr, "Error: Failed writing G-code to %s\n", output->filename);
+        status = -1;
+    }
+    if (status == 0) {
+        print_generation_stats(generator, num_commands);
+        if (estimator) print_estimate_report(estimator, show_layers, NULL);
+        printf("G-code written to %s\n", output->filename);
+    }
+    
+    print_estimator_free(estimator);
+    path_generator_free(generator);
+    slice_cursor_free(cursor);
+    return status;
 }
 
 int main(int argc, char* argv[]) {
@@ -106,7 +396,7 @@ int main(int argc, char* argv[]) {
     }
     
     char* input_file = argv[1];
-    char* output_file = "output.gcode";
+    char* output_file = NULL;
     slicing_params_t params = get_default_params();
     int interactive_mode = 0;
     int use_bvh = 0;
@@ -121,6 +411,15 @@ int main(int argc, char* argv[]) {
     topology_analysis_type_t topology_type = TOPO_ANALYSIS_COMPLETE;
     gpu_mode_t gpu_mode = GPU_MODE_AUTO;
     gpu_context_t* gpu_ctx = NULL;
+    stl_load_options_t load_options = stl_default_load_options();
+    int use_cache = 1;
+    unsigned int stream_layers = 0;
+    int num_threads = 1;
+    int use_pipeline = 0;
+    print_estimate_config_t estimate_config = print_estimate_default_config();
+    int show_layer_times = 0;
+    output_options_t output = { .binary = 0, .thumbnail_sizes = { { 16, 16 }, { 313, 173 } }, .num_thumbnails = 2 };
+    bvh_tree_t* cached_bvh = NULL;
     
     // Parse command line arguments
     for (int i = 2; i < argc; i++) {
@@ -160,6 +459,77 @@ int main(int argc, char* argv[]) {
                 fprintf(stderr, "Error: Invalid sort axis '%s'. Use x, y, z, xy, xz, yz, or xyz\n", axis_str);
                 return 1;
             }
+        } else if (strcmp(argv[i], "--infill-pattern") == 0 && i + 1 < argc) {
+            const infill_pattern_info_t* pattern = infill_pattern_lookup(argv[++i]);
+            if (!pattern) {
+                fprintf(stderr, "Error: Invalid infill pattern '%s'. Use rectilinear, grid, triangles, cubic, gyroid, or lightning\n", argv[i]);
+                return 1;
+            }
+            params.infill_pattern = pattern->pattern;
+        } else if (strcmp(argv[i], "--fill-rule") == 0 && i + 1 < argc) {
+            char* rule_str = argv[++i];
+            if (strcmp(rule_str, "nonzero") == 0) params.infill_rule = INFILL_RULE_NONZERO;
+            else if (strcmp(rule_str, "evenodd") == 0) params.infill_rule = INFILL_RULE_EVEN_ODD;
+            else {
+                fprintf(stderr, "Error: Invalid fill rule '%s'. Use nonzero or evenodd\n", rule_str);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--perimeter-width") == 0 && i + 1 < argc) {
+            params.perimeter_width = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--infill-width") == 0 && i + 1 < argc) {
+            params.infill_width = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--perimeter-flow") == 0 && i + 1 < argc) {
+            params.perimeter_flow = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--infill-flow") == 0 && i + 1 < argc) {
+            params.infill_flow = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--relative-e") == 0) {
+            params.relative_e = 1;
+        } else if (strcmp(argv[i], "--arc-fit") == 0 && i + 1 < argc) {
+            params.arc_tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--weld-epsilon") == 0 && i + 1 < argc) {
+            load_options.weld_epsilon = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            stream_layers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc) {
+            params.cusp_height = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-height") == 0 && i + 1 < argc) {
+            params.min_layer_height = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-height") == 0 && i + 1 < argc) {
+            params.max_layer_height = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            use_pipeline = 1;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            output.binary = 1;
+        } else if (strcmp(argv[i], "--thumbnails") == 0 && i + 1 < argc) {
+            if (parse_thumbnail_sizes(argv[++i], &output) != 0) {
+                fprintf(stderr, "Error: Invalid thumbnail sizes '%s'. Use up to %d sizes WxH,WxH or none\n",
+                        argv[i], BGCODE_MAX_THUMBNAILS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--accel") == 0 && i + 1 < argc) {
+            estimate_config.acceleration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--travel-accel") == 0 && i + 1 < argc) {
+            estimate_config.travel_acceleration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--junction-deviation") == 0 && i + 1 < argc) {
+            estimate_config.junction_deviation = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "--jerk") == 0 || strcmp(argv[i], "--max-feedrate") == 0 ||
+                    strcmp(argv[i], "--max-accel") == 0) && i + 1 < argc) {
+            float* values = strcmp(argv[i], "--jerk") == 0 ? estimate_config.max_jerk :
+                            strcmp(argv[i], "--max-feedrate") == 0 ? estimate_config.max_feedrate :
+                            estimate_config.max_acceleration;
+            if (parse_axis_values(argv[i + 1], values) != 0) {
+                fprintf(stderr, "Error: Invalid %s '%s'. Use four values x,y,z,e\n", argv[i], argv[i + 1]);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--filament-density") == 0 && i + 1 < argc) {
+            estimate_config.filament_density = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--layer-times") == 0) {
+            show_layer_times = 1;
         } else if (strcmp(argv[i], "--gpu") == 0 && i + 1 < argc) {
             char* gpu_mode_str = argv[++i];
             if (strcmp(gpu_mode_str, "cpu") == 0) gpu_mode = GPU_MODE_CPU_ONLY;
@@ -173,28 +543,89 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (!output_file) {
+        output_file = output.binary ? "output.bgcode" : "output.gcode";
+    }
+    output.filename = output_file;
+    output.binary |= has_extension(output_file, ".bgcode");
+    
     printf("Parametric Slicer - 3D Path Generation\n");
     printf("=====================================\n\n");
     
+    // Estimate an existing G-code file instead of slicing
+    if (has_extension(input_file, ".gcode") || has_extension(input_file, ".gco")) {
+        printf("Estimating G-code file: %s\n", input_file);
+        estimate_config.filament_diameter = params.filament_diameter;
+        print_estimate_t estimate;
+        if (print_estimate_file(input_file, &estimate_config, &estimate) != 0) {
+            fprintf(stderr, "Error: Failed to estimate %s\n", input_file);
+            return 1;
+        }
+        print_estimate_info(&estimate, show_layer_times);
+        print_estimate_free(&estimate);
+        return 0;
+    }
+    
     // Interactive mode
     if (interactive_mode) {
         interactive_input(&params);
     }
+    estimate_config.filament_diameter = params.filament_diameter;
     
     // Print parameters
     print_params(&params);
     
-    // Load STL file
-    printf("Loading STL file: %s\n", input_file);
-    stl_file_t* stl = stl_load_file(input_file);
-    if (!stl) {
-        fprintf(stderr, "Error: Failed to load STL file\n");
-        return 1;
+    // The pipeline frees each layer once it is written
+    if (use_pipeline && params.infill_pattern == INFILL_PATTERN_LIGHTNING) {
+        printf("Note: lightning infill needs every layer sliced first; --pipeline is ignored\n\n");
+        use_pipeline = 0;
+    }
+    if (use_pipeline && (use_bvh || use_convex_decomp)) {
+        printf("Note: --bvh and --convex slice the whole model at once and are ignored with --pipeline\n\n");
+        use_bvh = 0;
+        use_convex_decomp = 0;
     }
     
-    // Print STL information
-    stl_print_info(stl);
-    printf("\n");
+    // Load STL file (streaming mode reads it band by band while slicing)
+    stl_file_t* stl = NULL;
+    if (stream_layers > 0) {
+        printf("Streaming STL file: %s (%u layers per band)\n\n", input_file, stream_layers);
+        if (use_bvh || use_convex_decomp || use_topology_analysis) {
+            printf("Note: --bvh, --convex and --topology need the whole mesh and are ignored when streaming\n\n");
+        }
+        if (output.binary && output.num_thumbnails > 0) {
+            printf("Note: thumbnails need the whole mesh and are left out of the binary G-code when streaming\n\n");
+        }
+        if (params.cusp_height > 0) {
+            printf("Note: streaming bands hold whole fixed-height layers; --adaptive is ignored\n\n");
+            params.cusp_height = 0.0f;
+        }
+        use_bvh = 0;
+        use_convex_decomp = 0;
+        use_topology_analysis = 0;
+        gpu_mode = GPU_MODE_CPU_ONLY;
+    } else if (use_cache) {
+        printf("Loading STL file: %s\n", input_file);
+        // Reuse the welded mesh (and BVH) from the .pscm cache when the STL is unchanged
+        int from_cache = 0;
+        stl = mesh_cache_load_or_create(input_file, &load_options, use_bvh ? &cached_bvh : NULL, &from_cache);
+        if (stl) {
+            printf("%s mesh cache\n", from_cache ? "Loaded" : "Created");
+        }
+    } else {
+        printf("Loading STL file: %s\n", input_file);
+        stl = stl_load_file_with_options(input_file, &load_options);
+    }
+    if (stream_layers == 0) {
+        if (!stl) {
+            fprintf(stderr, "Error: Failed to load STL file\n");
+            return 1;
+        }
+        
+        // Print STL information
+        stl_print_info(stl);
+        printf("\n");
+    }
     
     // Initialize GPU acceleration
     if (gpu_mode != GPU_MODE_CPU_ONLY) {
@@ -207,6 +638,7 @@ int main(int argc, char* argv[]) {
         } else {
             if (gpu_mode == GPU_MODE_GPU_ONLY) {
                 fprintf(stderr, "Error: GPU-only mode requested but GPU not available\n");
+                if (cached_bvh) bvh_free(cached_bvh);
                 stl_free(stl);
                 return 1;
             } else {
@@ -274,16 +706,41 @@ int main(int argc, char* argv[]) {
     spatial_partition_t* partition = NULL;
     convex_decomposition_t* decomp = NULL;
     
-    if (use_bvh) {
+    if (num_threads != 1) {
+        params.pool = thread_pool_create(num_threads);
+        if (params.pool) {
+            printf("Slicing layers and generating G-code on %d threads\n", params.pool->num_threads);
+        } else {
+            fprintf(stderr, "Warning: Failed to start worker threads, slicing serially\n");
+        }
+    }
+    
+    if (use_pipeline) {
+        int status = run_pipeline(stl, input_file, stream_layers, &params, &output,
+                                  &estimate_config, show_layer_times);
+        thread_pool_destroy(params.pool);
+        if (topology_eval) free_topology_evaluation(topology_eval);
+        if (gpu_ctx) gpu_cleanup(gpu_ctx);
+        stl_free(stl);
+        if (status != 0) return 1;
+        
+        printf("\nSlicing completed successfully!\n");
+        printf("Output file: %s\n", output_file);
+        return 0;
+    }
+    
+    if (stream_layers > 0) {
+        sliced = slice_model_streaming(input_file, &params, stream_layers);
+    } else if (use_bvh) {
         printf("Using BVH spatial partitioning with %u partitions, sort axis: %d\n", num_partitions, sort_axis);
         
         // Create spatial partition with GPU acceleration if available
         if (gpu_ctx && gpu_is_available(gpu_ctx)) {
             printf("Using GPU-accelerated BVH construction...\n");
             // Note: GPU BVH construction would be implemented here
-            partition = spatial_partition_create(stl, num_partitions, sort_axis);
+            partition = spatial_partition_create_with_bvh(stl, num_partitions, sort_axis, cached_bvh);
         } else {
-            partition = spatial_partition_create(stl, num_partitions, sort_axis);
+            partition = spatial_partition_create_with_bvh(stl, num_partitions, sort_axis, cached_bvh);
         }
         if (!partition) {
             fprintf(stderr, "Error: Failed to create spatial partition\n");
@@ -335,6 +792,7 @@ int main(int argc, char* argv[]) {
     
     if (!sliced) {
         fprintf(stderr, "Error: Failed to slice model\n");
+        thread_pool_destroy(params.pool);
         if (partition) spatial_partition_free(partition);
         if (decomp) convex_decomposition_free(decomp);
         if (topology_eval) free_topology_evaluation(topology_eval);
@@ -351,6 +809,7 @@ int main(int argc, char* argv[]) {
     path_generator_t* generator = path_generator_create(&params);
     if (!generator) {
         fprintf(stderr, "Error: Failed to create path generator\n");
+        thread_pool_destroy(params.pool);
         free_sliced_model(sliced);
         stl_free(stl);
         return 1;
@@ -358,9 +817,42 @@ int main(int argc, char* argv[]) {
     
     generate_gcode_from_slices(generator, sliced);
     
+    // The pool only lives for slicing and G-code generation
+    thread_pool_destroy(params.pool);
+    params.pool = NULL;
+    sliced->params.pool = NULL;
+    generator->pool = NULL;
+    print_generation_stats(generator, (long long)generator->commands.count);
+    
+    print_estimate_t estimate;
+    print_estimator_t* estimator = print_estimator_create(&estimate_config);
+    if (estimator) {
+        print_estimator_add_commands(estimator, &generator->commands);
+        print_estimate_report(estimator, show_layer_times, &estimate);
+        print_estimator_free(estimator);
+    } else {
+        fprintf(stderr, "Warning: Out of memory for the print time estimate, skipping it\n");
+    }
+    
     // Write G-code to file
-    printf("Writing G-code to: %s\n", output_file);
-    write_gcode_to_file(generator, output_file);
+    printf("Writing %sG-code to: %s\n", output.binary ? "binary " : "", output_file);
+    if (output.binary) {
+        // The estimate goes into the metadata, ahead of the G-code
+        gcode_writer_t* writer = open_output(&output, &params, stl, sliced, estimator ? &estimate : NULL);
+        if (writer) {
+            gcode_output_state_t state = {0};
+            write_gcode_header(writer, generator, (long long)generator->commands.count);
+            write_gcode_commands(writer, &state, &generator->commands);
+            if (gcode_writer_close(writer) != 0) {
+                fprintf(stderr, "Error: Failed writing G-code to %s\n", output_file);
+            } else {
+                printf("G-code written to %s\n", output_file);
+            }
+        }
+    } else {
+        write_gcode_to_file(generator, output_file);
+    }
+    if (estimator) print_estimate_free(&estimate);
     
     // Cleanup
     path_generator_free(generator);
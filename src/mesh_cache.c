@@ -0,0 +1,357 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mesh_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#define MESH_CACHE_PRIME1 0x9E3779B185EBCA87ULL
+#define MESH_CACHE_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define MESH_CACHE_PRIME3 0x165667B19E3779F9ULL
+#define MESH_CACHE_PRIME4 0x85EBCA77C2B2AE63ULL
+#define MESH_CACHE_PRIME5 0x27D4EB2F165667C5ULL
+
+static uint64_t mesh_cache_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t mesh_cache_round(uint64_t acc, uint64_t input) {
+    acc += input * MESH_CACHE_PRIME2;
+    return mesh_cache_rotl(acc, 31) * MESH_CACHE_PRIME1;
+}
+
+static uint64_t mesh_cache_merge(uint64_t hash, uint64_t acc) {
+    hash ^= mesh_cache_round(0, acc);
+    return hash * MESH_CACHE_PRIME1 + MESH_CACHE_PRIME4;
+}
+
+// XXH64 with seed 0: every input bit reaches every output bit through the
+// rotations and the final avalanche, so small edits always change the key
+uint64_t mesh_cache_hash(const unsigned char* data, size_t size) {
+    const unsigned char* p = data;
+    const unsigned char* end = data + size;
+    uint64_t hash;
+    
+    if (size >= 32) {
+        uint64_t lanes[4] = {
+            MESH_CACHE_PRIME1 + MESH_CACHE_PRIME2, MESH_CACHE_PRIME2, 0, 0 - MESH_CACHE_PRIME1
+        };
+        for (; p + 32 <= end; p += 32) {
+            for (int k = 0; k < 4; k++) {
+                uint64_t word;
+                memcpy(&word, p + k * 8, sizeof(word));
+                lanes[k] = mesh_cache_round(lanes[k], word);
+            }
+        }
+        hash = mesh_cache_rotl(lanes[0], 1) + mesh_cache_rotl(lanes[1], 7) +
+               mesh_cache_rotl(lanes[2], 12) + mesh_cache_rotl(lanes[3], 18);
+        for (int k = 0; k < 4; k++) {
+            hash = mesh_cache_merge(hash, lanes[k]);
+        }
+    } else {
+        hash = MESH_CACHE_PRIME5;
+    }
+    hash += (uint64_t)size;
+    
+    for (; p + 8 <= end; p += 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        hash ^= mesh_cache_round(0, word);
+        hash = mesh_cache_rotl(hash, 27) * MESH_CACHE_PRIME1 + MESH_CACHE_PRIME4;
+    }
+    if (p + 4 <= end) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        hash ^= (uint64_t)word * MESH_CACHE_PRIME1;
+        hash = mesh_cache_rotl(hash, 23) * MESH_CACHE_PRIME2 + MESH_CACHE_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= *p * MESH_CACHE_PRIME5;
+        hash = mesh_cache_rotl(hash, 11) * MESH_CACHE_PRIME1;
+    }
+    
+    hash ^= hash >> 33;
+    hash *= MESH_CACHE_PRIME2;
+    hash ^= hash >> 29;
+    hash *= MESH_CACHE_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+char* mesh_cache_path(const char* stl_filename) {
+    if (!stl_filename) return NULL;
+    
+    // model.stl -> model.pscm, anything else gets the extension appended
+    size_t length = strlen(stl_filename);
+    size_t stem = length;
+    if (length >= 4) {
+        const char* ext = stl_filename + length - 4;
+        if (ext[0] == '.' && (ext[1] == 's' || ext[1] == 'S') && (ext[2] == 't' || ext[2] == 'T') &&
+            (ext[3] == 'l' || ext[3] == 'L')) {
+            stem = length - 4;
+        }
+    }
+    
+    char* path = malloc(stem + strlen(MESH_CACHE_EXTENSION) + 1);
+    if (!path) return NULL;
+    memcpy(path, stl_filename, stem);
+    strcpy(path + stem, MESH_CACHE_EXTENSION);
+    return path;
+}
+
+// Total file size implied by the header counts
+static uint64_t mesh_cache_expected_size(const mesh_cache_header_t* header) {
+    return (uint64_t)sizeof(mesh_cache_header_t) +
+           (uint64_t)header->num_vertices * 3 * sizeof(float) +
+           (uint64_t)header->num_triangles * 3 * sizeof(uint32_t) +
+           (uint64_t)header->num_triangles * 2 * sizeof(float) +
+           (uint64_t)header->num_bvh_nodes * sizeof(bvh_packed_node_t) +
+           (uint64_t)header->num_bvh_leaf_indices * sizeof(uint32_t);
+}
+
+int mesh_cache_write(const char* cache_filename, const stl_file_t* stl, uint64_t source_hash,
+                     uint64_t source_size, int64_t source_mtime, float weld_epsilon, const bvh_tree_t* bvh) {
+    if (!cache_filename || !stl || !stl->vertices || !stl->indices) return -1;
+    
+    mesh_cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = MESH_CACHE_VERSION;
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.num_triangles = stl->num_triangles;
+    header.num_vertices = stl->num_vertices;
+    header.weld_epsilon = weld_epsilon;
+    header.source_format = (uint32_t)stl->format;
+    memcpy(header.bounds, stl->bounds, sizeof(header.bounds));
+    memcpy(header.stl_header, stl->header, sizeof(header.stl_header));
+    
+    bvh_packed_node_t* bvh_nodes = NULL;
+    uint32_t* bvh_leaf_indices = NULL;
+    unsigned int num_bvh_nodes = 0, num_bvh_leaf_indices = 0;
+    if (bvh && bvh_serialize(bvh, &bvh_nodes, &num_bvh_nodes, &bvh_leaf_indices, &num_bvh_leaf_indices) == 0) {
+        header.num_bvh_nodes = num_bvh_nodes;
+        header.num_bvh_leaf_indices = num_bvh_leaf_indices;
+    }
+    
+    // Per-triangle z-ranges
+    float* z_ranges = malloc(((size_t)stl->num_triangles * 2 + 1) * sizeof(float));
+    if (!z_ranges) {
+        free(bvh_nodes);
+        free(bvh_leaf_indices);
+        return -1;
+    }
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        const uint32_t* tri = &stl->indices[(size_t)i * 3];
+        float z0 = stl->vertices[(size_t)tri[0] * 3 + 2];
+        float z1 = stl->vertices[(size_t)tri[1] * 3 + 2];
+        float z2 = stl->vertices[(size_t)tri[2] * 3 + 2];
+        z_ranges[(size_t)i * 2] = fminf(z0, fminf(z1, z2));
+        z_ranges[(size_t)i * 2 + 1] = fmaxf(z0, fmaxf(z1, z2));
+    }
+    
+    // Write to a temporary name and rename, so readers never see a partial cache
+    size_t name_length = strlen(cache_filename);
+    char* temp_filename = malloc(name_length + 5);
+    if (!temp_filename) {
+        free(z_ranges);
+        free(bvh_nodes);
+        free(bvh_leaf_indices);
+        return -1;
+    }
+    memcpy(temp_filename, cache_filename, name_length);
+    strcpy(temp_filename + name_length, ".tmp");
+    
+    int result = -1;
+    FILE* file = fopen(temp_filename, "wb");
+    if (file) {
+        size_t num_corners = (size_t)stl->num_triangles * 3;
+        int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(stl->vertices, sizeof(float) * 3, stl->num_vertices, file) == stl->num_vertices &&
+                 fwrite(stl->indices, sizeof(uint32_t), num_corners, file) == num_corners &&
+                 fwrite(z_ranges, sizeof(float) * 2, stl->num_triangles, file) == stl->num_triangles &&
+                 fwrite(bvh_nodes, sizeof(bvh_packed_node_t), header.num_bvh_nodes, file) == header.num_bvh_nodes &&
+                 fwrite(bvh_leaf_indices, sizeof(uint32_t), header.num_bvh_leaf_indices, file) ==
+                     header.num_bvh_leaf_indices;
+        if (fclose(file) != 0) ok = 0;
+        
+        if (ok && rename(temp_filename, cache_filename) == 0) {
+            result = 0;
+        } else {
+            remove(temp_filename);
+        }
+    }
+    
+    free(temp_filename);
+    free(z_ranges);
+    free(bvh_nodes);
+    free(bvh_leaf_indices);
+    return result;
+}
+
+mesh_cache_t* mesh_cache_open(const char* cache_filename, uint64_t source_hash,
+                              uint64_t source_size, int64_t source_mtime, float weld_epsilon) {
+    size_t size = 0;
+    unsigned char* data = stl_map_file(cache_filename, &size);
+    if (!data) return NULL;
+    
+    // Reject caches from another version, another source file or another welding distance
+    const mesh_cache_header_t* header = (const mesh_cache_header_t*)data;
+    if (size < sizeof(mesh_cache_header_t) ||
+        memcmp(header->magic, MESH_CACHE_MAGIC, 4) != 0 ||
+        header->version != MESH_CACHE_VERSION ||
+        header->source_hash != source_hash ||
+        header->source_size != source_size ||
+        header->source_mtime != source_mtime ||
+        header->weld_epsilon != weld_epsilon ||
+        mesh_cache_expected_size(header) != (uint64_t)size) {
+        stl_unmap_file(data, size);
+        return NULL;
+    }
+    
+    mesh_cache_t* cache = malloc(sizeof(mesh_cache_t));
+    if (!cache) {
+        stl_unmap_file(data, size);
+        return NULL;
+    }
+    
+    const unsigned char* p = data + sizeof(mesh_cache_header_t);
+    cache->mapping = data;
+    cache->mapping_size = size;
+    cache->header = header;
+    cache->vertices = (const float*)p;
+    p += (size_t)header->num_vertices * 3 * sizeof(float);
+    cache->indices = (const uint32_t*)p;
+    p += (size_t)header->num_triangles * 3 * sizeof(uint32_t);
+    cache->z_ranges = (const float*)p;
+    p += (size_t)header->num_triangles * 2 * sizeof(float);
+    cache->bvh_nodes = header->num_bvh_nodes ? (const bvh_packed_node_t*)p : NULL;
+    p += (size_t)header->num_bvh_nodes * sizeof(bvh_packed_node_t);
+    cache->bvh_leaf_indices = header->num_bvh_nodes ? (const uint32_t*)p : NULL;
+    
+    // Every index must reference a stored vertex
+    size_t num_corners = (size_t)header->num_triangles * 3;
+    for (size_t i = 0; i < num_corners; i++) {
+        if (cache->indices[i] >= header->num_vertices) {
+            fprintf(stderr, "Error: Mesh cache %s is corrupt\n", cache_filename);
+            mesh_cache_close(cache);
+            return NULL;
+        }
+    }
+    
+    return cache;
+}
+
+void mesh_cache_close(mesh_cache_t* cache) {
+    if (!cache) return;
+    stl_unmap_file(cache->mapping, cache->mapping_size);
+    free(cache);
+}
+
+stl_file_t* mesh_cache_to_stl(const mesh_cache_t* cache, int build_soa) {
+    if (!cache) return NULL;
+    
+    const mesh_cache_header_t* header = cache->header;
+    stl_file_t* stl = calloc(1, sizeof(stl_file_t));
+    if (!stl) return NULL;
+    
+    size_t num_corners = (size_t)header->num_triangles * 3;
+    memcpy(stl->header, header->stl_header, sizeof(stl->header));
+    memcpy(stl->bounds, header->bounds, sizeof(stl->bounds));
+    stl->format = (stl_format_t)header->source_format;
+    stl->num_triangles = header->num_triangles;
+    stl->num_vertices = header->num_vertices;
+    stl->vertices = malloc(((size_t)header->num_vertices * 3 + 1) * sizeof(float));
+    stl->indices = malloc((num_corners + 1) * sizeof(uint32_t));
+    if (!stl->vertices || !stl->indices) {
+        stl_free(stl);
+        return NULL;
+    }
+    
+    // The indexed form is the whole mesh; stl_get_triangle expands triangles on demand
+    memcpy(stl->vertices, cache->vertices, (size_t)header->num_vertices * 3 * sizeof(float));
+    memcpy(stl->indices, cache->indices, num_corners * sizeof(uint32_t));
+    
+    if (build_soa && stl_build_soa_with_z_ranges(stl, cache->z_ranges) != 0) {
+        fprintf(stderr, "Warning: Failed to build SoA view, using scalar kernels\n");
+    }
+    
+    return stl;
+}
+
+bvh_tree_t* mesh_cache_load_bvh(const mesh_cache_t* cache) {
+    if (!cache || !cache->bvh_nodes) return NULL;
+    
+    return bvh_deserialize(cache->bvh_nodes, cache->header->num_bvh_nodes,
+                           cache->bvh_leaf_indices, cache->header->num_bvh_leaf_indices,
+                           cache->header->num_triangles, BVH_DEFAULT_LEAF_SIZE);
+}
+
+stl_file_t* mesh_cache_load_or_create(const char* stl_filename, const stl_load_options_t* options,
+                                      bvh_tree_t** bvh, int* from_cache) {
+    if (!stl_filename || !options) return NULL;
+    if (bvh) *bvh = NULL;
+    if (from_cache) *from_cache = 0;
+    
+    // Key the cache by the source contents and modification time
+    struct stat source_stat;
+    int64_t source_mtime = stat(stl_filename, &source_stat) == 0 ? (int64_t)source_stat.st_mtime : 0;
+    size_t source_size = 0;
+    unsigned char* source = stl_map_file(stl_filename, &source_size);
+    if (!source) {
+        fprintf(stderr, "Error: Cannot open file %s\n", stl_filename);
+        return NULL;
+    }
+    uint64_t source_hash = mesh_cache_hash(source, source_size);
+    stl_unmap_file(source, source_size);
+    
+    char* cache_filename = mesh_cache_path(stl_filename);
+    if (!cache_filename) return NULL;
+    
+    // Cache hit: no parsing, only expansion of the indexed mesh
+    mesh_cache_t* cache = mesh_cache_open(cache_filename, source_hash, source_size, source_mtime,
+                                          options->weld_epsilon);
+    if (cache && (!bvh || cache->bvh_nodes)) {
+        stl_file_t* stl = mesh_cache_to_stl(cache, options->build_soa);
+        if (stl && bvh) {
+            *bvh = mesh_cache_load_bvh(cache);
+        }
+        mesh_cache_close(cache);
+        
+        if (stl && (!bvh || *bvh)) {
+            if (from_cache) *from_cache = 1;
+            free(cache_filename);
+            return stl;
+        }
+        stl_free(stl);
+    } else {
+        mesh_cache_close(cache);
+    }
+    
+    // Cache miss or cache without the BVH: parse the STL and rewrite the cache
+    stl_load_options_t create_options = *options;
+    create_options.weld_vertices = 1;
+    stl_file_t* stl = stl_load_file_with_options(stl_filename, &create_options);
+    if (!stl) {
+        free(cache_filename);
+        return NULL;
+    }
+    
+    bvh_tree_t* built = NULL;
+    if (bvh) {
+        built = bvh_create(stl, BVH_DEFAULT_LEAF_SIZE);
+        *bvh = built;
+    }
+    
+    if (!stl->indices ||
+        mesh_cache_write(cache_filename, stl, source_hash, source_size, source_mtime, options->weld_epsilon,
+                         built) != 0) {
+        fprintf(stderr, "Warning: Could not write mesh cache %s\n", cache_filename);
+    }
+    
+    free(cache_filename);
+    return stl;
+}
@@ -0,0 +1,63 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "stl_parser.h"
+#include "bvh.h"
+#include <stdint.h>
+
+// Precompiled mesh cache (.pscm), written next to the source STL
+#define MESH_CACHE_MAGIC "PSCM"
+#define MESH_CACHE_VERSION 2
+#define MESH_CACHE_EXTENSION ".pscm"
+
+// On-disk header, followed by the sections in this order:
+//   float    vertices[num_vertices * 3]
+//   uint32_t indices[num_triangles * 3]
+//   float    z_ranges[num_triangles * 2]   (z_min, z_max per triangle)
+//   bvh_packed_node_t bvh_nodes[num_bvh_nodes]
+//   uint32_t bvh_leaf_indices[num_bvh_leaf_indices]
+typedef struct {
+    char magic[4];              // "PSCM"
+    uint32_t version;           // MESH_CACHE_VERSION
+    uint64_t source_hash;       // Content hash of the source STL
+    uint64_t source_size;       // Size of the source STL in bytes
+    int64_t source_mtime;       // Modification time of the source STL
+    uint32_t num_triangles;
+    uint32_t num_vertices;
+    uint32_t num_bvh_nodes;     // 0 when no BVH is stored
+    uint32_t num_bvh_leaf_indices;
+    float weld_epsilon;         // Welding distance the vertex buffer was built with
+    uint32_t source_format;     // stl_format_t of the source file
+    float bounds[6];            // [min_x, min_y, min_z, max_x, max_y, max_z]
+    char stl_header[80];        // Header of the source STL
+} mesh_cache_header_t;
+
+// Open cache file; all pointers reference the mapping
+typedef struct {
+    void* mapping;
+    size_t mapping_size;
+    const mesh_cache_header_t* header;
+    const float* vertices;
+    const uint32_t* indices;
+    const float* z_ranges;
+    const bvh_packed_node_t* bvh_nodes;
+    const uint32_t* bvh_leaf_indices;
+} mesh_cache_t;
+
+// Function declarations
+uint64_t mesh_cache_hash(const unsigned char* data, size_t size);
+char* mesh_cache_path(const char* stl_filename);
+int mesh_cache_write(const char* cache_filename, const stl_file_t* stl, uint64_t source_hash,
+                     uint64_t source_size, int64_t source_mtime, float weld_epsilon, const bvh_tree_t* bvh);
+mesh_cache_t* mesh_cache_open(const char* cache_filename, uint64_t source_hash,
+                              uint64_t source_size, int64_t source_mtime, float weld_epsilon);
+void mesh_cache_close(mesh_cache_t* cache);
+stl_file_t* mesh_cache_to_stl(const mesh_cache_t* cache, int build_soa);
+bvh_tree_t* mesh_cache_load_bvh(const mesh_cache_t* cache);
+
+// Load from a valid cache, or parse the STL and (re)write the cache.
+// When bvh is non-NULL a BVH is returned too, and stored in the cache.
+stl_file_t* mesh_cache_load_or_create(const char* stl_filename, const stl_load_options_t* options,
+                                      bvh_tree_t** bvh, int* from_cache);
+
+#endif // MESH_CACHE_H
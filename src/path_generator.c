@@ -1,30 +1,74 @@
 #include "path_generator.h"
+#include "path_order.h"
+#include "arc_fit.h"
+#include "gcode_writer.h"
 #include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// What joining a layer's commands to the layers below needs. The layer's paths are ordered
+// from the origin, so only its first travel and its move up depend on where the last
+// layer ended.
+typedef struct {
+    size_t z_move;                  // Index of the move up to the layer
+    int has_paths;
+    point2d_t entry;                // Start of the first path
+    point2d_t unordered_entry;      // Start of the first path in slice order
+    point2d_t exit;                 // Nozzle position after the layer
+    float travel;                   // Travel between the layer's paths, ordered
+    float unordered_travel;         // The same in slice order
+    double e;                       // Extruder position after the layer
+} layer_gcode_t;
+
+// One block of layers generated in parallel, each into its own buffer
+typedef struct {
+    path_generator_t** workers;     // One per pool worker
+    const sliced_model_t* model;
+    int first_layer;
+    gcode_buffer_t* commands;
+    layer_gcode_t* layers;
+    int* status;
+} layer_block_t;
 
 path_generator_t* path_generator_create(const slicing_params_t* params) {
     path_generator_t* generator = malloc(sizeof(path_generator_t));
     if (!generator) return NULL;
     
-    generator->capacity = 1000;
-    generator->num_commands = 0;
-    generator->commands = malloc(generator->capacity * sizeof(gcode_command_t));
-    
-    if (!generator->commands) {
-        free(generator);
-        return NULL;
-    }
+    gcode_buffer_init(&generator->commands);
     
     // Initialize position
     generator->current_x = 0.0f;
     generator->current_y = 0.0f;
     generator->current_z = 0.0f;
-    generator->current_e = 0.0f;
+    generator->current_e = 0.0;
+    generator->travel_distance = 0.0f;
+    generator->unordered_travel_distance = 0.0f;
+    generator->arc_moves = 0;
+    generator->arc_replaced_moves = 0;
+    generator->path_points = NULL;
+    generator->path_capacity = 0;
+    generator->position.x = 0.0f;
+    generator->position.y = 0.0f;
+    generator->items = NULL;
+    generator->item_capacity = 0;
+    generator->chains = NULL;
+    generator->chain_capacity = 0;
+    generator->pool = params->pool;
     
     // Copy parameters
     generator->print_speed = params->print_speed;
     generator->travel_speed = params->travel_speed;
     generator->nozzle_diameter = params->nozzle_diameter;
     generator->filament_diameter = params->filament_diameter;
+    generator->arc_tolerance = params->arc_tolerance;
+    generator->perimeter_width = extrusion_width(params, params->perimeter_width);
+    generator->infill_width = extrusion_width(params, params->infill_width);
+    generator->perimeter_flow = params->perimeter_flow > 0 ? params->perimeter_flow : 1.0f;
+    generator->infill_flow = params->infill_flow > 0 ? params->infill_flow : 1.0f;
+    generator->relative_e = params->relative_e;
     
     return generator;
 }
@@ -32,213 +76,562 @@ path_generator_t* path_generator_create(const slicing_params_t* params) {
 void path_generator_free(path_generator_t* generator) {
     if (!generator) return;
     
-    // Free command comments
-    for (int i = 0; i < generator->num_commands; i++) {
-        if (generator->commands[i].comment) {
-            free(generator->commands[i].comment);
+    gcode_buffer_free(&generator->commands);
+    free(generator->path_points);
+    free(generator->items);
+    free(generator->chains);
+    free(generator);
+}
+
+float bead_extrusion(const path_generator_t* generator, float width, float height, float flow) {
+    if (generator->filament_diameter <= 0) return 0.0f;
+    
+    float bead = bead_area(width, height);
+    float filament = (float)M_PI * generator->filament_diameter * generator->filament_diameter / 4.0f;
+    return bead * flow / filament;
+}
+
+// E word for a move feeding amount of filament (0 for travel)
+static double next_e(path_generator_t* generator, double amount) {
+    generator->current_e += amount;
+    return generator->relative_e ? amount : generator->current_e;
+}
+
+// Index of the k-th point printed when the path starts where path_order put it
+static int path_point_index(const path_order_item_t* item, int start, int k) {
+    int n = item->num_points;
+    return item->closed ? (start + k) % n : (start ? n - 1 - k : k);
+}
+
+// Copy a path's points in print order for arc fitting; NULL turns arc fitting off
+static const point2d_t* path_points_in_order(path_generator_t* generator, const path_order_item_t* item,
+                                             int start, int count) {
+    if (count > generator->path_capacity) {
+        point2d_t* grown = realloc(generator->path_points, count * sizeof(point2d_t));
+        if (!grown) {
+            fprintf(stderr, "Warning: Out of memory for arc fitting, writing straight moves only\n");
+            generator->arc_tolerance = 0.0f;
+            return NULL;
         }
+        generator->path_points = grown;
+        generator->path_capacity = count;
+    }
+    for (int k = 0; k < count; k++) {
+        generator->path_points[k] = item->points[path_point_index(item, start, k)];
+    }
+    return generator->path_points;
+}
+
+// Print one path from where path_order starts it, travelling there first if needed (the
+// first path of a layer always does). Closed loops return to their first point. With arc
+// fitting on, runs of points along a circle become one G2/G3 move.
+static void add_path_commands(path_generator_t* generator, const path_order_item_t* item, int start, float z,
+                              float extrusion_per_mm, point2d_t* position, int first) {
+    point2d_t previous = item->points[path_point_index(item, start, 0)];
+    if (first || previous.x != position->x || previous.y != position->y) {
+        add_move_command(generator, previous.x, previous.y, z, next_e(generator, 0.0), 1);
     }
     
-    if (generator->commands) {
-        free(generator->commands);
+    int count = item->closed ? item->num_points + 1 : item->num_points;
+    const point2d_t* path = NULL;
+    if (generator->arc_tolerance > 0 && count > ARC_FIT_MIN_SEGMENTS) {
+        path = path_points_in_order(generator, item, start, count);
     }
-    free(generator);
+    for (int k = 1; k < count; k++) {
+        if (path) {
+            arc_fit_t arc;
+            int last = arc_fit(path, count, k - 1, generator->arc_tolerance, &arc);
+            if (last > k - 1) {
+                add_arc_command(generator, path[last].x, path[last].y,
+                                next_e(generator, arc.length * extrusion_per_mm),
+                                arc.center.x - previous.x, arc.center.y - previous.y, arc.clockwise);
+                generator->arc_moves++;
+                generator->arc_replaced_moves += last - (k - 1);
+                previous = path[last];
+                k = last;
+                continue;
+            }
+        }
+        point2d_t point = item->points[path_point_index(item, start, k)];
+        float distance = sqrtf(powf(point.x - previous.x, 2) + powf(point.y - previous.y, 2));
+        add_move_command(generator, point.x, point.y, z, next_e(generator, distance * extrusion_per_mm), 0);
+        previous = point;
+    }
+    *position = previous;
 }
 
-void generate_gcode_from_slices(path_generator_t* generator, const sliced_model_t* model) {
-    if (!generator || !model) return;
+// Print paths in travel order; falls back to array order if ordering fails. Travel to
+// the layer's first path is left to join_layer.
+static void add_ordered_paths(path_generator_t* generator, const path_order_item_t* items, int num_items,
+                              float z, float extrusion_per_mm, point2d_t* position, layer_gcode_t* layer) {
+    if (num_items <= 0) return;
+    
+    if (!layer->has_paths) layer->unordered_entry = items[0].points[0];
+    layer->unordered_travel += path_order_travel(items, NULL, num_items,
+                                                 layer->has_paths ? *position : layer->unordered_entry);
+    path_order_step_t* steps = malloc(num_items * sizeof(path_order_step_t));
+    if (!steps || path_order(items, num_items, *position, steps, NULL) != 0) {
+        fprintf(stderr, "Warning: Could not order paths at Z=%.3f, printing them in slice order\n", z);
+        free(steps);
+        steps = NULL;
+    }
+    if (!layer->has_paths) {
+        const path_order_item_t* item = &items[steps ? steps[0].item : 0];
+        layer->entry = item->points[path_point_index(item, steps ? steps[0].start : 0, 0)];
+    }
+    layer->travel += path_order_travel(items, steps, num_items, layer->has_paths ? *position : layer->entry);
+    
+    for (int i = 0; i < num_items; i++) {
+        const path_order_item_t* item = &items[steps ? steps[i].item : i];
+        add_path_commands(generator, item, steps ? steps[i].start : 0, z, extrusion_per_mm, position,
+                          !layer->has_paths && i == 0);
+    }
+    layer->has_paths = 1;
+    free(steps);
+}
+
+void generate_gcode_start(path_generator_t* generator) {
+    if (!generator) return;
     
     // Add start commands
     add_home_command(generator);
     add_temperature_command(generator, 200.0f); // Default temperature
     add_fan_command(generator, 0); // Start with fan off
     
-    // Process each layer
-    for (int layer_idx = 0; layer_idx < model->num_layers; layer_idx++) {
-        const layer_t* layer = &model->layers[layer_idx];
-        
-        // Add layer comment
-        gcode_command_t layer_comment = {0};
-        layer_comment.type = GCODE_MOVE;
-        layer_comment.comment = malloc(50);
-        snprintf(layer_comment.comment, 50, "Layer %d, Z=%.3f", layer_idx + 1, layer->z_height);
-        add_gcode_command(generator, layer_comment);
-        
-        // Move to layer height
-        add_move_command(generator, generator->current_x, generator->current_y, layer->z_height, generator->current_e, 1);
+    // Absolute E counts from each layer's G92 E0
+    add_extrusion_mode_command(generator, generator->relative_e);
+    generator->current_e = 0.0;
+    
+    generator->position.x = 0.0f;
+    generator->position.y = 0.0f;
+}
+
+// Commands for one layer, appended to the generator's buffer. They do not depend on
+// earlier layers: paths are ordered from the origin, and absolute E restarts from zero.
+// The move up to the layer starts from the generator's position, which join_layer
+// corrects when the layer was generated elsewhere.
+static int generate_layer(path_generator_t* generator, const layer_t* layer, int layer_index,
+                          layer_gcode_t* summary) {
+    memset(summary, 0, sizeof(layer_gcode_t));
+    
+    // Add layer comment
+    add_layer_command(generator, layer_index + 1, layer->z_height);
+    generator->current_e = 0.0;
+    if (!generator->relative_e) add_extruder_reset_command(generator, 0.0);
+    
+    // Move to layer height
+    summary->z_move = generator->commands.count;
+    add_move_command(generator, generator->position.x, generator->position.y, layer->z_height,
+                     next_e(generator, 0.0), 1);
+    if (generator->commands.count != summary->z_move + 1) return -1;
+    point2d_t origin = { 0.0f, 0.0f };
+    point2d_t* position = &origin;
+    
+    // Perimeters, or the raw contours when no shells were generated, plus one path
+    // per run of joined infill lines
+    const contour_t* loops = layer->num_shells > 0 ? layer->shells : layer->contours;
+    int num_loops = layer->num_shells > 0 ? layer->num_shells : layer->num_contours;
+    int needed = num_loops > layer->num_infill_points / 2 ? num_loops : layer->num_infill_points / 2;
+    if (needed > generator->item_capacity) {
+        path_order_item_t* grown = realloc(generator->items, needed * sizeof(path_order_item_t));
+        if (!grown) return -1;
+        generator->items = grown;
+        generator->item_capacity = needed;
+    }
+    if (layer->num_infill_points > generator->chain_capacity) {
+        point2d_t* grown = realloc(generator->chains, layer->num_infill_points * sizeof(point2d_t));
+        if (!grown) return -1;
+        generator->chains = grown;
+        generator->chain_capacity = layer->num_infill_points;
+    }
+    path_order_item_t* items = generator->items;
+    point2d_t* chains = generator->chains;
+    
+    // Open chains from broken meshes are printed as polylines
+    int num_items = 0;
+    for (int contour_idx = 0; contour_idx < num_loops; contour_idx++) {
+        const contour_t* contour = &loops[contour_idx];
+        if (contour->num_points < (contour->closed ? 3 : 2)) continue;
+        items[num_items++] = (path_order_item_t){ contour->points, contour->num_points, contour->closed };
+    }
+    float perimeter = bead_extrusion(generator, generator->perimeter_width, layer->thickness, generator->perimeter_flow);
+    add_ordered_paths(generator, items, num_items, layer->z_height, perimeter, position, summary);
+    
+    // Print infill
+    if (layer->num_infill_points > 0) {
+        add_comment_command(generator, "Infill");
         
-        // Print contours (shell)
-        for (int contour_idx = 0; contour_idx < layer->num_contours; contour_idx++) {
-            const contour_t* contour = &layer->contours[contour_idx];
-            
-            if (contour->num_points < 3) continue;
-            
-            // Move to first point
-            add_move_command(generator, contour->points[0].x, contour->points[0].y, layer->z_height, generator->current_e, 1);
-            
-            // Print contour
-            for (int point_idx = 1; point_idx < contour->num_points; point_idx++) {
-                float distance = sqrtf(
-                    powf(contour->points[point_idx].x - contour->points[point_idx-1].x, 2) +
-                    powf(contour->points[point_idx].y - contour->points[point_idx-1].y, 2)
-                );
-                
-                // Calculate extrusion (simplified)
-                float extrusion = distance * 0.1f; // 0.1mm per mm of travel
-                add_move_command(generator, contour->points[point_idx].x, contour->points[point_idx].y, layer->z_height, generator->current_e + extrusion, 0);
+        // A line starting where the previous one ended continues its path
+        int num_chain_points = 0;
+        num_items = 0;
+        for (int i = 0; i + 1 < layer->num_infill_points; i += 2) {
+            const point2d_t* line = &layer->infill_points[i];
+            if (num_items == 0 || line[0].x != chains[num_chain_points - 1].x ||
+                line[0].y != chains[num_chain_points - 1].y) {
+                items[num_items++] = (path_order_item_t){ &chains[num_chain_points], 0, 0 };
+                chains[num_chain_points++] = line[0];
+                items[num_items - 1].num_points = 1;
             }
-            
-            // Close contour
-            float distance = sqrtf(
-                powf(contour->points[0].x - contour->points[contour->num_points-1].x, 2) +
-                powf(contour->points[0].y - contour->points[contour->num_points-1].y, 2)
-            );
-            float extrusion = distance * 0.1f;
-            add_move_command(generator, contour->points[0].x, contour->points[0].y, layer->z_height, generator->current_e + extrusion, 0);
+            chains[num_chain_points++] = line[1];
+            items[num_items - 1].num_points++;
         }
+        float infill = bead_extrusion(generator, generator->infill_width, layer->thickness, generator->infill_flow);
+        add_ordered_paths(generator, items, num_items, layer->z_height, infill, position, summary);
+    }
+    summary->exit = *position;
+    summary->e = generator->current_e;
+    return 0;
+}
+
+// Stitch a layer onto the ones below: its move up starts where the last layer ended, and
+// the travel from there to its first path is counted
+static void join_layer(path_generator_t* generator, gcode_command_t* z_move, const layer_gcode_t* layer) {
+    point2d_t* position = &generator->position;
+    z_move->data.move.x = gcode_units(position->x);
+    z_move->data.move.y = gcode_units(position->y);
+    
+    if (layer->has_paths) {
+        generator->travel_distance += sqrtf(powf(layer->entry.x - position->x, 2) +
+                                            powf(layer->entry.y - position->y, 2)) + layer->travel;
+        generator->unordered_travel_distance += sqrtf(powf(layer->unordered_entry.x - position->x, 2) +
+                                                      powf(layer->unordered_entry.y - position->y, 2)) +
+                                                layer->unordered_travel;
+        *position = layer->exit;
+    }
+    generator->current_e = layer->e;
+}
+
+int generate_gcode_for_layer(path_generator_t* generator, const layer_t* layer, int layer_index) {
+    if (!generator || !layer) return -1;
+    
+    layer_gcode_t summary;
+    if (generate_layer(generator, layer, layer_index, &summary) != 0) return -1;
+    join_layer(generator, (gcode_command_t*)gcode_buffer_at(&generator->commands, summary.z_move), &summary);
+    return 0;
+}
+
+// A generator with the same settings and its own buffer and scratch space
+static path_generator_t* path_generator_worker(const path_generator_t* generator) {
+    path_generator_t* worker = malloc(sizeof(path_generator_t));
+    if (!worker) return NULL;
+    
+    *worker = *generator;
+    gcode_buffer_init(&worker->commands);
+    worker->travel_distance = 0.0f;
+    worker->unordered_travel_distance = 0.0f;
+    worker->arc_moves = 0;
+    worker->arc_replaced_moves = 0;
+    worker->path_points = NULL;
+    worker->path_capacity = 0;
+    worker->items = NULL;
+    worker->item_capacity = 0;
+    worker->chains = NULL;
+    worker->chain_capacity = 0;
+    worker->pool = NULL;
+    return worker;
+}
+
+static void generate_layer_task(void* user_data, int index, int worker) {
+    layer_block_t* block = (layer_block_t*)user_data;
+    path_generator_t* generator = block->workers[worker];
+    int layer_index = block->first_layer + index;
+    
+    block->status[index] = generate_layer(generator, &block->model->layers[layer_index], layer_index,
+                                          &block->layers[index]);
+    path_generator_take_commands(generator, &block->commands[index]);
+}
+
+// Generate layers from first_layer on; returns the number of layers generated, which is
+// short only when out of memory
+static int generate_layers_serial(path_generator_t* generator, const sliced_model_t* model, int first_layer) {
+    int layer_idx = first_layer;
+    while (layer_idx < model->num_layers &&
+           generate_gcode_for_layer(generator, &model->layers[layer_idx], layer_idx) == 0) {
+        layer_idx++;
+    }
+    return layer_idx;
+}
+
+// Blocks of layers are generated on the pool's workers, then appended in layer order and
+// joined, so the output is the same at any thread count. Blocks bound the commands held
+// outside the generator's buffer.
+static int generate_layers_parallel(path_generator_t* generator, const sliced_model_t* model) {
+    thread_pool_t* pool = generator->pool;
+    int block_size = PATH_GENERATOR_BLOCK_LAYERS;
+    layer_block_t block = { 0 };
+    block.model = model;
+    block.workers = calloc(pool->num_threads, sizeof(path_generator_t*));
+    block.commands = calloc(block_size, sizeof(gcode_buffer_t));
+    block.layers = malloc(block_size * sizeof(layer_gcode_t));
+    block.status = malloc(block_size * sizeof(int));
+    int ready = block.workers && block.commands && block.layers && block.status;
+    for (int w = 0; ready && w < pool->num_threads; w++) {
+        block.workers[w] = path_generator_worker(generator);
+        if (!block.workers[w]) ready = 0;
+    }
+    
+    int layer_idx = 0;
+    if (!ready) {
+        fprintf(stderr, "Warning: Out of memory for parallel G-code generation, generating serially\n");
+        layer_idx = generate_layers_serial(generator, model, 0);
+    }
+    while (ready && layer_idx < model->num_layers) {
+        int count = model->num_layers - layer_idx < block_size ? model->num_layers - layer_idx : block_size;
+        block.first_layer = layer_idx;
+        thread_pool_parallel_for(pool, count, generate_layer_task, &block);
         
-        // Print infill
-        if (layer->num_infill_points > 0) {
-            // Add infill comment
-            gcode_command_t infill_comment = {0};
-            infill_comment.type = GCODE_MOVE;
-            infill_comment.comment = malloc(20);
-            snprintf(infill_comment.comment, 20, "Infill");
-            add_gcode_command(generator, infill_comment);
-            
-            for (int i = 0; i < layer->num_infill_points; i += 2) {
-                if (i + 1 < layer->num_infill_points) {
-                    // Move to start of line
-                    add_move_command(generator, layer->infill_points[i].x, layer->infill_points[i].y, layer->z_height, generator->current_e, 1);
-                    
-                    // Print line
-                    float distance = sqrtf(
-                        powf(layer->infill_points[i+1].x - layer->infill_points[i].x, 2) +
-                        powf(layer->infill_points[i+1].y - layer->infill_points[i].y, 2)
-                    );
-                    float extrusion = distance * 0.05f; // Less extrusion for infill
-                    add_move_command(generator, layer->infill_points[i+1].x, layer->infill_points[i+1].y, layer->z_height, generator->current_e + extrusion, 0);
-                }
+        for (int i = 0; i < count; i++) {
+            size_t base = generator->commands.count;
+            if (ready && block.status[i] == 0 &&
+                gcode_buffer_append_buffer(&generator->commands, &block.commands[i]) == 0) {
+                gcode_command_t* z_move = (gcode_command_t*)gcode_buffer_at(&generator->commands,
+                                                                            base + block.layers[i].z_move);
+                join_layer(generator, z_move, &block.layers[i]);
+                layer_idx++;
+            } else {
+                ready = 0;
             }
+            gcode_buffer_free(&block.commands[i]);
+        }
+    }
+    
+    if (block.workers) {
+        for (int w = 0; w < pool->num_threads; w++) {
+            if (!block.workers[w]) continue;
+            generator->arc_moves += block.workers[w]->arc_moves;
+            generator->arc_replaced_moves += block.workers[w]->arc_replaced_moves;
+            if (block.workers[w]->arc_tolerance <= 0) generator->arc_tolerance = 0.0f;
+            path_generator_free(block.workers[w]);
         }
     }
+    free(block.workers);
+    free(block.commands);
+    free(block.layers);
+    free(block.status);
+    return layer_idx;
+}
+
+void generate_gcode_end(path_generator_t* generator) {
+    if (!generator) return;
     
     // Add end commands
     add_fan_command(generator, 0);
     add_end_command(generator);
 }
 
-void add_gcode_command(path_generator_t* generator, gcode_command_t command) {
-    if (!generator) return;
+void generate_gcode_from_slices(path_generator_t* generator, const sliced_model_t* model) {
+    if (!generator || !model) return;
     
-    // Expand capacity if needed
-    if (generator->num_commands >= generator->capacity) {
-        generator->capacity *= 2;
-        generator->commands = realloc(generator->commands, generator->capacity * sizeof(gcode_command_t));
-        if (!generator->commands) return;
+    generate_gcode_start(generator);
+    int layers_done = generator->pool && generator->pool->num_threads > 1 && model->num_layers > 1
+        ? generate_layers_parallel(generator, model)
+        : generate_layers_serial(generator, model, 0);
+    if (layers_done < model->num_layers) {
+        fprintf(stderr, "Warning: Out of memory, G-code stops before layer %d\n", layers_done + 1);
     }
+    generate_gcode_end(generator);
+}
+
+void path_generator_take_commands(path_generator_t* generator, gcode_buffer_t* commands) {
+    if (!generator || !commands) return;
     
-    generator->commands[generator->num_commands] = command;
-    generator->num_commands++;
+    // Chunks and interned text go along as they are
+    *commands = generator->commands;
+    gcode_buffer_init(&generator->commands);
 }
 
-void write_gcode_to_file(path_generator_t* generator, const char* filename) {
-    if (!generator || !filename) return;
+void add_gcode_command(path_generator_t* generator, gcode_command_t command) {
+    if (!generator) return;
     
-    FILE* file = fopen(filename, "w");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot create file %s\n", filename);
-        return;
+    gcode_command_t* slot = gcode_buffer_append(&generator->commands);
+    if (slot) *slot = command;
+}
+
+void write_gcode_header(gcode_writer_t* writer, const path_generator_t* generator, long long num_commands) {
+    gcode_writer_text(writer, "; G-code generated by Parametric Slicer\n");
+    if (num_commands >= 0) {
+        gcode_writer_text(writer, "; Number of commands: ");
+        gcode_writer_number(writer, (double)num_commands, 0);
+        gcode_writer_text(writer, "\n");
     }
-    
-    // Write header
-    fprintf(file, "; G-code generated by Parametric Slicer\n");
-    fprintf(file, "; Number of commands: %d\n", generator->num_commands);
-    fprintf(file, "; Print speed: %.1f mm/s\n", generator->print_speed);
-    fprintf(file, "; Travel speed: %.1f mm/s\n", generator->travel_speed);
-    fprintf(file, "\n");
-    
-    // Write commands
-    for (int i = 0; i < generator->num_commands; i++) {
-        const gcode_command_t* cmd = &generator->commands[i];
+    gcode_writer_text(writer, "; Print speed: ");
+    gcode_writer_number(writer, generator->print_speed, 1);
+    gcode_writer_text(writer, " mm/s\n; Travel speed: ");
+    gcode_writer_number(writer, generator->travel_speed, 1);
+    gcode_writer_text(writer, " mm/s\n\n");
+}
+
+static void write_gcode_feed(gcode_writer_t* writer, gcode_output_state_t* state,
+                             const gcode_buffer_t* commands, const gcode_command_t* cmd) {
+    float feed = commands->feeds[cmd->feed];
+    if (feed > 0 && feed != state->f) {
+        gcode_writer_word(writer, 'F', feed, 1);
+        state->f = feed;
+    }
+}
+
+// Whether a move's E word is needed: after M83 any extrusion, otherwise a new position
+static int extrudes(const gcode_output_state_t* state, int32_t e) {
+    return state->relative_e ? e != 0 : e != state->e;
+}
+
+// Words that repeat the modal state are left out: unchanged axes and feed rates, and
+// moves that go nowhere
+void write_gcode_commands(gcode_writer_t* writer, gcode_output_state_t* state, const gcode_buffer_t* commands) {
+    for (size_t i = 0; i < commands->count; i++) {
+        const gcode_command_t* cmd = gcode_buffer_at(commands, i);
         
         switch (cmd->type) {
             case GCODE_MOVE:
-                fprintf(file, "G1");
-                if (cmd->x != generator->current_x || cmd->y != generator->current_y || 
-                    cmd->z != generator->current_z || cmd->e != generator->current_e) {
-                    if (cmd->x != generator->current_x) fprintf(file, " X%.3f", cmd->x);
-                    if (cmd->y != generator->current_y) fprintf(file, " Y%.3f", cmd->y);
-                    if (cmd->z != generator->current_z) fprintf(file, " Z%.3f", cmd->z);
-                    if (cmd->e != generator->current_e) fprintf(file, " E%.3f", cmd->e);
-                    if (cmd->f > 0) fprintf(file, " F%.1f", cmd->f);
+                if (cmd->data.move.x == state->x && cmd->data.move.y == state->y &&
+                    cmd->data.move.z == state->z && !extrudes(state, cmd->data.move.e)) {
+                    continue;
                 }
+                gcode_writer_text(writer, "G1");
+                if (cmd->data.move.x != state->x) gcode_writer_word_units(writer, 'X', cmd->data.move.x, GCODE_UNIT_DECIMALS);
+                if (cmd->data.move.y != state->y) gcode_writer_word_units(writer, 'Y', cmd->data.move.y, GCODE_UNIT_DECIMALS);
+                if (cmd->data.move.z != state->z) gcode_writer_word_units(writer, 'Z', cmd->data.move.z, GCODE_UNIT_DECIMALS);
+                if (extrudes(state, cmd->data.move.e)) gcode_writer_word_units(writer, 'E', cmd->data.move.e, GCODE_UNIT_DECIMALS);
+                write_gcode_feed(writer, state, commands, cmd);
+                state->x = cmd->data.move.x;
+                state->y = cmd->data.move.y;
+                state->z = cmd->data.move.z;
+                state->e = cmd->data.move.e;
+                break;
+                
+            case GCODE_ARC:
+                // Firmware needs the end point and centre even when unchanged
+                gcode_writer_text(writer, (cmd->flags & GCODE_FLAG_CLOCKWISE) ? "G2" : "G3");
+                gcode_writer_word_units(writer, 'X', cmd->data.arc.x, GCODE_UNIT_DECIMALS);
+                gcode_writer_word_units(writer, 'Y', cmd->data.arc.y, GCODE_UNIT_DECIMALS);
+                gcode_writer_word_units(writer, 'I', cmd->data.arc.i, GCODE_UNIT_DECIMALS);
+                gcode_writer_word_units(writer, 'J', cmd->data.arc.j, GCODE_UNIT_DECIMALS);
+                if (extrudes(state, cmd->data.arc.e)) gcode_writer_word_units(writer, 'E', cmd->data.arc.e, GCODE_UNIT_DECIMALS);
+                write_gcode_feed(writer, state, commands, cmd);
+                state->x = cmd->data.arc.x;
+                state->y = cmd->data.arc.y;
+                state->e = cmd->data.arc.e;
                 break;
                 
             case GCODE_HOME:
-                fprintf(file, "G28");
+                gcode_writer_text(writer, "G28");
+                break;
+                
+            case GCODE_SET_POS:
+                gcode_writer_text(writer, "G92");
+                gcode_writer_word_units(writer, 'E', cmd->data.value, GCODE_UNIT_DECIMALS);
+                state->e = cmd->data.value;
+                break;
+                
+            case GCODE_E_MODE:
+                gcode_writer_text(writer, cmd->data.value ? "M83" : "M82");
+                state->relative_e = cmd->data.value;
                 break;
                 
             case GCODE_SET_TEMP:
-                fprintf(file, "M104 S%.1f", cmd->s);
+                gcode_writer_text(writer, "M104");
+                gcode_writer_word_units(writer, 'S', cmd->data.value, 1);
                 break;
                 
             case GCODE_FAN:
-                if (cmd->s > 0) {
-                    fprintf(file, "M106 S%d", (int)cmd->s);
+                if (cmd->data.value > 0) {
+                    gcode_writer_text(writer, "M106");
+                    gcode_writer_word_units(writer, 'S', cmd->data.value, 0);
                 } else {
-                    fprintf(file, "M107");
+                    gcode_writer_text(writer, "M107");
                 }
                 break;
                 
             case GCODE_END:
-                fprintf(file, "M2");
+                gcode_writer_text(writer, "M2");
+                break;
+                
+            case GCODE_COMMENT:
+                gcode_writer_text(writer, "; ");
+                gcode_writer_text(writer, commands->comments[cmd->data.comment]);
+                break;
+                
+            case GCODE_LAYER:
+                gcode_writer_text(writer, "; Layer ");
+                gcode_writer_number(writer, cmd->data.layer.number, 0);
+                gcode_writer_text(writer, ", Z=");
+                gcode_writer_units(writer, cmd->data.layer.z, GCODE_UNIT_DECIMALS);
                 break;
                 
             default:
                 break;
         }
-        
-        if (cmd->comment) {
-            fprintf(file, " ; %s", cmd->comment);
-        }
-        fprintf(file, "\n");
-        
-        // Update current position
-        if (cmd->type == GCODE_MOVE) {
-            generator->current_x = cmd->x;
-            generator->current_y = cmd->y;
-            generator->current_z = cmd->z;
-            generator->current_e = cmd->e;
-        }
+        gcode_writer_text(writer, "\n");
+    }
+}
+
+void write_gcode_to_file(path_generator_t* generator, const char* filename) {
+    if (!generator || !filename) return;
+    
+    gcode_writer_t* writer = gcode_writer_open(filename);
+    if (!writer) {
+        fprintf(stderr, "Error: Cannot create file %s\n", filename);
+        return;
     }
     
-    fclose(file);
+    gcode_output_state_t state = {0};
+    write_gcode_header(writer, generator, (long long)generator->commands.count);
+    write_gcode_commands(writer, &state, &generator->commands);
+    if (gcode_writer_close(writer) != 0) {
+        fprintf(stderr, "Error: Failed writing G-code to %s\n", filename);
+        return;
+    }
     printf("G-code written to %s\n", filename);
 }
 
-void add_move_command(path_generator_t* generator, float x, float y, float z, float e, int is_travel) {
+int write_gcode_to_fd(path_generator_t* generator, int fd) {
+    if (!generator) return -1;
+    
+    gcode_writer_t* writer = gcode_writer_create(fd);
+    if (!writer) return -1;
+    
+    gcode_output_state_t state = {0};
+    write_gcode_header(writer, generator, (long long)generator->commands.count);
+    write_gcode_commands(writer, &state, &generator->commands);
+    return gcode_writer_close(writer);
+}
+
+void add_move_command(path_generator_t* generator, float x, float y, float z, double e, int is_travel) {
     gcode_command_t cmd = {0};
     cmd.type = GCODE_MOVE;
-    cmd.x = x;
-    cmd.y = y;
-    cmd.z = z;
-    cmd.e = e;
-    cmd.f = is_travel ? generator->travel_speed * 60.0f : generator->print_speed * 60.0f; // Convert to mm/min
+    float feed = is_travel ? generator->travel_speed * 60.0f : generator->print_speed * 60.0f; // Convert to mm/min
+    if (gcode_buffer_feed(&generator->commands, feed, &cmd.feed) != 0) return;
+    cmd.data.move.x = gcode_units(x);
+    cmd.data.move.y = gcode_units(y);
+    cmd.data.move.z = gcode_units(z);
+    cmd.data.move.e = gcode_units(e);
+    add_gcode_command(generator, cmd);
+}
+
+void add_arc_command(path_generator_t* generator, float x, float y, double e, float i, float j, int clockwise) {
+    gcode_command_t cmd = {0};
+    cmd.type = GCODE_ARC;
+    cmd.flags = clockwise ? GCODE_FLAG_CLOCKWISE : 0;
+    if (gcode_buffer_feed(&generator->commands, generator->print_speed * 60.0f, &cmd.feed) != 0) return; // Arcs always extrude
+    cmd.data.arc.x = gcode_units(x);
+    cmd.data.arc.y = gcode_units(y);
+    cmd.data.arc.e = gcode_units(e);
+    cmd.data.arc.i = gcode_units(i);
+    cmd.data.arc.j = gcode_units(j);
     add_gcode_command(generator, cmd);
 }
 
 void add_temperature_command(path_generator_t* generator, float temp) {
     gcode_command_t cmd = {0};
     cmd.type = GCODE_SET_TEMP;
-    cmd.s = temp;
+    cmd.data.value = (int32_t)lrint((double)temp * 10.0); // Tenths of a degree
     add_gcode_command(generator, cmd);
 }
 
 void add_fan_command(path_generator_t* generator, int fan_speed) {
     gcode_command_t cmd = {0};
     cmd.type = GCODE_FAN;
-    cmd.s = fan_speed;
+    cmd.data.value = fan_speed;
     add_gcode_command(generator, cmd);
 }
 
@@ -252,4 +645,33 @@ void add_end_command(path_generator_t* generator) {
     gcode_command_t cmd = {0};
     cmd.type = GCODE_END;
     add_gcode_command(generator, cmd);
+} 
+
+void add_comment_command(path_generator_t* generator, const char* comment) {
+    gcode_command_t cmd = {0};
+    cmd.type = GCODE_COMMENT;
+    if (gcode_buffer_intern(&generator->commands, comment, &cmd.data.comment) != 0) return;
+    add_gcode_command(generator, cmd);
+}
+
+void add_layer_command(path_generator_t* generator, int layer_number, float z) {
+    gcode_command_t cmd = {0};
+    cmd.type = GCODE_LAYER;
+    cmd.data.layer.number = layer_number;
+    cmd.data.layer.z = gcode_units(z);
+    add_gcode_command(generator, cmd);
+}
+
+void add_extrusion_mode_command(path_generator_t* generator, int relative) {
+    gcode_command_t cmd = {0};
+    cmd.type = GCODE_E_MODE;
+    cmd.data.value = relative ? 1 : 0;
+    add_gcode_command(generator, cmd);
+}
+
+void add_extruder_reset_command(path_generator_t* generator, double e) {
+    gcode_command_t cmd = {0};
+    cmd.type = GCODE_SET_POS;
+    cmd.data.value = gcode_units(e);
+    add_gcode_command(generator, cmd);
 } 
\ No newline at end of file
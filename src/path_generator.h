@@ -2,48 +2,82 @@
 #define PATH_GENERATOR_H
 
 #include "slicer.h"
+#include "path_order.h"
+#include "gcode_writer.h"
+#include "gcode_buffer.h"
 
-// G-code command types
-typedef enum {
-    GCODE_MOVE,     // G0/G1 - Linear move
-    GCODE_ARC,      // G2/G3 - Arc move
-    GCODE_SET_POS,  // G92 - Set position
-    GCODE_HOME,     // G28 - Home axes
-    GCODE_SET_UNITS, // G20/G21 - Set units
-    GCODE_SET_TEMP, // M104/M109 - Set temperature
-    GCODE_FAN,      // M106/M107 - Fan control
-    GCODE_END       // M2 - End program
-} gcode_type_t;
-
-// G-code command structure
-typedef struct {
-    gcode_type_t type;
-    float x, y, z, e;       // Coordinates and extrusion
-    float f;                // Feed rate
-    float s;                // Speed/temperature
-    char* comment;          // Optional comment
-} gcode_command_t;
+// Layers generated in parallel before they are joined in order; bounds the commands held
+// in per-layer buffers
+#define PATH_GENERATOR_BLOCK_LAYERS 64
 
 // Path generator structure
 typedef struct {
-    gcode_command_t* commands;
-    int num_commands;
-    int capacity;
-    float current_x, current_y, current_z, current_e;
+    gcode_buffer_t commands;
+    float current_x, current_y, current_z;
+    double current_e;                // Filament fed so far in the layer (mm); the E position in absolute mode
     float print_speed, travel_speed;
     float nozzle_diameter, filament_diameter;
+    float perimeter_width, infill_width; // Extrusion widths (mm)
+    float perimeter_flow, infill_flow;   // Extrusion multipliers
+    int relative_e;                  // E words give each move's own extrusion (M83)
+    float travel_distance;           // Travel moves after path ordering (mm)
+    float unordered_travel_distance; // Travel the paths would need in slice order (mm)
+    float arc_tolerance;             // Arc fitting tolerance (mm), 0 = straight moves only
+    int arc_moves;                   // G2/G3 moves emitted
+    int arc_replaced_moves;          // Straight moves those arcs replaced
+    point2d_t* path_points;          // Scratch: the current path's points in print order
+    int path_capacity;
+    point2d_t position;              // Nozzle position as generated, carried between layers
+    path_order_item_t* items;        // Scratch: one layer's paths
+    int item_capacity;
+    point2d_t* chains;               // Scratch: infill lines joined into paths
+    int chain_capacity;
+    thread_pool_t* pool;             // Workers for per-layer generation (NULL = serial)
 } path_generator_t;
 
+// Last value written for each modal word
+typedef struct {
+    int32_t x, y, z, e;     // GCODE_UNITS_PER_MM
+    float f;
+    int relative_e;         // After M83: every nonzero E is written
+} gcode_output_state_t;
+
 // Function declarations
 path_generator_t* path_generator_create(const slicing_params_t* params);
 void path_generator_free(path_generator_t* generator);
 void generate_gcode_from_slices(path_generator_t* generator, const sliced_model_t* model);
+
+// Layer-at-a-time generation, as generate_gcode_from_slices does it: start commands,
+// every layer bottom-up (-1 when out of memory), end commands. Each layer's paths are
+// ordered from the origin and, with absolute E, start with G92 E0, so layers can be
+// generated independently; generate_gcode_from_slices does that on the pool.
+void generate_gcode_start(path_generator_t* generator);
+int generate_gcode_for_layer(path_generator_t* generator, const layer_t* layer, int layer_index);
+void generate_gcode_end(path_generator_t* generator);
+
+// Move the commands generated so far into commands (free with gcode_buffer_free) and
+// start an empty buffer
+void path_generator_take_commands(path_generator_t* generator, gcode_buffer_t* commands);
+
+// Header (num_commands < 0 leaves the count out), then commands in any number of
+// batches sharing one state
+void write_gcode_header(gcode_writer_t* writer, const path_generator_t* generator, long long num_commands);
+void write_gcode_commands(gcode_writer_t* writer, gcode_output_state_t* state, const gcode_buffer_t* commands);
 void add_gcode_command(path_generator_t* generator, gcode_command_t command);
 void write_gcode_to_file(path_generator_t* generator, const char* filename);
-void add_move_command(path_generator_t* generator, float x, float y, float z, float e, int is_travel);
+int write_gcode_to_fd(path_generator_t* generator, int fd); // fd stays open; 0 on success
+void add_move_command(path_generator_t* generator, float x, float y, float z, double e, int is_travel);
+void add_arc_command(path_generator_t* generator, float x, float y, double e, float i, float j, int clockwise);
 void add_temperature_command(path_generator_t* generator, float temp);
 void add_fan_command(path_generator_t* generator, int fan_speed);
 void add_home_command(path_generator_t* generator);
 void add_end_command(path_generator_t* generator);
+void add_comment_command(path_generator_t* generator, const char* comment);
+void add_layer_command(path_generator_t* generator, int layer_number, float z);
+void add_extrusion_mode_command(path_generator_t* generator, int relative);
+void add_extruder_reset_command(path_generator_t* generator, double e);
+
+// Filament per mm of a bead width wide and height high, times flow
+float bead_extrusion(const path_generator_t* generator, float width, float height, float flow);
 
 #endif // PATH_GENERATOR_H 
\ No newline at end of file
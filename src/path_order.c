@@ -0,0 +1,343 @@
+#include "path_order.h"
+#include "cell_grid.h"
+#include <math.h>
+#include <string.h>
+
+// Path ends (and loop vertices) bucketed in a uniform grid of about one entry per cell.
+// Entries can be removed: each cell keeps its live entries first.
+typedef struct {
+    float* x;
+    float* y;
+    int* item;
+    int* ref;                // Loop vertex, or open path end (0 first, 1 last)
+    int num_entries;
+    int* cell_starts;
+    int* cell_counts;        // Live entries per cell
+    int* cell_entries;
+    int* slots;              // Where each entry sits in cell_entries
+    cell_grid_t cells;
+} path_grid_t;
+
+static float path_distance(point2d_t a, point2d_t b) {
+    return sqrtf((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+}
+
+static void path_grid_free(path_grid_t* grid) {
+    free(grid->x);
+    free(grid->y);
+    free(grid->item);
+    free(grid->ref);
+    free(grid->cell_starts);
+    free(grid->cell_counts);
+    free(grid->cell_entries);
+    free(grid->slots);
+}
+
+static int path_grid_alloc(path_grid_t* grid, int num_entries) {
+    memset(grid, 0, sizeof(path_grid_t));
+    size_t n = (size_t)num_entries + 1;
+    grid->x = malloc(n * sizeof(float));
+    grid->y = malloc(n * sizeof(float));
+    grid->item = malloc(n * sizeof(int));
+    grid->ref = malloc(n * sizeof(int));
+    grid->slots = malloc(n * sizeof(int));
+    if (!grid->x || !grid->y || !grid->item || !grid->ref || !grid->slots) {
+        path_grid_free(grid);
+        return -1;
+    }
+    return 0;
+}
+
+static void path_grid_push(path_grid_t* grid, point2d_t p, int item, int ref) {
+    int e = grid->num_entries++;
+    grid->x[e] = p.x;
+    grid->y[e] = p.y;
+    grid->item[e] = item;
+    grid->ref[e] = ref;
+}
+
+// Bucket the pushed entries
+static int path_grid_build(path_grid_t* grid) {
+    int n = grid->num_entries;
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    for (int e = 0; e < n; e++) {
+        min_x = fminf(min_x, grid->x[e]);
+        min_y = fminf(min_y, grid->y[e]);
+        max_x = fmaxf(max_x, grid->x[e]);
+        max_y = fmaxf(max_y, grid->y[e]);
+    }
+    if (n == 0) min_x = min_y = max_x = max_y = 0.0f;
+    
+    float width = max_x - min_x, height = max_y - min_y;
+    float cell_size = sqrtf(fmaxf(width * height, 1e-6f) / (n > 0 ? n : 1));
+    if (cell_size < 1e-3f) cell_size = 1e-3f;
+    while (((double)width / cell_size + 1) * ((double)height / cell_size + 1) > 4.0 * n + 16) {
+        cell_size *= 2.0f;
+    }
+    grid->cells.cell_size = cell_size;
+    grid->cells.min_x = min_x;
+    grid->cells.min_y = min_y;
+    grid->cells.nx = (int)(width / cell_size) + 1;
+    grid->cells.ny = (int)(height / cell_size) + 1;
+    
+    size_t num_cells = (size_t)grid->cells.nx * grid->cells.ny;
+    grid->cell_starts = calloc(num_cells + 1, sizeof(int));
+    grid->cell_counts = calloc(num_cells, sizeof(int));
+    grid->cell_entries = malloc(((size_t)n + 1) * sizeof(int));
+    if (!grid->cell_starts || !grid->cell_counts || !grid->cell_entries) return -1;
+    
+    for (int e = 0; e < n; e++) {
+        grid->cell_starts[cell_grid_cell(&grid->cells, grid->x[e], grid->y[e], NULL, NULL) + 1]++;
+    }
+    for (size_t c = 0; c < num_cells; c++) grid->cell_starts[c + 1] += grid->cell_starts[c];
+    for (int e = 0; e < n; e++) {
+        int cell = cell_grid_cell(&grid->cells, grid->x[e], grid->y[e], NULL, NULL);
+        int slot = grid->cell_starts[cell] + grid->cell_counts[cell]++;
+        grid->cell_entries[slot] = e;
+        grid->slots[e] = slot;
+    }
+    return 0;
+}
+
+static void path_grid_remove(path_grid_t* grid, int e) {
+    int cell = cell_grid_cell(&grid->cells, grid->x[e], grid->y[e], NULL, NULL);
+    int last = grid->cell_starts[cell] + --grid->cell_counts[cell];
+    int moved = grid->cell_entries[last];
+    grid->cell_entries[grid->slots[e]] = moved;
+    grid->slots[moved] = grid->slots[e];
+    grid->cell_entries[last] = e;
+    grid->slots[e] = last;
+}
+
+// Nearest-entry search state for cell_grid_nearest
+typedef struct {
+    const path_grid_t* grid;
+    point2d_t p;
+    int best;
+    float best_d2;
+} path_grid_search_t;
+
+static float path_grid_visit(void* context, int cell) {
+    path_grid_search_t* search = (path_grid_search_t*)context;
+    const path_grid_t* grid = search->grid;
+    int end = grid->cell_starts[cell] + grid->cell_counts[cell];
+    for (int s = grid->cell_starts[cell]; s < end; s++) {
+        int e = grid->cell_entries[s];
+        float dx = grid->x[e] - search->p.x, dy = grid->y[e] - search->p.y;
+        float d2 = dx * dx + dy * dy;
+        if (d2 < search->best_d2) {
+            search->best_d2 = d2;
+            search->best = e;
+        }
+    }
+    return search->best_d2;
+}
+
+// Nearest live entry, or -1
+static int path_grid_nearest(const path_grid_t* grid, point2d_t p) {
+    path_grid_search_t search = { grid, p, -1, FLT_MAX };
+    cell_grid_nearest(&grid->cells, p.x, p.y, path_grid_visit, &search);
+    return search.best;
+}
+
+// Where a path is entered and left, given where it starts
+static point2d_t path_entry(const path_order_item_t* item, int start) {
+    if (item->closed) return item->points[start];
+    return item->points[start ? item->num_points - 1 : 0];
+}
+
+static point2d_t path_exit(const path_order_item_t* item, int start) {
+    if (item->closed) return item->points[start];
+    return item->points[start ? 0 : item->num_points - 1];
+}
+
+// Greedy tour: always go to the nearest path end or loop vertex not printed yet
+static int path_order_nearest(const path_order_item_t* items, int num_items, point2d_t start,
+                              path_order_step_t* steps) {
+    int num_entries = 0;
+    for (int i = 0; i < num_items; i++) {
+        num_entries += items[i].closed ? items[i].num_points : 2;
+    }
+    
+    path_grid_t grid;
+    if (path_grid_alloc(&grid, num_entries) != 0) return -1;
+    int* first_entry = malloc(((size_t)num_items + 1) * sizeof(int));
+    if (!first_entry) {
+        path_grid_free(&grid);
+        return -1;
+    }
+    for (int i = 0; i < num_items; i++) {
+        first_entry[i] = grid.num_entries;
+        if (items[i].closed) {
+            for (int p = 0; p < items[i].num_points; p++) path_grid_push(&grid, items[i].points[p], i, p);
+        } else {
+            path_grid_push(&grid, items[i].points[0], i, 0);
+            path_grid_push(&grid, items[i].points[items[i].num_points - 1], i, 1);
+        }
+    }
+    first_entry[num_items] = grid.num_entries;
+    if (path_grid_build(&grid) != 0) {
+        free(first_entry);
+        path_grid_free(&grid);
+        return -1;
+    }
+    
+    point2d_t position = start;
+    for (int k = 0; k < num_items; k++) {
+        int e = path_grid_nearest(&grid, position);
+        int item = grid.item[e];
+        steps[k].item = item;
+        steps[k].start = grid.ref[e];
+        for (int r = first_entry[item]; r < first_entry[item + 1]; r++) path_grid_remove(&grid, r);
+        position = path_exit(&items[item], steps[k].start);
+    }
+    
+    free(first_entry);
+    path_grid_free(&grid);
+    return 0;
+}
+
+// 2-opt over the greedy order. Reversing steps [a, b] joins the point before a to the
+// exit of b, now entered first, and the old entry of a to the step after b. Only exits
+// near the point before a are tried, found through a grid of path ends.
+static int path_order_improve(const path_order_item_t* items, int num_items, point2d_t start,
+                              path_order_step_t* steps) {
+    path_grid_t grid;
+    if (path_grid_alloc(&grid, 2 * num_items) != 0) return -1;
+    int* position = malloc(((size_t)num_items + 1) * sizeof(int));
+    if (!position) {
+        path_grid_free(&grid);
+        return -1;
+    }
+    
+    // Loops keep the seam the greedy pass gave them
+    for (int k = 0; k < num_items; k++) {
+        const path_order_item_t* item = &items[steps[k].item];
+        position[steps[k].item] = k;
+        if (item->closed) {
+            path_grid_push(&grid, item->points[steps[k].start], steps[k].item, steps[k].start);
+        } else {
+            path_grid_push(&grid, item->points[0], steps[k].item, 0);
+            path_grid_push(&grid, item->points[item->num_points - 1], steps[k].item, 1);
+        }
+    }
+    if (path_grid_build(&grid) != 0) {
+        free(position);
+        path_grid_free(&grid);
+        return -1;
+    }
+    
+    int improved = 1;
+    for (int pass = 0; pass < PATH_ORDER_MAX_PASSES && improved; pass++) {
+        improved = 0;
+        for (int a = 0; a < num_items; a++) {
+            point2d_t before = a > 0 ? path_exit(&items[steps[a - 1].item], steps[a - 1].start) : start;
+            int cx, cy;
+            cell_grid_cell(&grid.cells, before.x, before.y, &cx, &cy);
+            
+            for (int gy = cy - PATH_ORDER_NEIGHBOR_RINGS; gy <= cy + PATH_ORDER_NEIGHBOR_RINGS; gy++) {
+                if (gy < 0 || gy >= grid.cells.ny) continue;
+                for (int gx = cx - PATH_ORDER_NEIGHBOR_RINGS; gx <= cx + PATH_ORDER_NEIGHBOR_RINGS; gx++) {
+                    if (gx < 0 || gx >= grid.cells.nx) continue;
+                    int c = gy * grid.cells.nx + gx;
+                    for (int s = grid.cell_starts[c]; s < grid.cell_starts[c + 1]; s++) {
+                        int e = grid.cell_entries[s];
+                        int b = position[grid.item[e]];
+                        if (b < a || b - a >= PATH_ORDER_MAX_SPAN) continue;
+                        
+                        // The candidate must be where b is left now
+                        const path_order_item_t* last = &items[steps[b].item];
+                        if (!last->closed && grid.ref[e] != (steps[b].start ? 0 : 1)) continue;
+                        
+                        const path_order_item_t* first = &items[steps[a].item];
+                        point2d_t entry_a = path_entry(first, steps[a].start);
+                        point2d_t exit_b = path_exit(last, steps[b].start);
+                        float delta = path_distance(before, exit_b) - path_distance(before, entry_a);
+                        if (b + 1 < num_items) {
+                            point2d_t next = path_entry(&items[steps[b + 1].item], steps[b + 1].start);
+                            delta += path_distance(entry_a, next) - path_distance(exit_b, next);
+                        }
+                        if (delta >= -1e-4f) continue;
+                        
+                        for (int i = a, j = b; i < j; i++, j--) {
+                            path_order_step_t swap = steps[i];
+                            steps[i] = steps[j];
+                            steps[j] = swap;
+                        }
+                        for (int i = a; i <= b; i++) {
+                            if (!items[steps[i].item].closed) steps[i].start ^= 1;
+                            position[steps[i].item] = i;
+                        }
+                        improved = 1;
+                    }
+                }
+            }
+        }
+    }
+    
+    free(position);
+    path_grid_free(&grid);
+    return 0;
+}
+
+// Move each loop's seam to its vertex nearest the path before it, when that shortens
+// the travel in and out of the loop
+static void path_order_seams(const path_order_item_t* items, int num_items, point2d_t start,
+                             path_order_step_t* steps) {
+    point2d_t before = start;
+    for (int k = 0; k < num_items; k++) {
+        const path_order_item_t* item = &items[steps[k].item];
+        if (item->closed) {
+            int best = steps[k].start;
+            float best_d2 = FLT_MAX;
+            for (int p = 0; p < item->num_points; p++) {
+                float dx = item->points[p].x - before.x, dy = item->points[p].y - before.y;
+                if (dx * dx + dy * dy < best_d2) {
+                    best_d2 = dx * dx + dy * dy;
+                    best = p;
+                }
+            }
+            
+            float old_cost = path_distance(before, item->points[steps[k].start]);
+            float new_cost = path_distance(before, item->points[best]);
+            if (k + 1 < num_items) {
+                point2d_t next = path_entry(&items[steps[k + 1].item], steps[k + 1].start);
+                old_cost += path_distance(item->points[steps[k].start], next);
+                new_cost += path_distance(item->points[best], next);
+            }
+            if (new_cost < old_cost) steps[k].start = best;
+        }
+        before = path_exit(item, steps[k].start);
+    }
+}
+
+int path_order(const path_order_item_t* items, int num_items, point2d_t start,
+               path_order_step_t* steps, point2d_t* end) {
+    if (num_items <= 0) {
+        if (end) *end = start;
+        return 0;
+    }
+    
+    if (path_order_nearest(items, num_items, start, steps) != 0) return -1;
+    if (path_order_improve(items, num_items, start, steps) != 0) return -1;
+    path_order_seams(items, num_items, start, steps);
+    
+    if (end) {
+        const path_order_step_t* last = &steps[num_items - 1];
+        *end = path_exit(&items[last->item], last->start);
+    }
+    return 0;
+}
+
+float path_order_travel(const path_order_item_t* items, const path_order_step_t* steps, int num_steps,
+                        point2d_t start) {
+    float travel = 0.0f;
+    point2d_t position = start;
+    for (int k = 0; k < num_steps; k++) {
+        const path_order_item_t* item = &items[steps ? steps[k].item : k];
+        int entry_end = steps ? steps[k].start : 0;
+        travel += path_distance(position, path_entry(item, entry_end));
+        position = path_exit(item, entry_end);
+    }
+    return travel;
+}
@@ -0,0 +1,46 @@
+#ifndef PATH_ORDER_H
+#define PATH_ORDER_H
+
+#include "slicer.h"
+
+// Travel ordering. Paths are ordered nearest-neighbour first, then improved with 2-opt
+// moves that reverse stretches of the order. A reversed open path is printed backwards;
+// a closed loop starts and ends at the same vertex, so it only keeps its seam.
+
+// 2-opt only tries reconnecting to path ends within this many grid cells, about one
+// path end per cell
+#define PATH_ORDER_NEIGHBOR_RINGS 2
+
+// Improvement passes over the whole order, at most
+#define PATH_ORDER_MAX_PASSES 4
+
+// Longest stretch of the order a single 2-opt move may reverse
+#define PATH_ORDER_MAX_SPAN 1024
+
+// One printable path; a closed loop may start at any vertex, an open path at either end
+typedef struct {
+    const point2d_t* points;
+    int num_points;
+    int closed;
+} path_order_item_t;
+
+// Print order: item index, and where it starts (loop: vertex index; open path: 1 when
+// printed from its last point back to its first)
+typedef struct {
+    int item;
+    int start;
+} path_order_step_t;
+
+// Function declarations
+
+// Order every item for the shortest travel from start; fills num_items steps and leaves
+// the nozzle position after the last path in end (may be NULL)
+int path_order(const path_order_item_t* items, int num_items, point2d_t start,
+               path_order_step_t* steps, point2d_t* end);
+
+// Sum of travel distances from start through the ordered paths; steps == NULL takes the
+// items in array order, each from its first point
+float path_order_travel(const path_order_item_t* items, const path_order_step_t* steps, int num_steps,
+                        point2d_t start);
+
+#endif // PATH_ORDER_H
@@ -0,0 +1,787 @@
+#include "polygon_offset.h"
+#include <math.h>
+#include <string.h>
+
+// Directed edge of the raw offset
+typedef struct {
+    poly_point_t a, b;
+    int next;                    // Following edge of the same loop
+    int is_loop_start;           // Set on the first edge of its loop
+} poly_edge_t;
+
+// Part of a raw edge between crossings. Endpoints are rounded and shared exactly with
+// the neighbouring pieces; the span along the unrounded edge is kept for probing.
+typedef struct {
+    poly_point_t a, b;
+    int edge;
+    double t0, t1;
+    int run_start;               // Winding may differ from the previous piece
+} poly_piece_t;
+
+// Crossing or touching point on an edge, at parameter t along it
+typedef struct {
+    int edge;
+    double t;
+    poly_point_t point;
+} poly_split_t;
+
+typedef struct {
+    poly_split_t* splits;
+    int num_splits;
+    int capacity;
+} poly_split_list_t;
+
+// Exact orientation of c relative to a->b: > 0 left, < 0 right, 0 collinear
+static int64_t poly_orient(poly_point_t a, poly_point_t b, poly_point_t c) {
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static int poly_points_equal(poly_point_t a, poly_point_t b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static uint64_t poly_hash(poly_point_t p) {
+    uint64_t h = (uint64_t)p.x * 0x9E3779B97F4A7C15ull ^ (uint64_t)p.y * 0xC2B2AE3D27D4EB4Full;
+    return h ^ (h >> 29);
+}
+
+static poly_point_t poly_round(double x, double y) {
+    poly_point_t p = { (int64_t)llround(x), (int64_t)llround(y) };
+    return p;
+}
+
+static int poly_set_push(poly_set_t* set, poly_point_t* points, int num_points) {
+    if (set->num_loops == set->capacity) {
+        int capacity = set->capacity ? set->capacity * 2 : 16;
+        poly_loop_t* loops = realloc(set->loops, capacity * sizeof(poly_loop_t));
+        if (!loops) return -1;
+        set->loops = loops;
+        set->capacity = capacity;
+    }
+    set->loops[set->num_loops].points = points;
+    set->loops[set->num_loops].num_points = num_points;
+    set->num_loops++;
+    return 0;
+}
+
+int poly_set_from_contours(poly_set_t* set, const contour_t* contours, int num_contours) {
+    memset(set, 0, sizeof(poly_set_t));
+    
+    for (int i = 0; i < num_contours; i++) {
+        const contour_t* contour = &contours[i];
+        if (!contour->closed || contour->num_points < 3) continue;
+        
+        poly_point_t* points = malloc(contour->num_points * sizeof(poly_point_t));
+        if (!points) {
+            poly_set_free(set);
+            return -1;
+        }
+        
+        int count = 0;
+        for (int j = 0; j < contour->num_points; j++) {
+            poly_point_t p = poly_round(contour->points[j].x * POLY_OFFSET_SCALE,
+                                        contour->points[j].y * POLY_OFFSET_SCALE);
+            if (count > 0 && poly_points_equal(points[count - 1], p)) continue;
+            points[count++] = p;
+        }
+        while (count > 1 && poly_points_equal(points[count - 1], points[0])) count--;
+        
+        if (count < 3 || poly_set_push(set, points, count) != 0) {
+            free(points);
+        }
+    }
+    return 0;
+}
+
+int poly_set_to_contours(const poly_set_t* set, contour_t** contours, int* num_contours) {
+    *contours = NULL;
+    *num_contours = 0;
+    if (set->num_loops == 0) return 0;
+    
+    contour_t* out = calloc(set->num_loops, sizeof(contour_t));
+    if (!out) return -1;
+    
+    for (int i = 0; i < set->num_loops; i++) {
+        const poly_loop_t* loop = &set->loops[i];
+        out[i].points = malloc(loop->num_points * sizeof(point2d_t));
+        if (!out[i].points) {
+            for (int j = 0; j < i; j++) free(out[j].points);
+            free(out);
+            return -1;
+        }
+        for (int j = 0; j < loop->num_points; j++) {
+            out[i].points[j].x = (float)(loop->points[j].x / POLY_OFFSET_SCALE);
+            out[i].points[j].y = (float)(loop->points[j].y / POLY_OFFSET_SCALE);
+        }
+        out[i].num_points = loop->num_points;
+        out[i].closed = 1;
+    }
+    
+    *contours = out;
+    *num_contours = set->num_loops;
+    return 0;
+}
+
+void poly_set_free(poly_set_t* set) {
+    if (!set) return;
+    for (int i = 0; i < set->num_loops; i++) {
+        free(set->loops[i].points);
+    }
+    free(set->loops);
+    memset(set, 0, sizeof(poly_set_t));
+}
+
+double poly_loop_area(const poly_loop_t* loop) {
+    double area = 0.0;
+    for (int i = 0, j = loop->num_points - 1; i < loop->num_points; j = i++) {
+        area += (double)loop->points[j].x * loop->points[i].y - (double)loop->points[i].x * loop->points[j].y;
+    }
+    return 0.5 * area;
+}
+
+// Drop vertices within tolerance of the line joining their kept neighbours. Dense
+// slice contours otherwise fold over themselves at every tiny concavity when offset.
+static int poly_reduce(const poly_loop_t* loop, double tolerance, poly_point_t* out) {
+    int n = loop->num_points;
+    int count = 0;
+    out[count++] = loop->points[0];
+    for (int i = 1; i < n; i++) {
+        poly_point_t a = out[count - 1];
+        poly_point_t p = loop->points[i];
+        poly_point_t b = loop->points[(i + 1) % n];
+        double dx = (double)(b.x - a.x), dy = (double)(b.y - a.y);
+        double length = sqrt(dx * dx + dy * dy);
+        double deviation = length > 0 ? fabs((double)poly_orient(a, b, p)) / length : tolerance + 1.0;
+        if (deviation > tolerance) {
+            out[count++] = p;
+        }
+    }
+    return count;
+}
+
+// Raw offset of one loop: every edge moved left by distance. Where the edges diverge
+// they are joined with a miter, or a bevel past POLY_OFFSET_MITER_LIMIT.
+static int poly_raw_offset(const poly_loop_t* input, double distance, poly_edge_t** edges, int* num_edges,
+                           int* capacity) {
+    poly_point_t* reduced = malloc((input->num_points + 1) * sizeof(poly_point_t));
+    if (!reduced) return -1;
+    poly_loop_t loop_storage = { reduced, poly_reduce(input, POLY_OFFSET_TOLERANCE * POLY_OFFSET_SCALE, reduced) };
+    const poly_loop_t* loop = &loop_storage;
+    if (loop->num_points < 3) {
+        free(reduced);
+        return 0;
+    }
+    
+    int n = loop->num_points;
+    poly_point_t* points = malloc((3 * n + 1) * sizeof(poly_point_t));
+    if (!points) {
+        free(reduced);
+        return -1;
+    }
+    
+    int count = 0;
+    double limit = 2.0 / (POLY_OFFSET_MITER_LIMIT * POLY_OFFSET_MITER_LIMIT);
+    for (int i = 0; i < n; i++) {
+        poly_point_t prev = loop->points[(i + n - 1) % n];
+        poly_point_t p = loop->points[i];
+        poly_point_t next = loop->points[(i + 1) % n];
+        
+        double dx1 = (double)(p.x - prev.x), dy1 = (double)(p.y - prev.y);
+        double dx2 = (double)(next.x - p.x), dy2 = (double)(next.y - p.y);
+        double l1 = sqrt(dx1 * dx1 + dy1 * dy1);
+        double l2 = sqrt(dx2 * dx2 + dy2 * dy2);
+        
+        // Left normals of the incoming and outgoing edges
+        double n1x = -dy1 / l1, n1y = dx1 / l1;
+        double n2x = -dy2 / l2, n2y = dx2 / l2;
+        double cosine = n1x * n2x + n1y * n2y;
+        
+        double sine = n1x * n2y - n1y * n2x;
+        
+        // Where the edges converge on the offset side, a miter is only safe while it cuts
+        // back less than half of either edge; otherwise route through the vertex itself so
+        // the overlap forms a negatively wound loop that the winding rule discards
+        int converging = sine * distance > 0;
+        if (converging && fabs(distance) * fabs(sine) > 0.5 * fmin(l1, l2) * (1.0 + cosine)) {
+            points[count++] = poly_round(p.x + n1x * distance, p.y + n1y * distance);
+            points[count++] = p;
+            points[count++] = poly_round(p.x + n2x * distance, p.y + n2y * distance);
+        } else if (1.0 + cosine >= limit) {
+            double scale = distance / (1.0 + cosine);
+            points[count++] = poly_round(p.x + (n1x + n2x) * scale, p.y + (n1y + n2y) * scale);
+        } else {
+            points[count++] = poly_round(p.x + n1x * distance, p.y + n1y * distance);
+            points[count++] = poly_round(p.x + n2x * distance, p.y + n2y * distance);
+        }
+    }
+    
+    int first = *num_edges;
+    for (int i = 0; i < count; i++) {
+        poly_point_t a = points[i];
+        poly_point_t b = points[(i + 1) % count];
+        if (poly_points_equal(a, b)) continue;
+        
+        if (*num_edges == *capacity) {
+            int grown = *capacity ? *capacity * 2 : 256;
+            poly_edge_t* resized = realloc(*edges, grown * sizeof(poly_edge_t));
+            if (!resized) {
+                free(points);
+                free(reduced);
+                return -1;
+            }
+            *edges = resized;
+            *capacity = grown;
+        }
+        (*edges)[*num_edges] = (poly_edge_t){ a, b, *num_edges + 1, *num_edges == first };
+        (*num_edges)++;
+    }
+    if (*num_edges > first) {
+        (*edges)[*num_edges - 1].next = first;
+    }
+    
+    free(points);
+    free(reduced);
+    return 0;
+}
+
+static int poly_add_split(poly_split_list_t* list, int edge, double t, poly_point_t point) {
+    if (list->num_splits == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        poly_split_t* splits = realloc(list->splits, capacity * sizeof(poly_split_t));
+        if (!splits) return -1;
+        list->splits = splits;
+        list->capacity = capacity;
+    }
+    list->splits[list->num_splits++] = (poly_split_t){ edge, t, point };
+    return 0;
+}
+
+// Parameter of a point known to lie on edge e
+static double poly_edge_param(const poly_edge_t* e, poly_point_t p) {
+    double dx = (double)(e->b.x - e->a.x), dy = (double)(e->b.y - e->a.y);
+    return ((p.x - e->a.x) * dx + (p.y - e->a.y) * dy) / (dx * dx + dy * dy);
+}
+
+static int poly_within_box(const poly_edge_t* e, poly_point_t p) {
+    int64_t min_x = e->a.x < e->b.x ? e->a.x : e->b.x, max_x = e->a.x < e->b.x ? e->b.x : e->a.x;
+    int64_t min_y = e->a.y < e->b.y ? e->a.y : e->b.y, max_y = e->a.y < e->b.y ? e->b.y : e->a.y;
+    return p.x >= min_x && p.x <= max_x && p.y >= min_y && p.y <= max_y;
+}
+
+// Record where edges i and j cross or touch
+static int poly_intersect(const poly_edge_t* edges, int i, int j, poly_split_list_t* list) {
+    const poly_edge_t* e = &edges[i];
+    const poly_edge_t* f = &edges[j];
+    int64_t d1 = poly_orient(f->a, f->b, e->a);
+    int64_t d2 = poly_orient(f->a, f->b, e->b);
+    int64_t d3 = poly_orient(e->a, e->b, f->a);
+    int64_t d4 = poly_orient(e->a, e->b, f->b);
+    
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))) {
+        double t = (double)d1 / ((double)d1 - (double)d2);
+        double u = (double)d3 / ((double)d3 - (double)d4);
+        poly_point_t p = poly_round(e->a.x + t * (double)(e->b.x - e->a.x), e->a.y + t * (double)(e->b.y - e->a.y));
+        if (poly_add_split(list, i, t, p) != 0) return -1;
+        return poly_add_split(list, j, u, p);
+    }
+    
+    // Touching and collinear overlaps: split each edge where the other's endpoints rest on it.
+    // The touching endpoint is recorded on its own edge too, so the winding run breaks there;
+    // the vertex joining consecutive edges of a loop is not a touch.
+    int e_then_f = e->next == j && poly_points_equal(e->b, f->a);
+    int f_then_e = f->next == i && poly_points_equal(f->b, e->a);
+    if (d1 == 0 && !f_then_e && poly_within_box(f, e->a)) {
+        if (poly_add_split(list, j, poly_edge_param(f, e->a), e->a) != 0) return -1;
+        if (poly_add_split(list, i, 0.0, e->a) != 0) return -1;
+    }
+    if (d2 == 0 && !e_then_f && poly_within_box(f, e->b)) {
+        if (poly_add_split(list, j, poly_edge_param(f, e->b), e->b) != 0) return -1;
+        if (poly_add_split(list, i, 1.0, e->b) != 0) return -1;
+    }
+    if (d3 == 0 && !e_then_f && poly_within_box(e, f->a)) {
+        if (poly_add_split(list, i, poly_edge_param(e, f->a), f->a) != 0) return -1;
+        if (poly_add_split(list, j, 0.0, f->a) != 0) return -1;
+    }
+    if (d4 == 0 && !f_then_e && poly_within_box(e, f->b)) {
+        if (poly_add_split(list, i, poly_edge_param(e, f->b), f->b) != 0) return -1;
+        if (poly_add_split(list, j, 1.0, f->b) != 0) return -1;
+    }
+    return 0;
+}
+
+// Bucket edges into a uniform grid and intersect pairs sharing a cell; each pair is
+// tested only in the first cell common to both bounding boxes
+static int poly_find_splits(const poly_edge_t* edges, int num_edges, poly_split_list_t* list) {
+    int64_t min_x = INT64_MAX, min_y = INT64_MAX, max_x = INT64_MIN, max_y = INT64_MIN;
+    for (int i = 0; i < num_edges; i++) {
+        const poly_edge_t* e = &edges[i];
+        if (e->a.x < min_x) min_x = e->a.x;
+        if (e->b.x < min_x) min_x = e->b.x;
+        if (e->a.y < min_y) min_y = e->a.y;
+        if (e->b.y < min_y) min_y = e->b.y;
+        if (e->a.x > max_x) max_x = e->a.x;
+        if (e->b.x > max_x) max_x = e->b.x;
+        if (e->a.y > max_y) max_y = e->a.y;
+        if (e->b.y > max_y) max_y = e->b.y;
+    }
+    
+    int grid = (int)sqrt((double)num_edges) + 1;
+    if (grid > 1024) grid = 1024;
+    double cell_w = (double)(max_x - min_x + 1) / grid;
+    double cell_h = (double)(max_y - min_y + 1) / grid;
+    
+    // Cell ranges per edge, then CSR buckets
+    int* ranges = malloc((size_t)num_edges * 4 * sizeof(int));
+    int* starts = calloc((size_t)grid * grid + 1, sizeof(int));
+    if (!ranges || !starts) {
+        free(ranges);
+        free(starts);
+        return -1;
+    }
+    
+    for (int i = 0; i < num_edges; i++) {
+        const poly_edge_t* e = &edges[i];
+        int* r = &ranges[i * 4];
+        r[0] = (int)(((e->a.x < e->b.x ? e->a.x : e->b.x) - min_x) / cell_w);
+        r[1] = (int)(((e->a.x < e->b.x ? e->b.x : e->a.x) - min_x) / cell_w);
+        r[2] = (int)(((e->a.y < e->b.y ? e->a.y : e->b.y) - min_y) / cell_h);
+        r[3] = (int)(((e->a.y < e->b.y ? e->b.y : e->a.y) - min_y) / cell_h);
+        for (int k = 0; k < 4; k++) {
+            if (r[k] >= grid) r[k] = grid - 1;
+        }
+        for (int cy = r[2]; cy <= r[3]; cy++) {
+            for (int cx = r[0]; cx <= r[1]; cx++) {
+                starts[cy * grid + cx + 1]++;
+            }
+        }
+    }
+    for (int c = 0; c < grid * grid; c++) {
+        starts[c + 1] += starts[c];
+    }
+    
+    int* cells = malloc(((size_t)starts[grid * grid] + 1) * sizeof(int));
+    int* fill = malloc(((size_t)grid * grid + 1) * sizeof(int));
+    if (!cells || !fill) {
+        free(ranges);
+        free(starts);
+        free(cells);
+        free(fill);
+        return -1;
+    }
+    memcpy(fill, starts, (size_t)grid * grid * sizeof(int));
+    for (int i = 0; i < num_edges; i++) {
+        const int* r = &ranges[i * 4];
+        for (int cy = r[2]; cy <= r[3]; cy++) {
+            for (int cx = r[0]; cx <= r[1]; cx++) {
+                cells[fill[cy * grid + cx]++] = i;
+            }
+        }
+    }
+    
+    int status = 0;
+    for (int cy = 0; cy < grid && status == 0; cy++) {
+        for (int cx = 0; cx < grid && status == 0; cx++) {
+            int begin = starts[cy * grid + cx];
+            int end = starts[cy * grid + cx + 1];
+            for (int a = begin; a < end && status == 0; a++) {
+                for (int b = a + 1; b < end && status == 0; b++) {
+                    const int* ra = &ranges[cells[a] * 4];
+                    const int* rb = &ranges[cells[b] * 4];
+                    int first_x = ra[0] > rb[0] ? ra[0] : rb[0];
+                    int first_y = ra[2] > rb[2] ? ra[2] : rb[2];
+                    if (first_x != cx || first_y != cy) continue;
+                    status = poly_intersect(edges, cells[a], cells[b], list);
+                }
+            }
+        }
+    }
+    
+    free(ranges);
+    free(starts);
+    free(cells);
+    free(fill);
+    return status;
+}
+
+static int compare_splits(const void* a, const void* b) {
+    const poly_split_t* sa = (const poly_split_t*)a;
+    const poly_split_t* sb = (const poly_split_t*)b;
+    if (sa->edge != sb->edge) return sa->edge < sb->edge ? -1 : 1;
+    if (sa->t < sb->t) return -1;
+    if (sa->t > sb->t) return 1;
+    return 0;
+}
+
+// Find p in an open-addressing point table; returns its slot, or the empty slot to insert at
+static unsigned int poly_point_slot(const poly_point_t* table, const unsigned char* filled,
+                                    unsigned int mask, poly_point_t p) {
+    unsigned int slot = (unsigned int)(poly_hash(p) & mask);
+    while (filled[slot] && !poly_points_equal(table[slot], p)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Rounded crossings can land a unit away from a vertex or another crossing, leaving
+// pieces too short to probe reliably. Snap each split onto any vertex or earlier split
+// within one unit so near-coincident points become the same node.
+static int poly_snap_splits(const poly_edge_t* edges, int num_edges, poly_split_list_t* list) {
+    size_t size = 16;
+    while (size < 2 * ((size_t)num_edges + list->num_splits)) size <<= 1;
+    poly_point_t* table = malloc(size * sizeof(poly_point_t));
+    unsigned char* filled = calloc(size, 1);
+    if (!table || !filled) {
+        free(table);
+        free(filled);
+        return -1;
+    }
+    unsigned int mask = (unsigned int)(size - 1);
+    
+    for (int i = 0; i < num_edges; i++) {
+        unsigned int slot = poly_point_slot(table, filled, mask, edges[i].a);
+        table[slot] = edges[i].a;
+        filled[slot] = 1;
+    }
+    for (int s = 0; s < list->num_splits; s++) {
+        poly_point_t p = list->splits[s].point;
+        int snapped = 0;
+        for (int dy = -1; dy <= 1 && !snapped; dy++) {
+            for (int dx = -1; dx <= 1 && !snapped; dx++) {
+                poly_point_t q = { p.x + dx, p.y + dy };
+                if (filled[poly_point_slot(table, filled, mask, q)]) {
+                    list->splits[s].point = q;
+                    snapped = 1;
+                }
+            }
+        }
+        if (!snapped) {
+            unsigned int slot = poly_point_slot(table, filled, mask, p);
+            table[slot] = p;
+            filled[slot] = 1;
+        }
+    }
+    
+    free(table);
+    free(filled);
+    return 0;
+}
+
+// Cut the edges at their splits
+static poly_piece_t* poly_split_edges(const poly_edge_t* edges, int num_edges, poly_split_list_t* list,
+                                      int* num_pieces) {
+    qsort(list->splits, list->num_splits, sizeof(poly_split_t), compare_splits);
+    
+    poly_piece_t* pieces = malloc(((size_t)num_edges + list->num_splits + 1) * sizeof(poly_piece_t));
+    if (!pieces) return NULL;
+    
+    // Winding can only change where edges cross, so a new run starts after every split
+    int count = 0;
+    int s = 0;
+    int carry = 0;
+    for (int i = 0; i < num_edges; i++) {
+        poly_point_t from = edges[i].a;
+        double t_from = 0.0;
+        int run_start = edges[i].is_loop_start || carry;
+        carry = 0;
+        for (; s < list->num_splits && list->splits[s].edge == i; s++) {
+            poly_point_t p = list->splits[s].point;
+            if (poly_points_equal(p, from)) {
+                run_start = 1;
+                continue;
+            }
+            if (poly_points_equal(p, edges[i].b)) {
+                carry = 1;
+                continue;
+            }
+            pieces[count++] = (poly_piece_t){ from, p, i, t_from, list->splits[s].t, run_start };
+            run_start = 1;
+            from = p;
+            t_from = list->splits[s].t;
+        }
+        pieces[count++] = (poly_piece_t){ from, edges[i].b, i, t_from, 1.0, run_start };
+    }
+    
+    *num_pieces = count;
+    return pieces;
+}
+
+// Winding number of (px, py) over edges bucketed into horizontal strips
+static int poly_winding(const poly_edge_t* edges, const int* strip_starts, const int* strip_edges,
+                        int num_strips, double min_y, double strip_h, double px, double py) {
+    int s = (int)((py - min_y) / strip_h);
+    if (s < 0 || s >= num_strips) return 0;
+    
+    int winding = 0;
+    for (int k = strip_starts[s]; k < strip_starts[s + 1]; k++) {
+        const poly_edge_t* e = &edges[strip_edges[k]];
+        double ax = (double)e->a.x, ay = (double)e->a.y;
+        double bx = (double)e->b.x, by = (double)e->b.y;
+        double side = (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+        if (ay <= py) {
+            if (by > py && side > 0) winding++;
+        } else if (by <= py && side < 0) {
+            winding--;
+        }
+    }
+    return winding;
+}
+
+// Keep pieces with winding 1 on their left: the boundary of the positive-winding region.
+// Each run is probed once, just left of its longest piece, against the unrounded edges.
+static unsigned char* poly_classify(const poly_edge_t* edges, int num_edges, const poly_piece_t* pieces,
+                                    int num_pieces) {
+    unsigned char* keep = calloc((size_t)num_pieces + 1, 1);
+    if (!keep || num_pieces == 0) return keep;
+    
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    for (int i = 0; i < num_edges; i++) {
+        if (edges[i].a.y < lo) lo = edges[i].a.y;
+        if (edges[i].b.y < lo) lo = edges[i].b.y;
+        if (edges[i].a.y > hi) hi = edges[i].a.y;
+        if (edges[i].b.y > hi) hi = edges[i].b.y;
+    }
+    
+    // Bucket the edges into horizontal strips a few edges tall, so a probe mostly sees
+    // the edges its ray actually crosses
+    int num_strips = num_edges / 4 + 1;
+    if (num_strips > 65536) num_strips = 65536;
+    double min_y = (double)lo - 1.0;
+    double strip_h = ((double)hi + 1.0 - min_y) / num_strips;
+    
+    int* strip_starts = calloc((size_t)num_strips + 1, sizeof(int));
+    int* fill = malloc(((size_t)num_strips + 1) * sizeof(int));
+    int* strip_edges = NULL;
+    if (strip_starts && fill) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < num_edges; i++) {
+                double ya = (double)edges[i].a.y, yb = (double)edges[i].b.y;
+                int first = (int)(((ya < yb ? ya : yb) - min_y) / strip_h);
+                int last = (int)(((ya < yb ? yb : ya) - min_y) / strip_h);
+                if (last >= num_strips) last = num_strips - 1;
+                for (int k = first; k <= last; k++) {
+                    if (pass == 0) strip_starts[k + 1]++;
+                    else strip_edges[fill[k]++] = i;
+                }
+            }
+            if (pass == 0) {
+                for (int k = 0; k < num_strips; k++) strip_starts[k + 1] += strip_starts[k];
+                memcpy(fill, strip_starts, (size_t)num_strips * sizeof(int));
+                strip_edges = malloc(((size_t)strip_starts[num_strips] + 1) * sizeof(int));
+                if (!strip_edges) break;
+            }
+        }
+    }
+    if (!strip_starts || !fill || !strip_edges) {
+        free(strip_starts);
+        free(fill);
+        free(strip_edges);
+        free(keep);
+        return NULL;
+    }
+    
+    for (int i = 0; i < num_pieces; ) {
+        int end = i + 1;
+        while (end < num_pieces && !pieces[end].run_start) end++;
+        
+        int longest = i;
+        double longest_span = -1.0;
+        for (int k = i; k < end; k++) {
+            const poly_edge_t* e = &edges[pieces[k].edge];
+            double dx = (double)(e->b.x - e->a.x), dy = (double)(e->b.y - e->a.y);
+            double span = (pieces[k].t1 - pieces[k].t0) * sqrt(dx * dx + dy * dy);
+            if (span > longest_span) {
+                longest_span = span;
+                longest = k;
+            }
+        }
+        
+        // Midpoint of the piece on the exact edge, nudged left by a fraction of its length
+        const poly_piece_t* piece = &pieces[longest];
+        const poly_edge_t* e = &edges[piece->edge];
+        double dx = (double)(e->b.x - e->a.x), dy = (double)(e->b.y - e->a.y);
+        double length = sqrt(dx * dx + dy * dy);
+        double t = 0.5 * (piece->t0 + piece->t1);
+        double eps = 0.1 * longest_span;
+        if (eps > 0.5) eps = 0.5;
+        double px = (double)e->a.x + t * dx - dy / length * eps;
+        double py = (double)e->a.y + t * dy + dx / length * eps;
+        
+        int inside = poly_winding(edges, strip_starts, strip_edges, num_strips, min_y, strip_h, px, py) == 1;
+        for (int k = i; k < end; k++) {
+            keep[k] = (unsigned char)inside;
+        }
+        i = end;
+    }
+    
+    free(strip_starts);
+    free(fill);
+    free(strip_edges);
+    return keep;
+}
+
+// Remove repeated and collinear vertices in place
+static int poly_simplify(poly_point_t* points, int count) {
+    int changed = 1;
+    while (changed && count >= 3) {
+        changed = 0;
+        int out = 0;
+        for (int i = 0; i < count; i++) {
+            poly_point_t prev = out > 0 ? points[out - 1] : points[count - 1];
+            poly_point_t next = points[(i + 1) % count];
+            if (poly_points_equal(points[i], prev) || poly_orient(prev, points[i], next) == 0) {
+                changed = 1;
+                continue;
+            }
+            points[out++] = points[i];
+        }
+        count = out;
+    }
+    return count;
+}
+
+// Chain kept pieces end to start into closed loops
+static int poly_chain(const poly_piece_t* pieces, const unsigned char* keep, int num_pieces,
+                      double min_area, poly_set_t* output) {
+    int num_kept = 0;
+    for (int i = 0; i < num_pieces; i++) num_kept += keep[i];
+    if (num_kept == 0) return 0;
+    
+    // Open-addressing map from start point to the list of pieces starting there
+    int table_size = 16;
+    while (table_size < num_kept * 2) table_size <<= 1;
+    int* table = malloc(table_size * sizeof(int));
+    int* next = malloc(((size_t)num_pieces + 1) * sizeof(int));
+    unsigned char* used = calloc((size_t)num_pieces + 1, 1);
+    poly_point_t* points = malloc(((size_t)num_kept + 1) * sizeof(poly_point_t));
+    if (!table || !next || !used || !points) {
+        free(table);
+        free(next);
+        free(used);
+        free(points);
+        return -1;
+    }
+    for (int i = 0; i < table_size; i++) table[i] = -1;
+    
+    for (int i = 0; i < num_pieces; i++) {
+        if (!keep[i]) continue;
+        unsigned int slot = (unsigned int)(poly_hash(pieces[i].a) & (table_size - 1));
+        while (table[slot] >= 0 && !poly_points_equal(pieces[table[slot]].a, pieces[i].a)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        next[i] = table[slot];
+        table[slot] = i;
+    }
+    
+    int status = 0;
+    for (int i = 0; i < num_pieces && status == 0; i++) {
+        if (!keep[i] || used[i]) continue;
+        
+        int count = 0;
+        int current = i;
+        int closed = 0;
+        while (current >= 0) {
+            used[current] = 1;
+            points[count++] = pieces[current].a;
+            poly_point_t end = pieces[current].b;
+            if (poly_points_equal(end, pieces[i].a)) {
+                closed = 1;
+                break;
+            }
+            
+            unsigned int slot = (unsigned int)(poly_hash(end) & (table_size - 1));
+            while (table[slot] >= 0 && !poly_points_equal(pieces[table[slot]].a, end)) {
+                slot = (slot + 1) & (table_size - 1);
+            }
+            current = -1;
+            for (int k = table[slot]; k >= 0; k = next[k]) {
+                if (!used[k]) {
+                    current = k;
+                    break;
+                }
+            }
+        }
+        if (!closed) continue;
+        
+        count = poly_simplify(points, count);
+        if (count < 3) continue;
+        
+        poly_loop_t loop = { points, count };
+        if (fabs(poly_loop_area(&loop)) < min_area) continue;
+        
+        poly_point_t* copy = malloc(count * sizeof(poly_point_t));
+        if (!copy) {
+            status = -1;
+            break;
+        }
+        memcpy(copy, points, count * sizeof(poly_point_t));
+        if (poly_set_push(output, copy, count) != 0) {
+            free(copy);
+            status = -1;
+        }
+    }
+    
+    free(table);
+    free(next);
+    free(used);
+    free(points);
+    return status;
+}
+
+int poly_offset(const poly_set_t* input, double distance, poly_set_t* output) {
+    memset(output, 0, sizeof(poly_set_t));
+    if (!input || input->num_loops == 0) return 0;
+    
+    poly_edge_t* edges = NULL;
+    int num_edges = 0;
+    int capacity = 0;
+    for (int i = 0; i < input->num_loops; i++) {
+        if (input->loops[i].num_points < 3) continue;
+        if (poly_raw_offset(&input->loops[i], distance, &edges, &num_edges, &capacity) != 0) {
+            free(edges);
+            return -1;
+        }
+    }
+    if (num_edges == 0) {
+        free(edges);
+        return 0;
+    }
+    
+    poly_split_list_t splits = {0};
+    int num_pieces = 0;
+    poly_piece_t* pieces = NULL;
+    unsigned char* keep = NULL;
+    int status = poly_find_splits(edges, num_edges, &splits);
+    if (status == 0) status = poly_snap_splits(edges, num_edges, &splits);
+    if (status == 0) {
+        pieces = poly_split_edges(edges, num_edges, &splits, &num_pieces);
+        keep = pieces ? poly_classify(edges, num_edges, pieces, num_pieces) : NULL;
+        status = keep ? 0 : -1;
+    }
+    if (status == 0) {
+        double min_area = POLY_OFFSET_MIN_AREA_FACTOR * distance * distance;
+        status = poly_chain(pieces, keep, num_pieces, min_area, output);
+    }
+    
+    free(edges);
+    free(splits.splits);
+    free(pieces);
+    free(keep);
+    if (status != 0) poly_set_free(output);
+    return status;
+}
+
+int polygon_offset_contours(const contour_t* contours, int num_contours, float distance,
+                            contour_t** out, int* num_out) {
+    *out = NULL;
+    *num_out = 0;
+    
+    poly_set_t input, output;
+    if (poly_set_from_contours(&input, contours, num_contours) != 0) return -1;
+    int status = poly_offset(&input, distance * POLY_OFFSET_SCALE, &output);
+    if (status == 0) {
+        status = poly_set_to_contours(&output, out, num_out);
+    }
+    poly_set_free(&input);
+    poly_set_free(&output);
+    return status;
+}
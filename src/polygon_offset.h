@@ -0,0 +1,46 @@
+#ifndef POLYGON_OFFSET_H
+#define POLYGON_OFFSET_H
+
+#include "slicer.h"
+#include <stdint.h>
+
+// Integer polygon offsetting for perimeters. Coordinates are fixed-point so all
+// orientation tests are exact; keep models within +-10 m of the origin.
+#define POLY_OFFSET_SCALE 10000.0          // Integer units per mm (0.1 um)
+#define POLY_OFFSET_MITER_LIMIT 2.0        // Longest miter, in offset distances, before a corner is beveled
+#define POLY_OFFSET_MIN_AREA_FACTOR 0.25   // Loops smaller than this times distance^2 are dropped as collapsed
+#define POLY_OFFSET_TOLERANCE 0.005        // Input vertices closer than this (mm) to a straight run are dropped
+
+typedef struct {
+    int64_t x, y;
+} poly_point_t;
+
+// Closed loop; counter-clockwise loops are outlines, clockwise loops are holes
+typedef struct {
+    poly_point_t* points;
+    int num_points;
+} poly_loop_t;
+
+typedef struct {
+    poly_loop_t* loops;
+    int num_loops;
+    int capacity;
+} poly_set_t;
+
+// Function declarations
+int poly_set_from_contours(poly_set_t* set, const contour_t* contours, int num_contours);
+int poly_set_to_contours(const poly_set_t* set, contour_t** contours, int* num_contours);
+void poly_set_free(poly_set_t* set);
+double poly_loop_area(const poly_loop_t* loop);
+
+// Offset every loop to its left by distance (integer units): outlines shrink and holes
+// grow. The raw offset is split at all self- and mutual intersections and only edges
+// bounding the positive-winding region are kept, so pinched regions split, colliding
+// loops merge and collapsed loops vanish.
+int poly_offset(const poly_set_t* input, double distance, poly_set_t* output);
+
+// Convenience wrapper in millimetres; open contours are ignored
+int polygon_offset_contours(const contour_t* contours, int num_contours, float distance,
+                            contour_t** out, int* num_out);
+
+#endif // POLYGON_OFFSET_H
@@ -0,0 +1,578 @@
+#include "print_estimate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// One move as the planner sees it
+typedef struct {
+    double distance;        // Along the path; |E| for moves that only extrude or retract
+    double nominal_speed;   // Feed rate after per-axis caps (mm/s)
+    double acceleration;    // mm/s^2
+    double max_entry;       // Corner limit; for a move carried over, its settled entry speed
+    double entry;
+    int layer;
+} estimate_block_t;
+
+struct print_estimator {
+    print_estimate_config_t config;
+    estimate_block_t* blocks;   // Planning window
+    int num_blocks;
+    double position[PRINT_ESTIMATE_AXES];
+    double feed;                // mm/s
+    int relative_xyz;           // G91
+    int relative_e;             // M83 (or G91)
+    double previous_unit[PRINT_ESTIMATE_AXES]; // Direction the last move ended in
+    double previous_speed;      // Its nominal speed; 0 when the machine stopped after it
+    int layer;                  // Layer markers seen, minus one
+    double time;
+    double filament;
+    long long moves;
+    double* layer_times;
+    int layer_capacity;
+    int num_layers;
+    int error;
+};
+
+print_estimate_config_t print_estimate_default_config(void) {
+    // Typical Marlin defaults for a small Cartesian printer
+    print_estimate_config_t config = {
+        .acceleration = 1000.0f,
+        .travel_acceleration = 1500.0f,
+        .junction_deviation = 0.013f,
+        .max_jerk = { 10.0f, 10.0f, 0.3f, 5.0f },
+        .max_feedrate = { 300.0f, 300.0f, 5.0f, 25.0f },
+        .max_acceleration = { 3000.0f, 3000.0f, 100.0f, 10000.0f },
+        .filament_diameter = 1.75f,
+        .filament_density = 1.24f    // PLA
+    };
+    return config;
+}
+
+print_estimator_t* print_estimator_create(const print_estimate_config_t* config) {
+    if (!config) return NULL;
+    
+    print_estimator_t* estimator = calloc(1, sizeof(print_estimator_t));
+    if (!estimator) return NULL;
+    
+    estimator->blocks = malloc(PRINT_ESTIMATE_WINDOW * sizeof(estimate_block_t));
+    estimator->layer_capacity = 64;
+    estimator->layer_times = calloc(estimator->layer_capacity, sizeof(double));
+    if (!estimator->blocks || !estimator->layer_times) {
+        print_estimator_free(estimator);
+        return NULL;
+    }
+    estimator->config = *config;
+    estimator->layer = -1;
+    return estimator;
+}
+
+void print_estimator_free(print_estimator_t* estimator) {
+    if (!estimator) return;
+    
+    free(estimator->blocks);
+    free(estimator->layer_times);
+    free(estimator);
+}
+
+// Time to cover distance starting at v0 and ending at v1, accelerating towards nominal
+static double estimate_block_time(const estimate_block_t* block, double v0, double v1) {
+    double vn = block->nominal_speed;
+    double a = block->acceleration;
+    if (block->distance <= 0 || vn <= 0) return 0.0;
+    if (a <= 0) return block->distance / vn;
+    
+    double accelerate = (vn * vn - v0 * v0) / (2.0 * a);
+    double decelerate = (vn * vn - v1 * v1) / (2.0 * a);
+    if (accelerate + decelerate <= block->distance) {
+        return (vn - v0) / a + (vn - v1) / a + (block->distance - accelerate - decelerate) / vn;
+    }
+    // Triangle: never reaches the nominal speed
+    double peak = sqrt(a * block->distance + 0.5 * (v0 * v0 + v1 * v1));
+    return (peak - v0) / a + (peak - v1) / a;
+}
+
+// Plan the window as if the machine stopped after its last move. A move whose entry
+// speed reaches its corner limit on the backward pass is unaffected by that stop, so
+// it and every move before it are final. final plans the whole window.
+static void estimator_plan(print_estimator_t* estimator, int final) {
+    estimate_block_t* blocks = estimator->blocks;
+    int n = estimator->num_blocks;
+    if (n == 0) return;
+    
+    int settled = -1;
+    double next = 0.0;
+    for (int i = n - 1; i >= 0; i--) {
+        double reach = sqrt(next * next + 2.0 * blocks[i].acceleration * blocks[i].distance);
+        if (reach >= blocks[i].max_entry) {
+            blocks[i].entry = blocks[i].max_entry;
+            if (settled < 0) settled = i;
+        } else {
+            blocks[i].entry = reach;
+        }
+        next = blocks[i].entry;
+    }
+    for (int i = 0; i + 1 < n; i++) {
+        double reach = sqrt(blocks[i].entry * blocks[i].entry + 2.0 * blocks[i].acceleration * blocks[i].distance);
+        if (blocks[i + 1].entry > reach) blocks[i + 1].entry = reach;
+    }
+    
+    // A window of tiny moves that never reach their corner speed would stall here; take
+    // the stop at its end as real for the first half instead
+    if (final) settled = n;
+    else if (settled < n / 2) settled = n / 2;
+    
+    for (int i = 0; i < settled; i++) {
+        double exit = i + 1 < n ? blocks[i + 1].entry : 0.0;
+        double time = estimate_block_time(&blocks[i], blocks[i].entry, exit);
+        estimator->time += time;
+        estimator->layer_times[blocks[i].layer] += time;
+    }
+    
+    estimator->num_blocks = n - settled;
+    memmove(blocks, blocks + settled, estimator->num_blocks * sizeof(estimate_block_t));
+    if (estimator->num_blocks > 0) blocks[0].max_entry = blocks[0].entry;
+}
+
+// Speed allowed through the corner from the previous move into one starting in
+// direction unit (XYZ part is a unit vector, or zero for extrude-only moves)
+static double estimator_junction_speed(const print_estimator_t* estimator, const double* unit,
+                                       double nominal_speed, double acceleration) {
+    const print_estimate_config_t* config = &estimator->config;
+    int moving = estimator->previous_speed > 0 && (unit[0] != 0 || unit[1] != 0 || unit[2] != 0);
+    
+    if (config->junction_deviation > 0) {
+        if (!moving) return 0.0;
+        
+        const double* previous = estimator->previous_unit;
+        double cos_theta = -(previous[0] * unit[0] + previous[1] * unit[1] + previous[2] * unit[2]);
+        double limit = fmin(nominal_speed, estimator->previous_speed);
+        if (cos_theta < -0.999999) return limit;    // Straight on
+        if (cos_theta > 0.999999) return 0.0;       // Reversal
+        double sin_half = sqrt(0.5 * (1.0 - cos_theta));
+        double speed = sqrt(acceleration * config->junction_deviation * sin_half / (1.0 - sin_half));
+        return fmin(speed, limit);
+    }
+    
+    // Jerk: each axis may change speed by max_jerk at once; from rest that is the whole
+    // speed along the axis
+    double speed = moving ? fmin(nominal_speed, estimator->previous_speed) : nominal_speed;
+    for (int axis = 0; axis < PRINT_ESTIMATE_AXES; axis++) {
+        double change = moving ? fabs(unit[axis] - estimator->previous_unit[axis]) : fabs(unit[axis]);
+        if (change > 1e-9) speed = fmin(speed, config->max_jerk[axis] / change);
+    }
+    return speed;
+}
+
+static void estimator_add_block(print_estimator_t* estimator, const estimate_block_t* block) {
+    if (estimator->num_blocks == PRINT_ESTIMATE_WINDOW) estimator_plan(estimator, 0);
+    estimator->blocks[estimator->num_blocks++] = *block;
+}
+
+// Move to target along a path of length (0 when X, Y and Z stay put). start and end give
+// the XYZ direction at each end; NULL means straight. speed_cap limits arcs.
+static void estimator_move(print_estimator_t* estimator, const double* target, double length,
+                           const double* start, const double* end, double speed_cap) {
+    const print_estimate_config_t* config = &estimator->config;
+    double delta[PRINT_ESTIMATE_AXES];
+    for (int axis = 0; axis < PRINT_ESTIMATE_AXES; axis++) {
+        delta[axis] = target[axis] - estimator->position[axis];
+        estimator->position[axis] = target[axis];
+    }
+    estimator->filament += delta[3];
+    
+    double distance = length > 0 ? length : fabs(delta[3]);
+    if (distance < 1e-9) return;
+    estimator->moves++;
+    
+    // Per-axis caps use the straight line between the end points
+    double unit[PRINT_ESTIMATE_AXES];
+    estimate_block_t block = { .distance = distance, .layer = estimator->layer < 0 ? 0 : estimator->layer };
+    block.nominal_speed = fmin(estimator->feed, speed_cap);
+    block.acceleration = (delta[3] > 0 && length > 0) ? config->acceleration : config->travel_acceleration;
+    for (int axis = 0; axis < PRINT_ESTIMATE_AXES; axis++) {
+        unit[axis] = delta[axis] / distance;
+        double share = fabs(unit[axis]);
+        if (share > 1e-9) {
+            block.nominal_speed = fmin(block.nominal_speed, config->max_feedrate[axis] / share);
+            block.acceleration = fmin(block.acceleration, config->max_acceleration[axis] / share);
+        }
+    }
+    if (length <= 0) {
+        unit[0] = unit[1] = unit[2] = 0.0;
+    }
+    
+    double direction[PRINT_ESTIMATE_AXES] = { unit[0], unit[1], unit[2], unit[3] };
+    if (start) memcpy(direction, start, 3 * sizeof(double));
+    block.max_entry = estimator_junction_speed(estimator, direction, block.nominal_speed, block.acceleration);
+    estimator_add_block(estimator, &block);
+    
+    if (end) memcpy(direction, end, 3 * sizeof(double));
+    memcpy(estimator->previous_unit, direction, sizeof(direction));
+    estimator->previous_speed = length > 0 ? block.nominal_speed : 0.0;
+}
+
+static void estimator_line(print_estimator_t* estimator, const double* target) {
+    double dx = target[0] - estimator->position[0];
+    double dy = target[1] - estimator->position[1];
+    double dz = target[2] - estimator->position[2];
+    estimator_move(estimator, target, sqrt(dx * dx + dy * dy + dz * dz), NULL, NULL, INFINITY);
+}
+
+// Arc from the current position to target around the centre at offset (i, j)
+static void estimator_arc(print_estimator_t* estimator, const double* target, double i, double j, int clockwise) {
+    double radius = sqrt(i * i + j * j);
+    if (radius < 1e-6) {
+        estimator_line(estimator, target);
+        return;
+    }
+    double cx = estimator->position[0] + i;
+    double cy = estimator->position[1] + j;
+    double end_x = target[0] - cx;
+    double end_y = target[1] - cy;
+    
+    double sweep = atan2(end_y, end_x) - atan2(-j, -i);
+    if (clockwise && sweep >= 0) sweep -= 2.0 * M_PI;
+    if (!clockwise && sweep <= 0) sweep += 2.0 * M_PI;
+    double planar = radius * fabs(sweep);
+    double dz = target[2] - estimator->position[2];
+    double length = sqrt(planar * planar + dz * dz);
+    
+    // Tangents at both ends: the radius turned a quarter in the direction of travel
+    double turn = clockwise ? -1.0 : 1.0;
+    double end_radius = sqrt(end_x * end_x + end_y * end_y);
+    if (end_radius < 1e-9) end_radius = radius;
+    double scale = planar / length;
+    double start[3] = { turn * j / radius * scale, -turn * i / radius * scale, dz / length };
+    double end[3] = { -turn * end_y / end_radius * scale, turn * end_x / end_radius * scale, dz / length };
+    
+    // Going round a curve at v takes v^2 / r of acceleration
+    double speed_cap = sqrt(estimator->config.acceleration * radius);
+    estimator_move(estimator, target, length, start, end, speed_cap);
+}
+
+// The machine comes to rest (homing, and similar non-motion commands)
+static void estimator_stop(print_estimator_t* estimator) {
+    estimator->previous_speed = 0.0;
+}
+
+static void estimator_next_layer(print_estimator_t* estimator) {
+    estimator->layer++;
+    if (estimator->layer >= estimator->layer_capacity) {
+        int capacity = estimator->layer_capacity * 2;
+        double* grown = realloc(estimator->layer_times, capacity * sizeof(double));
+        if (!grown) {
+            // Keep counting into the last layer we have room for
+            estimator->error = 1;
+            estimator->layer = estimator->layer_capacity - 1;
+            return;
+        }
+        memset(grown + estimator->layer_capacity, 0, (capacity - estimator->layer_capacity) * sizeof(double));
+        estimator->layer_times = grown;
+        estimator->layer_capacity = capacity;
+    }
+    estimator->num_layers = estimator->layer + 1;
+}
+
+void print_estimator_add_commands(print_estimator_t* estimator, const gcode_buffer_t* commands) {
+    if (!estimator || !commands) return;
+    
+    const double scale = 1.0 / GCODE_UNITS_PER_MM;
+    for (size_t k = 0; k < commands->count; k++) {
+        const gcode_command_t* cmd = gcode_buffer_at(commands, k);
+        double target[PRINT_ESTIMATE_AXES];
+        
+        switch (cmd->type) {
+            case GCODE_MOVE:
+                if (commands->feeds[cmd->feed] > 0) estimator->feed = commands->feeds[cmd->feed] / 60.0;
+                target[0] = cmd->data.move.x * scale;
+                target[1] = cmd->data.move.y * scale;
+                target[2] = cmd->data.move.z * scale;
+                target[3] = cmd->data.move.e * scale + (estimator->relative_e ? estimator->position[3] : 0.0);
+                estimator_line(estimator, target);
+                break;
+            
+            case GCODE_ARC:
+                if (commands->feeds[cmd->feed] > 0) estimator->feed = commands->feeds[cmd->feed] / 60.0;
+                target[0] = cmd->data.arc.x * scale;
+                target[1] = cmd->data.arc.y * scale;
+                target[2] = estimator->position[2];
+                target[3] = cmd->data.arc.e * scale + (estimator->relative_e ? estimator->position[3] : 0.0);
+                estimator_arc(estimator, target, cmd->data.arc.i * scale, cmd->data.arc.j * scale,
+                              cmd->flags & GCODE_FLAG_CLOCKWISE);
+                break;
+            
+            case GCODE_HOME:
+                estimator->position[0] = estimator->position[1] = estimator->position[2] = 0.0;
+                estimator_stop(estimator);
+                break;
+            
+            case GCODE_LAYER:
+                estimator_next_layer(estimator);
+                break;
+            
+            case GCODE_SET_POS:
+                estimator->position[3] = cmd->data.value * scale;
+                break;
+            
+            case GCODE_E_MODE:
+                estimator->relative_e = cmd->data.value;
+                break;
+            
+            default:
+                break;
+        }
+    }
+}
+
+// Read a plain decimal number (G-code never uses exponents); returns the end
+static const char* parse_gcode_number(const char* p, const char* end, double* value) {
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                     1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    
+    unsigned long long mantissa = 0;
+    int digits = 0, exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 18) {
+            mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 18) {
+                mantissa = mantissa * 10 + (unsigned long long)(*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+        }
+    }
+    double result = (double)mantissa;
+    result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+    *value = negative ? -result : result;
+    return p;
+}
+
+static int has_word(unsigned int seen, char letter) {
+    return (seen >> (letter - 'A')) & 1u;
+}
+
+static int starts_with(const char* p, const char* end, const char* prefix) {
+    size_t length = strlen(prefix);
+    return (size_t)(end - p) >= length && memcmp(p, prefix, length) == 0;
+}
+
+void print_estimator_add_line(print_estimator_t* estimator, const char* line, size_t length) {
+    if (!estimator || !line) return;
+    
+    const char* p = line;
+    const char* end = line + length;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == ';') {
+        // Layer markers: ours, Cura's and PrusaSlicer's
+        for (p++; p < end && *p == ' '; p++) {}
+        if (starts_with(p, end, "Layer ") || starts_with(p, end, "LAYER:") || starts_with(p, end, "LAYER_CHANGE")) {
+            estimator_next_layer(estimator);
+        }
+        return;
+    }
+    if (p >= end || (*p != 'G' && *p != 'g' && *p != 'M' && *p != 'm')) return;
+    
+    char letter = (char)(*p++ & ~0x20);
+    double code_value;
+    p = parse_gcode_number(p, end, &code_value);
+    int code = (int)code_value;
+    
+    // Parameter words up to a comment
+    double words[26];
+    unsigned int seen = 0;
+    while (p < end && *p != ';') {
+        char c = (char)(*p & ~0x20);
+        if (c >= 'A' && c <= 'Z') {
+            p = parse_gcode_number(p + 1, end, &words[c - 'A']);
+            seen |= 1u << (c - 'A');
+        } else {
+            p++;
+        }
+    }
+    
+    if (letter == 'M') {
+        if (code == 82) estimator->relative_e = 0;
+        else if (code == 83) estimator->relative_e = 1;
+        return;
+    }
+    
+    static const char axis_letters[PRINT_ESTIMATE_AXES] = { 'X', 'Y', 'Z', 'E' };
+    double target[PRINT_ESTIMATE_AXES];
+    switch (code) {
+        case 0: case 1: case 2: case 3:
+            if (has_word(seen, 'F') && words['F' - 'A'] > 0) estimator->feed = words['F' - 'A'] / 60.0;
+            for (int axis = 0; axis < PRINT_ESTIMATE_AXES; axis++) {
+                int relative = axis == 3 ? estimator->relative_e : estimator->relative_xyz;
+                target[axis] = estimator->position[axis];
+                if (has_word(seen, axis_letters[axis])) {
+                    double value = words[axis_letters[axis] - 'A'];
+                    target[axis] = relative ? target[axis] + value : value;
+                }
+            }
+            if (code >= 2 && (has_word(seen, 'I') || has_word(seen, 'J'))) {
+                estimator_arc(estimator, target, has_word(seen, 'I') ? words['I' - 'A'] : 0.0,
+                              has_word(seen, 'J') ? words['J' - 'A'] : 0.0, code == 2);
+            } else {
+                estimator_line(estimator, target);
+            }
+            break;
+        
+        case 28:
+            // Homes the axes given, or all of them
+            for (int axis = 0; axis < 3; axis++) {
+                int any = has_word(seen, 'X') || has_word(seen, 'Y') || has_word(seen, 'Z');
+                if (!any || has_word(seen, axis_letters[axis])) estimator->position[axis] = 0.0;
+            }
+            estimator_stop(estimator);
+            break;
+        
+        case 90:
+            estimator->relative_xyz = 0;
+            estimator->relative_e = 0;
+            break;
+        
+        case 91:
+            estimator->relative_xyz = 1;
+            estimator->relative_e = 1;
+            break;
+        
+        case 92:
+            // Sets the axes given, or all of them, without moving
+            for (int axis = 0; axis < PRINT_ESTIMATE_AXES; axis++) {
+                if (!seen) estimator->position[axis] = 0.0;
+                else if (has_word(seen, axis_letters[axis])) estimator->position[axis] = words[axis_letters[axis] - 'A'];
+            }
+            break;
+        
+        default:
+            break;
+    }
+}
+
+int print_estimator_finish(print_estimator_t* estimator, print_estimate_t* estimate) {
+    if (!estimator || !estimate) return -1;
+    
+    memset(estimate, 0, sizeof(print_estimate_t));
+    estimator_plan(estimator, 1);
+    
+    int num_layers = estimator->num_layers > 0 ? estimator->num_layers : (estimator->moves > 0 ? 1 : 0);
+    if (num_layers > 0) {
+        estimate->layer_times = malloc(num_layers * sizeof(double));
+        if (!estimate->layer_times) return -1;
+        memcpy(estimate->layer_times, estimator->layer_times, num_layers * sizeof(double));
+    }
+    estimate->num_layers = num_layers;
+    estimate->time = estimator->time;
+    estimate->moves = estimator->moves;
+    estimate->filament_length = estimator->filament;
+    
+    // mm^3 to cm^3
+    double radius = 0.5 * estimator->config.filament_diameter;
+    estimate->filament_mass = estimator->filament * M_PI * radius * radius / 1000.0 * estimator->config.filament_density;
+    return estimator->error ? -1 : 0;
+}
+
+int print_estimate_file(const char* filename, const print_estimate_config_t* config, print_estimate_t* estimate) {
+    if (!filename || !config || !estimate) return -1;
+    
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return -1;
+    }
+    print_estimator_t* estimator = print_estimator_create(config);
+    char* buffer = malloc(PRINT_ESTIMATE_READ_SIZE);
+    if (!estimator || !buffer) {
+        fprintf(stderr, "Error: Out of memory estimating %s\n", filename);
+        print_estimator_free(estimator);
+        free(buffer);
+        fclose(file);
+        return -1;
+    }
+    
+    // Whole lines are handed over; a partial one moves to the front for the next read.
+    // A line longer than the buffer is cut, which only loses the end of a comment.
+    size_t used = 0;
+    size_t count;
+    while ((count = fread(buffer + used, 1, PRINT_ESTIMATE_READ_SIZE - used, file)) > 0 || used > 0) {
+        size_t length = used + count;
+        int at_end = count == 0;
+        size_t start = 0;
+        for (;;) {
+            const char* newline = memchr(buffer + start, '\n', length - start);
+            if (!newline) break;
+            size_t line_end = (size_t)(newline - buffer);
+            print_estimator_add_line(estimator, buffer + start, line_end - start);
+            start = line_end + 1;
+        }
+        if (at_end || (start == 0 && length == PRINT_ESTIMATE_READ_SIZE)) {
+            print_estimator_add_line(estimator, buffer + start, length - start);
+            start = length;
+        }
+        used = length - start;
+        memmove(buffer, buffer + start, used);
+    }
+    int failed = ferror(file);
+    fclose(file);
+    free(buffer);
+    
+    int status = print_estimator_finish(estimator, estimate);
+    print_estimator_free(estimator);
+    if (failed) {
+        fprintf(stderr, "Error: Failed reading %s\n", filename);
+        print_estimate_free(estimate);
+        return -1;
+    }
+    return status;
+}
+
+void print_estimate_free(print_estimate_t* estimate) {
+    if (!estimate) return;
+    
+    free(estimate->layer_times);
+    estimate->layer_times = NULL;
+    estimate->num_layers = 0;
+}
+
+static void print_duration(double seconds) {
+    long total = (long)(seconds + 0.5);
+    if (total >= 3600) printf("%ldh %02ldm %02lds", total / 3600, total / 60 % 60, total % 60);
+    else if (total >= 60) printf("%ldm %02lds", total / 60, total % 60);
+    else printf("%.1fs", seconds);
+}
+
+void print_estimate_info(const print_estimate_t* estimate, int show_layers) {
+    printf("Estimated print time: ");
+    print_duration(estimate->time);
+    printf(" (%lld moves)\n", estimate->moves);
+    printf("Filament: %.2f m, %.1f g\n", estimate->filament_length / 1000.0, estimate->filament_mass);
+    
+    if (estimate->num_layers > 0) {
+        int fastest = 0, slowest = 0;
+        for (int i = 1; i < estimate->num_layers; i++) {
+            if (estimate->layer_times[i] < estimate->layer_times[fastest]) fastest = i;
+            if (estimate->layer_times[i] > estimate->layer_times[slowest]) slowest = i;
+        }
+        printf("Layer times: %.1fs (layer %d) to %.1fs (layer %d)\n", estimate->layer_times[fastest],
+               fastest + 1, estimate->layer_times[slowest], slowest + 1);
+    }
+    if (show_layers) {
+        for (int i = 0; i < estimate->num_layers; i++) {
+            printf("  Layer %d: %.2fs\n", i + 1, estimate->layer_times[i]);
+        }
+    }
+}
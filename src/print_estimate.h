@@ -0,0 +1,64 @@
+#ifndef PRINT_ESTIMATE_H
+#define PRINT_ESTIMATE_H
+
+#include <stddef.h>
+#include "gcode_buffer.h"
+
+// Print time and filament estimation. Moves are planned the way firmware plans them:
+// a trapezoidal speed profile per move, with corner speeds set by junction deviation
+// (or per-axis jerk) and speeds and accelerations capped per axis. Works on generated
+// commands or on any G-code file.
+
+// Axes in the order the per-axis limits are given
+#define PRINT_ESTIMATE_AXES 4   // X, Y, Z, E
+
+// Moves planned together; a move is final once a later one is sure to reach full speed
+#define PRINT_ESTIMATE_WINDOW 4096
+
+// Bytes read from a G-code file at a time
+#define PRINT_ESTIMATE_READ_SIZE (1 << 20)
+
+typedef struct {
+    float acceleration;                         // Extruding moves (mm/s^2)
+    float travel_acceleration;                  // Moves without extrusion (mm/s^2)
+    float junction_deviation;                   // mm; 0 limits corners by max_jerk instead
+    float max_jerk[PRINT_ESTIMATE_AXES];        // Speed change allowed at a corner (mm/s)
+    float max_feedrate[PRINT_ESTIMATE_AXES];    // mm/s
+    float max_acceleration[PRINT_ESTIMATE_AXES]; // mm/s^2
+    float filament_diameter;                    // mm
+    float filament_density;                     // g/cm^3
+} print_estimate_config_t;
+
+typedef struct {
+    double time;                // Total (s)
+    double filament_length;     // Net filament fed, after retractions (mm)
+    double filament_mass;       // g
+    long long moves;
+    double* layer_times;        // Seconds per layer; moves before the first layer count toward it
+    int num_layers;
+} print_estimate_t;
+
+typedef struct print_estimator print_estimator_t;
+
+// Function declarations
+print_estimate_config_t print_estimate_default_config(void);
+
+print_estimator_t* print_estimator_create(const print_estimate_config_t* config);
+void print_estimator_free(print_estimator_t* estimator);
+
+// Feed commands in print order, from one buffer or from many batches
+void print_estimator_add_commands(print_estimator_t* estimator, const gcode_buffer_t* commands);
+
+// Feed one line of G-code text (no newline needed)
+void print_estimator_add_line(print_estimator_t* estimator, const char* line, size_t length);
+
+// Plan what is left and fill estimate (free with print_estimate_free); -1 when out of memory
+int print_estimator_finish(print_estimator_t* estimator, print_estimate_t* estimate);
+
+// Estimate a G-code file; -1 if it cannot be read
+int print_estimate_file(const char* filename, const print_estimate_config_t* config, print_estimate_t* estimate);
+
+void print_estimate_free(print_estimate_t* estimate);
+void print_estimate_info(const print_estimate_t* estimate, int show_layers);
+
+#endif // PRINT_ESTIMATE_H
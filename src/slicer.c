@@ -1,6 +1,414 @@
 #include "slicer.h"
+#include "stl_stream.h"
+#include "polygon_offset.h"
+#include "infill.h"
+#include "lightning.h"
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Growable list of slice segments for one layer
+typedef struct {
+    slice_segment_t* segments;
+    int num_segments;
+    int capacity;
+} segment_list_t;
+
+static int segment_list_push(segment_list_t* list, const slice_segment_t* segment) {
+    if (list->num_segments == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        slice_segment_t* segments = realloc(list->segments, capacity * sizeof(slice_segment_t));
+        if (!segments) return -1;
+        list->segments = segments;
+        list->capacity = capacity;
+    }
+    list->segments[list->num_segments++] = *segment;
+    return 0;
+}
+
+// Returns -1 when the segment could not be stored
+static int slice_triangle_into(segment_list_t* list, const stl_file_t* stl, unsigned int index, float z) {
+    stl_triangle_t triangle;
+    slice_segment_t segment;
+    stl_get_triangle_corners(stl, index, &triangle);
+    if (slice_triangle(&triangle, z, &segment)) {
+        return segment_list_push(list, &segment);
+    }
+    return 0;
+}
+
+// Allocate layers; each layer's z_height is the top of the layer.
+// heights == NULL gives uniform layers of params->layer_height.
+static int init_layers(sliced_model_t* model, float min_z, int num_layers, const float* heights,
+                       const slicing_params_t* params) {
+    model->params = *params;
+    model->infill_plan = NULL;
+    model->num_layers = num_layers > 0 ? num_layers : 0;
+    model->layers = calloc(model->num_layers > 0 ? model->num_layers : 1, sizeof(layer_t));
+    if (!model->layers) return -1;
+    
+    model->infill_plan = infill_plan_create(params);
+    if (!model->infill_plan && params->infill_density > 0.0f) {
+        fprintf(stderr, "Warning: Failed to prepare the infill pattern, layers will have no infill\n");
+    }
+    
+    float z = min_z;
+    for (int i = 0; i < model->num_layers; i++) {
+        if (heights) {
+            z += heights[i];
+            model->layers[i].z_height = z;
+            model->layers[i].thickness = heights[i];
+        } else {
+            model->layers[i].z_height = min_z + (i + 1) * params->layer_height;
+            model->layers[i].thickness = params->layer_height;
+        }
+    }
+    return 0;
+}
+
+// Uniform or adaptive layers over the mesh, depending on params->cusp_height
+static int init_model_layers(sliced_model_t* model, const stl_file_t* stl, const slicing_params_t* params) {
+    if (params->cusp_height > 0) {
+        int num_layers = 0;
+        float* heights = compute_adaptive_layer_heights(stl, params, &num_layers);
+        if (heights) {
+            int status = init_layers(model, stl->bounds[2], num_layers, heights, params);
+            free(heights);
+            return status;
+        }
+        fprintf(stderr, "Warning: Failed to build adaptive layer profile, using fixed layers\n");
+    }
+    return init_layers(model, stl->bounds[2], calculate_num_layers(stl, params->layer_height), NULL, params);
+}
+
+// Layers are cut through their middle, away from the flat top and bottom faces
+static float layer_slice_height(const layer_t* layer) {
+    return layer->z_height - 0.5f * layer->thickness;
+}
+
+// Per-triangle z-ranges, borrowed from the SoA view or computed once
+typedef struct {
+    const float* z_min;
+    const float* z_max;
+    float* owned;                // Non-NULL when computed here
+} slice_z_ranges_t;
+
+static int slice_z_ranges_init(slice_z_ranges_t* ranges, const stl_file_t* stl) {
+    ranges->owned = NULL;
+    if (stl->soa) {
+        ranges->z_min = stl->soa->z_min;
+        ranges->z_max = stl->soa->z_max;
+        return 0;
+    }
+    
+    ranges->owned = malloc(((size_t)stl->num_triangles * 2 + 1) * sizeof(float));
+    if (!ranges->owned) return -1;
+    
+    float* z_min = ranges->owned;
+    float* z_max = ranges->owned + stl->num_triangles;
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, i, &triangle);
+        z_min[i] = fminf(triangle.vertices[0][2], fminf(triangle.vertices[1][2], triangle.vertices[2][2]));
+        z_max[i] = fmaxf(triangle.vertices[0][2], fmaxf(triangle.vertices[1][2], triangle.vertices[2][2]));
+    }
+    ranges->z_min = z_min;
+    ranges->z_max = z_max;
+    return 0;
+}
+
+static void slice_z_ranges_free(slice_z_ranges_t* ranges) {
+    free(ranges->owned);
+    ranges->owned = NULL;
+}
+
+typedef struct {
+    float z_min;
+    unsigned int index;
+} sweep_key_t;
+
+static int compare_sweep_keys(const void* a, const void* b) {
+    const sweep_key_t* ka = (const sweep_key_t*)a;
+    const sweep_key_t* kb = (const sweep_key_t*)b;
+    if (ka->z_min < kb->z_min) return -1;
+    if (ka->z_min > kb->z_min) return 1;
+    return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+// Sort triangles by (z_min, index) once; indices == NULL sorts all num_indices triangles
+static unsigned int* slice_sweep_order(const slice_z_ranges_t* ranges, const unsigned int* indices,
+                                       unsigned int num_indices) {
+    sweep_key_t* keys = malloc(((size_t)num_indices + 1) * sizeof(sweep_key_t));
+    unsigned int* order = malloc(((size_t)num_indices + 1) * sizeof(unsigned int));
+    if (!keys || !order) {
+        free(keys);
+        free(order);
+        return NULL;
+    }
+    
+    for (unsigned int i = 0; i < num_indices; i++) {
+        unsigned int index = indices ? indices[i] : i;
+        keys[i].z_min = ranges->z_min[index];
+        keys[i].index = index;
+    }
+    qsort(keys, num_indices, sizeof(sweep_key_t), compare_sweep_keys);
+    
+    for (unsigned int i = 0; i < num_indices; i++) {
+        order[i] = keys[i].index;
+    }
+    free(keys);
+    return order;
+}
+
+// Sweep-plane cursor: triangles enter the active set as the plane rises past their
+// z_min and leave once it passes their z_max. The sorted order is shared; each
+// worker keeps its own cursor.
+typedef struct {
+    const float* z_min;
+    const float* z_max;
+    const unsigned int* order;   // Triangle indices sorted by (z_min, index)
+    unsigned int num_order;
+    unsigned int next;           // First triangle in order not yet entered
+    unsigned int* active;        // Triangles spanning the current plane, in entry order
+    unsigned int num_active;
+    unsigned int active_capacity;
+    float z;                     // Current plane height; must not decrease between resets
+} slice_sweep_t;
+
+static void slice_sweep_reset(slice_sweep_t* sweep) {
+    sweep->next = 0;
+    sweep->num_active = 0;
+    sweep->z = -INFINITY;
+}
+
+// Move the plane up to z: retire triangles below it, then admit those it reached.
+// Compaction is stable, so the active set is always in sorted order whatever height
+// the sweep was started from; this keeps contours identical between layer blocks.
+static int slice_sweep_advance(slice_sweep_t* sweep, float z) {
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < sweep->num_active; i++) {
+        unsigned int index = sweep->active[i];
+        if (sweep->z_max[index] >= z) {
+            sweep->active[kept++] = index;
+        }
+    }
+    sweep->num_active = kept;
+    sweep->z = z;
+    
+    while (sweep->next < sweep->num_order && sweep->z_min[sweep->order[sweep->next]] <= z) {
+        unsigned int index = sweep->order[sweep->next++];
+        if (sweep->z_max[index] < z) continue;
+        
+        if (sweep->num_active == sweep->active_capacity) {
+            unsigned int capacity = sweep->active_capacity ? sweep->active_capacity * 2 : 256;
+            unsigned int* active = realloc(sweep->active, capacity * sizeof(unsigned int));
+            if (!active) return -1;
+            sweep->active = active;
+            sweep->active_capacity = capacity;
+        }
+        sweep->active[sweep->num_active++] = index;
+    }
+    return 0;
+}
+
+// Cut the triangles active at the sweep's current plane
+static int slice_sweep_collect(segment_list_t* list, const stl_file_t* stl, const slice_sweep_t* sweep,
+                               unsigned int* stamps, unsigned int stamp) {
+    for (unsigned int i = 0; i < sweep->num_active; i++) {
+        unsigned int index = sweep->active[i];
+        
+        // A triangle shared by several parts is cut only once per layer
+        if (stamps) {
+            if (stamps[index] == stamp) continue;
+            stamps[index] = stamp;
+        }
+        if (slice_triangle_into(list, stl, index, sweep->z) != 0) return -1;
+    }
+    return 0;
+}
+
+// Sorted triangle sets sliced together: the whole mesh, or one per partition or part.
+// Segments from all sets are chained together, so loops crossing partition
+// boundaries stay closed.
+typedef struct {
+    slice_z_ranges_t ranges;
+    unsigned int** orders;
+    unsigned int* order_sizes;
+    unsigned int num_sweeps;
+} sweep_group_t;
+
+static int sweep_group_init(sweep_group_t* group, const stl_file_t* stl, unsigned int max_sweeps) {
+    group->num_sweeps = 0;
+    group->orders = calloc(max_sweeps + 1, sizeof(unsigned int*));
+    group->order_sizes = calloc(max_sweeps + 1, sizeof(unsigned int));
+    if (!group->orders || !group->order_sizes || slice_z_ranges_init(&group->ranges, stl) != 0) {
+        free(group->orders);
+        free(group->order_sizes);
+        return -1;
+    }
+    return 0;
+}
+
+static int sweep_group_add(sweep_group_t* group, const unsigned int* indices, unsigned int num_indices) {
+    unsigned int* order = slice_sweep_order(&group->ranges, indices, num_indices);
+    if (!order) return -1;
+    group->orders[group->num_sweeps] = order;
+    group->order_sizes[group->num_sweeps] = num_indices;
+    group->num_sweeps++;
+    return 0;
+}
+
+static void sweep_group_free(sweep_group_t* group) {
+    for (unsigned int i = 0; i < group->num_sweeps; i++) {
+        free(group->orders[i]);
+    }
+    free(group->orders);
+    free(group->order_sizes);
+    slice_z_ranges_free(&group->ranges);
+}
+
+// Per-worker scratch, reused across the layer blocks the worker runs
+typedef struct {
+    segment_list_t list;
+    slice_sweep_t* sweeps;       // This worker's cursors over the group's orders
+    unsigned int* stamps;        // Per-layer marks when sweeps share triangles
+    int failed;
+} slice_worker_t;
+
+typedef struct {
+    const sweep_group_t* group;
+    sliced_model_t* model;
+    const stl_file_t* stl;
+    int first;                   // First layer of block 0
+    int last;                    // One past the last layer
+    int block_size;              // Layers per block
+    int dedupe;                  // Sweeps may share triangles
+    slice_worker_t* workers;
+} slice_job_t;
+
+static int slice_worker_prepare(slice_worker_t* worker, const slice_job_t* job) {
+    if (worker->sweeps) return 0;
+    
+    worker->sweeps = calloc(job->group->num_sweeps + 1, sizeof(slice_sweep_t));
+    if (!worker->sweeps) return -1;
+    for (unsigned int s = 0; s < job->group->num_sweeps; s++) {
+        worker->sweeps[s].z_min = job->group->ranges.z_min;
+        worker->sweeps[s].z_max = job->group->ranges.z_max;
+        worker->sweeps[s].order = job->group->orders[s];
+        worker->sweeps[s].num_order = job->group->order_sizes[s];
+    }
+    
+    if (job->dedupe) {
+        worker->stamps = calloc(job->stl->num_triangles + 1, sizeof(unsigned int));
+        if (!worker->stamps) return -1;
+    }
+    return 0;
+}
+
+static void slice_worker_free(slice_worker_t* worker, unsigned int num_sweeps) {
+    if (worker->sweeps) {
+        for (unsigned int s = 0; s < num_sweeps; s++) {
+            free(worker->sweeps[s].active);
+        }
+        free(worker->sweeps);
+    }
+    free(worker->stamps);
+    free(worker->list.segments);
+}
+
+// Slice one block of consecutive layers, starting every sweep afresh at its bottom
+static void slice_layer_block(void* user_data, int block, int worker_id) {
+    slice_job_t* job = (slice_job_t*)user_data;
+    slice_worker_t* worker = &job->workers[worker_id];
+    if (slice_worker_prepare(worker, job) != 0) {
+        worker->failed = 1;
+        return;
+    }
+    
+    int first = job->first + block * job->block_size;
+    int last = first + job->block_size < job->last ? first + job->block_size : job->last;
+    for (unsigned int s = 0; s < job->group->num_sweeps; s++) {
+        slice_sweep_reset(&worker->sweeps[s]);
+    }
+    
+    for (int i = first; i < last; i++) {
+        layer_t* layer = &job->model->layers[i];
+        float z = layer_slice_height(layer);
+        
+        worker->list.num_segments = 0;
+        for (unsigned int s = 0; s < job->group->num_sweeps; s++) {
+            if (slice_sweep_advance(&worker->sweeps[s], z) != 0 ||
+                slice_sweep_collect(&worker->list, job->stl, &worker->sweeps[s], worker->stamps,
+                                    (unsigned int)i + 1) != 0) {
+                worker->failed = 1;
+                return;
+            }
+        }
+        chain_segments(layer, worker->list.segments, worker->list.num_segments);
+        generate_shells(layer, &job->model->params);
+        generate_infill(layer, i, job->model->infill_plan, &job->model->params);
+    }
+}
+
+// Slice layers [first, last). With a pool in the params the layers are cut into blocks
+// spread over the workers; the output is identical to the serial run.
+static int slice_layers(sliced_model_t* model, const stl_file_t* stl, const sweep_group_t* group,
+                        int first, int last, int dedupe) {
+    int num_layers = last - first;
+    if (num_layers <= 0) return 0;
+    
+    thread_pool_t* pool = model->params.pool;
+    int num_workers = pool ? pool->num_threads : 1;
+    int num_blocks = num_workers > 1 ? num_workers * SLICER_BLOCKS_PER_THREAD : 1;
+    if (num_blocks > num_layers) num_blocks = num_layers;
+    
+    slice_job_t job = {
+        .group = group,
+        .model = model,
+        .stl = stl,
+        .first = first,
+        .last = last,
+        .block_size = (num_layers + num_blocks - 1) / num_blocks,
+        .dedupe = dedupe,
+        .workers = calloc(num_workers, sizeof(slice_worker_t))
+    };
+    if (!job.workers) return -1;
+    num_blocks = (num_layers + job.block_size - 1) / job.block_size;
+    
+    thread_pool_parallel_for(pool, num_blocks, slice_layer_block, &job);
+    
+    int status = 0;
+    for (int w = 0; w < num_workers; w++) {
+        if (job.workers[w].failed) status = -1;
+        slice_worker_free(&job.workers[w], group->num_sweeps);
+    }
+    free(job.workers);
+    return status;
+}
+
+// Infill that needs every layer sliced first
+static void finish_infill(sliced_model_t* model) {
+    if (generate_lightning_infill(model) != 0) {
+        fprintf(stderr, "Warning: Could not generate lightning infill\n");
+    }
+}
+
+// Slice layers [first, last) of the model with a single sweep over the whole mesh
+static int slice_layers_sweep(sliced_model_t* model, const stl_file_t* stl, int first, int last) {
+    sweep_group_t group;
+    if (sweep_group_init(&group, stl, 1) != 0) return -1;
+    
+    int status = sweep_group_add(&group, NULL, stl->num_triangles);
+    if (status == 0) {
+        status = slice_layers(model, stl, &group, first, last, 0);
+    }
+    sweep_group_free(&group);
+    return status;
+}
 
 sliced_model_t* slice_model(const stl_file_t* stl, const slicing_params_t* params) {
     if (!stl || !params) return NULL;
@@ -8,92 +416,280 @@ sliced_model_t* slice_model(const stl_file_t* stl, const slicing_params_t* param
     sliced_model_t* model = malloc(sizeof(sliced_model_t));
     if (!model) return NULL;
     
-    model->params = *params;
-    model->num_layers = calculate_num_layers(stl, params->layer_height);
-    model->layers = malloc(model->num_layers * sizeof(layer_t));
-    
-    if (!model->layers) {
+    if (init_model_layers(model, stl, params) != 0) {
         free(model);
         return NULL;
     }
     
-    // Initialize layers
-    for (int i = 0; i < model->num_layers; i++) {
-        model->layers[i].z_height = stl->bounds[2] + i * params->layer_height;
-        model->layers[i].contours = NULL;
-        model->layers[i].num_contours = 0;
-        model->layers[i].infill_points = NULL;
-        model->layers[i].num_infill_points = 0;
+    // Generate contours and infill for each layer in one upward sweep
+    if (slice_layers_sweep(model, stl, 0, model->num_layers) != 0) {
+        free_sliced_model(model);
+        return NULL;
     }
+    finish_infill(model);
     
-    // Generate contours and infill for each layer
-    for (int i = 0; i < model->num_layers; i++) {
-        generate_contours(&model->layers[i], stl, model->layers[i].z_height);
-        generate_infill(&model->layers[i], params);
+    return model;
+}
+
+static int collect_partition_segments(segment_list_t* list, const stl_file_t* stl,
+                                      const spatial_partition_t* partition, float z_height,
+                                      unsigned int partition_id, unsigned int* candidates) {
+    // Check if this Z height intersects with the partition
+    const float* bounds = &partition->partition_bounds[partition_id * 6];
+    if (z_height < bounds[2] || z_height > bounds[5]) return 0;
+    
+    if (stl->soa && candidates) {
+        // Vectorized z-range test over the SoA view
+        unsigned int count = stl_soa_filter_z_range_labeled(stl->soa, partition->partition_ids,
+                                                            partition_id, z_height, candidates);
+        for (unsigned int i = 0; i < count; i++) {
+            if (slice_triangle_into(list, stl, candidates[i], z_height) != 0) return -1;
+        }
+        return 0;
     }
     
-    return model;
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        if (partition->partition_ids[i] == partition_id &&
+            slice_triangle_into(list, stl, i, z_height) != 0) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
-sliced_model_t* slice_model_with_bvh(const stl_file_t* stl, const slicing_params_t* params, 
+sliced_model_t* slice_model_with_bvh(const stl_file_t* stl, const slicing_params_t* params,
                                      const spatial_partition_t* partition) {
     if (!stl || !params || !partition) return NULL;
     
     sliced_model_t* model = malloc(sizeof(sliced_model_t));
     if (!model) return NULL;
     
-    model->params = *params;
-    model->num_layers = calculate_num_layers(stl, params->layer_height);
-    model->layers = malloc(model->num_layers * sizeof(layer_t));
-    
-    if (!model->layers) {
+    if (init_model_layers(model, stl, params) != 0) {
         free(model);
         return NULL;
     }
     
-    // Initialize layers
-    for (int i = 0; i < model->num_layers; i++) {
-        model->layers[i].z_height = stl->bounds[2] + i * params->layer_height;
-        model->layers[i].contours = NULL;
-        model->layers[i].num_contours = 0;
-        model->layers[i].infill_points = NULL;
-        model->layers[i].num_infill_points = 0;
+    // Group triangle indices by partition (counting sort keeps index order within each)
+    unsigned int num_partitions = partition->num_partitions;
+    unsigned int* offsets = calloc(num_partitions + 1, sizeof(unsigned int));
+    unsigned int* grouped = malloc(((size_t)stl->num_triangles + 1) * sizeof(unsigned int));
+    sweep_group_t group;
+    int status = (offsets && grouped) ? sweep_group_init(&group, stl, num_partitions) : -1;
+    
+    if (status == 0) {
+        for (unsigned int i = 0; i < stl->num_triangles; i++) {
+            if (partition->partition_ids[i] < num_partitions) offsets[partition->partition_ids[i] + 1]++;
+        }
+        for (unsigned int p = 0; p < num_partitions; p++) {
+            offsets[p + 1] += offsets[p];
+        }
+        for (unsigned int i = 0; i < stl->num_triangles; i++) {
+            unsigned int p = partition->partition_ids[i];
+            if (p < num_partitions) grouped[offsets[p]++] = i;
+        }
+        
+        // offsets[p] now holds the end of partition p
+        for (unsigned int p = 0; p < num_partitions && status == 0; p++) {
+            unsigned int begin = p ? offsets[p - 1] : 0;
+            status = sweep_group_add(&group, grouped + begin, offsets[p] - begin);
+        }
+        if (status == 0) {
+            status = slice_layers(model, stl, &group, 0, model->num_layers, 0);
+        }
+        sweep_group_free(&group);
     }
     
-    // Generate contours and infill for each layer using BVH partitions
-    for (int i = 0; i < model->num_layers; i++) {
-        // Generate contours for each partition
-        for (unsigned int partition_id = 0; partition_id < partition->num_partitions; partition_id++) {
-            generate_contours_with_bvh(&model->layers[i], stl, partition, model->layers[i].z_height, partition_id);
+    free(offsets);
+    free(grouped);
+    if (status != 0) {
+        fprintf(stderr, "Error: Failed to slice partitions\n");
+        free_sliced_model(model);
+        return NULL;
+    }
+    finish_infill(model);
+    return model;
+}
+
+// A whole mesh swept a block of layers at a time, or a streamed mesh sliced band by band
+struct slice_cursor {
+    sliced_model_t* model;
+    const stl_file_t* stl;      // Whole mesh; NULL when streaming
+    sweep_group_t group;        // Sorted once, valid while stl is set
+    stl_band_set_t* bands;      // Streaming: triangles spilled per band of whole layers
+    unsigned int layers_per_band;
+    int block_size;             // Layers per slice_cursor_next
+    int next_layer;             // First layer not sliced yet
+};
+
+slice_cursor_t* slice_cursor_create(const stl_file_t* stl, const slicing_params_t* params) {
+    if (!stl || !params) return NULL;
+    
+    slice_cursor_t* cursor = calloc(1, sizeof(slice_cursor_t));
+    if (!cursor) return NULL;
+    
+    cursor->model = malloc(sizeof(sliced_model_t));
+    if (!cursor->model || init_model_layers(cursor->model, stl, params) != 0) {
+        free(cursor->model);
+        free(cursor);
+        return NULL;
+    }
+    if (sweep_group_init(&cursor->group, stl, 1) != 0) {
+        slice_cursor_free(cursor);
+        return NULL;
+    }
+    cursor->stl = stl;
+    if (sweep_group_add(&cursor->group, NULL, stl->num_triangles) != 0) {
+        slice_cursor_free(cursor);
+        return NULL;
+    }
+    
+    // Every sweep restarts at the bottom of each block, so blocks stay a few per worker
+    int num_workers = params->pool ? params->pool->num_threads : 1;
+    cursor->block_size = SLICER_CURSOR_LAYERS_PER_WORKER * num_workers;
+    return cursor;
+}
+
+slice_cursor_t* slice_cursor_create_streaming(const char* filename, const slicing_params_t* params,
+                                              unsigned int layers_per_band) {
+    if (!filename || !params || params->layer_height <= 0 || layers_per_band == 0) return NULL;
+    
+    // Pass 1: bounds, without holding the mesh
+    float bounds[6];
+    if (stl_stream_bounds(filename, bounds, NULL) != 0) return NULL;
+    
+    slice_cursor_t* cursor = calloc(1, sizeof(slice_cursor_t));
+    if (!cursor) return NULL;
+    
+    // Pass 2: spill triangles into bands of whole layers
+    float band_height = layers_per_band * params->layer_height;
+    cursor->bands = stl_stream_bucket_by_z(filename, bounds, band_height, 0);
+    cursor->model = cursor->bands ? malloc(sizeof(sliced_model_t)) : NULL;
+    int num_layers = (int)ceil((bounds[5] - bounds[2]) / params->layer_height);
+    if (!cursor->model || init_layers(cursor->model, bounds[2], num_layers, NULL, params) != 0) {
+        free(cursor->model);
+        cursor->model = NULL;
+        slice_cursor_free(cursor);
+        return NULL;
+    }
+    cursor->layers_per_band = layers_per_band;
+    cursor->block_size = (int)layers_per_band;
+    return cursor;
+}
+
+sliced_model_t* slice_cursor_model(const slice_cursor_t* cursor) {
+    return cursor ? cursor->model : NULL;
+}
+
+int slice_cursor_next(slice_cursor_t* cursor, int* first, int* last) {
+    if (!cursor || !cursor->model) return -1;
+    
+    sliced_model_t* model = cursor->model;
+    int begin = cursor->next_layer;
+    if (begin >= model->num_layers) return 0;
+    int end = begin + cursor->block_size < model->num_layers ? begin + cursor->block_size : model->num_layers;
+    
+    int status = 0;
+    if (cursor->bands) {
+        // Only this band's triangles are in memory
+        unsigned int b = (unsigned int)begin / cursor->layers_per_band;
+        if (b < cursor->bands->num_bands) {
+            stl_load_options_t band_options = stl_default_load_options();
+            band_options.weld_vertices = 0;
+            stl_file_t* band = stl_band_load(cursor->bands, b, &band_options);
+            if (!band) return -1;
+            status = slice_layers_sweep(model, band, begin, end);
+            stl_free(band);
         }
-        generate_infill(&model->layers[i], params);
+    } else {
+        status = slice_layers(model, cursor->stl, &cursor->group, begin, end, 0);
+    }
+    if (status != 0) return -1;
+    
+    cursor->next_layer = end;
+    *first = begin;
+    *last = end;
+    return 1;
+}
+
+void slice_cursor_free(slice_cursor_t* cursor) {
+    if (!cursor) return;
+    
+    if (cursor->stl) sweep_group_free(&cursor->group);
+    if (cursor->bands) stl_band_set_free(cursor->bands);
+    if (cursor->model) free_sliced_model(cursor->model);
+    free(cursor);
+}
+
+sliced_model_t* slice_model_streaming(const char* filename, const slicing_params_t* params,
+                                      unsigned int layers_per_band) {
+    slice_cursor_t* cursor = slice_cursor_create_streaming(filename, params, layers_per_band);
+    if (!cursor) return NULL;
+    
+    int first, last, status;
+    do {
+        status = slice_cursor_next(cursor, &first, &last);
+    } while (status > 0);
+    
+    // Keep the model when the cursor goes
+    sliced_model_t* model = NULL;
+    if (status == 0) {
+        model = cursor->model;
+        cursor->model = NULL;
     }
+    slice_cursor_free(cursor);
     
+    if (model) finish_infill(model);
     return model;
 }
 
+void free_layer(layer_t* layer) {
+    if (!layer) return;
+    
+    // Free contours
+    for (int j = 0; j < layer->num_contours; j++) {
+        if (layer->contours[j].points) {
+            free(layer->contours[j].points);
+        }
+    }
+    if (layer->contours) {
+        free(layer->contours);
+    }
+    layer->contours = NULL;
+    layer->num_contours = 0;
+    
+    // Free shells
+    for (int j = 0; j < layer->num_shells; j++) {
+        free(layer->shells[j].points);
+    }
+    free(layer->shells);
+    layer->shells = NULL;
+    layer->num_shells = 0;
+    
+    // Free infill region
+    for (int j = 0; j < layer->num_infill_region; j++) {
+        free(layer->infill_region[j].points);
+    }
+    free(layer->infill_region);
+    layer->infill_region = NULL;
+    layer->num_infill_region = 0;
+    
+    // Free infill points
+    if (layer->infill_points) {
+        free(layer->infill_points);
+    }
+    layer->infill_points = NULL;
+    layer->num_infill_points = 0;
+}
+
 void free_sliced_model(sliced_model_t* model) {
     if (!model) return;
     
     for (int i = 0; i < model->num_layers; i++) {
-        layer_t* layer = &model->layers[i];
-        
-        // Free contours
-        for (int j = 0; j < layer->num_contours; j++) {
-            if (layer->contours[j].points) {
-                free(layer->contours[j].points);
-            }
-        }
-        if (layer->contours) {
-            free(layer->contours);
-        }
-        
-        // Free infill points
-        if (layer->infill_points) {
-            free(layer->infill_points);
-        }
+        free_layer(&model->layers[i]);
     }
     
+    infill_plan_free(model->infill_plan);
+    
     if (model->layers) {
         free(model->layers);
     }
@@ -107,204 +703,658 @@ int calculate_num_layers(const stl_file_t* stl, float layer_height) {
     return (int)ceil(model_height / layer_height);
 }
 
-void generate_contours(layer_t* layer, const stl_file_t* stl, float z_height) {
-    // This is a simplified contour generation
-    // In a real implementation, you would:
-    // 1. Find all triangles that intersect with the z-plane
-    // 2. Calculate intersection points
-    // 3. Sort points to form closed contours
-    // 4. Handle multiple contours (outer shell + holes)
+// Cusp-height adaptive layers: a facet whose unit normal has vertical component n_z
+// leaves a stair-step of h * |n_z| with layers of height h, so it allows layers up to
+// cusp_height / |n_z|. Each facet caps a profile of bins over its z-range; layers
+// are then laid bottom-up, each as thick as every bin it covers allows.
+float* compute_adaptive_layer_heights(const stl_file_t* stl, const slicing_params_t* params, int* num_layers) {
+    if (num_layers) *num_layers = 0;
+    if (!stl || !params || !num_layers || params->cusp_height <= 0) return NULL;
+    
+    float min_height = params->min_layer_height > 0 ? params->min_layer_height : params->layer_height;
+    float max_height = params->max_layer_height > 0 ? params->max_layer_height : params->layer_height;
+    if (min_height <= 0 || max_height < min_height) return NULL;
     
-    // For now, create a simple bounding box contour
-    float margin = 5.0f; // 5mm margin
+    float bottom = stl->bounds[2];
+    float top = stl->bounds[5];
+    if (top <= bottom) return NULL;
+    
+    float bin_height = min_height / SLICER_ADAPTIVE_BINS_PER_MIN_LAYER;
+    int num_bins = (int)ceil((top - bottom) / bin_height) + 1;
+    float* allowed = malloc(num_bins * sizeof(float));
+    int capacity = (int)ceil((top - bottom) / min_height) + 2;
+    float* heights = malloc(capacity * sizeof(float));
+    if (!allowed || !heights) {
+        free(allowed);
+        free(heights);
+        return NULL;
+    }
+    
+    for (int b = 0; b < num_bins; b++) {
+        allowed[b] = max_height;
+    }
+    
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, i, &triangle);
+        const float* v0 = triangle.vertices[0];
+        const float* v1 = triangle.vertices[1];
+        const float* v2 = triangle.vertices[2];
+        
+        float z_min = fminf(v0[2], fminf(v1[2], v2[2]));
+        float z_max = fmaxf(v0[2], fmaxf(v1[2], v2[2]));
+        
+        // Horizontal facets leave no stair-step
+        if (z_max <= z_min) continue;
+        
+        float ux = v1[0] - v0[0], uy = v1[1] - v0[1], uz = v1[2] - v0[2];
+        float wx = v2[0] - v0[0], wy = v2[1] - v0[1], wz = v2[2] - v0[2];
+        float nx = uy * wz - uz * wy;
+        float ny = uz * wx - ux * wz;
+        float nz = ux * wy - uy * wx;
+        float length = sqrtf(nx * nx + ny * ny + nz * nz);
+        if (length <= 0) continue;
+        
+        float slope = fabsf(nz) / length;
+        float height = slope * max_height > params->cusp_height ? params->cusp_height / slope : max_height;
+        if (height < min_height) height = min_height;
+        
+        int first = (int)((z_min - bottom) / bin_height);
+        int last = (int)((z_max - bottom) / bin_height);
+        if (first < 0) first = 0;
+        if (last >= num_bins) last = num_bins - 1;
+        for (int b = first; b <= last; b++) {
+            if (height < allowed[b]) allowed[b] = height;
+        }
+    }
     
-    layer->num_contours = 1;
-    layer->contours = malloc(sizeof(contour_t));
-    layer->contours[0].num_points = 4;
-    layer->contours[0].points = malloc(4 * sizeof(point2d_t));
+    // Grow each layer as far as the bins it covers allow
+    int count = 0;
+    float z = bottom;
+    while (top - z > 1e-5f && count < capacity) {
+        float height = max_height;
+        for (;;) {
+            int first = (int)((z - bottom) / bin_height);
+            int last = (int)((z + height - bottom) / bin_height);
+            if (last >= num_bins) last = num_bins - 1;
+            
+            float limit = height;
+            for (int b = first; b <= last; b++) {
+                if (allowed[b] < limit) limit = allowed[b];
+            }
+            if (limit >= height) break;
+            height = limit;
+        }
+        
+        // Stretch the last layer to the top rather than leaving a sliver
+        float rest = top - z - height;
+        if (rest < 0) height = top - z;
+        else if (rest < min_height && height + rest <= max_height) height += rest;
+        
+        heights[count++] = height;
+        z += height;
+    }
     
-    // Create a simple rectangular contour
-    layer->contours[0].points[0] = (point2d_t){stl->bounds[0] - margin, stl->bounds[1] - margin};
-    layer->contours[0].points[1] = (point2d_t){stl->bounds[3] + margin, stl->bounds[1] - margin};
-    layer->contours[0].points[2] = (point2d_t){stl->bounds[3] + margin, stl->bounds[4] + margin};
-    layer->contours[0].points[3] = (point2d_t){stl->bounds[0] - margin, stl->bounds[4] + margin};
+    free(allowed);
+    *num_layers = count;
+    return heights;
 }
 
-sliced_model_t* slice_model_with_convex_decomposition(const stl_file_t* stl, const slicing_params_t* params,
-                                                     const convex_decomposition_t* decomp) {
-    if (!stl || !params || !decomp) return NULL;
+// Edge/plane intersection, always interpolated from the lexicographically smaller
+// endpoint so the two triangles sharing an edge produce bit-identical points
+static point2d_t slicer_edge_point(const float* p, const float* q, float z) {
+    if (q[0] < p[0] || (q[0] == p[0] && (q[1] < p[1] || (q[1] == p[1] && q[2] < p[2])))) {
+        const float* tmp = p;
+        p = q;
+        q = tmp;
+    }
     
-    sliced_model_t* model = malloc(sizeof(sliced_model_t));
-    if (!model) return NULL;
+    float t = (z - p[2]) / (q[2] - p[2]);
+    return (point2d_t){p[0] + t * (q[0] - p[0]), p[1] + t * (q[1] - p[1])};
+}
+
+int slice_triangle(const stl_triangle_t* triangle, float z, slice_segment_t* segment) {
+    if (!triangle || !segment) return 0;
     
-    model->params = *params;
-    model->num_layers = calculate_num_layers(stl, params->layer_height);
-    model->layers = malloc(model->num_layers * sizeof(layer_t));
+    // Vertices on the plane count as above, so every vertex has exactly one side
+    // and no triangle yields a point or a face-on-plane case
+    int above[3];
+    for (int j = 0; j < 3; j++) {
+        above[j] = triangle->vertices[j][2] >= z;
+    }
+    if (above[0] == above[1] && above[1] == above[2]) return 0;
     
-    if (!model->layers) {
-        free(model);
-        return NULL;
+    // Following the winding, the cut runs from the edge going down through the plane
+    // to the edge going up, which leaves the solid on the left
+    for (int j = 0; j < 3; j++) {
+        int k = (j + 1) % 3;
+        if (above[j] == above[k]) continue;
+        
+        point2d_t p = slicer_edge_point(triangle->vertices[j], triangle->vertices[k], z);
+        if (above[j]) {
+            segment->a = p;
+        } else {
+            segment->b = p;
+        }
     }
+    return 1;
+}
+
+// Hash from quantized endpoint to the first segment starting (or ending) there;
+// segments sharing a cell are linked through a next array
+typedef struct {
+    int64_t* cell_x;
+    int64_t* cell_y;
+    int* head;
+    size_t mask;
+} point_map_t;
+
+static int64_t quantize(float v) {
+    return (int64_t)floorf(v / SLICER_CHAIN_QUANTUM + 0.5f);
+}
+
+static int point_map_init(point_map_t* map, int num_points) {
+    size_t capacity = 64;
+    while (capacity < (size_t)num_points * 2) capacity *= 2;
+    map->mask = capacity - 1;
+    map->cell_x = malloc(capacity * sizeof(int64_t));
+    map->cell_y = malloc(capacity * sizeof(int64_t));
+    map->head = malloc(capacity * sizeof(int));
+    if (!map->cell_x || !map->cell_y || !map->head) return -1;
+    for (size_t i = 0; i < capacity; i++) map->head[i] = -1;
+    return 0;
+}
+
+static void point_map_free(point_map_t* map) {
+    free(map->cell_x);
+    free(map->cell_y);
+    free(map->head);
+}
+
+static int* point_map_slot(const point_map_t* map, int64_t x, int64_t y, int insert) {
+    uint64_t hash = (uint64_t)x * 0x9E3779B97F4A7C15ULL ^ (uint64_t)y * 0xC2B2AE3D27D4EB4FULL;
+    size_t slot = (size_t)(hash ^ (hash >> 29)) & map->mask;
     
-    // Initialize layers
-    for (int i = 0; i < model->num_layers; i++) {
-        model->layers[i].z_height = stl->bounds[2] + i * params->layer_height;
-        model->layers[i].contours = NULL;
-        model->layers[i].num_contours = 0;
-        model->layers[i].infill_points = NULL;
-        model->layers[i].num_infill_points = 0;
+    while (map->head[slot] >= 0) {
+        if (map->cell_x[slot] == x && map->cell_y[slot] == y) return &map->head[slot];
+        slot = (slot + 1) & map->mask;
     }
+    if (!insert) return NULL;
     
-    // Generate contours and infill for each layer using convex parts
-    for (int i = 0; i < model->num_layers; i++) {
-        // Generate contours for each convex part
-        for (unsigned int part_id = 0; part_id < decomp->num_parts; part_id++) {
-            generate_contours_with_convex_parts(&model->layers[i], stl, decomp, model->layers[i].z_height, part_id);
+    map->cell_x[slot] = x;
+    map->cell_y[slot] = y;
+    return &map->head[slot];
+}
+
+static void point_map_insert(point_map_t* map, int* next, point2d_t p, int segment) {
+    int* head = point_map_slot(map, quantize(p.x), quantize(p.y), 1);
+    next[segment] = *head;
+    *head = segment;
+}
+
+// Find the unused segment whose key point is closest to p, within the quantum.
+// Neighbouring cells catch points that straddle a cell boundary; an exact match
+// (the usual case, as shared edges give identical points) ends the search.
+static int point_map_find(const point_map_t* map, const int* next, const unsigned char* used,
+                          const slice_segment_t* segments, int use_end, point2d_t p) {
+    int64_t qx = quantize(p.x), qy = quantize(p.y);
+    int best = -1;
+    float best_distance = FLT_MAX;
+    
+    for (int64_t dy = -1; dy <= 1; dy++) {
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            int* head = point_map_slot(map, qx + dx, qy + dy, 0);
+            if (!head) continue;
+            
+            // Drop used segments from the front of the list as they are met; the last
+            // one stays so the slot keeps marking an occupied cell for probing
+            while (used[*head] && next[*head] >= 0) *head = next[*head];
+            
+            for (int s = *head; s >= 0; s = next[s]) {
+                if (used[s]) continue;
+                point2d_t q = use_end ? segments[s].b : segments[s].a;
+                float distance = fmaxf(fabsf(q.x - p.x), fabsf(q.y - p.y));
+                if (distance == 0.0f) return s;
+                if (distance <= SLICER_CHAIN_QUANTUM && distance < best_distance) {
+                    best = s;
+                    best_distance = distance;
+                }
+            }
         }
-        generate_infill(&model->layers[i], params);
     }
+    return best;
+}
+
+static int points_coincide(point2d_t p, point2d_t q) {
+    return fabsf(p.x - q.x) <= SLICER_CHAIN_QUANTUM && fabsf(p.y - q.y) <= SLICER_CHAIN_QUANTUM;
+}
+
+static int append_point(point2d_t** points, int* num_points, int* capacity, point2d_t p) {
+    if (*num_points == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        point2d_t* grown = realloc(*points, new_capacity * sizeof(point2d_t));
+        if (!grown) return -1;
+        *points = grown;
+        *capacity = new_capacity;
+    }
+    (*points)[(*num_points)++] = p;
+    return 0;
+}
+
+static void add_contour(layer_t* layer, const point2d_t* points, int num_points, int closed) {
+    contour_t* contours = realloc(layer->contours, (layer->num_contours + 1) * sizeof(contour_t));
+    if (!contours) return;
+    layer->contours = contours;
     
-    return model;
+    contour_t* contour = &layer->contours[layer->num_contours];
+    contour->points = malloc(num_points * sizeof(point2d_t));
+    if (!contour->points) return;
+    memcpy(contour->points, points, num_points * sizeof(point2d_t));
+    contour->num_points = num_points;
+    contour->closed = closed;
+    layer->num_contours++;
 }
 
-void generate_contours_with_bvh(layer_t* layer, const stl_file_t* stl, const spatial_partition_t* partition, 
-                               float z_height, unsigned int partition_id) {
-    if (!layer || !stl || !partition || partition_id >= partition->num_partitions) return;
+void chain_segments(layer_t* layer, const slice_segment_t* segments, int num_segments) {
+    if (!layer || !segments || num_segments <= 0) return;
     
-    // Get partition bounds
-    unsigned int base_idx = partition_id * 6;
-    float min_x = partition->partition_bounds[base_idx + 0];
-    float min_y = partition->partition_bounds[base_idx + 1];
-    float min_z = partition->partition_bounds[base_idx + 2];
-    float max_x = partition->partition_bounds[base_idx + 3];
-    float max_y = partition->partition_bounds[base_idx + 4];
-    float max_z = partition->partition_bounds[base_idx + 5];
+    unsigned char* used = calloc(num_segments, 1);
+    int* next_start = malloc(num_segments * sizeof(int));
+    int* next_end = malloc(num_segments * sizeof(int));
+    point_map_t starts = {0}, ends = {0};
+    point2d_t* forward = NULL;
+    point2d_t* backward = NULL;
+    int forward_capacity = 0, backward_capacity = 0;
     
-    // Check if this Z height intersects with the partition
-    if (z_height < min_z || z_height > max_z) return;
+    if (!used || !next_start || !next_end ||
+        point_map_init(&starts, num_segments) != 0 || point_map_init(&ends, num_segments) != 0) {
+        goto cleanup;
+    }
     
-    // Count triangles in this partition at this Z height
-    unsigned int triangles_in_partition = 0;
-    for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        if (partition->partition_ids[i] == partition_id) {
-            const stl_triangle_t* triangle = &stl->triangles[i];
-            
-            // Check if triangle intersects with Z plane
-            float min_triangle_z = triangle->vertices[0][2];
-            float max_triangle_z = triangle->vertices[0][2];
-            
-            for (int j = 1; j < 3; j++) {
-                if (triangle->vertices[j][2] < min_triangle_z) min_triangle_z = triangle->vertices[j][2];
-                if (triangle->vertices[j][2] > max_triangle_z) max_triangle_z = triangle->vertices[j][2];
+    // Index every segment by both endpoints. Zero-length segments (plane through a vertex)
+    // carry no edge; short ones are kept, or the loop they sit in could not close.
+    for (int i = 0; i < num_segments; i++) {
+        if (segments[i].a.x == segments[i].b.x && segments[i].a.y == segments[i].b.y) {
+            used[i] = 1;
+            continue;
+        }
+        point_map_insert(&starts, next_start, segments[i].a, i);
+        point_map_insert(&ends, next_end, segments[i].b, i);
+    }
+    
+    for (int seed = 0; seed < num_segments; seed++) {
+        if (used[seed]) continue;
+        used[seed] = 1;
+        
+        int num_forward = 0, num_backward = 0, closed = 0;
+        append_point(&forward, &num_forward, &forward_capacity, segments[seed].a);
+        append_point(&forward, &num_forward, &forward_capacity, segments[seed].b);
+        
+        // Walk forward from the end of the chain until it returns to its start. A segment
+        // running the wrong way (flipped facet) is taken reversed when nothing else continues.
+        for (;;) {
+            point2d_t tail = forward[num_forward - 1];
+            point2d_t next;
+            int s = point_map_find(&starts, next_start, used, segments, 0, tail);
+            if (s >= 0) {
+                next = segments[s].b;
+            } else {
+                s = point_map_find(&ends, next_end, used, segments, 1, tail);
+                if (s < 0) break;
+                next = segments[s].a;
+            }
+            used[s] = 1;
+            if (points_coincide(next, forward[0])) {
+                closed = 1;
+                break;
+            }
+            append_point(&forward, &num_forward, &forward_capacity, next);
+        }
+        
+        // Open chain (hole in the mesh): extend backwards from its start as well
+        if (!closed) {
+            point2d_t head = forward[0];
+            for (;;) {
+                int s = point_map_find(&ends, next_end, used, segments, 1, head);
+                if (s >= 0) {
+                    head = segments[s].a;
+                } else {
+                    s = point_map_find(&starts, next_start, used, segments, 0, head);
+                    if (s < 0) break;
+                    head = segments[s].b;
+                }
+                used[s] = 1;
+                append_point(&backward, &num_backward, &backward_capacity, head);
             }
             
-            if (z_height >= min_triangle_z && z_height <= max_triangle_z) {
-                triangles_in_partition++;
+            // Both walks stopped at the same point: the loop is closed after all
+            point2d_t first = num_backward > 0 ? backward[num_backward - 1] : forward[0];
+            if (num_backward + num_forward > 3 && points_coincide(first, forward[num_forward - 1])) {
+                closed = 1;
+                num_forward--;
             }
         }
+        
+        int num_points = num_backward + num_forward;
+        if (num_points < (closed ? 3 : 2)) continue;
+        
+        // Slivers around degenerate facets collapse to a point-sized two-point chain
+        if (num_points == 2) {
+            point2d_t first = num_backward > 0 ? backward[0] : forward[0];
+            point2d_t last = forward[num_forward - 1];
+            if (fabsf(first.x - last.x) <= 2.0f * SLICER_CHAIN_QUANTUM &&
+                fabsf(first.y - last.y) <= 2.0f * SLICER_CHAIN_QUANTUM) continue;
+        }
+        
+        if (num_backward > 0) {
+            // Backward points were collected in reverse order
+            point2d_t* points = malloc(num_points * sizeof(point2d_t));
+            if (!points) continue;
+            for (int i = 0; i < num_backward; i++) {
+                points[i] = backward[num_backward - 1 - i];
+            }
+            memcpy(points + num_backward, forward, num_forward * sizeof(point2d_t));
+            add_contour(layer, points, num_points, closed);
+            free(points);
+        } else {
+            add_contour(layer, forward, num_forward, closed);
+        }
     }
+
+cleanup:
+    free(forward);
+    free(backward);
+    point_map_free(&starts);
+    point_map_free(&ends);
+    free(used);
+    free(next_start);
+    free(next_end);
+}
+
+void generate_contours(layer_t* layer, const stl_file_t* stl, float z_height) {
+    if (!layer || !stl) return;
     
-    if (triangles_in_partition == 0) return;
+    // Cut every triangle spanning z_height, then chain the segments into loops
+    segment_list_t list = {0};
+    unsigned int* candidates = stl->soa ? malloc((stl->num_triangles + 1) * sizeof(unsigned int)) : NULL;
     
-    // Create contour for this partition
-    float margin = 2.0f; // Smaller margin for partitions
+    int status = 0;
+    if (candidates) {
+        unsigned int count = stl_soa_filter_z_range(stl->soa, z_height, candidates);
+        for (unsigned int i = 0; i < count && status == 0; i++) {
+            status = slice_triangle_into(&list, stl, candidates[i], z_height);
+        }
+    } else {
+        for (unsigned int i = 0; i < stl->num_triangles && status == 0; i++) {
+            status = slice_triangle_into(&list, stl, i, z_height);
+        }
+    }
     
-    // Expand layer contours array
-    layer->num_contours++;
-    layer->contours = realloc(layer->contours, layer->num_contours * sizeof(contour_t));
+    if (status == 0) {
+        chain_segments(layer, list.segments, list.num_segments);
+    } else {
+        fprintf(stderr, "Error: Failed to slice layer at Z=%.3f\n", z_height);
+    }
+    free(list.segments);
+    free(candidates);
+}
+
+static int collect_part_segments(segment_list_t* list, const stl_file_t* stl, const convex_part_t* part,
+                                 float z_height, unsigned int* candidates, unsigned int* stamps,
+                                 unsigned int stamp) {
+    // Check if this Z height intersects with the part
+    if (z_height < part->hull.bounds[2] || z_height > part->hull.bounds[5]) return 0;
     
-    contour_t* new_contour = &layer->contours[layer->num_contours - 1];
-    new_contour->num_points = 4;
-    new_contour->points = malloc(4 * sizeof(point2d_t));
+    unsigned int count = part->num_triangles;
+    const unsigned int* indices = part->triangle_indices;
+    if (stl->soa && candidates) {
+        // Vectorized z-range test, gathering the part's triangles from the SoA view
+        count = stl_soa_filter_z_range_subset(stl->soa, part->triangle_indices, part->num_triangles,
+                                              z_height, candidates);
+        indices = candidates;
+    }
     
-    // Create rectangular contour for this partition
-    new_contour->points[0] = (point2d_t){min_x - margin, min_y - margin};
-    new_contour->points[1] = (point2d_t){max_x + margin, min_y - margin};
-    new_contour->points[2] = (point2d_t){max_x + margin, max_y + margin};
-    new_contour->points[3] = (point2d_t){min_x - margin, max_y + margin};
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int triangle_idx = indices[i];
+        if (triangle_idx >= stl->num_triangles) continue;
+        
+        // A triangle shared by several parts is cut only once per layer
+        if (stamps) {
+            if (stamps[triangle_idx] == stamp) continue;
+            stamps[triangle_idx] = stamp;
+        }
+        if (slice_triangle_into(list, stl, triangle_idx, z_height) != 0) return -1;
+    }
+    return 0;
 }
 
-void generate_contours_with_convex_parts(layer_t* layer, const stl_file_t* stl, const convex_decomposition_t* decomp,
-                                        float z_height, unsigned int part_id) {
-    if (!layer || !stl || !decomp || part_id >= decomp->num_parts) return;
+sliced_model_t* slice_model_with_convex_decomposition(const stl_file_t* stl, const slicing_params_t* params,
+                                                     const convex_decomposition_t* decomp) {
+    if (!stl || !params || !decomp) return NULL;
     
-    const convex_part_t* part = decomp->parts[part_id];
-    if (!part || part->num_triangles == 0) return;
+    sliced_model_t* model = malloc(sizeof(sliced_model_t));
+    if (!model) return NULL;
     
-    // Check if this Z height intersects with the part
-    if (z_height < part->hull.bounds[2] || z_height > part->hull.bounds[5]) return;
+    if (init_model_layers(model, stl, params) != 0) {
+        free(model);
+        return NULL;
+    }
     
-    // Count triangles in this part at this Z height
-    unsigned int triangles_in_part = 0;
-    for (unsigned int i = 0; i < part->num_triangles; i++) {
-        unsigned int triangle_idx = part->triangle_indices[i];
-        const stl_triangle_t* triangle = &stl->triangles[triangle_idx];
-        
-        // Check if triangle intersects with Z plane
-        float min_triangle_z = triangle->vertices[0][2];
-        float max_triangle_z = triangle->vertices[0][2];
-        
-        for (int j = 1; j < 3; j++) {
-            if (triangle->vertices[j][2] < min_triangle_z) min_triangle_z = triangle->vertices[j][2];
-            if (triangle->vertices[j][2] > max_triangle_z) max_triangle_z = triangle->vertices[j][2];
+    unsigned int* stamps = calloc(stl->num_triangles + 1, sizeof(unsigned int));
+    unsigned int* valid = malloc(((size_t)stl->num_triangles + 1) * sizeof(unsigned int));
+    sweep_group_t group;
+    int status = (stamps && valid) ? sweep_group_init(&group, stl, decomp->num_parts) : -1;
+    
+    if (status == 0) {
+        // One sweep per part, skipping out-of-range indices and duplicates within a part
+        for (unsigned int part_id = 0; part_id < decomp->num_parts && status == 0; part_id++) {
+            const convex_part_t* part = decomp->parts[part_id];
+            if (!part || part->num_triangles == 0) continue;
+            
+            unsigned int count = 0;
+            for (unsigned int i = 0; i < part->num_triangles; i++) {
+                unsigned int triangle_idx = part->triangle_indices[i];
+                if (triangle_idx >= stl->num_triangles || stamps[triangle_idx] == part_id + 1) continue;
+                stamps[triangle_idx] = part_id + 1;
+                valid[count++] = triangle_idx;
+            }
+            status = sweep_group_add(&group, valid, count);
         }
         
-        if (z_height >= min_triangle_z && z_height <= max_triangle_z) {
-            triangles_in_part++;
+        // Parts may share triangles; they are cut once per layer
+        if (status == 0) {
+            status = slice_layers(model, stl, &group, 0, model->num_layers, 1);
         }
+        sweep_group_free(&group);
     }
     
-    if (triangles_in_part == 0) return;
+    free(stamps);
+    free(valid);
+    if (status != 0) {
+        fprintf(stderr, "Error: Failed to slice convex parts\n");
+        free_sliced_model(model);
+        return NULL;
+    }
+    finish_infill(model);
+    return model;
+}
+
+void generate_contours_with_bvh(layer_t* layer, const stl_file_t* stl, const spatial_partition_t* partition,
+                               float z_height, unsigned int partition_id) {
+    if (!layer || !stl || !partition || partition_id >= partition->num_partitions) return;
     
-    // Create contour for this convex part
-    float margin = 1.0f; // Smaller margin for convex parts
+    // Contours of this partition alone; loops cut by the partition boundary stay open
+    segment_list_t list = {0};
+    unsigned int* candidates = stl->soa ? malloc((stl->num_triangles + 1) * sizeof(unsigned int)) : NULL;
     
-    // Expand layer contours array
-    layer->num_contours++;
-    layer->contours = realloc(layer->contours, layer->num_contours * sizeof(contour_t));
+    if (collect_partition_segments(&list, stl, partition, z_height, partition_id, candidates) == 0) {
+        chain_segments(layer, list.segments, list.num_segments);
+    } else {
+        fprintf(stderr, "Error: Failed to slice layer at Z=%.3f\n", z_height);
+    }
+    
+    free(list.segments);
+    free(candidates);
+}
+
+void generate_contours_with_convex_parts(layer_t* layer, const stl_file_t* stl, const convex_decomposition_t* decomp,
+                                        float z_height, unsigned int part_id) {
+    if (!layer || !stl || !decomp || part_id >= decomp->num_parts) return;
     
-    contour_t* new_contour = &layer->contours[layer->num_contours - 1];
-    new_contour->num_points = 4;
-    new_contour->points = malloc(4 * sizeof(point2d_t));
+    const convex_part_t* part = decomp->parts[part_id];
+    if (!part || part->num_triangles == 0) return;
+    
+    // Contours of this part alone; loops cut by the part boundary stay open
+    segment_list_t list = {0};
+    unsigned int* candidates = stl->soa ? malloc((part->num_triangles + 1) * sizeof(unsigned int)) : NULL;
     
-    // Create rectangular contour based on part bounds
-    new_contour->points[0] = (point2d_t){part->hull.bounds[0] - margin, part->hull.bounds[1] - margin};
-    new_contour->points[1] = (point2d_t){part->hull.bounds[3] + margin, part->hull.bounds[1] - margin};
-    new_contour->points[2] = (point2d_t){part->hull.bounds[3] + margin, part->hull.bounds[4] + margin};
-    new_contour->points[3] = (point2d_t){part->hull.bounds[0] - margin, part->hull.bounds[4] + margin};
+    if (collect_part_segments(&list, stl, part, z_height, candidates, NULL, 0) == 0) {
+        chain_segments(layer, list.segments, list.num_segments);
+    } else {
+        fprintf(stderr, "Error: Failed to slice layer at Z=%.3f\n", z_height);
+    }
+    
+    free(list.segments);
+    free(candidates);
 }
 
-void generate_infill(layer_t* layer, const slicing_params_t* params) {
-    if (params->infill_density <= 0.0f) return;
+float extrusion_width(const slicing_params_t* params, float feature_width) {
+    if (feature_width > 0) return feature_width;
+    return params->nozzle_diameter > 0 ? params->nozzle_diameter : 0.4f;
+}
+
+// A squashed bead: a rectangle with semicircular sides, as tall as the layer. A layer
+// taller than the width would give a negative rectangle; that bead is a circle.
+float bead_area(float width, float height) {
+    if (width <= 0 || height <= 0) return 0.0f;
+    if (height > width) height = width;
+    return (width - height) * height + (float)M_PI * height * height / 4.0f;
+}
+
+// Adjacent beads overlap their rounded sides so that together they fill the layer
+float extrusion_spacing(const slicing_params_t* params, float feature_width, float height) {
+    float width = extrusion_width(params, feature_width);
+    return height > 0 ? bead_area(width, height) / height : width;
+}
+
+// The outer perimeter runs half a width inside the outline, so its bead ends on the
+// outline; further shells follow at bead spacing. Each shell is offset from the previous
+// one, which keeps every offset short: the raw offset of a dense contour grows much more
+// tangled with distance.
+void generate_shells(layer_t* layer, const slicing_params_t* params) {
+    if (!layer || !params || layer->num_contours == 0) return;
     
-    // Simple linear infill pattern
-    // In a real implementation, you would generate more sophisticated patterns
-    // like grid, honeycomb, triangles, etc.
+    float width = extrusion_width(params, params->perimeter_width);
+    float spacing = extrusion_spacing(params, params->perimeter_width, layer->thickness);
+    int num_shells = params->num_shells;
+    if (num_shells <= 0 && params->shell_thickness > 0) {
+        num_shells = 1 + (int)ceilf((params->shell_thickness - width) / spacing - 1e-3f);
+    }
     
-    float spacing = 10.0f / params->infill_density; // Base spacing of 10mm
-    if (spacing < 1.0f) spacing = 1.0f;
+    int capacity = layer->num_contours * (num_shells > 0 ? num_shells : 1) + 1;
+    layer->shells = calloc(capacity, sizeof(contour_t));
+    if (!layer->shells) return;
+    layer->num_shells = 0;
     
-    // Calculate infill area (simplified - using bounding box)
-    float min_x = layer->contours[0].points[0].x;
-    float max_x = layer->contours[0].points[2].x;
-    float min_y = layer->contours[0].points[0].y;
-    float max_y = layer->contours[0].points[2].y;
+    poly_set_t previous;
+    if (poly_set_from_contours(&previous, layer->contours, layer->num_contours) == 0) {
+        int k = 0;
+        for (; k < num_shells; k++) {
+            poly_set_t offset;
+            double step = (k == 0 ? 0.5 * width : spacing) * POLY_OFFSET_SCALE;
+            if (poly_offset(&previous, step, &offset) != 0) break;
+            poly_set_free(&previous);
+            previous = offset;
+            
+            contour_t* loops = NULL;
+            int num_loops = 0;
+            int status = poly_set_to_contours(&offset, &loops, &num_loops);
+            if (status != 0 || num_loops == 0) break;
+            
+            // A thin neck can split one loop into several
+            if (layer->num_shells + num_loops > capacity) {
+                int grown = (layer->num_shells + num_loops) * 2;
+                contour_t* shells = realloc(layer->shells, grown * sizeof(contour_t));
+                if (!shells) {
+                    for (int j = 0; j < num_loops; j++) free(loops[j].points);
+                    free(loops);
+                    break;
+                }
+                layer->shells = shells;
+                capacity = grown;
+            }
+            memcpy(&layer->shells[layer->num_shells], loops, num_loops * sizeof(contour_t));
+            layer->num_shells += num_loops;
+            free(loops);
+        }
+        
+        // Infill fills the outline itself, or starts half a spacing inside the innermost shell
+        if (num_shells <= 0) {
+            poly_set_to_contours(&previous, &layer->infill_region, &layer->num_infill_region);
+        } else if (k == num_shells) {
+            poly_set_t region;
+            if (poly_offset(&previous, 0.5 * spacing * POLY_OFFSET_SCALE, &region) == 0) {
+                poly_set_to_contours(&region, &layer->infill_region, &layer->num_infill_region);
+                poly_set_free(&region);
+            }
+        }
+        poly_set_free(&previous);
+    }
     
-    int num_lines = (int)((max_x - min_x) / spacing) + 1;
-    layer->num_infill_points = num_lines * 2; // Start and end points for each line
-    layer->infill_points = malloc(layer->num_infill_points * sizeof(point2d_t));
+    // Open chains from broken meshes cannot be offset; print them as they are
+    for (int i = 0; i < layer->num_contours; i++) {
+        const contour_t* contour = &layer->contours[i];
+        if (contour->closed) continue;
+        
+        if (layer->num_shells == capacity) {
+            contour_t* shells = realloc(layer->shells, capacity * 2 * sizeof(contour_t));
+            if (!shells) return;
+            layer->shells = shells;
+            capacity *= 2;
+        }
+        contour_t* copy = &layer->shells[layer->num_shells];
+        copy->points = malloc(contour->num_points * sizeof(point2d_t));
+        if (!copy->points) return;
+        memcpy(copy->points, contour->points, contour->num_points * sizeof(point2d_t));
+        copy->num_points = contour->num_points;
+        copy->closed = 0;
+        layer->num_shells++;
+    }
+}
+
+// Clip the model's infill pattern to the region left inside the shells. Contours may
+// overlap on broken meshes, so params->infill_rule decides what counts as inside.
+void generate_infill(layer_t* layer, int layer_index, const struct infill_plan* plan,
+                     const slicing_params_t* params) {
+    if (!plan || params->infill_density <= 0.0f || layer->num_infill_region == 0) return;
     
-    for (int i = 0; i < num_lines; i++) {
-        float x = min_x + i * spacing;
-        layer->infill_points[i * 2] = (point2d_t){x, min_y};
-        layer->infill_points[i * 2 + 1] = (point2d_t){x, max_y};
+    point2d_t* points = NULL;
+    int num_points = 0;
+    if (infill_plan_fill(plan, layer->infill_region, layer->num_infill_region, layer_index, layer->z_height,
+                         params->infill_rule, &points, &num_points) != 0) {
+        fprintf(stderr, "Warning: Could not generate infill at Z=%.3f\n", layer->z_height);
+        free(points);
+        return;
     }
+    layer->infill_points = points;
+    layer->num_infill_points = num_points;
 }
 
 void print_slicing_info(const sliced_model_t* model) {
     printf("Slicing Information:\n");
     printf("Number of layers: %d\n", model->num_layers);
-    printf("Layer height: %.3f mm\n", model->params.layer_height);
+    if (model->params.cusp_height > 0 && model->num_layers > 0) {
+        float thinnest = model->layers[0].thickness;
+        float thickest = model->layers[0].thickness;
+        for (int i = 1; i < model->num_layers; i++) {
+            thinnest = fminf(thinnest, model->layers[i].thickness);
+            thickest = fmaxf(thickest, model->layers[i].thickness);
+        }
+        printf("Layer height: adaptive %.3f-%.3f mm (cusp height %.3f mm)\n",
+               thinnest, thickest, model->params.cusp_height);
+    } else {
+        printf("Layer height: %.3f mm\n", model->params.layer_height);
+    }
     printf("Infill density: %.1f%%\n", model->params.infill_density * 100.0f);
     printf("Shell thickness: %.3f mm\n", model->params.shell_thickness);
     printf("Print speed: %.1f mm/s\n", model->params.print_speed);
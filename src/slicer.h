@@ -4,6 +4,23 @@
 #include "stl_parser.h"
 #include "bvh.h"
 #include "convex_decomposition.h"
+#include "thread_pool.h"
+
+// Which spans between infill crossings are inside the region
+typedef enum {
+    INFILL_RULE_NONZERO = 0,    // Inside wherever the winding number is not zero
+    INFILL_RULE_EVEN_ODD        // Inside after an odd number of crossings
+} infill_rule_t;
+
+// Infill patterns; see infill.c for how each is built
+typedef enum {
+    INFILL_PATTERN_RECTILINEAR = 0, // Parallel lines, direction alternating by layer
+    INFILL_PATTERN_GRID,
+    INFILL_PATTERN_TRIANGLES,
+    INFILL_PATTERN_CUBIC,           // Three line sets shifting with z into stacked cubes
+    INFILL_PATTERN_GYROID,
+    INFILL_PATTERN_LIGHTNING        // Branching trees under top surfaces only; see lightning.c
+} infill_pattern_t;
 
 // Slicing parameters
 typedef struct {
@@ -15,24 +32,57 @@ typedef struct {
     float travel_speed;     // Travel speed (mm/s)
     float nozzle_diameter;  // Nozzle diameter (mm)
     float filament_diameter; // Filament diameter (mm)
+    float cusp_height;      // Adaptive layers: largest stair-step allowed (mm), 0 = fixed layer_height
+    float min_layer_height; // Adaptive layer bounds (mm)
+    float max_layer_height;
+    infill_rule_t infill_rule; // How infill treats overlapping or nested contours
+    infill_pattern_t infill_pattern;
+    float arc_tolerance;    // Arc fitting: largest deviation from the sliced path (mm), 0 = G1 only
+    float perimeter_width;  // Extrusion widths (mm), 0 = nozzle diameter
+    float infill_width;
+    float perimeter_flow;   // Extrusion multipliers, 0 = 1
+    float infill_flow;
+    int relative_e;         // Write relative extrusion (M83) instead of absolute
+    thread_pool_t* pool;    // Workers for per-layer slicing (NULL = serial)
 } slicing_params_t;
 
-// Point structure for 2D coordinates
-typedef struct {
-    float x, y;
-} point2d_t;
+// Endpoints closer than this (mm) are joined when chaining slice segments
+#define SLICER_CHAIN_QUANTUM 1e-4f
+
+// Layer blocks per worker when slicing in parallel; more blocks balance better,
+// fewer blocks re-enter the sweep less often
+#define SLICER_BLOCKS_PER_THREAD 4
+
+// Layers per worker that slice_cursor_next slices at a time
+#define SLICER_CURSOR_LAYERS_PER_WORKER 16
+
+// Resolution of the adaptive height profile, in bins per minimum layer height
+#define SLICER_ADAPTIVE_BINS_PER_MIN_LAYER 4
 
-// Contour structure (closed loop of points)
+// point2d_t comes from convex_decomposition.h
+
+// Contour structure (closed loop of points, or an open polyline on broken meshes)
 typedef struct {
     point2d_t* points;
     int num_points;
+    int closed;             // 0 when the chain could not be closed
 } contour_t;
 
+// Directed segment from cutting one triangle; outer loops run counter-clockwise
+typedef struct {
+    point2d_t a, b;
+} slice_segment_t;
+
 // Layer structure
 typedef struct {
-    float z_height;         // Z height of this layer
+    float z_height;         // Z height of this layer (its top)
+    float thickness;        // Height of this layer; varies with adaptive layers
     contour_t* contours;    // Array of contours (outer shell + holes)
     int num_contours;       // Number of contours
+    contour_t* shells;      // Perimeters, outermost first; open contours are copied as they are
+    int num_shells;         // Number of perimeter loops
+    contour_t* infill_region; // Area inside the innermost perimeter, set by generate_shells
+    int num_infill_region;
     point2d_t* infill_points; // Infill pattern points
     int num_infill_points;  // Number of infill points
 } layer_t;
@@ -42,22 +92,50 @@ typedef struct {
     layer_t* layers;        // Array of layers
     int num_layers;         // Number of layers
     slicing_params_t params; // Slicing parameters
+    struct infill_plan* infill_plan; // Infill line sets and tiles, built once per model
 } sliced_model_t;
 
+// Incremental slicing: layers come out bottom-up a block at a time, so a pipeline can
+// use and free each one before the layers above it are sliced
+typedef struct slice_cursor slice_cursor_t;
+
 // Function declarations
 sliced_model_t* slice_model(const stl_file_t* stl, const slicing_params_t* params);
 sliced_model_t* slice_model_with_bvh(const stl_file_t* stl, const slicing_params_t* params, 
                                     const spatial_partition_t* partition);
 sliced_model_t* slice_model_with_convex_decomposition(const stl_file_t* stl, const slicing_params_t* params,
                                                      const convex_decomposition_t* decomp);
+sliced_model_t* slice_model_streaming(const char* filename, const slicing_params_t* params,
+                                      unsigned int layers_per_band);
 void free_sliced_model(sliced_model_t* model);
+void free_layer(layer_t* layer); // Contents only; the layer stays in its model, empty
+
+// Cursors over a loaded mesh, or over a binary STL streamed in bands of layers_per_band
+// layers. The model's layers all exist from the start but stay empty until sliced, and
+// lightning infill, which needs every layer, is never generated.
+slice_cursor_t* slice_cursor_create(const stl_file_t* stl, const slicing_params_t* params);
+slice_cursor_t* slice_cursor_create_streaming(const char* filename, const slicing_params_t* params,
+                                              unsigned int layers_per_band);
+sliced_model_t* slice_cursor_model(const slice_cursor_t* cursor);
+// Slice the next block of layers into [*first, *last); returns 1, 0 when every layer is
+// done, or -1 on failure
+int slice_cursor_next(slice_cursor_t* cursor, int* first, int* last);
+void slice_cursor_free(slice_cursor_t* cursor); // Frees the model too
 int calculate_num_layers(const stl_file_t* stl, float layer_height);
+float* compute_adaptive_layer_heights(const stl_file_t* stl, const slicing_params_t* params, int* num_layers);
 void generate_contours(layer_t* layer, const stl_file_t* stl, float z_height);
 void generate_contours_with_bvh(layer_t* layer, const stl_file_t* stl, const spatial_partition_t* partition, 
                                float z_height, unsigned int partition_id);
 void generate_contours_with_convex_parts(layer_t* layer, const stl_file_t* stl, const convex_decomposition_t* decomp,
                                         float z_height, unsigned int part_id);
-void generate_infill(layer_t* layer, const slicing_params_t* params);
+int slice_triangle(const stl_triangle_t* triangle, float z, slice_segment_t* segment);
+void chain_segments(layer_t* layer, const slice_segment_t* segments, int num_segments);
+float extrusion_width(const slicing_params_t* params, float feature_width); // feature_width, else the nozzle's
+float bead_area(float width, float height); // Cross-section of one extruded line (mm^2)
+float extrusion_spacing(const slicing_params_t* params, float feature_width, float height);
+void generate_shells(layer_t* layer, const slicing_params_t* params);
+void generate_infill(layer_t* layer, int layer_index, const struct infill_plan* plan,
+                     const slicing_params_t* params);
 void print_slicing_info(const sliced_model_t* model);
 
 #endif // SLICER_H 
\ No newline at end of file
@@ -1,105 +1,454 @@
+#define _POSIX_C_SOURCE 200809L
 #include "stl_parser.h"
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static int stl_is_space(char c);
+static const char* stl_find_keyword(const char* p, const char* end, const char* keyword, size_t length);
+
+stl_load_options_t stl_default_load_options(void) {
+    stl_load_options_t options = {
+        .keep_mapping = 0,
+        .num_threads = 0,
+        .weld_vertices = 1,
+        .weld_epsilon = STL_DEFAULT_WELD_EPSILON,
+        .build_soa = 1
+    };
+    return options;
+}
 
 stl_file_t* stl_load_file(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
+    stl_load_options_t options = stl_default_load_options();
+    return stl_load_file_with_options(filename, &options);
+}
+
+stl_file_t* stl_load_file_with_options(const char* filename, const stl_load_options_t* options) {
+    size_t size = 0;
+    unsigned char* data = stl_map_file(filename, &size);
+    if (!data) {
         fprintf(stderr, "Error: Cannot open file %s\n", filename);
         return NULL;
     }
 
-    stl_file_t* stl = malloc(sizeof(stl_file_t));
+    stl_file_t* stl = calloc(1, sizeof(stl_file_t));
     if (!stl) {
-        fclose(file);
+        stl_unmap_file(data, size);
         return NULL;
     }
 
-    // Read header to determine if ASCII or binary
-    if (fread(stl->header, 1, 80, file) != 80) {
-        fprintf(stderr, "Error: Cannot read STL header\n");
-        free(stl);
-        fclose(file);
+    memcpy(stl->header, data, size < 80 ? size : 80);
+
+    // Pick the parser from the file size, not the "solid" prefix
+    stl->format = stl_detect_format(data, size);
+    if (stl->format == STL_FORMAT_UNKNOWN) {
+        fprintf(stderr, "Error: %s is neither a binary nor an ASCII STL file\n", filename);
+        stl_unmap_file(data, size);
+        stl_free(stl);
         return NULL;
     }
-
-    // Check if it's ASCII STL (starts with "solid")
-    if (strncmp(stl->header, "solid", 5) == 0) {
-        if (stl_parse_ascii(file, stl) != 0) {
+    
+    if (stl->format == STL_FORMAT_ASCII) {
+        int num_threads = options ? options->num_threads : 0;
+        int result = stl_parse_ascii_buffer((const char*)data, size, stl, num_threads);
+        stl_unmap_file(data, size);
+        if (result != 0) {
             fprintf(stderr, "Error: Failed to parse ASCII STL\n");
-            free(stl);
-            fclose(file);
+            stl_free(stl);
             return NULL;
         }
     } else {
-        if (stl_parse_binary(file, stl) != 0) {
+        int keep_mapping = options ? options->keep_mapping : 0;
+        if (stl_parse_binary_buffer(data, size, stl, keep_mapping) != 0) {
             fprintf(stderr, "Error: Failed to parse binary STL\n");
-            free(stl);
-            fclose(file);
+            stl_unmap_file(data, size);
+            stl_free(stl);
             return NULL;
         }
+
+        if (keep_mapping) {
+            // Facets are read straight out of the mapping for the lifetime of stl
+            stl->mapping = data;
+            stl->mapping_size = size;
+        } else {
+            stl_unmap_file(data, size);
+        }
+    }
+
+    if (options && options->weld_vertices) {
+        if (stl_weld_vertices(stl, options->weld_epsilon) != 0) {
+            fprintf(stderr, "Warning: Vertex welding failed, continuing without indexed mesh\n");
+        }
+    }
+
+    if (options && options->build_soa) {
+        if (stl_build_soa(stl) != 0) {
+            fprintf(stderr, "Warning: Failed to build SoA view, using scalar kernels\n");
+        }
     }
 
-    fclose(file);
     stl_calculate_bounds(stl);
     return stl;
 }
 
+stl_format_t stl_detect_format(const unsigned char* data, size_t size) {
+    if (!data || size == 0) return STL_FORMAT_UNKNOWN;
+    
+    // A binary file whose size matches its facet count exactly is binary,
+    // even when an exporter wrote "solid" into the header
+    uint32_t count = 0;
+    if (size >= STL_HEADER_SIZE) {
+        memcpy(&count, data + 80, sizeof(count));
+        if ((uint64_t)STL_HEADER_SIZE + (uint64_t)count * STL_FACET_SIZE == (uint64_t)size) {
+            return STL_FORMAT_BINARY;
+        }
+    }
+    
+    // Otherwise probe the start of the file for ASCII tokens
+    size_t probe = size < STL_FORMAT_PROBE_BYTES ? size : STL_FORMAT_PROBE_BYTES;
+    const char* text = (const char*)data;
+    size_t pos = 0;
+    while (pos < probe && stl_is_space(text[pos])) pos++;
+    
+    if (probe - pos >= 5 && memcmp(text + pos, "solid", 5) == 0 && !memchr(text, '\0', probe)) {
+        const char* end = text + probe;
+        if (stl_find_keyword(text + pos + 5, end, "facet", 5) ||
+            stl_find_keyword(text + pos + 5, end, "endsolid", 8) ||
+            size <= STL_FORMAT_PROBE_BYTES) {
+            return STL_FORMAT_ASCII;
+        }
+    }
+    
+    // Binary with trailing bytes or a bad count; the binary parser validates the size
+    if (size >= STL_HEADER_SIZE) {
+        return STL_FORMAT_BINARY;
+    }
+    
+    return STL_FORMAT_UNKNOWN;
+}
+
+const char* stl_format_name(stl_format_t format) {
+    switch (format) {
+        case STL_FORMAT_ASCII: return "ASCII";
+        case STL_FORMAT_BINARY: return "binary";
+        default: return "unknown";
+    }
+}
+
 void stl_free(stl_file_t* stl) {
     if (stl) {
         if (stl->triangles) {
             free(stl->triangles);
         }
+        if (stl->mapping) {
+            stl_unmap_file(stl->mapping, stl->mapping_size);
+        }
+        if (stl->vertices) {
+            free(stl->vertices);
+        }
+        if (stl->indices) {
+            free(stl->indices);
+        }
+        stl_free_soa(stl->soa);
         free(stl);
     }
 }
 
 int stl_parse_ascii(FILE* file, stl_file_t* stl) {
-    // Reset file position after header
+    // Read the whole file and hand it to the single-pass buffer parser
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
     fseek(file, 0, SEEK_SET);
+    if (length < 0) {
+        return -1;
+    }
     
-    char line[256];
-    int triangle_count = 0;
+    char* buffer = malloc((size_t)length + 1);
+    if (!buffer) {
+        return -1;
+    }
+    if (fread(buffer, 1, (size_t)length, file) != (size_t)length) {
+        free(buffer);
+        return -1;
+    }
     
-    // Count triangles first
-    while (fgets(line, sizeof(line), file)) {
-        if (strstr(line, "facet normal")) {
-            triangle_count++;
+    int result = stl_parse_ascii_buffer(buffer, (size_t)length, stl, 0);
+    free(buffer);
+    return result;
+}
+
+// Powers of ten that are exact in double precision
+static const double stl_pow10_table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int stl_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Parse one decimal float ([+-]digits[.digits][(e|E)[+-]digits]) without sscanf/locale.
+// Returns the position after the number, or NULL if no number starts at p.
+static const char* stl_scan_float(const char* p, const char* end, float* out) {
+    while (p < end && stl_is_space(*p)) p++;
+    if (p >= end) return NULL;
+    
+    int negative = 0;
+    if (*p == '-' || *p == '+') {
+        negative = (*p == '-');
+        p++;
+    }
+    
+    uint64_t mantissa = 0;
+    int digits = 0;      // Significant digits accumulated into mantissa
+    int exponent = 0;    // Decimal exponent applied to mantissa
+    int seen_digit = 0;
+    
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+        seen_digit = 1;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+            seen_digit = 1;
+            p++;
         }
     }
+    if (!seen_digit) return NULL;
     
-    stl->num_triangles = triangle_count;
-    stl->triangles = malloc(triangle_count * sizeof(stl_triangle_t));
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = (*q == '-');
+            q++;
+        }
+        if (q < end && *q >= '0' && *q <= '9') {
+            int exp_value = 0;
+            while (q < end && *q >= '0' && *q <= '9') {
+                if (exp_value < 10000) exp_value = exp_value * 10 + (*q - '0');
+                q++;
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = q;
+        }
+    }
     
-    if (!stl->triangles) {
-        return -1;
+    double value = (double)mantissa;
+    if (exponent != 0 && mantissa != 0) {
+        if (exponent > 0 && exponent <= 22) {
+            value *= stl_pow10_table[exponent];
+        } else if (exponent < 0 && exponent >= -22) {
+            value /= stl_pow10_table[-exponent];
+        } else {
+            value *= pow(10.0, exponent);
+        }
     }
     
-    // Reset and parse
-    fseek(file, 0, SEEK_SET);
-    int current_triangle = 0;
-    
-    while (fgets(line, sizeof(line), file) && current_triangle < triangle_count) {
-        if (strstr(line, "facet normal")) {
-            sscanf(line, "facet normal %f %f %f", 
-                   &stl->triangles[current_triangle].normal[0],
-                   &stl->triangles[current_triangle].normal[1],
-                   &stl->triangles[current_triangle].normal[2]);
-        } else if (strstr(line, "vertex")) {
-            int vertex_idx = 0;
-            if (strstr(line, "outer loop")) {
-                // Read three vertices
-                for (int i = 0; i < 3; i++) {
-                    fgets(line, sizeof(line), file);
-                    sscanf(line, "vertex %f %f %f",
-                           &stl->triangles[current_triangle].vertices[i][0],
-                           &stl->triangles[current_triangle].vertices[i][1],
-                           &stl->triangles[current_triangle].vertices[i][2]);
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+// Find the next occurrence of a keyword followed by whitespace
+static const char* stl_find_keyword(const char* p, const char* end, const char* keyword, size_t length) {
+    while (p + length < end) {
+        const char* hit = memchr(p, keyword[0], (size_t)(end - p) - length);
+        if (!hit) return NULL;
+        if (memcmp(hit, keyword, length) == 0 && stl_is_space(hit[length])) {
+            return hit;
+        }
+        p = hit + 1;
+    }
+    return NULL;
+}
+
+// Triangles parsed from one chunk of an ASCII file
+typedef struct {
+    const char* begin;
+    const char* end;
+    stl_triangle_t* triangles;
+    unsigned int num_triangles;
+    unsigned int capacity;
+    int status;
+} stl_ascii_chunk_t;
+
+static int stl_ascii_chunk_push(stl_ascii_chunk_t* chunk, const stl_triangle_t* triangle) {
+    if (chunk->num_triangles >= chunk->capacity) {
+        unsigned int capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+        stl_triangle_t* grown = realloc(chunk->triangles, (size_t)capacity * sizeof(stl_triangle_t));
+        if (!grown) return -1;
+        chunk->triangles = grown;
+        chunk->capacity = capacity;
+    }
+    chunk->triangles[chunk->num_triangles++] = *triangle;
+    return 0;
+}
+
+static void* stl_parse_ascii_chunk(void* arg) {
+    stl_ascii_chunk_t* chunk = (stl_ascii_chunk_t*)arg;
+    const char* start = chunk->begin;
+    const char* end = chunk->end;
+    const char* p = start;
+    
+    // Rough guess: a facet takes ~250 bytes of text
+    chunk->capacity = (unsigned int)((end - start) / 250) + 16;
+    chunk->triangles = malloc((size_t)chunk->capacity * sizeof(stl_triangle_t));
+    if (!chunk->triangles) {
+        chunk->status = -1;
+        return NULL;
+    }
+    
+    while ((p = stl_find_keyword(p, end, "facet", 5)) != NULL) {
+        // "endfacet" also ends in "facet"
+        if (p - start >= 3 && memcmp(p - 3, "end", 3) == 0) {
+            p += 5;
+            continue;
+        }
+        p += 5;
+        
+        stl_triangle_t triangle;
+        memset(&triangle, 0, sizeof(triangle));
+        
+        const char* q = p;
+        while (q < end && stl_is_space(*q)) q++;
+        if (end - q >= 6 && memcmp(q, "normal", 6) == 0) {
+            q += 6;
+            for (int k = 0; k < 3; k++) {
+                q = stl_scan_float(q, end, &triangle.normal[k]);
+                if (!q) {
+                    chunk->status = -1;
+                    return NULL;
+                }
+            }
+        }
+        p = q;
+        
+        for (int v = 0; v < 3; v++) {
+            p = stl_find_keyword(p, end, "vertex", 6);
+            if (!p) {
+                chunk->status = -1;
+                return NULL;
+            }
+            p += 6;
+            for (int k = 0; k < 3; k++) {
+                p = stl_scan_float(p, end, &triangle.vertices[v][k]);
+                if (!p) {
+                    chunk->status = -1;
+                    return NULL;
                 }
-                current_triangle++;
             }
         }
+        
+        if (stl_ascii_chunk_push(chunk, &triangle) != 0) {
+            chunk->status = -1;
+            return NULL;
+        }
     }
     
-    return 0;
+    chunk->status = 0;
+    return NULL;
+}
+
+int stl_parse_ascii_buffer(const char* data, size_t size, stl_file_t* stl, int num_threads) {
+    if (!data || !stl) return -1;
+    
+    if (num_threads <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (int)online : 1;
+#else
+        num_threads = 1;
+#endif
+    }
+    // Small files are not worth the thread start-up cost
+    if (size < STL_ASCII_PARALLEL_MIN_BYTES) num_threads = 1;
+    if (num_threads > STL_ASCII_MAX_THREADS) num_threads = STL_ASCII_MAX_THREADS;
+    
+    stl_ascii_chunk_t chunks[STL_ASCII_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    
+    // Split at "endfacet" boundaries so no facet straddles two chunks
+    const char* end = data + size;
+    const char* begin = data;
+    int num_chunks = 0;
+    for (int t = 0; t < num_threads && begin < end; t++) {
+        const char* split = end;
+        if (t < num_threads - 1) {
+            const char* target = data + (size / (size_t)num_threads) * (size_t)(t + 1);
+            if (target < begin) target = begin;
+            const char* hit = stl_find_keyword(target, end, "endfacet", 8);
+            split = hit ? hit + 8 : end;
+        }
+        chunks[num_chunks].begin = begin;
+        chunks[num_chunks].end = split;
+        num_chunks++;
+        begin = split;
+    }
+    
+    pthread_t threads[STL_ASCII_MAX_THREADS];
+    int started[STL_ASCII_MAX_THREADS] = {0};
+    for (int t = 1; t < num_chunks; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, stl_parse_ascii_chunk, &chunks[t]) == 0);
+        if (!started[t]) stl_parse_ascii_chunk(&chunks[t]);
+    }
+    if (num_chunks > 0) stl_parse_ascii_chunk(&chunks[0]);
+    for (int t = 1; t < num_chunks; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+    
+    // Concatenate the per-chunk results in file order
+    int status = 0;
+    size_t total = 0;
+    for (int t = 0; t < num_chunks; t++) {
+        if (chunks[t].status != 0) status = -1;
+        total += chunks[t].num_triangles;
+    }
+    
+    stl->num_triangles = (unsigned int)total;
+    stl->format = STL_FORMAT_ASCII;
+    stl->triangles = NULL;
+    if (status == 0 && total > 0) {
+        stl->triangles = malloc(total * sizeof(stl_triangle_t));
+        if (!stl->triangles) {
+            status = -1;
+        } else {
+            size_t offset = 0;
+            for (int t = 0; t < num_chunks; t++) {
+                memcpy(stl->triangles + offset, chunks[t].triangles,
+                       (size_t)chunks[t].num_triangles * sizeof(stl_triangle_t));
+                offset += chunks[t].num_triangles;
+            }
+        }
+    }
+    
+    for (int t = 0; t < num_chunks; t++) {
+        free(chunks[t].triangles);
+    }
+    
+    if (status != 0) stl->num_triangles = 0;
+    return status;
 }
 
 int stl_parse_binary(FILE* file, stl_file_t* stl) {
@@ -110,37 +459,611 @@ int stl_parse_binary(FILE* file, stl_file_t* stl) {
     if (fread(&stl->num_triangles, sizeof(unsigned int), 1, file) != 1) {
         return -1;
     }
+    stl->format = STL_FORMAT_BINARY;
     
     // Allocate memory for triangles
-    stl->triangles = malloc(stl->num_triangles * sizeof(stl_triangle_t));
-    if (!stl->triangles) {
+    stl->triangles = malloc((size_t)stl->num_triangles * sizeof(stl_triangle_t));
+    if (!stl->triangles && stl->num_triangles > 0) {
         return -1;
     }
     
-    // Read all triangles
-    for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        // Read normal vector
-        if (fread(stl->triangles[i].normal, sizeof(float), 3, file) != 3) {
+    // Read facets in large blocks instead of one fread per field
+    enum { FACETS_PER_BLOCK = 4096 };
+    unsigned char* block = malloc(FACETS_PER_BLOCK * STL_FACET_SIZE);
+    if (!block) {
+        return -1;
+    }
+    
+    unsigned int done = 0;
+    while (done < stl->num_triangles) {
+        unsigned int count = stl->num_triangles - done;
+        if (count > FACETS_PER_BLOCK) count = FACETS_PER_BLOCK;
+        
+        if (fread(block, STL_FACET_SIZE, count, file) != count) {
+            free(block);
             return -1;
         }
+        for (unsigned int i = 0; i < count; i++) {
+            memcpy(&stl->triangles[done + i], block + (size_t)i * STL_FACET_SIZE, sizeof(stl_triangle_t));
+        }
+        done += count;
+    }
+    
+    free(block);
+    return 0;
+}
+
+int stl_parse_binary_buffer(const unsigned char* data, size_t size, stl_file_t* stl, int keep_mapping) {
+    if (!data || !stl || size < STL_HEADER_SIZE) {
+        return -1;
+    }
+    
+    uint32_t count;
+    memcpy(&count, data + 80, sizeof(count));
+    
+    // Validate the whole facet table up front so the copy loop needs no checks
+    if ((uint64_t)(size - STL_HEADER_SIZE) < (uint64_t)count * STL_FACET_SIZE) {
+        fprintf(stderr, "Error: Binary STL truncated (%u facets need %llu bytes, file has %llu)\n",
+                count, (unsigned long long)STL_HEADER_SIZE + (unsigned long long)count * STL_FACET_SIZE,
+                (unsigned long long)size);
+        return -1;
+    }
+    
+    stl->num_triangles = count;
+    stl->format = STL_FORMAT_BINARY;
+    stl->facets = data + STL_HEADER_SIZE;
+    stl->triangles = NULL;
+    
+    if (keep_mapping) {
+        return 0;
+    }
+    
+    return stl_materialize_triangles(stl);
+}
+
+void stl_get_triangle_corners(const stl_file_t* stl, unsigned int index, stl_triangle_t* triangle) {
+    if (stl->triangles) {
+        memcpy(triangle->vertices, stl->triangles[index].vertices, sizeof(triangle->vertices));
+    } else if (stl->facets) {
+        // The vertices follow the 3-float normal in each facet
+        memcpy(triangle->vertices, stl->facets + (size_t)index * STL_FACET_SIZE + 3 * sizeof(float),
+               sizeof(triangle->vertices));
+    } else {
+        const uint32_t* corners = &stl->indices[(size_t)index * 3];
+        for (int j = 0; j < 3; j++) {
+            memcpy(triangle->vertices[j], &stl->vertices[(size_t)corners[j] * 3], 3 * sizeof(float));
+        }
+    }
+}
+
+void stl_get_triangle(const stl_file_t* stl, unsigned int index, stl_triangle_t* triangle) {
+    if (stl->triangles) {
+        *triangle = stl->triangles[index];
+    } else if (stl->facets) {
+        // Normal and vertices are 12 contiguous floats at the start of each facet
+        memcpy(triangle, stl->facets + (size_t)index * STL_FACET_SIZE, sizeof(stl_triangle_t));
+    } else {
+        // Welded mesh: gather the corners, the normal follows the winding
+        stl_get_triangle_corners(stl, index, triangle);
+        
+        float e1[3], e2[3];
+        for (int k = 0; k < 3; k++) {
+            e1[k] = triangle->vertices[1][k] - triangle->vertices[0][k];
+            e2[k] = triangle->vertices[2][k] - triangle->vertices[0][k];
+        }
+        float nx = e1[1] * e2[2] - e1[2] * e2[1];
+        float ny = e1[2] * e2[0] - e1[0] * e2[2];
+        float nz = e1[0] * e2[1] - e1[1] * e2[0];
+        float length = sqrtf(nx * nx + ny * ny + nz * nz);
+        if (length > 0.0f) {
+            nx /= length;
+            ny /= length;
+            nz /= length;
+        }
+        triangle->normal[0] = nx;
+        triangle->normal[1] = ny;
+        triangle->normal[2] = nz;
+    }
+}
+
+// Drop the per-facet storage once another form carries the geometry
+static void stl_release_facets(stl_file_t* stl) {
+    free(stl->triangles);
+    stl->triangles = NULL;
+    stl->facets = NULL;
+    if (stl->mapping) {
+        stl_unmap_file(stl->mapping, stl->mapping_size);
+        stl->mapping = NULL;
+        stl->mapping_size = 0;
+    }
+}
+
+int stl_materialize_triangles(stl_file_t* stl) {
+    if (!stl) return -1;
+    if (stl->triangles || stl->num_triangles == 0) return 0;
+    if (!stl->facets && !stl->indices) return -1;
+    
+    stl_triangle_t* triangles = malloc((size_t)stl->num_triangles * sizeof(stl_triangle_t));
+    if (!triangles) {
+        return -1;
+    }
+    
+    // Copy from the mapping, or expand the welded mesh
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        stl_get_triangle(stl, i, &triangles[i]);
+    }
+    
+    // The copy is now authoritative; release the mapping if we own one
+    stl_release_facets(stl);
+    stl->triangles = triangles;
+    
+    return 0;
+}
+
+void* stl_map_file(const char* filename, size_t* size) {
+    if (!filename || !size) return NULL;
+    
+#ifdef _WIN32
+    // No mmap: read the whole file into memory in a single call
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    void* data = malloc((size_t)length);
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    
+    *size = (size_t)length;
+    return data;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    
+    posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+void stl_unmap_file(void* data, size_t size) {
+    if (!data) return;
+    
+#ifdef _WIN32
+    (void)size;
+    free(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// Spatial hash used by the vertex welder. Each slot holds a vertex index;
+// vertices are filed under the grid cell containing them.
+typedef struct {
+    uint32_t* slots;
+    size_t mask;
+    float cell_size;    // 2 * epsilon, so any match lies in one of 8 probed cells
+    int exact;          // epsilon <= 0: cells are the raw coordinate bits
+} stl_weld_table_t;
+
+#define STL_WELD_EMPTY 0xFFFFFFFFu
+
+static void stl_weld_cell(const stl_weld_table_t* table, const float* p, int64_t cell[3]) {
+    for (int k = 0; k < 3; k++) {
+        if (table->exact) {
+            float v = p[k] == 0.0f ? 0.0f : p[k]; // Fold -0 onto +0
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            cell[k] = bits;
+        } else {
+            cell[k] = (int64_t)floor((double)p[k] / table->cell_size);
+        }
+    }
+}
+
+static size_t stl_weld_hash(const int64_t cell[3]) {
+    uint64_t h = (uint64_t)cell[0] * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)cell[1] * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+    h ^= (uint64_t)cell[2] * 0x165667B19E3779F9ull + (h >> 32);
+    h ^= h >> 31;
+    return (size_t)h;
+}
+
+static void stl_weld_insert(stl_weld_table_t* table, const float* vertices, uint32_t index) {
+    int64_t cell[3];
+    stl_weld_cell(table, &vertices[(size_t)index * 3], cell);
+    size_t slot = stl_weld_hash(cell) & table->mask;
+    while (table->slots[slot] != STL_WELD_EMPTY) {
+        slot = (slot + 1) & table->mask;
+    }
+    table->slots[slot] = index;
+}
+
+static int stl_weld_grow(stl_weld_table_t* table, const float* vertices, uint32_t num_vertices) {
+    size_t capacity = (table->mask + 1) * 2;
+    uint32_t* slots = malloc(capacity * sizeof(uint32_t));
+    if (!slots) return -1;
+    
+    free(table->slots);
+    table->slots = slots;
+    table->mask = capacity - 1;
+    memset(table->slots, 0xFF, capacity * sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        stl_weld_insert(table, vertices, i);
+    }
+    return 0;
+}
+
+// Return the index of a welded vertex within epsilon of p, or STL_WELD_EMPTY
+static uint32_t stl_weld_find(const stl_weld_table_t* table, const float* vertices,
+                              const float* p, float epsilon) {
+    int64_t base[3];
+    int step[3] = {0, 0, 0};
+    stl_weld_cell(table, p, base);
+    
+    int probes = 1;
+    if (!table->exact) {
+        // Only the neighbour on the nearer side of each axis can hold a match
+        for (int k = 0; k < 3; k++) {
+            double frac = (double)p[k] / table->cell_size - (double)base[k];
+            step[k] = frac < 0.5 ? -1 : 1;
+        }
+        probes = 8;
+    }
+    
+    float epsilon_sq = epsilon * epsilon;
+    for (int n = 0; n < probes; n++) {
+        int64_t cell[3] = {
+            base[0] + ((n & 1) ? step[0] : 0),
+            base[1] + ((n & 2) ? step[1] : 0),
+            base[2] + ((n & 4) ? step[2] : 0)
+        };
+        
+        size_t slot = stl_weld_hash(cell) & table->mask;
+        while (table->slots[slot] != STL_WELD_EMPTY) {
+            uint32_t candidate = table->slots[slot];
+            const float* q = &vertices[(size_t)candidate * 3];
+            
+            if (table->exact) {
+                if (q[0] == p[0] && q[1] == p[1] && q[2] == p[2]) return candidate;
+            } else {
+                int64_t candidate_cell[3];
+                stl_weld_cell(table, q, candidate_cell);
+                if (candidate_cell[0] == cell[0] && candidate_cell[1] == cell[1] &&
+                    candidate_cell[2] == cell[2]) {
+                    float dx = q[0] - p[0], dy = q[1] - p[1], dz = q[2] - p[2];
+                    if (dx * dx + dy * dy + dz * dz <= epsilon_sq) return candidate;
+                }
+            }
+            slot = (slot + 1) & table->mask;
+        }
+    }
+    
+    return STL_WELD_EMPTY;
+}
+
+int stl_weld_vertices(stl_file_t* stl, float epsilon) {
+    if (!stl) return -1;
+    
+    // Re-welding a mesh that is only held in indexed form needs its triangles back first
+    if (!stl->triangles && !stl->facets && stl->num_triangles > 0 &&
+        stl_materialize_triangles(stl) != 0) {
+        return -1;
+    }
+    
+    free(stl->vertices);
+    free(stl->indices);
+    stl->vertices = NULL;
+    stl->indices = NULL;
+    stl->num_vertices = 0;
+    
+    if (stl->num_triangles == 0) return 0;
+    
+    size_t num_corners = (size_t)stl->num_triangles * 3;
+    stl->indices = malloc(num_corners * sizeof(uint32_t));
+    
+    // Closed meshes have roughly half as many vertices as triangles
+    size_t vertex_capacity = stl->num_triangles / 2 + 16;
+    stl->vertices = malloc(vertex_capacity * 3 * sizeof(float));
+    
+    stl_weld_table_t table;
+    table.exact = epsilon <= 0.0f;
+    table.cell_size = 2.0f * epsilon;
+    size_t table_capacity = 1024;
+    while (table_capacity < vertex_capacity * 2) table_capacity *= 2;
+    table.mask = table_capacity - 1;
+    table.slots = malloc(table_capacity * sizeof(uint32_t));
+    
+    if (!stl->indices || !stl->vertices || !table.slots) {
+        free(table.slots);
+        free(stl->indices);
+        free(stl->vertices);
+        stl->indices = NULL;
+        stl->vertices = NULL;
+        return -1;
+    }
+    memset(table.slots, 0xFF, table_capacity * sizeof(uint32_t));
+    
+    uint32_t num_vertices = 0;
+    int failed = 0;
+    for (unsigned int i = 0; i < stl->num_triangles && !failed; i++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, i, &triangle);
         
-        // Read three vertices
         for (int j = 0; j < 3; j++) {
-            if (fread(stl->triangles[i].vertices[j], sizeof(float), 3, file) != 3) {
-                return -1;
+            const float* p = triangle.vertices[j];
+            uint32_t index = stl_weld_find(&table, stl->vertices, p, epsilon);
+            
+            if (index == STL_WELD_EMPTY) {
+                if (num_vertices >= vertex_capacity) {
+                    float* grown = realloc(stl->vertices, vertex_capacity * 2 * 3 * sizeof(float));
+                    if (!grown) {
+                        failed = 1;
+                        break;
+                    }
+                    stl->vertices = grown;
+                    vertex_capacity *= 2;
+                }
+                if ((size_t)(num_vertices + 1) * 2 > table.mask + 1 &&
+                    stl_weld_grow(&table, stl->vertices, num_vertices) != 0) {
+                    failed = 1;
+                    break;
+                }
+                
+                index = num_vertices++;
+                memcpy(&stl->vertices[(size_t)index * 3], p, 3 * sizeof(float));
+                stl_weld_insert(&table, stl->vertices, index);
             }
+            
+            stl->indices[(size_t)i * 3 + j] = index;
         }
+    }
+    
+    free(table.slots);
+    
+    if (failed) {
+        free(stl->indices);
+        free(stl->vertices);
+        stl->indices = NULL;
+        stl->vertices = NULL;
+        return -1;
+    }
+    
+    float* shrunk = realloc(stl->vertices, (size_t)num_vertices * 3 * sizeof(float));
+    if (shrunk) stl->vertices = shrunk;
+    stl->num_vertices = num_vertices;
+    
+    // The indexed form now carries the geometry; stl_get_triangle expands it on demand
+    stl_release_facets(stl);
+    
+    return 0;
+}
+
+int stl_build_soa(stl_file_t* stl) {
+    return stl_build_soa_with_z_ranges(stl, NULL);
+}
+
+int stl_build_soa_with_z_ranges(stl_file_t* stl, const float* z_ranges) {
+    if (!stl) return -1;
+    
+    stl_free_soa(stl->soa);
+    stl->soa = NULL;
+    
+    stl_soa_t* soa = calloc(1, sizeof(stl_soa_t));
+    if (!soa) return -1;
+    soa->num_triangles = stl->num_triangles;
+    
+    // One block holds all 14 per-triangle arrays
+    size_t n = stl->num_triangles ? stl->num_triangles : 1;
+    soa->block = malloc(n * STL_SOA_ARRAYS * sizeof(float));
+    if (!soa->block) {
+        free(soa);
+        return -1;
+    }
+    
+    float* next = soa->block;
+    for (int j = 0; j < 3; j++) {
+        soa->x[j] = next; next += n;
+        soa->y[j] = next; next += n;
+        soa->z[j] = next; next += n;
+    }
+    soa->z_min = next; next += n;
+    soa->z_max = next; next += n;
+    for (int k = 0; k < 3; k++) {
+        soa->centroid[k] = next; next += n;
+    }
+    
+    // The SoA view holds no normals, so only the corners are gathered
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, i, &triangle);
         
-        // Skip attribute byte count (2 bytes)
-        unsigned short attr;
-        if (fread(&attr, sizeof(unsigned short), 1, file) != 1) {
-            return -1;
+        for (int j = 0; j < 3; j++) {
+            soa->x[j][i] = triangle.vertices[j][0];
+            soa->y[j][i] = triangle.vertices[j][1];
+            soa->z[j][i] = triangle.vertices[j][2];
+        }
+        
+        if (z_ranges) {
+            soa->z_min[i] = z_ranges[(size_t)i * 2];
+            soa->z_max[i] = z_ranges[(size_t)i * 2 + 1];
+        } else {
+            float z0 = triangle.vertices[0][2], z1 = triangle.vertices[1][2], z2 = triangle.vertices[2][2];
+            soa->z_min[i] = fminf(z0, fminf(z1, z2));
+            soa->z_max[i] = fmaxf(z0, fmaxf(z1, z2));
+        }
+        for (int k = 0; k < 3; k++) {
+            soa->centroid[k][i] = (triangle.vertices[0][k] + triangle.vertices[1][k] +
+                                   triangle.vertices[2][k]) / 3.0f;
         }
     }
     
+    stl->soa = soa;
     return 0;
 }
 
+void stl_free_soa(stl_soa_t* soa) {
+    if (!soa) return;
+    free(soa->block);
+    free(soa);
+}
+
+// Min/max of a float array, 8 lanes at a time with AVX2
+static void stl_min_max(const float* values, unsigned int count, float* min_out, float* max_out) {
+    float lo = *min_out, hi = *max_out;
+    unsigned int i = 0;
+    
+#ifdef __AVX2__
+    if (count >= 8) {
+        __m256 vlo = _mm256_set1_ps(lo);
+        __m256 vhi = _mm256_set1_ps(hi);
+        for (; i + 8 <= count; i += 8) {
+            __m256 v = _mm256_loadu_ps(values + i);
+            vlo = _mm256_min_ps(vlo, v);
+            vhi = _mm256_max_ps(vhi, v);
+        }
+        float lanes_lo[8], lanes_hi[8];
+        _mm256_storeu_ps(lanes_lo, vlo);
+        _mm256_storeu_ps(lanes_hi, vhi);
+        for (int k = 0; k < 8; k++) {
+            if (lanes_lo[k] < lo) lo = lanes_lo[k];
+            if (lanes_hi[k] > hi) hi = lanes_hi[k];
+        }
+    }
+#endif
+    
+    for (; i < count; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+    }
+    
+    *min_out = lo;
+    *max_out = hi;
+}
+
+unsigned int stl_soa_filter_z_range(const stl_soa_t* soa, float z, unsigned int* out) {
+    if (!soa) return 0;
+    
+    unsigned int count = 0;
+    unsigned int i = 0;
+    
+#ifdef __AVX2__
+    __m256 vz = _mm256_set1_ps(z);
+    for (; i + 8 <= soa->num_triangles; i += 8) {
+        __m256 lo = _mm256_cmp_ps(_mm256_loadu_ps(soa->z_min + i), vz, _CMP_LE_OQ);
+        __m256 hi = _mm256_cmp_ps(vz, _mm256_loadu_ps(soa->z_max + i), _CMP_LE_OQ);
+        int bits = _mm256_movemask_ps(_mm256_and_ps(lo, hi));
+        if (!bits) continue;
+        for (int b = 0; b < 8; b++) {
+            if (bits & (1 << b)) {
+                if (out) out[count] = i + b;
+                count++;
+            }
+        }
+    }
+#endif
+    
+    for (; i < soa->num_triangles; i++) {
+        if (soa->z_min[i] <= z && z <= soa->z_max[i]) {
+            if (out) out[count] = i;
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+unsigned int stl_soa_filter_z_range_labeled(const stl_soa_t* soa, const unsigned int* labels,
+                                            unsigned int label, float z, unsigned int* out) {
+    if (!soa || !labels) return 0;
+    
+    unsigned int count = 0;
+    unsigned int i = 0;
+    
+#ifdef __AVX2__
+    __m256 vz = _mm256_set1_ps(z);
+    __m256i vlabel = _mm256_set1_epi32((int)label);
+    for (; i + 8 <= soa->num_triangles; i += 8) {
+        __m256i ids = _mm256_loadu_si256((const __m256i*)(labels + i));
+        __m256 match = _mm256_castsi256_ps(_mm256_cmpeq_epi32(ids, vlabel));
+        __m256 lo = _mm256_cmp_ps(_mm256_loadu_ps(soa->z_min + i), vz, _CMP_LE_OQ);
+        __m256 hi = _mm256_cmp_ps(vz, _mm256_loadu_ps(soa->z_max + i), _CMP_LE_OQ);
+        int bits = _mm256_movemask_ps(_mm256_and_ps(match, _mm256_and_ps(lo, hi)));
+        if (!bits) continue;
+        for (int b = 0; b < 8; b++) {
+            if (bits & (1 << b)) {
+                if (out) out[count] = i + b;
+                count++;
+            }
+        }
+    }
+#endif
+    
+    for (; i < soa->num_triangles; i++) {
+        if (labels[i] == label && soa->z_min[i] <= z && z <= soa->z_max[i]) {
+            if (out) out[count] = i;
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+unsigned int stl_soa_filter_z_range_subset(const stl_soa_t* soa, const unsigned int* indices,
+                                           unsigned int num_indices, float z, unsigned int* out) {
+    if (!soa || !indices) return 0;
+    
+    unsigned int count = 0;
+    unsigned int i = 0;
+    
+#ifdef __AVX2__
+    __m256 vz = _mm256_set1_ps(z);
+    for (; i + 8 <= num_indices; i += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(indices + i));
+        __m256 lo = _mm256_cmp_ps(_mm256_i32gather_ps(soa->z_min, idx, 4), vz, _CMP_LE_OQ);
+        __m256 hi = _mm256_cmp_ps(vz, _mm256_i32gather_ps(soa->z_max, idx, 4), _CMP_LE_OQ);
+        int bits = _mm256_movemask_ps(_mm256_and_ps(lo, hi));
+        if (!bits) continue;
+        for (int b = 0; b < 8; b++) {
+            if (bits & (1 << b)) {
+                if (out) out[count] = indices[i + b];
+                count++;
+            }
+        }
+    }
+#endif
+    
+    for (; i < num_indices; i++) {
+        unsigned int t = indices[i];
+        if (soa->z_min[t] <= z && z <= soa->z_max[t]) {
+            if (out) out[count] = t;
+            count++;
+        }
+    }
+    
+    return count;
+}
+
 void stl_calculate_bounds(stl_file_t* stl) {
     if (stl->num_triangles == 0) return;
     
@@ -148,10 +1071,23 @@ void stl_calculate_bounds(stl_file_t* stl) {
     stl->bounds[0] = stl->bounds[1] = stl->bounds[2] = FLT_MAX;  // min
     stl->bounds[3] = stl->bounds[4] = stl->bounds[5] = -FLT_MAX; // max
     
+    // Contiguous coordinate arrays reduce with SIMD min/max
+    if (stl->soa) {
+        for (int j = 0; j < 3; j++) {
+            stl_min_max(stl->soa->x[j], stl->num_triangles, &stl->bounds[0], &stl->bounds[3]);
+            stl_min_max(stl->soa->y[j], stl->num_triangles, &stl->bounds[1], &stl->bounds[4]);
+            stl_min_max(stl->soa->z[j], stl->num_triangles, &stl->bounds[2], &stl->bounds[5]);
+        }
+        return;
+    }
+    
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, i, &triangle);
+        
         for (int j = 0; j < 3; j++) {
             for (int k = 0; k < 3; k++) {
-                float val = stl->triangles[i].vertices[j][k];
+                float val = triangle.vertices[j][k];
                 if (val < stl->bounds[k]) stl->bounds[k] = val;     // min
                 if (val > stl->bounds[k+3]) stl->bounds[k+3] = val; // max
             }
@@ -162,7 +1098,11 @@ void stl_calculate_bounds(stl_file_t* stl) {
 void stl_print_info(const stl_file_t* stl) {
     printf("STL File Information:\n");
     printf("Header: %.80s\n", stl->header);
+    printf("Format: %s\n", stl_format_name(stl->format));
     printf("Number of triangles: %u\n", stl->num_triangles);
+    if (stl->indices) {
+        printf("Welded vertices: %u\n", stl->num_vertices);
+    }
     printf("Bounding box:\n");
     printf("  X: %.3f to %.3f (width: %.3f)\n", 
            stl->bounds[0], stl->bounds[3], stl->bounds[3] - stl->bounds[0]);
@@ -5,6 +5,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary STL layout
+#define STL_HEADER_SIZE 84  // 80-byte header + 32-bit triangle count
+#define STL_FACET_SIZE 50   // Normal + 3 vertices (12 floats) + 16-bit attribute
+
+// Bytes inspected for ASCII tokens when the size check is inconclusive
+#define STL_FORMAT_PROBE_BYTES 4096
+
+// Default distance (mm) under which vertices are merged by the welder
+#define STL_DEFAULT_WELD_EPSILON 1e-6f
+
+// ASCII parser threading
+#define STL_ASCII_MAX_THREADS 64
+#define STL_ASCII_PARALLEL_MIN_BYTES (1 << 20) // Parse smaller files on one thread
+
+// STL encodings
+typedef enum {
+    STL_FORMAT_UNKNOWN,
+    STL_FORMAT_ASCII,
+    STL_FORMAT_BINARY
+} stl_format_t;
 
 // STL triangle structure
 typedef struct {
@@ -12,20 +36,77 @@ typedef struct {
     float vertices[3][3]; // Three vertices, each with (x, y, z) coordinates
 } stl_triangle_t;
 
+// Structure-of-arrays view of the triangles for vectorized kernels
+#define STL_SOA_ARRAYS 14
+typedef struct {
+    float* x[3];        // x coordinate of corner j, one entry per triangle
+    float* y[3];        // y coordinate of corner j
+    float* z[3];        // z coordinate of corner j
+    float* z_min;       // Lowest corner z per triangle
+    float* z_max;       // Highest corner z per triangle
+    float* centroid[3]; // Centroid (x, y, z) per triangle
+    unsigned int num_triangles;
+    float* block;       // Single allocation backing all arrays
+} stl_soa_t;
+
 // STL file structure
 typedef struct {
     char header[80];    // STL header (80 bytes)
     unsigned int num_triangles; // Number of triangles
-    stl_triangle_t* triangles;  // Array of triangles
+    stl_triangle_t* triangles;  // Array of triangles (NULL when served from the mapping or the welded mesh)
     float bounds[6];    // Bounding box: [min_x, min_y, min_z, max_x, max_y, max_z]
+    const unsigned char* facets; // Raw binary facets inside the mapping (keep_mapping mode)
+    void* mapping;      // Memory-mapped file backing the facets, if kept
+    size_t mapping_size; // Size of the mapping in bytes
+    stl_format_t format; // Parser path taken by the loader
+    
+    // Optional indexed form built by the vertex welder; replaces the triangle array
+    float* vertices;    // Welded vertex positions (x, y, z), NULL when not indexed
+    uint32_t* indices;  // Three vertex indices per triangle
+    unsigned int num_vertices; // Number of welded vertices
+    
+    stl_soa_t* soa;     // Optional SoA view, built once after load
 } stl_file_t;
 
+// Loader options
+typedef struct {
+    int keep_mapping;   // Keep the file mapping as backing store instead of copying facets
+    int num_threads;    // Threads for ASCII parsing (0 = one per online CPU)
+    int weld_vertices;  // Build the indexed form while loading
+    float weld_epsilon; // Merge distance for welding (<= 0 merges exact duplicates only)
+    int build_soa;      // Build the SoA view after loading
+} stl_load_options_t;
+
 // Function declarations
 stl_file_t* stl_load_file(const char* filename);
+stl_file_t* stl_load_file_with_options(const char* filename, const stl_load_options_t* options);
+stl_load_options_t stl_default_load_options(void);
 void stl_free(stl_file_t* stl);
+stl_format_t stl_detect_format(const unsigned char* data, size_t size);
+const char* stl_format_name(stl_format_t format);
 int stl_parse_ascii(FILE* file, stl_file_t* stl);
+int stl_parse_ascii_buffer(const char* data, size_t size, stl_file_t* stl, int num_threads);
 int stl_parse_binary(FILE* file, stl_file_t* stl);
+int stl_parse_binary_buffer(const unsigned char* data, size_t size, stl_file_t* stl, int keep_mapping);
+void stl_get_triangle(const stl_file_t* stl, unsigned int index, stl_triangle_t* triangle);
+void stl_get_triangle_corners(const stl_file_t* stl, unsigned int index, stl_triangle_t* triangle); // Normal left unset
+int stl_materialize_triangles(stl_file_t* stl);
+int stl_weld_vertices(stl_file_t* stl, float epsilon);
 void stl_calculate_bounds(stl_file_t* stl);
+
+// SoA view and its vectorized kernels (AVX2 when compiled with -mavx2)
+int stl_build_soa(stl_file_t* stl);
+int stl_build_soa_with_z_ranges(stl_file_t* stl, const float* z_ranges); // (z_min, z_max) per triangle, or NULL
+void stl_free_soa(stl_soa_t* soa);
+unsigned int stl_soa_filter_z_range(const stl_soa_t* soa, float z, unsigned int* out);
+unsigned int stl_soa_filter_z_range_labeled(const stl_soa_t* soa, const unsigned int* labels,
+                                            unsigned int label, float z, unsigned int* out);
+unsigned int stl_soa_filter_z_range_subset(const stl_soa_t* soa, const unsigned int* indices,
+                                           unsigned int num_indices, float z, unsigned int* out);
 void stl_print_info(const stl_file_t* stl);
 
+// File mapping helpers (fall back to a heap copy where mmap is unavailable)
+void* stl_map_file(const char* filename, size_t* size);
+void stl_unmap_file(void* data, size_t size);
+
 #endif // STL_PARSER_H 
\ No newline at end of file
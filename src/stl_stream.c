@@ -0,0 +1,361 @@
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+#include "stl_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 64-bit file offsets, so meshes beyond 2 GB can be validated and spilled
+#ifdef _WIN32
+#define stl_stream_seek _fseeki64
+#define stl_stream_tell _ftelli64
+#else
+#define stl_stream_seek fseeko
+#define stl_stream_tell ftello
+#endif
+
+stl_stream_t* stl_stream_open(const char* filename, unsigned int batch_size) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return NULL;
+    }
+    
+    unsigned char header[STL_HEADER_SIZE];
+    if (fread(header, 1, STL_HEADER_SIZE, file) != STL_HEADER_SIZE) {
+        fprintf(stderr, "Error: %s is too short for a binary STL\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    
+    // Same size rule as the in-memory parser: 84-byte header plus 50 bytes per facet
+    uint32_t count;
+    memcpy(&count, header + 80, sizeof(count));
+    int64_t size = -1;
+    if (stl_stream_seek(file, 0, SEEK_END) == 0) {
+        size = (int64_t)stl_stream_tell(file);
+    }
+    if (size < (int64_t)STL_HEADER_SIZE + (int64_t)count * STL_FACET_SIZE ||
+        stl_stream_seek(file, STL_HEADER_SIZE, SEEK_SET) != 0) {
+        fprintf(stderr, "Error: %s is not a complete binary STL (streaming supports binary files only)\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    
+    stl_stream_t* stream = calloc(1, sizeof(stl_stream_t));
+    if (!stream) {
+        fclose(file);
+        return NULL;
+    }
+    
+    stream->file = file;
+    memcpy(stream->header, header, 80);
+    stream->num_triangles = count;
+    stream->batch_size = batch_size ? batch_size : STL_STREAM_DEFAULT_BATCH;
+    stream->raw = malloc((size_t)stream->batch_size * STL_FACET_SIZE);
+    stream->batch = malloc((size_t)stream->batch_size * sizeof(stl_triangle_t));
+    if (!stream->raw || !stream->batch) {
+        stl_stream_close(stream);
+        return NULL;
+    }
+    
+    return stream;
+}
+
+unsigned int stl_stream_next(stl_stream_t* stream, const stl_triangle_t** triangles, unsigned int* first_index) {
+    if (!stream || stream->next_triangle >= stream->num_triangles) return 0;
+    
+    unsigned int count = stream->num_triangles - stream->next_triangle;
+    if (count > stream->batch_size) count = stream->batch_size;
+    
+    if (fread(stream->raw, STL_FACET_SIZE, count, stream->file) != count) {
+        fprintf(stderr, "Error: Unexpected end of STL stream at triangle %u\n", stream->next_triangle);
+        stream->next_triangle = stream->num_triangles;
+        return 0;
+    }
+    
+    // Normal and vertices are 12 little-endian floats; skip the attribute word
+    for (unsigned int i = 0; i < count; i++) {
+        memcpy(&stream->batch[i], stream->raw + (size_t)i * STL_FACET_SIZE, sizeof(stl_triangle_t));
+    }
+    
+    if (triangles) *triangles = stream->batch;
+    if (first_index) *first_index = stream->next_triangle;
+    stream->next_triangle += count;
+    return count;
+}
+
+int stl_stream_rewind(stl_stream_t* stream) {
+    if (!stream || stl_stream_seek(stream->file, STL_HEADER_SIZE, SEEK_SET) != 0) return -1;
+    stream->next_triangle = 0;
+    return 0;
+}
+
+void stl_stream_close(stl_stream_t* stream) {
+    if (!stream) return;
+    if (stream->file) fclose(stream->file);
+    free(stream->raw);
+    free(stream->batch);
+    free(stream);
+}
+
+int stl_stream_for_each(const char* filename, unsigned int batch_size,
+                        stl_stream_callback_t callback, void* user_data) {
+    if (!callback) return -1;
+    
+    stl_stream_t* stream = stl_stream_open(filename, batch_size);
+    if (!stream) return -1;
+    
+    const stl_triangle_t* triangles;
+    unsigned int first_index, count;
+    while ((count = stl_stream_next(stream, &triangles, &first_index)) > 0) {
+        if (callback(triangles, count, first_index, user_data) != 0) break;
+    }
+    
+    int result = stream->next_triangle == stream->num_triangles ? 0 : -1;
+    stl_stream_close(stream);
+    return result;
+}
+
+static int stl_stream_bounds_callback(const stl_triangle_t* triangles, unsigned int count,
+                                      unsigned int first_index, void* user_data) {
+    (void)first_index;
+    float* bounds = (float*)user_data;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) {
+                float val = triangles[i].vertices[j][k];
+                if (val < bounds[k]) bounds[k] = val;     // min
+                if (val > bounds[k+3]) bounds[k+3] = val; // max
+            }
+        }
+    }
+    return 0;
+}
+
+int stl_stream_bounds(const char* filename, float bounds[6], unsigned int* num_triangles) {
+    if (!bounds) return -1;
+    
+    bounds[0] = bounds[1] = bounds[2] = FLT_MAX;  // min
+    bounds[3] = bounds[4] = bounds[5] = -FLT_MAX; // max
+    
+    stl_stream_t* stream = stl_stream_open(filename, 0);
+    if (!stream) return -1;
+    
+    const stl_triangle_t* triangles;
+    unsigned int first_index, count;
+    while ((count = stl_stream_next(stream, &triangles, &first_index)) > 0) {
+        stl_stream_bounds_callback(triangles, count, first_index, bounds);
+    }
+    
+    int result = stream->next_triangle == stream->num_triangles ? 0 : -1;
+    if (num_triangles) *num_triangles = stream->num_triangles;
+    stl_stream_close(stream);
+    return result;
+}
+
+// Bucketing state: one pending block per band, appended to the spill file when full
+typedef struct {
+    stl_band_set_t* bands;
+    stl_triangle_t** pending;
+    unsigned int* num_pending;
+    unsigned int block_size;
+    int64_t spill_offset;
+    int failed;
+} stl_bucket_state_t;
+
+static int stl_bucket_flush(stl_bucket_state_t* state, unsigned int band) {
+    stl_band_set_t* bands = state->bands;
+    unsigned int count = state->num_pending[band];
+    if (count == 0) return 0;
+    
+    if (bands->num_blocks[band] == bands->block_capacity[band]) {
+        unsigned int capacity = bands->block_capacity[band] ? bands->block_capacity[band] * 2 : 8;
+        stl_spill_block_t* blocks = realloc(bands->blocks[band], capacity * sizeof(stl_spill_block_t));
+        if (!blocks) return -1;
+        bands->blocks[band] = blocks;
+        bands->block_capacity[band] = capacity;
+    }
+    
+    if (fwrite(state->pending[band], sizeof(stl_triangle_t), count, bands->spill) != count) {
+        fprintf(stderr, "Error: Failed to write STL spill file\n");
+        return -1;
+    }
+    
+    stl_spill_block_t* block = &bands->blocks[band][bands->num_blocks[band]++];
+    block->offset = state->spill_offset;
+    block->count = count;
+    state->spill_offset += (int64_t)count * (int64_t)sizeof(stl_triangle_t);
+    state->num_pending[band] = 0;
+    return 0;
+}
+
+static void stl_bucket_batch(stl_bucket_state_t* state, const stl_triangle_t* triangles, unsigned int count) {
+    stl_band_set_t* bands = state->bands;
+    int last = (int)bands->num_bands - 1;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        const stl_triangle_t* triangle = &triangles[i];
+        float z0 = triangle->vertices[0][2], z1 = triangle->vertices[1][2], z2 = triangle->vertices[2][2];
+        float z_min = fminf(z0, fminf(z1, z2));
+        float z_max = fmaxf(z0, fmaxf(z1, z2));
+        
+        // A triangle goes into every band its z-range touches
+        int lo = (int)floorf((z_min - bands->z_origin) / bands->band_height);
+        int hi = (int)floorf((z_max - bands->z_origin) / bands->band_height);
+        if (lo < 0) lo = 0;
+        if (hi > last) hi = last;
+        
+        for (int b = lo; b <= hi; b++) {
+            if (!state->pending[b]) {
+                state->pending[b] = malloc((size_t)state->block_size * sizeof(stl_triangle_t));
+                if (!state->pending[b]) {
+                    state->failed = 1;
+                    return;
+                }
+            }
+            state->pending[b][state->num_pending[b]++] = *triangle;
+            bands->band_counts[b]++;
+            
+            if (state->num_pending[b] == state->block_size && stl_bucket_flush(state, (unsigned int)b) != 0) {
+                state->failed = 1;
+                return;
+            }
+        }
+    }
+}
+
+stl_band_set_t* stl_stream_bucket_by_z(const char* filename, const float bounds[6], float band_height,
+                                       unsigned int batch_size) {
+    if (!filename || !bounds || band_height <= 0.0f) return NULL;
+    
+    stl_band_set_t* bands = calloc(1, sizeof(stl_band_set_t));
+    if (!bands) return NULL;
+    
+    memcpy(bands->bounds, bounds, sizeof(bands->bounds));
+    bands->z_origin = bounds[2];
+    bands->band_height = band_height;
+    float height = bounds[5] - bounds[2];
+    bands->num_bands = height > 0.0f ? (unsigned int)ceilf(height / band_height) : 1;
+    if (bands->num_bands == 0) bands->num_bands = 1;
+    
+    bands->band_counts = calloc(bands->num_bands, sizeof(unsigned int));
+    bands->blocks = calloc(bands->num_bands, sizeof(stl_spill_block_t*));
+    bands->num_blocks = calloc(bands->num_bands, sizeof(unsigned int));
+    bands->block_capacity = calloc(bands->num_bands, sizeof(unsigned int));
+    bands->spill = tmpfile();
+    
+    stl_bucket_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.bands = bands;
+    state.pending = calloc(bands->num_bands, sizeof(stl_triangle_t*));
+    state.num_pending = calloc(bands->num_bands, sizeof(unsigned int));
+    
+    // Split the buffer budget across bands
+    size_t block_size = STL_STREAM_SPILL_BUDGET / sizeof(stl_triangle_t) / bands->num_bands;
+    if (block_size < STL_STREAM_MIN_SPILL_BLOCK) block_size = STL_STREAM_MIN_SPILL_BLOCK;
+    if (block_size > STL_STREAM_DEFAULT_BATCH) block_size = STL_STREAM_DEFAULT_BATCH;
+    state.block_size = (unsigned int)block_size;
+    
+    int result = -1;
+    if (!bands->spill) {
+        fprintf(stderr, "Error: Cannot create STL spill file\n");
+    } else if (bands->band_counts && bands->blocks && bands->num_blocks && bands->block_capacity &&
+               state.pending && state.num_pending) {
+        stl_stream_t* stream = stl_stream_open(filename, batch_size);
+        if (stream) {
+            memcpy(bands->header, stream->header, 80);
+            const stl_triangle_t* triangles;
+            unsigned int first_index, count;
+            while (!state.failed && (count = stl_stream_next(stream, &triangles, &first_index)) > 0) {
+                stl_bucket_batch(&state, triangles, count);
+            }
+            if (!state.failed && stream->next_triangle == stream->num_triangles) {
+                result = 0;
+            }
+            stl_stream_close(stream);
+        }
+    }
+    
+    // Spill the partial blocks
+    for (unsigned int b = 0; b < bands->num_bands && state.pending; b++) {
+        if (result == 0 && stl_bucket_flush(&state, b) != 0) result = -1;
+        free(state.pending[b]);
+    }
+    free(state.pending);
+    free(state.num_pending);
+    
+    if (result != 0 || fflush(bands->spill) != 0) {
+        stl_band_set_free(bands);
+        return NULL;
+    }
+    
+    return bands;
+}
+
+stl_file_t* stl_band_load(const stl_band_set_t* bands, unsigned int band, const stl_load_options_t* options) {
+    if (!bands || band >= bands->num_bands) return NULL;
+    
+    stl_file_t* stl = calloc(1, sizeof(stl_file_t));
+    if (!stl) return NULL;
+    
+    memcpy(stl->header, bands->header, sizeof(stl->header));
+    stl->format = STL_FORMAT_BINARY;
+    stl->num_triangles = bands->band_counts[band];
+    stl->triangles = malloc(((size_t)stl->num_triangles + 1) * sizeof(stl_triangle_t));
+    if (!stl->triangles) {
+        stl_free(stl);
+        return NULL;
+    }
+    
+    // Read back the band's runs in the order they were spilled
+    unsigned int loaded = 0;
+    for (unsigned int i = 0; i < bands->num_blocks[band]; i++) {
+        const stl_spill_block_t* block = &bands->blocks[band][i];
+        if (stl_stream_seek(bands->spill, block->offset, SEEK_SET) != 0 ||
+            fread(stl->triangles + loaded, sizeof(stl_triangle_t), block->count, bands->spill) != block->count) {
+            fprintf(stderr, "Error: Failed to read STL spill file\n");
+            stl_free(stl);
+            return NULL;
+        }
+        loaded += block->count;
+    }
+    
+    if (options && options->weld_vertices) {
+        if (stl_weld_vertices(stl, options->weld_epsilon) != 0) {
+            fprintf(stderr, "Warning: Vertex welding failed, continuing without indexed mesh\n");
+        }
+    }
+    if (options && options->build_soa) {
+        if (stl_build_soa(stl) != 0) {
+            fprintf(stderr, "Warning: Failed to build SoA view, using scalar kernels\n");
+        }
+    }
+    
+    stl_calculate_bounds(stl);
+    return stl;
+}
+
+void stl_band_range(const stl_band_set_t* bands, unsigned int band, float* z_low, float* z_high) {
+    if (!bands) return;
+    if (z_low) *z_low = bands->z_origin + band * bands->band_height;
+    if (z_high) *z_high = bands->z_origin + (band + 1) * bands->band_height;
+}
+
+void stl_band_set_free(stl_band_set_t* bands) {
+    if (!bands) return;
+    
+    if (bands->blocks) {
+        for (unsigned int b = 0; b < bands->num_bands; b++) {
+            free(bands->blocks[b]);
+        }
+    }
+    free(bands->blocks);
+    free(bands->num_blocks);
+    free(bands->block_capacity);
+    free(bands->band_counts);
+    if (bands->spill) fclose(bands->spill);
+    free(bands);
+}
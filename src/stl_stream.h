@@ -0,0 +1,65 @@
+#ifndef STL_STREAM_H
+#define STL_STREAM_H
+
+#include "stl_parser.h"
+#include <stdint.h>
+
+// Streaming reader for binary STL files too large to load at once
+#define STL_STREAM_DEFAULT_BATCH 65536          // Triangles decoded per batch
+#define STL_STREAM_SPILL_BUDGET (32u << 20)     // Bytes of band buffers held before spilling
+#define STL_STREAM_MIN_SPILL_BLOCK 64           // Smallest spill block in triangles
+
+// Chunked reader state (iterator form)
+typedef struct {
+    FILE* file;
+    char header[80];
+    unsigned int num_triangles;
+    unsigned int next_triangle;  // Index of the first triangle in the next batch
+    unsigned int batch_size;
+    unsigned char* raw;          // Raw facets of the current batch
+    stl_triangle_t* batch;       // Decoded triangles of the current batch
+} stl_stream_t;
+
+// Callback form: return non-zero to stop early
+typedef int (*stl_stream_callback_t)(const stl_triangle_t* triangles, unsigned int count,
+                                     unsigned int first_index, void* user_data);
+
+// One spilled run of triangles belonging to a band
+typedef struct {
+    int64_t offset;              // Byte offset in the spill file
+    unsigned int count;          // Triangles in the run
+} stl_spill_block_t;
+
+// Triangles bucketed into z-bands, spilled to a temporary file
+typedef struct {
+    char header[80];
+    float bounds[6];             // Bounds of the whole mesh
+    float z_origin;              // Bottom of band 0
+    float band_height;
+    unsigned int num_bands;
+    unsigned int* band_counts;   // Triangles per band (spanning triangles counted in each band)
+    stl_spill_block_t** blocks;  // Spilled runs per band
+    unsigned int* num_blocks;
+    unsigned int* block_capacity;
+    FILE* spill;                 // Temporary file, removed when closed
+} stl_band_set_t;
+
+// Iterator
+stl_stream_t* stl_stream_open(const char* filename, unsigned int batch_size);
+unsigned int stl_stream_next(stl_stream_t* stream, const stl_triangle_t** triangles, unsigned int* first_index);
+int stl_stream_rewind(stl_stream_t* stream);
+void stl_stream_close(stl_stream_t* stream);
+
+// Whole-file passes with bounded memory
+int stl_stream_for_each(const char* filename, unsigned int batch_size,
+                        stl_stream_callback_t callback, void* user_data);
+int stl_stream_bounds(const char* filename, float bounds[6], unsigned int* num_triangles);
+stl_band_set_t* stl_stream_bucket_by_z(const char* filename, const float bounds[6], float band_height,
+                                       unsigned int batch_size);
+
+// Band access
+stl_file_t* stl_band_load(const stl_band_set_t* bands, unsigned int band, const stl_load_options_t* options);
+void stl_band_range(const stl_band_set_t* bands, unsigned int band, float* z_low, float* z_high);
+void stl_band_set_free(stl_band_set_t* bands);
+
+#endif // STL_STREAM_H
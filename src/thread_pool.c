@@ -0,0 +1,246 @@
+#define _POSIX_C_SOURCE 200809L
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    thread_pool_t* pool;
+    int worker;
+} thread_pool_worker_arg_t;
+
+int thread_pool_cpu_count(void) {
+#ifndef _WIN32
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (int)online : 1;
+#else
+    return 1;
+#endif
+}
+
+// Take the next task from the front of our own queue
+static int thread_pool_pop(thread_pool_queue_t* queue) {
+    int index = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        index = queue->head++;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return index;
+}
+
+// Take the last task from another worker's queue, furthest from what its owner is doing
+static int thread_pool_steal(thread_pool_queue_t* queue) {
+    int index = -1;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail) {
+        index = --queue->tail;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return index;
+}
+
+// Drain our queue, then steal until every queue is empty
+static void thread_pool_run(thread_pool_t* pool, int worker) {
+    for (;;) {
+        int index = thread_pool_pop(&pool->queues[worker]);
+        for (int i = 1; index < 0 && i < pool->num_threads; i++) {
+            index = thread_pool_steal(&pool->queues[(worker + i) % pool->num_threads]);
+        }
+        if (index < 0) return;
+        pool->task(pool->user_data, index, worker);
+    }
+}
+
+static void* thread_pool_worker(void* arg) {
+    thread_pool_worker_arg_t* worker_arg = (thread_pool_worker_arg_t*)arg;
+    thread_pool_t* pool = worker_arg->pool;
+    int worker = worker_arg->worker;
+    free(worker_arg);
+    
+    unsigned int seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        
+        thread_pool_run(pool, worker);
+        
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+thread_pool_t* thread_pool_create(int num_threads) {
+    if (num_threads <= 0) num_threads = thread_pool_cpu_count();
+    if (num_threads > THREAD_POOL_MAX_THREADS) num_threads = THREAD_POOL_MAX_THREADS;
+    
+    thread_pool_t* pool = calloc(1, sizeof(thread_pool_t));
+    if (!pool) return NULL;
+    
+    pool->threads = calloc(num_threads, sizeof(pthread_t));
+    pool->queues = calloc(num_threads, sizeof(thread_pool_queue_t));
+    if (!pool->threads || !pool->queues) {
+        free(pool->threads);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    
+    // Worker 0 is the thread calling thread_pool_parallel_for
+    pool->num_threads = 1;
+    for (int i = 1; i < num_threads; i++) {
+        thread_pool_worker_arg_t* arg = malloc(sizeof(thread_pool_worker_arg_t));
+        if (!arg) break;
+        arg->pool = pool;
+        arg->worker = i;
+        if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, arg) != 0) {
+            free(arg);
+            break;
+        }
+        pool->num_threads++;
+    }
+    if (pool->num_threads < num_threads) {
+        fprintf(stderr, "Warning: Started only %d of %d worker threads\n", pool->num_threads, num_threads);
+    }
+    
+    // Workers only touch the queues once a loop is published
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+    }
+    
+    return pool;
+}
+
+void thread_pool_destroy(thread_pool_t* pool) {
+    if (!pool) return;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (int i = 1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->queues);
+    free(pool);
+}
+
+void thread_pool_parallel_for(thread_pool_t* pool, int num_tasks, thread_pool_task_t task, void* user_data) {
+    if (num_tasks <= 0) return;
+    
+    if (!pool || pool->num_threads == 1 || num_tasks == 1) {
+        for (int i = 0; i < num_tasks; i++) {
+            task(user_data, i, 0);
+        }
+        return;
+    }
+    
+    // Deal a contiguous run of tasks to each worker
+    int num_threads = pool->num_threads;
+    for (int w = 0; w < num_threads; w++) {
+        pool->queues[w].head = (int)((long long)num_tasks * w / num_threads);
+        pool->queues[w].tail = (int)((long long)num_tasks * (w + 1) / num_threads);
+    }
+    pool->task = task;
+    pool->user_data = user_data;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->running = num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    
+    thread_pool_run(pool, 0);
+    
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_queue_init(thread_queue_t* queue, int capacity) {
+    if (capacity <= 0) capacity = 1;
+    
+    queue->items = malloc(capacity * sizeof(void*));
+    if (!queue->items) return -1;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 0;
+}
+
+void thread_queue_destroy(thread_queue_t* queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->items);
+    queue->items = NULL;
+}
+
+int thread_queue_push(thread_queue_t* queue, void* item) {
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->closed && queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+int thread_queue_pop(thread_queue_t* queue, void** item) {
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->closed && queue->count == 0) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    if (queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return 0;
+    }
+    *item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return 1;
+}
+
+void thread_queue_close(thread_queue_t* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
@@ -0,0 +1,70 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+#define THREAD_POOL_MAX_THREADS 256
+
+// Task body: index is the task number, worker identifies the thread running it
+// (0 is the calling thread), so callers can keep per-worker scratch buffers
+typedef void (*thread_pool_task_t)(void* user_data, int index, int worker);
+
+// Per-worker queue of task indices [head, tail); the owner pops from the head,
+// idle workers steal from the tail
+typedef struct {
+    int head;
+    int tail;
+    pthread_mutex_t lock;
+} thread_pool_queue_t;
+
+// Fixed set of worker threads, reused across parallel loops
+typedef struct {
+    int num_threads;                 // Workers, including the calling thread
+    pthread_t* threads;              // num_threads - 1 background workers
+    thread_pool_queue_t* queues;     // One per worker
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned int generation;         // Bumped for every loop so workers wake once per loop
+    int running;                     // Background workers still busy with the current loop
+    int shutdown;
+    thread_pool_task_t task;
+    void* user_data;
+} thread_pool_t;
+
+// Bounded FIFO handing items between pipeline stages on different threads; push waits
+// while it is full, pop while it is empty
+typedef struct {
+    void** items;
+    int capacity;
+    int head;                        // Oldest item
+    int count;
+    int closed;                      // Pushes fail; pops drain what is left
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} thread_queue_t;
+
+// Function declarations
+int thread_pool_cpu_count(void);
+thread_pool_t* thread_pool_create(int num_threads);
+void thread_pool_destroy(thread_pool_t* pool);
+
+// Run task(user_data, i, worker) for i in [0, num_tasks) and wait for all of them.
+// Tasks start in index order on each worker; pool == NULL runs them serially.
+void thread_pool_parallel_for(thread_pool_t* pool, int num_tasks, thread_pool_task_t task, void* user_data);
+
+int thread_queue_init(thread_queue_t* queue, int capacity);
+void thread_queue_destroy(thread_queue_t* queue);
+
+// 0 once queued, -1 if the queue was closed (the item is not taken)
+int thread_queue_push(thread_queue_t* queue, void* item);
+
+// 1 with the oldest item, 0 once the queue is closed and empty
+int thread_queue_pop(thread_queue_t* queue, void** item);
+
+// No more items: wakes every waiting thread. A consumer closes the queue it reads from
+// to stop its producer early.
+void thread_queue_close(thread_queue_t* queue);
+
+#endif // THREAD_POOL_H
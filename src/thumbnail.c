@@ -0,0 +1,240 @@
+#include "thumbnail.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Image-space vertex: pixel position and distance toward the viewer
+typedef struct {
+    float x, y, depth;
+} thumbnail_vertex_t;
+
+static float dot3(const float* a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void normalize3(float* v) {
+    float length = sqrtf(dot3(v, v));
+    if (length > 0) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+// Twice the signed area of (a, b, p): which side of edge a-b the point p lies on
+static float edge(const thumbnail_vertex_t* a, const thumbnail_vertex_t* b, float x, float y) {
+    return (b->x - a->x) * (y - a->y) - (b->y - a->y) * (x - a->x);
+}
+
+// Fill one triangle's samples that are nearer than what the depth buffer holds
+static void rasterize(const thumbnail_vertex_t* v, float shade, float* depth, float* shades, int width, int height) {
+    float area = edge(&v[0], &v[1], v[2].x, v[2].y);
+    if (fabsf(area) < 1e-12f) return;
+    
+    int x0 = (int)floorf(fminf(v[0].x, fminf(v[1].x, v[2].x)));
+    int x1 = (int)ceilf(fmaxf(v[0].x, fmaxf(v[1].x, v[2].x)));
+    int y0 = (int)floorf(fminf(v[0].y, fminf(v[1].y, v[2].y)));
+    int y1 = (int)ceilf(fmaxf(v[0].y, fmaxf(v[1].y, v[2].y)));
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > width - 1) x1 = width - 1;
+    if (y1 > height - 1) y1 = height - 1;
+    
+    float sign = area > 0 ? 1.0f : -1.0f;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            float px = x + 0.5f, py = y + 0.5f;
+            float w0 = edge(&v[1], &v[2], px, py) * sign;
+            float w1 = edge(&v[2], &v[0], px, py) * sign;
+            float w2 = edge(&v[0], &v[1], px, py) * sign;
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+            
+            float d = (w0 * v[0].depth + w1 * v[1].depth + w2 * v[2].depth) / (area * sign);
+            size_t sample = (size_t)y * width + x;
+            if (d > depth[sample]) {
+                depth[sample] = d;
+                shades[sample] = shade;
+            }
+        }
+    }
+}
+
+unsigned char* thumbnail_render(const stl_file_t* stl, int width, int height) {
+    if (!stl || width <= 0 || height <= 0) return NULL;
+    
+    int samples_x = width * THUMBNAIL_SUPERSAMPLE;
+    int samples_y = height * THUMBNAIL_SUPERSAMPLE;
+    size_t num_samples = (size_t)samples_x * samples_y;
+    float* depth = malloc(num_samples * sizeof(float));
+    float* shades = malloc(num_samples * sizeof(float));
+    unsigned char* pixels = calloc((size_t)width * height, 4);
+    if (!depth || !shades || !pixels) {
+        free(depth);
+        free(shades);
+        free(pixels);
+        return NULL;
+    }
+    for (size_t i = 0; i < num_samples; i++) depth[i] = -FLT_MAX;
+    
+    // View basis: right, up, and toward the viewer; light from above the viewer
+    float azimuth = THUMBNAIL_AZIMUTH * (float)M_PI / 180.0f;
+    float elevation = THUMBNAIL_ELEVATION * (float)M_PI / 180.0f;
+    float toward[3] = { cosf(elevation) * sinf(azimuth), -cosf(elevation) * cosf(azimuth), sinf(elevation) };
+    float right[3] = { cosf(azimuth), sinf(azimuth), 0.0f };
+    float up[3] = { toward[1] * right[2] - toward[2] * right[1],
+                    toward[2] * right[0] - toward[0] * right[2],
+                    toward[0] * right[1] - toward[1] * right[0] };
+    float light[3] = { toward[0], toward[1], toward[2] + 1.0f };
+    normalize3(light);
+    
+    // Fit the projected bounding box into the image
+    float min_x = FLT_MAX, max_x = -FLT_MAX, min_y = FLT_MAX, max_y = -FLT_MAX;
+    for (int corner = 0; corner < 8; corner++) {
+        float p[3] = { stl->bounds[(corner & 1) ? 3 : 0], stl->bounds[(corner & 2) ? 4 : 1],
+                       stl->bounds[(corner & 4) ? 5 : 2] };
+        min_x = fminf(min_x, dot3(p, right));
+        max_x = fmaxf(max_x, dot3(p, right));
+        min_y = fminf(min_y, dot3(p, up));
+        max_y = fmaxf(max_y, dot3(p, up));
+    }
+    float span_x = fmaxf(max_x - min_x, 1e-6f);
+    float span_y = fmaxf(max_y - min_y, 1e-6f);
+    float scale = fminf(samples_x * (1.0f - 2.0f * THUMBNAIL_MARGIN) / span_x,
+                        samples_y * (1.0f - 2.0f * THUMBNAIL_MARGIN) / span_y);
+    float center_x = 0.5f * (min_x + max_x), center_y = 0.5f * (min_y + max_y);
+    
+    for (unsigned int t = 0; t < stl->num_triangles; t++) {
+        stl_triangle_t triangle;
+        stl_get_triangle_corners(stl, t, &triangle);
+        
+        thumbnail_vertex_t v[3];
+        for (int k = 0; k < 3; k++) {
+            const float* p = triangle.vertices[k];
+            v[k].x = 0.5f * samples_x + (dot3(p, right) - center_x) * scale;
+            v[k].y = 0.5f * samples_y - (dot3(p, up) - center_y) * scale;
+            v[k].depth = dot3(p, toward);
+        }
+        
+        // Facet normals from the vertices; either side may face the viewer
+        const float (*p)[3] = triangle.vertices;
+        float a[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+        float b[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        float normal[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        normalize3(normal);
+        rasterize(v, 0.3f + 0.7f * fabsf(dot3(normal, light)), depth, shades, samples_x, samples_y);
+    }
+    
+    // Average each pixel's samples; uncovered samples are transparent
+    const int per_pixel = THUMBNAIL_SUPERSAMPLE * THUMBNAIL_SUPERSAMPLE;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int covered = 0;
+            float shade = 0.0f;
+            for (int sy = 0; sy < THUMBNAIL_SUPERSAMPLE; sy++) {
+                for (int sx = 0; sx < THUMBNAIL_SUPERSAMPLE; sx++) {
+                    size_t sample = (size_t)(y * THUMBNAIL_SUPERSAMPLE + sy) * samples_x +
+                                    x * THUMBNAIL_SUPERSAMPLE + sx;
+                    if (depth[sample] == -FLT_MAX) continue;
+                    covered++;
+                    shade += shades[sample];
+                }
+            }
+            if (covered == 0) continue;
+            
+            unsigned char* pixel = &pixels[((size_t)y * width + x) * 4];
+            shade /= covered;
+            pixel[0] = (unsigned char)lrintf(THUMBNAIL_COLOR_R * shade);
+            pixel[1] = (unsigned char)lrintf(THUMBNAIL_COLOR_G * shade);
+            pixel[2] = (unsigned char)lrintf(THUMBNAIL_COLOR_B * shade);
+            pixel[3] = (unsigned char)(255 * covered / per_pixel);
+        }
+    }
+    
+    free(depth);
+    free(shades);
+    return pixels;
+}
+
+static unsigned char* put_u32_be(unsigned char* out, unsigned int value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+    return out + 4;
+}
+
+// QOI: runs of the previous pixel, a 64-entry cache of recent pixels, small differences,
+// or the pixel in full
+unsigned char* thumbnail_encode_qoi(const unsigned char* pixels, int width, int height, size_t* size) {
+    if (!pixels || width <= 0 || height <= 0 || !size) return NULL;
+    
+    size_t num_pixels = (size_t)width * height;
+    unsigned char* data = malloc(14 + num_pixels * 5 + 8);
+    if (!data) return NULL;
+    
+    unsigned char* out = data;
+    memcpy(out, "qoif", 4);
+    out = put_u32_be(out + 4, (unsigned int)width);
+    out = put_u32_be(out, (unsigned int)height);
+    *out++ = 4; // RGBA
+    *out++ = 0; // sRGB
+    
+    unsigned char seen[64][4];
+    memset(seen, 0, sizeof(seen));
+    unsigned char previous[4] = { 0, 0, 0, 255 };
+    int run = 0;
+    for (size_t i = 0; i < num_pixels; i++) {
+        const unsigned char* px = &pixels[i * 4];
+        if (memcmp(px, previous, 4) == 0) {
+            run++;
+            if (run == 62 || i == num_pixels - 1) {
+                *out++ = (unsigned char)(0xC0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            *out++ = (unsigned char)(0xC0 | (run - 1));
+            run = 0;
+        }
+        
+        int slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+        if (memcmp(seen[slot], px, 4) == 0) {
+            *out++ = (unsigned char)slot;
+        } else {
+            memcpy(seen[slot], px, 4);
+            if (px[3] == previous[3]) {
+                signed char dr = (signed char)(px[0] - previous[0]);
+                signed char dg = (signed char)(px[1] - previous[1]);
+                signed char db = (signed char)(px[2] - previous[2]);
+                int dr_dg = dr - dg, db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *out++ = (unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    *out++ = (unsigned char)(0x80 | (dg + 32));
+                    *out++ = (unsigned char)((dr_dg + 8) << 4 | (db_dg + 8));
+                } else {
+                    *out++ = 0xFE;
+                    memcpy(out, px, 3);
+                    out += 3;
+                }
+            } else {
+                *out++ = 0xFF;
+                memcpy(out, px, 4);
+                out += 4;
+            }
+        }
+        memcpy(previous, px, 4);
+    }
+    
+    static const unsigned char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    memcpy(out, end, 8);
+    out += 8;
+    *size = (size_t)(out - data);
+    return data;
+}
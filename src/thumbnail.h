@@ -0,0 +1,34 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <stddef.h>
+#include "stl_parser.h"
+
+// Preview images of the mesh: an orthographic view from the front right and above, flat
+// shaded, on a transparent background. Rendered with a depth buffer at twice the size
+// and averaged down, then stored as QOI, a lossless format printers decode cheaply.
+
+// Samples per pixel along each axis
+#define THUMBNAIL_SUPERSAMPLE 2
+
+// View direction (degrees): turned from the front, and raised above the bed
+#define THUMBNAIL_AZIMUTH 30.0f
+#define THUMBNAIL_ELEVATION 30.0f
+
+// Empty border around the model, as a fraction of the image
+#define THUMBNAIL_MARGIN 0.05f
+
+// Model colour (RGB)
+#define THUMBNAIL_COLOR_R 237
+#define THUMBNAIL_COLOR_G 107
+#define THUMBNAIL_COLOR_B 33
+
+// Function declarations
+
+// RGBA pixels, row by row from the top (free with free()); NULL when out of memory
+unsigned char* thumbnail_render(const stl_file_t* stl, int width, int height);
+
+// Encode RGBA pixels as a QOI file (free with free()); NULL when out of memory
+unsigned char* thumbnail_encode_qoi(const unsigned char* pixels, int width, int height, size_t* size);
+
+#endif // THUMBNAIL_H
@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <float.h>
 
+static unsigned int build_edge_list_by_distance(const stl_file_t* stl, topology_evaluation_t* eval);
+
 // Main evaluation functions
 topology_evaluation_t* evaluate_topology(const stl_file_t* stl, topology_analysis_type_t analysis_type) {
     if (!stl || stl->num_triangles == 0) return NULL;
@@ -15,8 +17,9 @@ topology_evaluation_t* evaluate_topology(const stl_file_t* stl, topology_analysi
     // Initialize all fields to zero/NULL
     memset(eval, 0, sizeof(topology_evaluation_t));
     
-    // Allocate vertex array (estimate: 3 vertices per triangle, but many will be shared)
-    eval->num_vertices = stl->num_triangles * 3; // Overestimate, will be corrected
+    // Allocate vertex array (exact when the mesh was welded at load time,
+    // otherwise estimate 3 vertices per triangle, but many will be shared)
+    eval->num_vertices = stl->indices ? stl->num_vertices : stl->num_triangles * 3;
     eval->vertices = malloc(eval->num_vertices * sizeof(topology_vertex_t));
     if (!eval->vertices) {
         free(eval);
@@ -35,12 +38,17 @@ topology_evaluation_t* evaluate_topology(const stl_file_t* stl, topology_analysi
     // Find unique vertices and build connectivity
     eval->num_vertices = find_unique_vertices(stl, eval->vertices);
     
+    // Vertex -> triangle adjacency lets per-vertex queries avoid full scans
+    if (stl->indices && !build_vertex_triangle_adjacency(stl, eval)) {
+        free_topology_evaluation(eval);
+        return NULL;
+    }
+    
     // Allocate edge array (estimate: 3 edges per triangle, but many will be shared)
     eval->num_edges = stl->num_triangles * 3; // Overestimate
     eval->edges = malloc(eval->num_edges * sizeof(topology_edge_t));
     if (!eval->edges) {
-        free(eval->vertices);
-        free(eval);
+        free_topology_evaluation(eval);
         return NULL;
     }
     
@@ -51,9 +59,7 @@ topology_evaluation_t* evaluate_topology(const stl_file_t* stl, topology_analysi
     eval->num_triangles = stl->num_triangles;
     eval->triangles = malloc(eval->num_triangles * sizeof(topology_triangle_t));
     if (!eval->triangles) {
-        free(eval->edges);
-        free(eval->vertices);
-        free(eval);
+        free_topology_evaluation(eval);
         return NULL;
     }
     
@@ -63,7 +69,7 @@ topology_evaluation_t* evaluate_topology(const stl_file_t* stl, topology_analysi
         eval->triangles[i].curvature = 0.0f;
         eval->triangles[i].aspect_ratio = 0.0f;
         for (int j = 0; j < 3; j++) {
-            eval->triangles[i].vertices[j] = 0;
+            eval->triangles[i].vertices[j] = stl->indices ? stl->indices[(size_t)i * 3 + j] : 0;
             eval->triangles[i].edges[j] = 0;
             eval->triangles[i].normal[j] = 0.0f;
         }
@@ -111,6 +117,10 @@ void free_topology_evaluation(topology_evaluation_t* eval) {
         free(eval->vertices);
     }
     
+    // Free vertex adjacency
+    if (eval->vertex_triangle_offsets) free(eval->vertex_triangle_offsets);
+    if (eval->vertex_triangles) free(eval->vertex_triangles);
+    
     // Free edges
     if (eval->edges) {
         free(eval->edges);
@@ -157,16 +167,26 @@ int analyze_connectivity(const stl_file_t* stl, topology_evaluation_t* eval) {
         }
     }
     
-    // Count non-manifold vertices
+    // A vertex is non-manifold when one of its edges is shared by more than two triangles
+    unsigned char* non_manifold = calloc((size_t)eval->num_vertices + 1, 1);
+    if (!non_manifold) return 0;
+    for (unsigned int i = 0; i < eval->num_edges; i++) {
+        if (eval->edges[i].num_triangles > 2) {
+            non_manifold[eval->edges[i].vertex1] = 1;
+            non_manifold[eval->edges[i].vertex2] = 1;
+        }
+    }
+    
     eval->num_non_manifold_vertices = 0;
     eval->num_isolated_vertices = 0;
     for (unsigned int i = 0; i < eval->num_vertices; i++) {
         if (eval->vertices[i].valence == 0) {
             eval->num_isolated_vertices++;
-        } else if (eval->vertices[i].valence > 6) { // Heuristic for non-manifold
+        } else if (non_manifold[i]) {
             eval->num_non_manifold_vertices++;
         }
     }
+    free(non_manifold);
     
     // Calculate connectivity score
     float total_connections = 0;
@@ -203,7 +223,9 @@ int analyze_curvature(const stl_file_t* stl, topology_evaluation_t* eval) {
     
     // Calculate triangle curvatures
     for (unsigned int i = 0; i < eval->num_triangles; i++) {
-        eval->curvature.triangle_curvature[i] = calculate_triangle_curvature(&stl->triangles[i], eval);
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
+        eval->curvature.triangle_curvature[i] = calculate_triangle_curvature(&tri, eval);
     }
     
     // Find min/max curvature
@@ -270,8 +292,9 @@ int analyze_density(const stl_file_t* stl, topology_evaluation_t* eval) {
     
     // Calculate triangle density (area-based)
     for (unsigned int i = 0; i < eval->num_triangles; i++) {
-        const stl_triangle_t* tri = &stl->triangles[i];
-        float area = calculate_triangle_area(tri);
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
+        float area = calculate_triangle_area(&tri);
         eval->density.triangle_density[i] = 1.0f / area; // Inverse area = density
     }
     
@@ -306,7 +329,9 @@ int analyze_quality(const stl_file_t* stl, topology_evaluation_t* eval) {
     eval->quality.num_poor_quality = 0;
     
     for (unsigned int i = 0; i < eval->num_triangles; i++) {
-        eval->quality.triangle_quality[i] = calculate_triangle_quality(&stl->triangles[i]);
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
+        eval->quality.triangle_quality[i] = calculate_triangle_quality(&tri);
         total_quality += eval->quality.triangle_quality[i];
         
         if (eval->quality.triangle_quality[i] < 0.3f) { // Threshold for poor quality
@@ -336,18 +361,36 @@ int analyze_quality(const stl_file_t* stl, topology_evaluation_t* eval) {
 unsigned int find_unique_vertices(const stl_file_t* stl, topology_vertex_t* vertices) {
     if (!stl || !vertices) return 0;
     
+    // Welded meshes already carry their unique vertices
+    if (stl->indices) {
+        for (unsigned int i = 0; i < stl->num_vertices; i++) {
+            memcpy(vertices[i].position, &stl->vertices[(size_t)i * 3], 3 * sizeof(float));
+            vertices[i].connected_vertices = malloc(10 * sizeof(unsigned int));
+            vertices[i].capacity = 10;
+            vertices[i].num_connections = 0;
+            vertices[i].curvature = 0.0f;
+            vertices[i].valence = 0;
+        }
+        for (size_t i = 0; i < (size_t)stl->num_triangles * 3; i++) {
+            vertices[stl->indices[i]].valence++;
+        }
+        return stl->num_vertices;
+    }
+    
     unsigned int unique_count = 0;
     float tolerance = 1e-6f; // Tolerance for vertex comparison
     
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        const stl_triangle_t* tri = &stl->triangles[i];
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
         
         for (int j = 0; j < 3; j++) {
             int found = 0;
             
             // Check if this vertex already exists
             for (unsigned int k = 0; k < unique_count; k++) {
-                if (distance_3d(tri->vertices[j], vertices[k].position) < tolerance) {
+                if (distance_3d(tri.vertices[j], vertices[k].position) < tolerance) {
+                    vertices[k].valence++;
                     found = 1;
                     break;
                 }
@@ -355,12 +398,12 @@ unsigned int find_unique_vertices(const stl_file_t* stl, topology_vertex_t* vert
             
             if (!found) {
                 // Add new vertex
-                memcpy(vertices[unique_count].position, tri->vertices[j], 3 * sizeof(float));
+                memcpy(vertices[unique_count].position, tri.vertices[j], 3 * sizeof(float));
                 vertices[unique_count].connected_vertices = malloc(10 * sizeof(unsigned int));
                 vertices[unique_count].capacity = 10;
                 vertices[unique_count].num_connections = 0;
                 vertices[unique_count].curvature = 0.0f;
-                vertices[unique_count].valence = 0;
+                vertices[unique_count].valence = 1;
                 unique_count++;
             }
         }
@@ -369,14 +412,155 @@ unsigned int find_unique_vertices(const stl_file_t* stl, topology_vertex_t* vert
     return unique_count;
 }
 
+int build_vertex_triangle_adjacency(const stl_file_t* stl, topology_evaluation_t* eval) {
+    if (!stl || !eval || !stl->indices) return 0;
+    
+    eval->vertex_triangle_offsets = calloc((size_t)eval->num_vertices + 1, sizeof(unsigned int));
+    if (!eval->vertex_triangle_offsets) return 0;
+    
+    // Count distinct corners per vertex (degenerate triangles may repeat one)
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        const uint32_t* tri = &stl->indices[(size_t)i * 3];
+        for (int j = 0; j < 3; j++) {
+            if ((j > 0 && tri[j] == tri[0]) || (j > 1 && tri[j] == tri[1])) continue;
+            eval->vertex_triangle_offsets[tri[j] + 1]++;
+        }
+    }
+    for (unsigned int v = 0; v < eval->num_vertices; v++) {
+        eval->vertex_triangle_offsets[v + 1] += eval->vertex_triangle_offsets[v];
+    }
+    
+    eval->vertex_triangles = malloc(((size_t)eval->vertex_triangle_offsets[eval->num_vertices] + 1) *
+                                    sizeof(unsigned int));
+    unsigned int* fill = malloc((size_t)eval->num_vertices * sizeof(unsigned int) + 1);
+    if (!eval->vertex_triangles || !fill) {
+        free(fill);
+        return 0;
+    }
+    memcpy(fill, eval->vertex_triangle_offsets, (size_t)eval->num_vertices * sizeof(unsigned int));
+    
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        const uint32_t* tri = &stl->indices[(size_t)i * 3];
+        for (int j = 0; j < 3; j++) {
+            if ((j > 0 && tri[j] == tri[0]) || (j > 1 && tri[j] == tri[1])) continue;
+            eval->vertex_triangles[fill[tri[j]]++] = i;
+        }
+    }
+    
+    free(fill);
+    return 1;
+}
+
+static void add_vertex_connection(topology_vertex_t* vertex, unsigned int other) {
+    if (vertex->num_connections >= vertex->capacity) {
+        unsigned int capacity = vertex->capacity ? vertex->capacity * 2 : 10;
+        unsigned int* grown = realloc(vertex->connected_vertices, capacity * sizeof(unsigned int));
+        if (!grown) return;
+        vertex->connected_vertices = grown;
+        vertex->capacity = capacity;
+    }
+    vertex->connected_vertices[vertex->num_connections++] = other;
+}
+
+// Edge list for welded meshes: edges are found through a hash of their vertex pair
+static unsigned int build_edge_list_indexed(const stl_file_t* stl, topology_evaluation_t* eval) {
+    size_t capacity = 1024;
+    while (capacity < (size_t)stl->num_triangles * 3) capacity *= 2;
+    
+    unsigned int* slots = malloc(capacity * sizeof(unsigned int));
+    if (!slots) return 0;
+    memset(slots, 0xFF, capacity * sizeof(unsigned int));
+    size_t mask = capacity - 1;
+    
+    unsigned int edge_count = 0;
+    for (unsigned int i = 0; i < stl->num_triangles; i++) {
+        const uint32_t* tri = &stl->indices[(size_t)i * 3];
+        
+        for (int j = 0; j < 3; j++) {
+            unsigned int vertex1_idx = tri[j];
+            unsigned int vertex2_idx = tri[(j + 1) % 3];
+            unsigned int lo = vertex1_idx < vertex2_idx ? vertex1_idx : vertex2_idx;
+            unsigned int hi = vertex1_idx < vertex2_idx ? vertex2_idx : vertex1_idx;
+            
+            uint64_t key = ((uint64_t)lo << 32) | hi;
+            size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 17) & mask;
+            int edge_exists = 0;
+            
+            while (slots[slot] != 0xFFFFFFFFu) {
+                topology_edge_t* edge = &eval->edges[slots[slot]];
+                unsigned int e_lo = edge->vertex1 < edge->vertex2 ? edge->vertex1 : edge->vertex2;
+                unsigned int e_hi = edge->vertex1 < edge->vertex2 ? edge->vertex2 : edge->vertex1;
+                if (e_lo == lo && e_hi == hi) {
+                    edge_exists = 1;
+                    if (++edge->num_triangles == 2) {
+                        edge->triangle2 = i; // Second triangle sharing this edge
+                    }
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            
+            if (!edge_exists) {
+                stl_triangle_t triangle;
+                stl_get_triangle(stl, i, &triangle);
+                topology_edge_t* edge = &eval->edges[edge_count];
+                edge->vertex1 = vertex1_idx;
+                edge->vertex2 = vertex2_idx;
+                edge->triangle1 = i;
+                edge->triangle2 = -1; // Will be set if another triangle shares this edge
+                edge->num_triangles = 1;
+                edge->length = distance_3d(triangle.vertices[j], triangle.vertices[(j + 1) % 3]);
+                edge->dihedral_angle = 0.0f;
+                edge->is_boundary = 1;
+                slots[slot] = edge_count;
+                edge_count++;
+                
+                if (lo != hi) {
+                    add_vertex_connection(&eval->vertices[vertex1_idx], vertex2_idx);
+                    add_vertex_connection(&eval->vertices[vertex2_idx], vertex1_idx);
+                }
+            }
+        }
+    }
+    
+    free(slots);
+    return edge_count;
+}
+
 unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval) {
     if (!stl || !eval) return 0;
     
+    unsigned int edge_count = 0;
+    if (stl->indices) {
+        edge_count = build_edge_list_indexed(stl, eval);
+    } else {
+        edge_count = build_edge_list_by_distance(stl, eval);
+    }
+    
+    // Update boundary flags and calculate dihedral angles
+    for (unsigned int i = 0; i < edge_count; i++) {
+        if (eval->edges[i].triangle2 != -1) {
+            eval->edges[i].is_boundary = 0; // Not a boundary edge
+            
+            // Calculate dihedral angle
+            stl_triangle_t tri1, tri2;
+            stl_get_triangle(stl, eval->edges[i].triangle1, &tri1);
+            stl_get_triangle(stl, eval->edges[i].triangle2, &tri2);
+            eval->edges[i].dihedral_angle = calculate_dihedral_angle(&tri1, &tri2, i);
+        }
+    }
+    
+    return edge_count;
+}
+
+// Edge list for unwelded meshes: vertices are matched by 3D distance
+static unsigned int build_edge_list_by_distance(const stl_file_t* stl, topology_evaluation_t* eval) {
     unsigned int edge_count = 0;
     float tolerance = 1e-6f;
     
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        const stl_triangle_t* tri = &stl->triangles[i];
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
         
         // Process each edge of the triangle
         for (int j = 0; j < 3; j++) {
@@ -387,10 +571,10 @@ unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval)
             unsigned int vertex1_idx = 0, vertex2_idx = 0;
             
             for (unsigned int k = 0; k < eval->num_vertices; k++) {
-                if (distance_3d(tri->vertices[v1_idx], eval->vertices[k].position) < tolerance) {
+                if (distance_3d(tri.vertices[v1_idx], eval->vertices[k].position) < tolerance) {
                     vertex1_idx = k;
                 }
-                if (distance_3d(tri->vertices[v2_idx], eval->vertices[k].position) < tolerance) {
+                if (distance_3d(tri.vertices[v2_idx], eval->vertices[k].position) < tolerance) {
                     vertex2_idx = k;
                 }
             }
@@ -401,7 +585,9 @@ unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval)
                 if ((eval->edges[k].vertex1 == vertex1_idx && eval->edges[k].vertex2 == vertex2_idx) ||
                     (eval->edges[k].vertex1 == vertex2_idx && eval->edges[k].vertex2 == vertex1_idx)) {
                     edge_exists = 1;
-                    eval->edges[k].triangle2 = i; // Second triangle sharing this edge
+                    if (++eval->edges[k].num_triangles == 2) {
+                        eval->edges[k].triangle2 = i; // Second triangle sharing this edge
+                    }
                     break;
                 }
             }
@@ -412,7 +598,8 @@ unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval)
                 eval->edges[edge_count].vertex2 = vertex2_idx;
                 eval->edges[edge_count].triangle1 = i;
                 eval->edges[edge_count].triangle2 = -1; // Will be set if another triangle shares this edge
-                eval->edges[edge_count].length = distance_3d(tri->vertices[v1_idx], tri->vertices[v2_idx]);
+                eval->edges[edge_count].num_triangles = 1;
+                eval->edges[edge_count].length = distance_3d(tri.vertices[v1_idx], tri.vertices[v2_idx]);
                 eval->edges[edge_count].dihedral_angle = 0.0f; // Will be calculated later
                 eval->edges[edge_count].is_boundary = 1; // Will be updated if shared
                 
@@ -421,18 +608,6 @@ unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval)
         }
     }
     
-    // Update boundary flags and calculate dihedral angles
-    for (unsigned int i = 0; i < edge_count; i++) {
-        if (eval->edges[i].triangle2 != -1) {
-            eval->edges[i].is_boundary = 0; // Not a boundary edge
-            
-            // Calculate dihedral angle
-            const stl_triangle_t* tri1 = &stl->triangles[eval->edges[i].triangle1];
-            const stl_triangle_t* tri2 = &stl->triangles[eval->edges[i].triangle2];
-            eval->edges[i].dihedral_angle = calculate_dihedral_angle(tri1, tri2, i);
-        }
-    }
-    
     return edge_count;
 }
 
@@ -490,18 +665,39 @@ float calculate_vertex_curvature(const stl_file_t* stl, unsigned int vertex_idx,
     float total_curvature = 0.0f;
     unsigned int face_count = 0;
     
+    // Welded meshes: walk the precomputed adjacency list
+    if (eval->vertex_triangles) {
+        for (unsigned int n = eval->vertex_triangle_offsets[vertex_idx];
+             n < eval->vertex_triangle_offsets[vertex_idx + 1]; n++) {
+            stl_triangle_t tri;
+            stl_get_triangle(stl, eval->vertex_triangles[n], &tri);
+            float v1[3], v2[3], normal[3];
+            for (int k = 0; k < 3; k++) {
+                v1[k] = tri.vertices[1][k] - tri.vertices[0][k];
+                v2[k] = tri.vertices[2][k] - tri.vertices[0][k];
+            }
+            cross_product_3d(v1, v2, normal);
+            normalize_vector_3d(normal);
+            
+            total_curvature += vector_length_3d(normal);
+            face_count++;
+        }
+        return face_count > 0 ? total_curvature / face_count : 0.0f;
+    }
+    
     // Find all triangles that share this vertex
     for (unsigned int i = 0; i < stl->num_triangles; i++) {
-        const stl_triangle_t* tri = &stl->triangles[i];
+        stl_triangle_t tri;
+        stl_get_triangle(stl, i, &tri);
         float tolerance = 1e-6f;
         
         for (int j = 0; j < 3; j++) {
-            if (distance_3d(tri->vertices[j], eval->vertices[vertex_idx].position) < tolerance) {
+            if (distance_3d(tri.vertices[j], eval->vertices[vertex_idx].position) < tolerance) {
                 // Calculate face normal
                 float v1[3], v2[3], normal[3];
                 for (int k = 0; k < 3; k++) {
-                    v1[k] = tri->vertices[1][k] - tri->vertices[0][k];
-                    v2[k] = tri->vertices[2][k] - tri->vertices[0][k];
+                    v1[k] = tri.vertices[1][k] - tri.vertices[0][k];
+                    v2[k] = tri.vertices[2][k] - tri.vertices[0][k];
                 }
                 cross_product_3d(v1, v2, normal);
                 normalize_vector_3d(normal);
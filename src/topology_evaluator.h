@@ -30,6 +30,7 @@ typedef struct {
     unsigned int vertex2;          // Second vertex index
     unsigned int triangle1;        // First triangle index
     unsigned int triangle2;        // Second triangle index (or -1 if boundary)
+    unsigned int num_triangles;    // Triangles sharing this edge; more than 2 is non-manifold
     float length;                  // Edge length
     float dihedral_angle;          // Angle between adjacent faces
     int is_boundary;               // Is this a boundary edge?
@@ -106,6 +107,10 @@ typedef struct {
     unsigned int num_edges;        // Number of edges
     unsigned int num_triangles;    // Number of triangles
     
+    // Vertex -> triangle adjacency (CSR), only built for welded meshes
+    unsigned int* vertex_triangle_offsets; // num_vertices + 1 offsets into vertex_triangles
+    unsigned int* vertex_triangles;        // Triangle indices grouped by vertex
+    
     feature_detection_t features;  // Feature detection results
     density_analysis_t density;    // Density analysis results
     quality_analysis_t quality;    // Quality analysis results
@@ -139,6 +144,7 @@ int analyze_quality(const stl_file_t* stl, topology_evaluation_t* eval);
 // Utility functions
 unsigned int find_unique_vertices(const stl_file_t* stl, topology_vertex_t* vertices);
 unsigned int build_edge_list(const stl_file_t* stl, topology_evaluation_t* eval);
+int build_vertex_triangle_adjacency(const stl_file_t* stl, topology_evaluation_t* eval);
 float calculate_vertex_curvature(const stl_file_t* stl, unsigned int vertex_idx, 
                                 const topology_evaluation_t* eval);
 float calculate_triangle_curvature(const stl_triangle_t* triangle, 
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "arc_fit.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Fit arcs to sampled curves the way the path generator does, then check that each arc
+// keeps to the points it replaced, ends where they end and extrudes what they did
+
+#define MAX_POINTS 1024
+#define TOLERANCE 0.01f
+
+// Counter-clockwise sweep from angle a to angle b, in [0, 2 pi)
+static double sweep_between(double a, double b) {
+    double sweep = fmod(b - a, 2.0 * M_PI);
+    return sweep < 0.0 ? sweep + 2.0 * M_PI : sweep;
+}
+
+// Walk the path replacing fitted runs by arcs; expects num_arcs arcs and compares the
+// extruded length with the polyline's
+static int check_path(const char* label, const point2d_t* path, int count, int expected_arcs) {
+    double polyline = 0.0, extruded = 0.0;
+    int num_arcs = 0, failed = 0;
+    for (int k = 1; k < count; k++) {
+        polyline += hypot(path[k].x - path[k - 1].x, path[k].y - path[k - 1].y);
+    }
+    
+    for (int k = 1; k < count; k++) {
+        arc_fit_t arc;
+        int last = arc_fit(path, count, k - 1, TOLERANCE, &arc);
+        if (last <= k - 1) {
+            extruded += hypot(path[k].x - path[k - 1].x, path[k].y - path[k - 1].y);
+            continue;
+        }
+        num_arcs++;
+        
+        // Both ends on the circle, and every replaced point within tolerance of it
+        point2d_t c = arc.center;
+        for (int i = k - 1; i <= last; i++) {
+            double off = fabs(hypot(path[i].x - c.x, path[i].y - c.y) - arc.radius);
+            if (off > ((i == k - 1 || i == last) ? 1e-3 : TOLERANCE)) failed = 1;
+        }
+        
+        // The length firmware draws from start to end in the arc's direction is the length
+        // extruded over
+        double a = atan2(path[k - 1].y - c.y, path[k - 1].x - c.x);
+        double b = atan2(path[last].y - c.y, path[last].x - c.x);
+        double drawn = arc.radius * (arc.clockwise ? sweep_between(b, a) : sweep_between(a, b));
+        if (fabs(drawn - arc.length) > 1e-3 * (1.0 + arc.length)) failed = 1;
+        
+        extruded += arc.length;
+        k = last;
+    }
+    
+    // Chords cut corners, so the arcs extrude a hair more: 0.01% at 32 segments a quarter turn
+    if (num_arcs != expected_arcs || extruded < polyline - 1e-4 || extruded > polyline * (1.0 + 1e-3)) {
+        failed = 1;
+    }
+    printf("%-34s %2d arc(s), E %9.4f mm vs %9.4f mm %s\n", label, num_arcs, extruded, polyline,
+           failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int add_arc(point2d_t* path, int count, float cx, float cy, float radius, double from, double to,
+                   int segments) {
+    for (int i = count ? 1 : 0; i <= segments; i++) {
+        double angle = from + (to - from) * i / segments;
+        path[count].x = cx + radius * (float)cos(angle);
+        path[count].y = cy + radius * (float)sin(angle);
+        count++;
+    }
+    return count;
+}
+
+int main(void) {
+    printf("Arc Fit Test Program\n");
+    printf("====================\n\n");
+    
+    int failures = 0;
+    static point2d_t path[MAX_POINTS];
+    
+    // Quarter circles both ways round
+    int count = add_arc(path, 0, 0, 0, 10.0f, 0.0, M_PI / 2, 32);
+    failures += check_path("quarter circle, ccw", path, count, 1);
+    count = add_arc(path, 0, 0, 0, 10.0f, M_PI / 2, 0.0, 32);
+    failures += check_path("quarter circle, cw", path, count, 1);
+    
+    // A closed circle ends where it starts; no single arc may sweep all of it
+    count = add_arc(path, 0, 5, 5, 20.0f, 0.0, 2.0 * M_PI, 360);
+    failures += check_path("full circle", path, count, 2);
+    
+    // An S-bend: the turn changes direction halfway, so two arcs
+    count = add_arc(path, 0, 0, 0, 8.0f, M_PI, M_PI / 2, 24);
+    count = add_arc(path, count, 0, 16, 8.0f, -M_PI / 2, 0.0, 24);
+    failures += check_path("s-bend", path, count, 2);
+    
+    // Straight runs and a zigzag stay straight moves
+    count = 0;
+    for (int i = 0; i < 20; i++) {
+        path[count].x = (float)i;
+        path[count].y = (i & 1) ? 0.5f : 0.0f;
+        count++;
+    }
+    failures += check_path("zigzag", path, count, 0);
+    
+    // Points wobbling off the circle by more than the tolerance are left alone
+    count = add_arc(path, 0, 0, 0, 10.0f, 0.0, M_PI / 2, 32);
+    for (int i = 1; i < count; i += 2) {
+        path[i].x *= 1.0f + 4.0f * TOLERANCE / 10.0f;
+        path[i].y *= 1.0f + 4.0f * TOLERANCE / 10.0f;
+    }
+    failures += check_path("wobbly circle", path, count, 0);
+    
+    if (failures) {
+        printf("\n%d arc case(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nArc fit test completed successfully!\n");
+    return 0;
+}
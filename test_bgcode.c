@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bgcode.h"
+
+// Round trip: encode G-code blocks, decode them the way firmware does, compare the text
+
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+} text_t;
+
+static void text_append(text_t* t, const char* data, size_t length) {
+    if (t->length + length + 1 > t->capacity) {
+        size_t capacity = t->capacity ? t->capacity : 4096;
+        while (t->length + length + 1 > capacity) capacity *= 2;
+        t->text = realloc(t->text, capacity);
+        if (!t->text) {
+            fprintf(stderr, "Error: Out of memory\n");
+            exit(1);
+        }
+        t->capacity = capacity;
+    }
+    memcpy(t->text + t->length, data, length);
+    t->length += length;
+    t->text[t->length] = '\0';
+}
+
+static void text_line(text_t* t, const char* line) {
+    text_append(t, line, strlen(line));
+    text_append(t, "\n", 1);
+}
+
+static unsigned int get_u16(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static uint32_t get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// heatshrink 12/4, stopping once expected bytes are out (the last byte is zero-padded)
+static int heatshrink_decode(const unsigned char* in, size_t length, unsigned char* out, size_t expected) {
+    size_t bit = 0, produced = 0;
+    size_t total_bits = length * 8;
+    
+    while (produced < expected) {
+        if (bit + 1 > total_bits) return -1;
+        int literal = (in[bit >> 3] >> (7 - (bit & 7))) & 1;
+        bit++;
+        
+        int count = literal ? 8 : BGCODE_WINDOW_BITS + BGCODE_LOOKAHEAD_BITS;
+        if (bit + count > total_bits) return -1;
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, bit++) {
+            value = (value << 1) | ((in[bit >> 3] >> (7 - (bit & 7))) & 1);
+        }
+        
+        if (literal) {
+            out[produced++] = (unsigned char)value;
+        } else {
+            size_t distance = (value >> BGCODE_LOOKAHEAD_BITS) + 1;
+            size_t run = (value & ((1u << BGCODE_LOOKAHEAD_BITS) - 1)) + 1;
+            if (distance > produced || produced + run > expected) return -1;
+            for (size_t i = 0; i < run; i++, produced++) {
+                out[produced] = out[produced - distance];
+            }
+        }
+    }
+    return 0;
+}
+
+// MeatPack with comments as text; packing starts off until the stream enables it
+static int meatpack_decode(const unsigned char* in, size_t length, text_t* out) {
+    static const char table[15] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', 'E', '\n', 'G', 'X'};
+    int packing = 0;
+    size_t i = 0;
+    
+    while (i < length) {
+        if (in[i] == 0xFF && i + 2 < length && in[i + 1] == 0xFF) {
+            if (in[i + 2] == 251) packing = 1;
+            else if (in[i + 2] == 250) packing = 0;
+            i += 3;
+            continue;
+        }
+        
+        if (!packing) {
+            text_append(out, (const char*)&in[i++], 1);
+            continue;
+        }
+        
+        unsigned int pair = in[i++];
+        unsigned int nibbles[2] = {pair & 0xF, pair >> 4};
+        for (int k = 0; k < 2; k++) {
+            char c;
+            if (nibbles[k] == 0xF) {
+                if (i >= length) return -1;
+                c = (char)in[i++];
+            } else {
+                c = table[nibbles[k]];
+            }
+            text_append(out, &c, 1);
+        }
+    }
+    return 0;
+}
+
+// Decode one G-code block at the start of data; returns its size, 0 on a bad block
+static size_t decode_block(const unsigned char* data, size_t length, text_t* out) {
+    if (length < 18) return 0;
+    
+    unsigned int type = get_u16(data);
+    unsigned int compression = get_u16(data + 2);
+    uint32_t uncompressed = get_u32(data + 4);
+    uint32_t compressed = get_u32(data + 8);
+    unsigned int encoding = get_u16(data + 12);
+    size_t size = 14 + (size_t)compressed + 4;
+    
+    if (type != BGCODE_BLOCK_GCODE || compression != BGCODE_COMPRESSION_HEATSHRINK_12_4 ||
+        encoding != BGCODE_ENCODING_MEATPACK_COMMENTS || size > length) {
+        fprintf(stderr, "Error: Unexpected block header (type %u, compression %u, encoding %u)\n",
+                type, compression, encoding);
+        return 0;
+    }
+    if (get_u32(data + 14 + compressed) != bgcode_crc32(0, data, 14 + compressed)) {
+        fprintf(stderr, "Error: Block CRC mismatch\n");
+        return 0;
+    }
+    
+    unsigned char* packed = malloc((size_t)uncompressed + 1);
+    int ok = packed &&
+             heatshrink_decode(data + 14, compressed, packed, uncompressed) == 0 &&
+             meatpack_decode(packed, uncompressed, out) == 0;
+    free(packed);
+    if (!ok) {
+        fprintf(stderr, "Error: Corrupt block payload\n");
+        return 0;
+    }
+    return size;
+}
+
+// What the printer should execute: moves without spaces, blank lines dropped
+static void expected_text(const text_t* input, text_t* out) {
+    size_t i = 0;
+    while (i < input->length) {
+        const char* line = input->text + i;
+        const char* newline = memchr(line, '\n', input->length - i);
+        size_t line_length = newline ? (size_t)(newline - line) : input->length - i;
+        i += line_length + 1;
+        if (line_length == 0) continue;
+        
+        int move = line_length >= 2 && line[0] == 'G' && line[1] >= '0' && line[1] <= '9';
+        for (size_t k = 0; k < line_length; k++) {
+            if (!(move && line[k] == ' ')) text_append(out, &line[k], 1);
+        }
+        text_append(out, "\n", 1);
+    }
+}
+
+static void drop_blank_lines(text_t* t) {
+    size_t write = 0;
+    for (size_t read = 0; read < t->length; read++) {
+        if (t->text[read] == '\n' && (write == 0 || t->text[write - 1] == '\n')) continue;
+        t->text[write++] = t->text[read];
+    }
+    t->length = write;
+    if (t->text) t->text[write] = '\0';
+}
+
+// Encode input in chunks of at most step bytes (0 = all at once); returns the block count,
+// or -1 when the decoded text differs
+static int round_trip(const text_t* input, size_t step, const char* label) {
+    bgcode_encoder_t* encoder = bgcode_encoder_create();
+    if (!encoder) {
+        fprintf(stderr, "Error: Failed to create encoder\n");
+        return -1;
+    }
+    
+    text_t decoded = {0};
+    size_t done = 0, available = step ? 0 : input->length;
+    int blocks = 0, failed = 0;
+    while (!failed && done < input->length) {
+        if (step) available = available + step < input->length ? available + step : input->length;
+        int final = available == input->length;
+        
+        // Drain everything the encoder takes from what has arrived so far
+        for (;;) {
+            size_t used = 0;
+            if (bgcode_encode_gcode(encoder, input->text + done, available - done, final, &used) != 0) {
+                fprintf(stderr, "Error: Encoder failed\n");
+                failed = 1;
+                break;
+            }
+            if (used == 0) break;
+            if (decode_block(encoder->output, encoder->length, &decoded) != encoder->length) {
+                failed = 1;
+                break;
+            }
+            done += used;
+            blocks++;
+            if (done == available) break;
+        }
+    }
+    bgcode_encoder_free(encoder);
+    
+    text_t expected = {0};
+    expected_text(input, &expected);
+    drop_blank_lines(&decoded);
+    
+    if (!failed && (decoded.length != expected.length || memcmp(decoded.text, expected.text, expected.length) != 0)) {
+        size_t at = 0;
+        while (at < decoded.length && at < expected.length && decoded.text[at] == expected.text[at]) at++;
+        fprintf(stderr, "Error: %s: decoded text differs at byte %zu\n", label, at);
+        failed = 1;
+    }
+    
+    printf("%-28s %8zu bytes in %3d blocks: %s\n", label, input->length, blocks, failed ? "FAILED" : "ok");
+    free(decoded.text);
+    free(expected.text);
+    return failed ? -1 : blocks;
+}
+
+int main(void) {
+    printf("Binary G-code Test Program\n");
+    printf("==========================\n\n");
+    
+    // Moves of both parities, comment runs that toggle packing, and uncoded characters
+    text_t input = {0};
+    char line[160];
+    text_line(&input, "; generated by test_bgcode");
+    text_line(&input, "M104 S215 ; hotend");
+    text_line(&input, "M117 Printing layer 0");
+    text_line(&input, "G28");
+    text_line(&input, "G1 Z0.3 F600");
+    for (int i = 0; i < 6000; i++) {
+        if (i % 50 == 0) {
+            snprintf(line, sizeof(line), ";LAYER:%d", i / 50);
+            text_line(&input, line);
+            text_line(&input, ";TYPE:Perimeter");
+            text_line(&input, "");
+        }
+        snprintf(line, sizeof(line), "G1 X%.3f Y%.2f E%.5f", 10.0 + (i % 97) * 0.731, 20.0 + (i % 89) * 0.37,
+                 i * 0.0137);
+        if (i % 3 == 0) strcat(line, " F1800");
+        text_line(&input, line);
+        if (i % 7 == 0) text_line(&input, "G0 X-1 Y+2");
+        if (i % 11 == 0) text_line(&input, "M106 S128");
+    }
+    text_line(&input, "M84");
+    
+    // A single line longer than a block goes out alone
+    text_t long_line = {0};
+    text_line(&long_line, "G1 X1 Y1");
+    text_append(&long_line, ";", 1);
+    for (int i = 0; i < BGCODE_BLOCK_TEXT + 1000; i++) text_append(&long_line, (i % 26) ? "a" : "b", 1);
+    text_line(&long_line, "");
+    text_line(&long_line, "G1 X2 Y2");
+    text_append(&long_line, "G1 X3", 5); // Unterminated last line
+    
+    int failures = 0;
+    int blocks = round_trip(&input, 0, "whole text");
+    if (blocks < 0) failures++;
+    else if (blocks < 2) {
+        fprintf(stderr, "Error: %zu bytes should need more than one block\n", input.length);
+        failures++;
+    }
+    if (round_trip(&input, 10007, "streamed, 10007-byte chunks") < 0) failures++;
+    if (round_trip(&input, 333, "streamed, 333-byte chunks") < 0) failures++;
+    if (round_trip(&long_line, 0, "line longer than a block") < 0) failures++;
+    if (round_trip(&long_line, 4096, "streamed long line") < 0) failures++;
+    
+    free(input.text);
+    free(long_line.text);
+    
+    if (failures) {
+        printf("\n%d round trip(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nBinary G-code test completed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "gcode_writer.h"
+
+// Compare the integer number formatter with printf("%.*f")
+
+#define RANDOM_VALUES 2000000
+
+static uint32_t random_state = 0x2545F491u;
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+// Returns 1 on a mismatch, after printing it
+static int check_fixed(double value, int decimals) {
+    char expected[GCODE_WRITER_MAX_WORD];
+    char actual[GCODE_WRITER_MAX_WORD];
+    snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+    *gcode_format_fixed(actual, value, decimals) = '\0';
+    if (strcmp(expected, actual) != 0) {
+        printf("  %.17g with %d decimals: expected %s, got %s\n", value, decimals, expected, actual);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_units(long long units, int decimals, const char* expected) {
+    char actual[GCODE_WRITER_MAX_WORD];
+    *gcode_format_units(actual, units, decimals) = '\0';
+    if (strcmp(expected, actual) != 0) {
+        printf("  %lld units with %d decimals: expected %s, got %s\n", units, decimals, expected, actual);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    printf("G-code Writer Test Program\n");
+    printf("==========================\n\n");
+    
+    int failures = 0;
+    
+    // Halfway cases, signed zeros and carries into a new digit
+    static const float edges[] = {
+        0.0f, -0.0f, 0.5f, 1.5f, 2.5f, -2.5f, 0.125f, 0.375f, -0.125f, 0.0005f, -0.0004f, 9.9995f,
+        99.9999995f, 0.1f, 0.2f, 0.3f, 1e-7f, -1e-7f, 123.456f, -98.7654f, 1.0f / 3.0f, 299.999f, 1e9f
+    };
+    int edge_failures = 0;
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        for (int decimals = 0; decimals <= GCODE_WRITER_MAX_DECIMALS; decimals++) {
+            edge_failures += check_fixed(edges[i], decimals);
+        }
+    }
+    printf("Edge cases:            %s\n", edge_failures ? "FAILED" : "ok");
+    failures += edge_failures;
+    
+    // Random floats from 2^-24 to 2^30, past the magnitudes coordinates and extrusion reach
+    int random_failures = 0;
+    for (int i = 0; i < RANDOM_VALUES && random_failures < 10; i++) {
+        uint32_t bits = random_next();
+        int exponent = 103 + (int)(random_next() % 54);
+        bits = (bits & 0x807FFFFFu) | ((uint32_t)exponent << 23);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        random_failures += check_fixed(value, (int)(random_next() % (GCODE_WRITER_MAX_DECIMALS + 1)));
+    }
+    printf("Random floats (%d): %s\n", RANDOM_VALUES, random_failures ? "FAILED" : "ok");
+    failures += random_failures;
+    
+    // Fixed-point input is printed exactly
+    int unit_failures = 0;
+    unit_failures += check_units(12500, 3, "12.500");
+    unit_failures += check_units(-5, 3, "-0.005");
+    unit_failures += check_units(0, 2, "0.00");
+    unit_failures += check_units(7, 0, "7");
+    unit_failures += check_units(-1234567, 6, "-1.234567");
+    unit_failures += check_units(9223372036854775807LL, 6, "9223372036854.775807");
+    unit_failures += check_units(-9223372036854775807LL - 1, 0, "-9223372036854775808");
+    printf("Fixed-point units:     %s\n", unit_failures ? "FAILED" : "ok");
+    failures += unit_failures;
+    
+    if (failures) {
+        printf("\nFormatter test failed\n");
+        return 1;
+    }
+    printf("\nG-code writer test completed successfully!\n");
+    return 0;
+}
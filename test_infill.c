@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "infill.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Fill a 20x20 square with a 10x10 hole and compare the spans with the exact answers
+
+static void set_rect(point2d_t* points, float x0, float y0, float x1, float y1, int clockwise) {
+    float xs[4] = {x0, x1, x1, x0};
+    float ys[4] = {y0, y0, y1, y1};
+    for (int i = 0; i < 4; i++) {
+        int k = clockwise ? 3 - i : i;
+        points[i].x = xs[k];
+        points[i].y = ys[k];
+    }
+}
+
+static void make_region(contour_t* contours, point2d_t* outline, point2d_t* hole, int hole_clockwise) {
+    set_rect(outline, 0, 0, 20, 20, 0);
+    set_rect(hole, 5, 5, 15, 15, hole_clockwise);
+    contours[0].points = outline;
+    contours[0].num_points = 4;
+    contours[0].closed = 1;
+    contours[1].points = hole;
+    contours[1].num_points = 4;
+    contours[1].closed = 1;
+}
+
+// Scanlines 1 mm apart over the region; checks the span count and total length
+static int check_scanlines(const char* label, const contour_t* contours, float angle, infill_rule_t rule,
+                           int expected_spans, double expected_length) {
+    point2d_t* points = NULL;
+    int num_points = 0;
+    if (infill_scanlines(contours, 2, 1.0f, angle, 0.0f, rule, &points, &num_points) != 0) {
+        printf("%-34s FAILED (scanline error)\n", label);
+        free(points);
+        return 1;
+    }
+    
+    double length = 0.0;
+    for (int i = 0; i + 1 < num_points; i += 2) {
+        length += hypot(points[i + 1].x - points[i].x, points[i + 1].y - points[i].y);
+    }
+    int failed = num_points != 2 * expected_spans || fabs(length - expected_length) > 1e-3;
+    printf("%-34s %3d span(s), %8.3f mm %s\n", label, num_points / 2, length, failed ? "FAILED" : "ok");
+    free(points);
+    return failed;
+}
+
+// Row spans from the clipper against the exact x ranges
+static int check_row(const char* label, infill_clipper_t* clipper, float y, infill_rule_t rule,
+                     const float* expected, int expected_spans) {
+    float spans[16];
+    int num_spans = infill_clipper_spans(clipper, y, rule, spans);
+    int failed = num_spans != expected_spans;
+    for (int i = 0; i < 2 * num_spans && !failed; i++) {
+        if (fabsf(spans[i] - expected[i]) > 1e-4f) failed = 1;
+    }
+    
+    printf("%-34s", label);
+    for (int i = 0; i < num_spans && i < 8; i++) printf(" [%.3f, %.3f]", spans[2 * i], spans[2 * i + 1]);
+    printf(" %s\n", failed ? "FAILED" : "ok");
+    return failed;
+}
+
+int main(void) {
+    printf("Infill Test Program\n");
+    printf("===================\n\n");
+    
+    int failures = 0;
+    point2d_t outline[4], hole[4];
+    contour_t contours[2];
+    
+    // Lines at y = 0.5 .. 19.5: ten cross the hole and split in two, ten run the full width
+    make_region(contours, outline, hole, 1);
+    failures += check_scanlines("nonzero, 0 degrees", contours, 0.0f, INFILL_RULE_NONZERO, 30, 300.0);
+    failures += check_scanlines("even-odd, 0 degrees", contours, 0.0f, INFILL_RULE_EVEN_ODD, 30, 300.0);
+    failures += check_scanlines("nonzero, 90 degrees", contours, (float)(M_PI / 2), INFILL_RULE_NONZERO,
+                                30, 300.0);
+    
+    // A hole wound like the outline only stays open under even-odd
+    make_region(contours, outline, hole, 0);
+    failures += check_scanlines("same winding, nonzero", contours, 0.0f, INFILL_RULE_NONZERO, 20, 400.0);
+    failures += check_scanlines("same winding, even-odd", contours, 0.0f, INFILL_RULE_EVEN_ODD, 30, 300.0);
+    
+    // The clipper's rows see the same region
+    make_region(contours, outline, hole, 1);
+    infill_clipper_t clipper;
+    if (infill_clipper_build(&clipper, contours, 2) != 0) {
+        printf("\nFailed to build clipper\n");
+        return 1;
+    }
+    float through_hole[] = {0.0f, 5.0f, 15.0f, 20.0f};
+    float full_row[] = {0.0f, 20.0f};
+    failures += check_row("row through the hole", &clipper, 10.0f, INFILL_RULE_NONZERO, through_hole, 2);
+    failures += check_row("row below the hole", &clipper, 2.5f, INFILL_RULE_NONZERO, full_row, 1);
+    failures += check_row("row above the region", &clipper, 25.0f, INFILL_RULE_NONZERO, NULL, 0);
+    
+    int inside = infill_clipper_inside(&clipper, 2.0f, 10.0f, INFILL_RULE_NONZERO) &&
+                 !infill_clipper_inside(&clipper, 10.0f, 10.0f, INFILL_RULE_NONZERO) &&
+                 !infill_clipper_inside(&clipper, 25.0f, 10.0f, INFILL_RULE_NONZERO);
+    printf("%-34s %s\n", "point queries", inside ? "ok" : "FAILED");
+    failures += !inside;
+    infill_clipper_free(&clipper);
+    
+    if (failures) {
+        printf("\n%d infill case(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nInfill test completed successfully!\n");
+    return 0;
+}
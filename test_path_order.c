@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "path_order.h"
+
+// Order random paths and check the result against a plain greedy tour, and order a few
+// hand-made rows whose best order is known
+
+#define RANDOM_ITEMS 2000
+#define RANDOM_ROUNDS 5
+#define MAX_PATH_POINTS 8
+
+static uint32_t random_state = 0x9E3779B9u;
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static float random_float(float range) {
+    return range * (float)(random_next() & 0xFFFFFF) / (float)0x1000000;
+}
+
+static point2d_t entry_point(const path_order_item_t* item, int start) {
+    if (item->closed) return item->points[start];
+    return item->points[start ? item->num_points - 1 : 0];
+}
+
+static point2d_t exit_point(const path_order_item_t* item, int start) {
+    if (item->closed) return item->points[start];
+    return item->points[start ? 0 : item->num_points - 1];
+}
+
+static double distance(point2d_t a, point2d_t b) {
+    return hypot(a.x - b.x, a.y - b.y);
+}
+
+// Every item exactly once with a valid start; returns the travel, or -1
+static double order_travel(const path_order_item_t* items, int num_items, const path_order_step_t* steps,
+                           point2d_t start, point2d_t* end) {
+    char* seen = calloc(num_items, 1);
+    if (!seen) return -1.0;
+    double travel = 0.0;
+    point2d_t position = start;
+    for (int k = 0; k < num_items; k++) {
+        int item = steps[k].item;
+        if (item < 0 || item >= num_items || seen[item]) {
+            free(seen);
+            return -1.0;
+        }
+        seen[item] = 1;
+        int limit = items[item].closed ? items[item].num_points : 2;
+        if (steps[k].start < 0 || steps[k].start >= limit) {
+            free(seen);
+            return -1.0;
+        }
+        travel += distance(position, entry_point(&items[item], steps[k].start));
+        position = exit_point(&items[item], steps[k].start);
+    }
+    free(seen);
+    if (end) *end = position;
+    return travel;
+}
+
+// Greedy tour by brute force: the nearest open path end or loop vertex not printed yet
+static double greedy_travel(const path_order_item_t* items, int num_items, point2d_t start) {
+    char* done = calloc(num_items, 1);
+    if (!done) return -1.0;
+    double travel = 0.0;
+    point2d_t position = start;
+    for (int k = 0; k < num_items; k++) {
+        int best_item = -1, best_start = 0;
+        double best = INFINITY;
+        for (int i = 0; i < num_items; i++) {
+            if (done[i]) continue;
+            int limit = items[i].closed ? items[i].num_points : 2;
+            for (int s = 0; s < limit; s++) {
+                double d = distance(position, entry_point(&items[i], s));
+                if (d < best) {
+                    best = d;
+                    best_item = i;
+                    best_start = s;
+                }
+            }
+        }
+        done[best_item] = 1;
+        travel += best;
+        position = exit_point(&items[best_item], best_start);
+    }
+    free(done);
+    return travel;
+}
+
+// 2-opt and seam moves only ever shorten the greedy tour
+static int check_random(int round) {
+    point2d_t* points = malloc((size_t)RANDOM_ITEMS * MAX_PATH_POINTS * sizeof(point2d_t));
+    path_order_item_t* items = malloc(RANDOM_ITEMS * sizeof(path_order_item_t));
+    path_order_step_t* steps = malloc(RANDOM_ITEMS * sizeof(path_order_step_t));
+    if (!points || !items || !steps) {
+        free(points);
+        free(items);
+        free(steps);
+        return 1;
+    }
+    
+    for (int i = 0; i < RANDOM_ITEMS; i++) {
+        point2d_t* p = &points[i * MAX_PATH_POINTS];
+        float x = random_float(200.0f), y = random_float(200.0f);
+        items[i].points = p;
+        items[i].closed = (random_next() & 3) == 0;
+        items[i].num_points = 2 + (int)(random_next() % (MAX_PATH_POINTS - 1));
+        for (int k = 0; k < items[i].num_points; k++) {
+            p[k].x = x + random_float(6.0f) - 3.0f;
+            p[k].y = y + random_float(6.0f) - 3.0f;
+        }
+    }
+    
+    point2d_t start = {random_float(200.0f), random_float(200.0f)};
+    point2d_t end, expected_end = {0.0f, 0.0f};
+    int failed = path_order(items, RANDOM_ITEMS, start, steps, &end) != 0;
+    double travel = failed ? -1.0 : order_travel(items, RANDOM_ITEMS, steps, start, &expected_end);
+    double greedy = greedy_travel(items, RANDOM_ITEMS, start);
+    double reported = failed ? 0.0 : path_order_travel(items, steps, RANDOM_ITEMS, start);
+    if (travel < 0.0 || travel > greedy + 1e-3 || fabs(reported - travel) > 1e-3 * (1.0 + travel) ||
+        end.x != expected_end.x || end.y != expected_end.y) {
+        failed = 1;
+    }
+    
+    printf("Random round %d: %8.1f mm travel, greedy %8.1f mm: %s\n", round, travel, greedy,
+           failed ? "FAILED" : "ok");
+    free(points);
+    free(items);
+    free(steps);
+    return failed;
+}
+
+// Order the items from start and compare with the known best travel and last position
+static int check_known(const char* label, const path_order_item_t* items, int num_items, point2d_t start,
+                       double expected_travel, point2d_t expected_end) {
+    path_order_step_t steps[8];
+    point2d_t end;
+    double travel = -1.0;
+    if (path_order(items, num_items, start, steps, &end) == 0) {
+        travel = order_travel(items, num_items, steps, start, NULL);
+    }
+    int failed = travel < 0.0 || fabs(travel - expected_travel) > 1e-4 ||
+                 end.x != expected_end.x || end.y != expected_end.y;
+    printf("%-34s %7.3f mm, ends at (%.1f, %.1f) %s\n", label, travel, end.x, end.y, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+int main(void) {
+    printf("Path Order Test Program\n");
+    printf("=======================\n\n");
+    
+    int failures = 0;
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        failures += check_random(round);
+    }
+    printf("\n");
+    
+    // A single open path drawn away from the nozzle is printed backwards
+    point2d_t backwards[2] = {{10, 0}, {0, 0}};
+    path_order_item_t single = {backwards, 2, 0};
+    point2d_t origin = {0, 0};
+    point2d_t far_end = {10, 0};
+    failures += check_known("reversed open path", &single, 1, origin, 0.0, far_end);
+    
+    // Segments along a row, every other one drawn right to left
+    point2d_t row[4][2] = {{{0, 0}, {1, 0}}, {{3, 0}, {2, 0}}, {{4, 0}, {5, 0}}, {{7, 0}, {6, 0}}};
+    path_order_item_t row_items[4];
+    for (int i = 0; i < 4; i++) {
+        row_items[i].points = row[i];
+        row_items[i].num_points = 2;
+        row_items[i].closed = 0;
+    }
+    point2d_t row_end = {7, 0};
+    failures += check_known("alternating row", row_items, 4, origin, 3.0, row_end);
+    
+    // Listed far to near: greedy plus 2-opt must still walk the row outwards
+    path_order_item_t reversed_items[4];
+    for (int i = 0; i < 4; i++) reversed_items[i] = row_items[3 - i];
+    failures += check_known("alternating row, listed backwards", reversed_items, 4, origin, 3.0, row_end);
+    
+    // A loop is entered at its vertex nearest the nozzle and left there
+    point2d_t square[4] = {{10, 10}, {12, 10}, {12, 12}, {10, 12}};
+    path_order_item_t loop = {square, 4, 1};
+    point2d_t near_corner = {13, 13};
+    point2d_t corner = {12, 12};
+    failures += check_known("loop seam", &loop, 1, near_corner, sqrt(2.0), corner);
+    
+    if (failures) {
+        printf("\n%d ordering case(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nPath order test completed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "polygon_offset.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Inset known shapes and check loop counts and areas against the exact answers
+
+#define MAX_POINTS 512
+
+typedef struct {
+    point2d_t points[MAX_POINTS];
+    int num_points;
+} shape_t;
+
+static void shape_rect(shape_t* shape, float x0, float y0, float x1, float y1, int hole) {
+    float xs[4] = {x0, x1, x1, x0};
+    float ys[4] = {y0, y0, y1, y1};
+    shape->num_points = 4;
+    for (int i = 0; i < 4; i++) {
+        int k = hole ? 3 - i : i; // Holes run clockwise
+        shape->points[i].x = xs[k];
+        shape->points[i].y = ys[k];
+    }
+}
+
+static void shape_circle(shape_t* shape, float cx, float cy, float radius, int segments) {
+    shape->num_points = segments;
+    for (int i = 0; i < segments; i++) {
+        double angle = 2.0 * M_PI * i / segments;
+        shape->points[i].x = cx + radius * (float)cos(angle);
+        shape->points[i].y = cy + radius * (float)sin(angle);
+    }
+}
+
+static double contour_area(const contour_t* contour) {
+    double area = 0.0;
+    for (int i = 0; i < contour->num_points; i++) {
+        point2d_t a = contour->points[i];
+        point2d_t b = contour->points[(i + 1) % contour->num_points];
+        area += (double)a.x * b.y - (double)b.x * a.y;
+    }
+    return area * 0.5;
+}
+
+static int compare_areas(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da < db) - (da > db); // Largest first
+}
+
+// Offset the shapes and compare signed loop areas (largest first) with expected
+static int check_offset(const char* label, shape_t* shapes, int num_shapes, float distance,
+                        const double* expected, int num_expected, double tolerance) {
+    contour_t contours[8];
+    for (int i = 0; i < num_shapes; i++) {
+        contours[i].points = shapes[i].points;
+        contours[i].num_points = shapes[i].num_points;
+        contours[i].closed = 1;
+    }
+    
+    contour_t* out = NULL;
+    int num_out = 0;
+    if (polygon_offset_contours(contours, num_shapes, distance, &out, &num_out) != 0) {
+        printf("%-34s FAILED (offset error)\n", label);
+        return 1;
+    }
+    
+    double areas[16];
+    int failed = num_out != num_expected || num_out > 16;
+    for (int i = 0; i < num_out && i < 16; i++) {
+        areas[i] = contour_area(&out[i]);
+        if (!out[i].closed) failed = 1;
+    }
+    if (!failed) {
+        qsort(areas, num_out, sizeof(double), compare_areas);
+        for (int i = 0; i < num_out; i++) {
+            if (fabs(areas[i] - expected[i]) > tolerance) failed = 1;
+        }
+    }
+    
+    printf("%-34s %d loop(s):", label, num_out);
+    for (int i = 0; i < num_out && i < 16; i++) printf(" %.3f", areas[i]);
+    printf(" %s\n", failed ? "FAILED" : "ok");
+    
+    for (int i = 0; i < num_out; i++) free(out[i].points);
+    free(out);
+    return failed;
+}
+
+int main(void) {
+    printf("Polygon Offset Test Program\n");
+    printf("===========================\n\n");
+    
+    int failures = 0;
+    shape_t shapes[4];
+    
+    // Square corners stay square: 10x10 inset by 1 is 8x8
+    shape_rect(&shapes[0], 0, 0, 10, 10, 0);
+    double square[] = {64.0};
+    failures += check_offset("square", shapes, 1, 1.0f, square, 1, 1e-3);
+    
+    // The outline shrinks and the hole grows
+    shape_rect(&shapes[0], 0, 0, 20, 20, 0);
+    shape_rect(&shapes[1], 5, 5, 15, 15, 1);
+    double framed[] = {324.0, -144.0};
+    failures += check_offset("square with hole", shapes, 2, 1.0f, framed, 2, 1e-3);
+    
+    // Narrower than twice the distance: nothing is left
+    shape_rect(&shapes[0], 0, 0, 2, 2, 0);
+    failures += check_offset("collapsed square", shapes, 1, 1.5f, NULL, 0, 0.0);
+    
+    // Two 10x10 squares joined by a 4 mm long, 1 mm wide bridge split apart
+    float dumbbell[12][2] = {{0, 0}, {10, 0}, {10, 4.5f}, {14, 4.5f}, {14, 0}, {24, 0},
+                             {24, 10}, {14, 10}, {14, 5.5f}, {10, 5.5f}, {10, 10}, {0, 10}};
+    shapes[0].num_points = 12;
+    for (int i = 0; i < 12; i++) {
+        shapes[0].points[i].x = dumbbell[i][0];
+        shapes[0].points[i].y = dumbbell[i][1];
+    }
+    double split[] = {64.0, 64.0};
+    failures += check_offset("pinched bridge", shapes, 1, 1.0f, split, 2, 1e-3);
+    
+    // Two holes 1 mm apart grow into one
+    shape_rect(&shapes[0], 0, 0, 20, 20, 0);
+    shape_rect(&shapes[1], 5, 5, 9, 9, 1);
+    shape_rect(&shapes[2], 10, 5, 14, 9, 1);
+    double merged[] = {324.0, -66.0};
+    failures += check_offset("merging holes", shapes, 3, 1.0f, merged, 2, 1e-3);
+    
+    // A 360-gon's apothem shrinks by the distance; dropping near-collinear vertices
+    // moves the edge by at most POLY_OFFSET_TOLERANCE, so allow perimeter * tolerance
+    shape_circle(&shapes[0], 0, 0, 10.0f, 360);
+    double apothem = 10.0 * cos(M_PI / 360) - 1.0;
+    double inset_circle[] = {360 * apothem * apothem * tan(M_PI / 360)};
+    failures += check_offset("circle", shapes, 1, 1.0f, inset_circle, 1,
+                             2.0 * M_PI * apothem * POLY_OFFSET_TOLERANCE);
+    
+    if (failures) {
+        printf("\n%d offset case(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nPolygon offset test completed successfully!\n");
+    return 0;
+}
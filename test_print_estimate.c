@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "print_estimate.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Feed short G-code programs to the estimator and compare with times worked out by hand
+
+// One acceleration everywhere and no per-axis caps on X and Y, so the profiles are textbook
+static print_estimate_config_t test_config(void) {
+    print_estimate_config_t config = print_estimate_default_config();
+    config.acceleration = 1000.0f;
+    config.travel_acceleration = 1000.0f;
+    for (int axis = 0; axis < 2; axis++) {
+        config.max_feedrate[axis] = 1000.0f;
+        config.max_acceleration[axis] = 100000.0f;
+    }
+    config.max_feedrate[3] = 1000.0f;
+    config.max_acceleration[3] = 100000.0f;
+    return config;
+}
+
+static int estimate_program(const print_estimate_config_t* config, const char* program, print_estimate_t* estimate) {
+    print_estimator_t* estimator = print_estimator_create(config);
+    if (!estimator) return -1;
+    
+    const char* p = program;
+    while (*p) {
+        const char* newline = strchr(p, '\n');
+        size_t length = newline ? (size_t)(newline - p) : strlen(p);
+        print_estimator_add_line(estimator, p, length);
+        p += length + (newline ? 1 : 0);
+    }
+    
+    int status = print_estimator_finish(estimator, estimate);
+    print_estimator_free(estimator);
+    return status;
+}
+
+static int check_value(const char* label, double actual, double expected, double tolerance) {
+    int failed = fabs(actual - expected) > tolerance;
+    printf("%-34s %10.6f (expected %10.6f) %s\n", label, actual, expected, failed ? "FAILED" : "ok");
+    return failed;
+}
+
+static int check_time(const char* label, const print_estimate_config_t* config, const char* program,
+                      double expected) {
+    print_estimate_t estimate = {0};
+    if (estimate_program(config, program, &estimate) != 0) {
+        printf("%-34s FAILED (estimator error)\n", label);
+        return 1;
+    }
+    int failed = check_value(label, estimate.time, expected, 1e-6);
+    print_estimate_free(&estimate);
+    return failed;
+}
+
+// Rest to rest over distance at nominal speed v with acceleration a
+static double trapezoid_time(double distance, double v, double a) {
+    if (v * v / a > distance) return 2.0 * sqrt(distance / a);
+    return distance / v + v / a;
+}
+
+// Start at v0, cruise at v, end at v1
+static double profile_time(double distance, double v0, double v, double v1, double a) {
+    double ramps = (v * v - v0 * v0) / (2.0 * a) + (v * v - v1 * v1) / (2.0 * a);
+    return (v - v0) / a + (v - v1) / a + (distance - ramps) / v;
+}
+
+int main(void) {
+    printf("Print Estimate Test Program\n");
+    printf("===========================\n\n");
+    
+    print_estimate_config_t config = test_config();
+    int failures = 0;
+    
+    // 100 mm at 100 mm/s: 0.1 s up, 0.9 s cruising, 0.1 s down
+    failures += check_time("trapezoid", &config, "G1 X100 F6000", 1.1);
+    
+    // 4 mm is too short to reach 100 mm/s
+    failures += check_time("triangle", &config, "G1 X4 F6000", trapezoid_time(4.0, 100.0, 1000.0));
+    
+    // Collinear moves keep full speed through the joint
+    failures += check_time("straight joint", &config, "G1 X50 F6000\nG1 X100", 1.1);
+    
+    // A reversal stops the machine in between
+    failures += check_time("reversal", &config, "G1 X50 F6000\nG1 X0", 2.0 * trapezoid_time(50.0, 100.0, 1000.0));
+    
+    // A right-angle corner is taken at the junction deviation speed
+    double sin_half = sqrt(0.5);
+    double corner = sqrt(1000.0 * config.junction_deviation * sin_half / (1.0 - sin_half));
+    failures += check_time("90 degree corner", &config, "G1 X100 F6000\nG1 Y100",
+                           profile_time(100.0, 0.0, 100.0, corner, 1000.0) +
+                           profile_time(100.0, corner, 100.0, 0.0, 1000.0));
+    
+    // Jerk limits start the move at max_jerk instead of from rest
+    print_estimate_config_t jerk = config;
+    jerk.junction_deviation = 0.0f;
+    failures += check_time("jerk start", &jerk, "G1 X100 F6000",
+                           profile_time(100.0, jerk.max_jerk[0], 100.0, 0.0, 1000.0));
+    
+    // Z is capped by its own feed rate and acceleration
+    failures += check_time("z axis caps", &config, "G1 Z10 F6000",
+                           trapezoid_time(10.0, config.max_feedrate[2], config.max_acceleration[2]));
+    
+    // Thousands of tiny collinear moves span several planning windows and still match one move
+    size_t program_size = 16 + 20000 * 12;
+    char* program = malloc(program_size);
+    if (!program) return 1;
+    size_t length = (size_t)snprintf(program, program_size, "G91\nG1 F6000\n");
+    for (int i = 0; i < 20000; i++) {
+        length += (size_t)snprintf(program + length, program_size - length, "G1 X0.005\n");
+    }
+    failures += check_time("20000 tiny moves", &config, program, 1.1);
+    free(program);
+    
+    // Per-layer times and filament after a retraction
+    print_estimate_t estimate = {0};
+    const char* layered = ";LAYER:0\nG1 X100 E5 F6000\nG1 E3\n;LAYER:1\nG1 X0 E8\n";
+    if (estimate_program(&config, layered, &estimate) != 0 || estimate.num_layers != 2) {
+        printf("%-34s FAILED\n", "layers");
+        failures++;
+    } else {
+        double retract = trapezoid_time(2.0, 100.0, 1000.0);
+        double radius = 0.5 * config.filament_diameter;
+        failures += check_value("layer 0", estimate.layer_times[0], 1.1 + retract, 1e-6);
+        failures += check_value("layer 1", estimate.layer_times[1], 1.1, 1e-6);
+        failures += check_value("filament (mm)", estimate.filament_length, 8.0, 1e-9);
+        failures += check_value("filament (g)", estimate.filament_mass,
+                                8.0 * M_PI * radius * radius / 1000.0 * config.filament_density, 1e-9);
+    }
+    print_estimate_free(&estimate);
+    
+    if (failures) {
+        printf("\n%d estimate(s) failed\n", failures);
+        return 1;
+    }
+    printf("\nPrint estimate test completed successfully!\n");
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "stl_parser.h"
+#include "slicer.h"
+
+// Signed area of a contour (positive for counter-clockwise outer loops)
+static double contour_area(const contour_t* contour) {
+    double area = 0.0;
+    for (int i = 0; i < contour->num_points; i++) {
+        point2d_t a = contour->points[i];
+        point2d_t b = contour->points[(i + 1) % contour->num_points];
+        area += (double)a.x * b.y - (double)b.x * a.y;
+    }
+    return area * 0.5;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <stl_file> [layer_height]\n", argv[0]);
+        printf("Example: %s test_cube.stl 0.2\n", argv[0]);
+        return 1;
+    }
+    
+    char* filename = argv[1];
+    float layer_height = (argc > 2) ? atof(argv[2]) : 0.2f;
+    
+    printf("Slicer Test Program\n");
+    printf("===================\n\n");
+    
+    // Load STL file
+    printf("Loading STL file: %s\n", filename);
+    stl_file_t* stl = stl_load_file(filename);
+    if (!stl) {
+        fprintf(stderr, "Error: Failed to load STL file\n");
+        return 1;
+    }
+    
+    // Print STL information
+    stl_print_info(stl);
+    printf("\n");
+    
+    // Slice without infill so only contours are generated
+    slicing_params_t params = {0};
+    params.layer_height = layer_height;
+    params.nozzle_diameter = 0.4f;
+    
+    printf("Slicing with layer height %.3f mm...\n", layer_height);
+    sliced_model_t* model = slice_model(stl, &params);
+    if (!model) {
+        fprintf(stderr, "Error: Failed to slice model\n");
+        stl_free(stl);
+        return 1;
+    }
+    
+    // Per-layer contour statistics
+    int total_closed = 0, total_open = 0;
+    for (int i = 0; i < model->num_layers; i++) {
+        const layer_t* layer = &model->layers[i];
+        int closed = 0, open = 0, points = 0;
+        double area = 0.0;
+        
+        for (int j = 0; j < layer->num_contours; j++) {
+            const contour_t* contour = &layer->contours[j];
+            if (contour->closed) {
+                closed++;
+                area += contour_area(contour);
+            } else {
+                open++;
+            }
+            points += contour->num_points;
+        }
+        
+        printf("Layer %d (Z=%.3f): %d closed, %d open, %d points, area %.3f mm^2\n",
+               i + 1, layer->z_height, closed, open, points, area);
+        total_closed += closed;
+        total_open += open;
+    }
+    printf("\n");
+    
+    printf("Total contours: %d closed, %d open\n", total_closed, total_open);
+    if (total_open > 0) {
+        printf("Warning: open contours indicate holes or flipped facets in the mesh\n");
+    }
+    printf("\n");
+    
+    // Cleanup
+    free_sliced_model(model);
+    stl_free(stl);
+    
+    printf("Slicer test completed successfully!\n");
+    return 0;
+}